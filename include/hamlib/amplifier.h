@@ -296,6 +296,9 @@ struct amp_state
   gran_t level_gran[RIG_SETTING_MAX]; /*!< Level granularity. */
   gran_t parm_gran[RIG_SETTING_MAX];  /*!< Parameter granularity. */
   hamlib_port_t ampport;  /*!< Amplifier port (internal use). */
+  double last_level[RIG_SETTING_MAX]; /*!< Last values read by amp_get_level(), for monitoring. */
+  setting_t has_last_level;   /*!< Levels with a value in last_level. */
+  powerstat_t last_powerstat; /*!< Last status read by amp_get_powerstat(). */
 };
 
 
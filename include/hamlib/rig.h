@@ -1763,6 +1763,15 @@ struct rig_spectrum_line
     unsigned char *spectrum_data; /*!< 8-bit spectrum data covering bandwidth of either the span_freq in center mode or from low edge to high edge in fixed mode. A higher value represents higher signal strength. */
 };
 
+/**
+ * \brief State of the keyer buffer, see rig_caps::get_morse_state
+ */
+enum morse_state_e {
+    RIG_MORSE_IDLE = 0,     /*!< Nothing buffered and not sending */
+    RIG_MORSE_SENDING,      /*!< Room left in the buffer, the rig may be sending */
+    RIG_MORSE_FULL          /*!< No room left in the buffer */
+};
+
 /**
  * \brief Rig data structure.
  *
@@ -2085,6 +2094,13 @@ struct rig_caps {
     int (*set_lock_mode)(RIG *rig, int mode);
     int (*get_lock_mode)(RIG *rig, int *mode);
     short timeout_retry;    /*!< number of retries to make in case of read timeout errors, some serial interfaces may require this, 0 to use default value, -1 to disable */
+    /*! ms before a frequency or mode set is read back, 0 to use default value.
+     *  -1 for rigs that round a frequency to their tuning step or reject it,
+     *  e.g. the FT-747 and the Omni VI+: rig_set_freq() reads it back right
+     *  away, so the cache never holds a frequency the rig is not on. */
+    short write_through;
+    int (*get_morse_state)(RIG *rig, vfo_t vfo, int *state);  /*!< Keyer buffer state, enum morse_state_e */
+    int (*set_serial_rate)(RIG *rig, int rate);  /*!< Switch the serial speed of the rig, the port is switched by the caller */
 };
 //! @endcond
 
@@ -2680,6 +2696,29 @@ struct rig_state {
     freq_t spectrum_spans[HAMLIB_MAX_SPECTRUM_SPANS];                   /*!< Supported spectrum scope frequency spans in Hz in center mode. Last entry must be 0. */
     struct rig_spectrum_avg_mode spectrum_avg_modes[HAMLIB_MAX_SPECTRUM_AVG_MODES]; /*!< Supported spectrum scope averaging modes. Last entry must have NULL name. */
     int spectrum_attenuator[HAMLIB_MAXDBLSTSIZ];    /*!< Spectrum attenuator list in dB, 0 terminated */
+    char *spectrum_shm_name;    /*!< POSIX shared memory name for the spectrum line ring, NULL to disable */
+    void *spectrum_ring;        /*!< Spectrum line ring (internal use) */
+    int spectrum_bins;          /*!< Reduce spectrum lines to at most this many bins, 0 to disable */
+    float spectrum_avg;         /*!< Weight of a new spectrum line in the exponential average, 0 to disable */
+    int spectrum_max_hold;      /*!< Pass on the maximum of all spectrum lines since the scope was tuned */
+    float spectrum_rate;        /*!< Maximum spectrum lines per second per scope, 0 for no limit */
+    void *spectrum_proc;        /*!< Spectrum line processing state (internal use) */
+    void *stats;                /*!< Call, cache and port statistics, see rig_stats.h (internal use) */
+    int write_through_ms;       /*!< Serve a set frequency/mode from the cache and read it back after this many ms, 0 to read back right away */
+    vfo_t verify_freq;          /*!< VFOs with a written through frequency not read back yet */
+    vfo_t verify_mode;          /*!< VFOs with a written through mode not read back yet */
+    void *async_set;            /*!< Queue of rig_set_freq_async() et al., see async_set.c (internal use) */
+    int vfo_swap_hold_ms;       /*!< ms a VFO selected for a call on a non-targetable VFO stays selected, 0 to swap back right away */
+    vfo_t vfo_parked;           /*!< VFO left selected on the rig, RIG_VFO_NONE if the rig is on current_vfo */
+    vfo_t vfo_parked_back;      /*!< VFO to swap back to */
+    struct timespec vfo_parked_time;    /*!< When the VFO was left selected */
+    int vfo_parked_depth;       /*!< Call depth the VFO was left selected at, shallower frontend calls do not swap back */
+    void *morse;                /*!< Keyer timing and text of rig_send_morse_queued(), see morse.c (internal use) */
+    void *range_index;          /*!< Sorted index of rx_range_list and tx_range_list, see rangeindex.c (internal use) */
+    char *state_file;           /*!< File the cached state is saved to by rig_close() and loaded from by rig_open(), NULL to disable */
+    int auto_baud;              /*!< 1 to find the serial speed the rig is at when rig_open() gets no answer, 2 to also switch it to the fastest */
+    void *worker;               /*!< Thread running the requests of rig_worker_call(), see rig_worker.c (internal use) */
+    pthread_mutex_t mutex_cache;    /*!< Held while the cache is read or written, recursive, see cache.c (internal use) */
 };
 
 /**
@@ -2938,6 +2977,10 @@ rig_get_freq HAMLIB_PARAMS((RIG *rig,
                             vfo_t vfo,
                             freq_t *freq));
 #endif
+extern HAMLIB_EXPORT(int)
+rig_get_freq_cached HAMLIB_PARAMS((RIG *rig,
+                                   vfo_t vfo,
+                                   freq_t *freq));
 
 extern HAMLIB_EXPORT(int)
 rig_set_mode HAMLIB_PARAMS((RIG *rig,
@@ -2949,6 +2992,11 @@ rig_get_mode HAMLIB_PARAMS((RIG *rig,
                             vfo_t vfo,
                             rmode_t *mode,
                             pbwidth_t *width));
+extern HAMLIB_EXPORT(int)
+rig_get_mode_cached HAMLIB_PARAMS((RIG *rig,
+                                   vfo_t vfo,
+                                   rmode_t *mode,
+                                   pbwidth_t *width));
 
 #if BUILTINFUNC
 #define rig_set_vfo(r,v) rig_set_vfo(r,v,__builtin_FUNCTION())
@@ -2987,6 +3035,10 @@ extern HAMLIB_EXPORT(int)
 rig_get_ptt HAMLIB_PARAMS((RIG *rig,
                            vfo_t vfo,
                            ptt_t *ptt));
+extern HAMLIB_EXPORT(int)
+rig_get_ptt_cached HAMLIB_PARAMS((RIG *rig,
+                                  vfo_t vfo,
+                                  ptt_t *ptt));
 
 extern HAMLIB_EXPORT(int)
 rig_get_dcd HAMLIB_PARAMS((RIG *rig,
@@ -3333,6 +3385,18 @@ extern HAMLIB_EXPORT(int)
 rig_wait_morse HAMLIB_PARAMS((RIG *rig,
                               vfo_t vfo));
 
+extern HAMLIB_EXPORT(int)
+rig_send_morse_queued HAMLIB_PARAMS((RIG *rig,
+                                     vfo_t vfo,
+                                     const char *msg));
+
+extern HAMLIB_EXPORT(int)
+rig_morse_queue_start HAMLIB_PARAMS((RIG *rig,
+                                     void (*sync_cb)(int lock)));
+
+extern HAMLIB_EXPORT(int)
+rig_morse_queue_stop HAMLIB_PARAMS((RIG *rig));
+
 extern HAMLIB_EXPORT(int)
 rig_send_voice_mem HAMLIB_PARAMS((RIG *rig,
                               vfo_t vfo,
@@ -3474,6 +3538,68 @@ rig_set_spectrum_callback HAMLIB_PARAMS((RIG *,
                                          spectrum_cb_t,
                                          rig_ptr_t));
 
+/**
+ * \brief Completion of a queued set, see rig_set_freq_async()
+ */
+typedef void (*async_set_cb_t)(RIG *, int retcode, rig_ptr_t);
+
+extern HAMLIB_EXPORT(int)
+rig_async_set_start HAMLIB_PARAMS((RIG *rig,
+                                   int depth,
+                                   void (*sync_cb)(int lock)));
+extern HAMLIB_EXPORT(int)
+rig_async_set_stop HAMLIB_PARAMS((RIG *rig));
+extern HAMLIB_EXPORT(int)
+rig_async_set_flush HAMLIB_PARAMS((RIG *rig));
+
+extern HAMLIB_EXPORT(int)
+rig_set_freq_async HAMLIB_PARAMS((RIG *rig,
+                                  vfo_t vfo,
+                                  freq_t freq,
+                                  async_set_cb_t cb,
+                                  rig_ptr_t arg));
+extern HAMLIB_EXPORT(int)
+rig_set_mode_async HAMLIB_PARAMS((RIG *rig,
+                                  vfo_t vfo,
+                                  rmode_t mode,
+                                  pbwidth_t width,
+                                  async_set_cb_t cb,
+                                  rig_ptr_t arg));
+extern HAMLIB_EXPORT(int)
+rig_set_level_async HAMLIB_PARAMS((RIG *rig,
+                                   vfo_t vfo,
+                                   setting_t level,
+                                   value_t val,
+                                   async_set_cb_t cb,
+                                   rig_ptr_t arg));
+extern HAMLIB_EXPORT(int)
+rig_set_split_freq_async HAMLIB_PARAMS((RIG *rig,
+                                        vfo_t vfo,
+                                        freq_t tx_freq,
+                                        async_set_cb_t cb,
+                                        rig_ptr_t arg));
+
+/**
+ * \brief Request run by the worker of a rig, see rig_worker_call()
+ */
+typedef int (*rig_worker_func_t)(RIG *, rig_ptr_t);
+
+extern HAMLIB_EXPORT(int)
+rig_worker_start HAMLIB_PARAMS((RIG *rig,
+                                void (*sync_cb)(int lock)));
+extern HAMLIB_EXPORT(int)
+rig_worker_stop HAMLIB_PARAMS((RIG *rig));
+extern HAMLIB_EXPORT(int)
+rig_worker_call HAMLIB_PARAMS((RIG *rig,
+                               rig_worker_func_t func,
+                               rig_ptr_t arg,
+                               int urgent,
+                               int timeout_ms));
+
+extern HAMLIB_EXPORT(int)
+rig_vfo_settle HAMLIB_PARAMS((RIG *rig,
+                              int force));
+
 extern HAMLIB_EXPORT(int)
 rig_set_twiddle HAMLIB_PARAMS((RIG *rig,
                                  int seconds));
@@ -3497,6 +3623,12 @@ rig_get_range HAMLIB_PARAMS((const freq_range_t *range_list,
                              freq_t freq,
                              rmode_t mode));
 
+extern HAMLIB_EXPORT(const freq_range_t *)
+rig_find_range HAMLIB_PARAMS((RIG *rig,
+                              int tx,
+                              freq_t freq,
+                              rmode_t mode));
+
 extern HAMLIB_EXPORT(pbwidth_t)
 rig_passband_normal HAMLIB_PARAMS((RIG *rig,
                                    rmode_t mode));
@@ -3553,7 +3685,7 @@ extern HAMLIB_EXPORT_VAR(char) debugmsgsave3[DEBUGMSGSAVE_SIZE];  // last-2 debu
 
 // Measuring elapsed time -- local variable inside function when macro is used
 #define ELAPSED1 struct timespec __begin; elapsed_ms(&__begin, HAMLIB_ELAPSED_SET);
-#define ELAPSED2 rig_debug(RIG_DEBUG_TRACE, "%.*s%d:%s: elapsed=%.0lfms\n", rig->state.depth-1, spaces(), rig->state.depth, __func__, elapsed_ms(&__begin, HAMLIB_ELAPSED_GET));
+#define ELAPSED2 do { static int __stats_op = -1; rig_debug(RIG_DEBUG_TRACE, "%.*s%d:%s: elapsed=%.0lfms\n", rig->state.depth-1, spaces(), rig->state.depth, __func__, elapsed_ms(&__begin, HAMLIB_ELAPSED_GET)); rig_stats_elapsed(rig, __func__, &__stats_op, &__begin); } while (0)
 
 // use this instead of snprintf for automatic detection of buffer limit
 #define SNPRINTF(s,n,...) { snprintf(s,n,##__VA_ARGS__);if (strlen(s) > n-1) fprintf(stderr,"****** %s(%d): buffer overflow ******\n", __func__, __LINE__); }
@@ -3602,6 +3734,24 @@ rig_probe_all HAMLIB_PARAMS((hamlib_port_t *p,
 extern HAMLIB_EXPORT(rig_model_t)
 rig_probe HAMLIB_PARAMS((hamlib_port_t *p));
 
+/**
+ * \brief A rig found by rig_probe_ports()
+ */
+typedef struct rig_probe_result
+{
+    char pathname[HAMLIB_FILPATHLEN];   /*!< Port the rig answered on */
+    int rate;                           /*!< Serial speed it answered at */
+    rig_model_t model;                  /*!< Model guessed from the answer */
+    int confidence;                     /*!< 1 to 100, models sharing an answer split it */
+} rig_probe_result_t;
+
+extern HAMLIB_EXPORT(int)
+rig_probe_ports HAMLIB_PARAMS((const char *const *pathnames,
+                               int nports,
+                               int time_limit_ms,
+                               rig_probe_result_t *results,
+                               int max_results));
+
 
 /* Misc calls */
 extern HAMLIB_EXPORT(const char *) rig_strrmode(rmode_t mode);
@@ -3643,6 +3793,7 @@ extern HAMLIB_EXPORT(int) rig_set_cache_timeout_ms(RIG *rig, hamlib_cache_t sele
 extern HAMLIB_EXPORT(int) rig_set_vfo_opt(RIG *rig, int status);
 extern HAMLIB_EXPORT(int) rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode, pbwidth_t *width, split_t *split, int *satmode);
 extern HAMLIB_EXPORT(int) rig_get_rig_info(RIG *rig, char *response, int max_response_len);
+extern HAMLIB_EXPORT(void) rig_stats_elapsed(RIG *rig, const char *func, int *op, const struct timespec *begin);
 extern HAMLIB_EXPORT(int) rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int * cache_ms_freq, rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width);
 extern HAMLIB_EXPORT(int) rig_get_cache_freq(RIG *rig, vfo_t vfo, freq_t *freq, int * cache_ms_freq);
 
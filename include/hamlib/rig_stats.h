@@ -0,0 +1,134 @@
+/*
+ *  Hamlib Interface - call, cache and port statistics
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _RIG_STATS_H
+#define _RIG_STATS_H 1
+
+#include <stdint.h>
+#include <hamlib/rig.h>
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file rig_stats.h
+ * \brief Call, cache and port statistics of a rig
+ *
+ * Every rig counts its API calls, cache hits and misses, port reads and
+ * writes, timeouts and retries from rig_init() on.  Latencies go into
+ * histograms with power of 2 buckets in microseconds: bucket i counts
+ * the calls that took less than 2^(i+1) us, the last bucket everything
+ * longer.  rig_get_stats() returns a consistent enough copy at any time;
+ * counting is cheap enough to stay on in production.
+ */
+
+__BEGIN_DECLS
+
+#define RIG_STATS_BUCKETS 24
+
+/**
+ * \brief API calls with their own statistics
+ */
+enum rig_stats_op_e
+{
+    RIG_STATS_OP_SET_FREQ = 0,
+    RIG_STATS_OP_GET_FREQ,
+    RIG_STATS_OP_SET_MODE,
+    RIG_STATS_OP_GET_MODE,
+    RIG_STATS_OP_SET_VFO,
+    RIG_STATS_OP_GET_VFO,
+    RIG_STATS_OP_SET_PTT,
+    RIG_STATS_OP_GET_PTT,
+    RIG_STATS_OP_GET_DCD,
+    RIG_STATS_OP_SET_RPTR_SHIFT,
+    RIG_STATS_OP_GET_RPTR_SHIFT,
+    RIG_STATS_OP_SET_RPTR_OFFS,
+    RIG_STATS_OP_GET_RPTR_OFFS,
+    RIG_STATS_OP_SET_SPLIT_FREQ,
+    RIG_STATS_OP_GET_SPLIT_FREQ,
+    RIG_STATS_OP_SET_SPLIT_MODE,
+    RIG_STATS_OP_GET_SPLIT_MODE,
+    RIG_STATS_OP_SET_SPLIT_FREQ_MODE,
+    RIG_STATS_OP_GET_SPLIT_FREQ_MODE,
+    RIG_STATS_OP_SET_SPLIT_VFO,
+    RIG_STATS_OP_GET_SPLIT_VFO,
+    RIG_STATS_OP_VFO_OP,
+    RIG_STATS_OP_GET_VFO_INFO,
+    RIG_STATS_OP_SET_LEVEL,
+    RIG_STATS_OP_GET_LEVEL,
+    RIG_STATS_OP_SET_FUNC,
+    RIG_STATS_OP_GET_FUNC,
+    RIG_STATS_OP_SET_PARM,
+    RIG_STATS_OP_GET_PARM,
+    RIG_STATS_OP_COUNT
+};
+
+/**
+ * \brief Latency histogram
+ */
+struct rig_stats_hist
+{
+    uint64_t count;                         /*!< Calls */
+    uint64_t total_us;                      /*!< Sum of all latencies */
+    uint64_t bucket[RIG_STATS_BUCKETS];     /*!< Calls faster than 2^(i+1) us, the last one the rest */
+};
+
+/**
+ * \brief Level calls of one setting, see rig_setting2idx()
+ */
+struct rig_stats_setting
+{
+    uint64_t get_count;
+    uint64_t get_us;
+    uint64_t set_count;
+    uint64_t set_us;
+    double value;       /*!< Last value read or set, integer levels converted */
+};
+
+/**
+ * \brief Everything counted for a rig
+ */
+struct rig_stats
+{
+    struct rig_stats_hist op[RIG_STATS_OP_COUNT];   /*!< API calls by enum rig_stats_op_e */
+    uint64_t cache_hit[RIG_STATS_OP_COUNT];         /*!< Answered from the cache */
+    uint64_t cache_miss[RIG_STATS_OP_COUNT];        /*!< Had to ask the rig */
+    struct rig_stats_hist port_write;               /*!< write_block() calls on the rig port */
+    struct rig_stats_hist port_read;                /*!< Reads waiting for the rig */
+    uint64_t timeouts;                              /*!< Reads that timed out */
+    uint64_t retries;                               /*!< Reads retried after a timeout and commands repeated to verify */
+    uint64_t vfo_swaps;                             /*!< VFO selections sent for calls on a non-targetable VFO */
+    uint64_t vfo_swaps_avoided;                     /*!< VFO selections not needed as the VFO was still selected */
+    struct rig_stats_setting level[RIG_SETTING_MAX]; /*!< rig_get_level/rig_set_level by setting */
+};
+
+extern HAMLIB_EXPORT(int) rig_get_stats(RIG *rig, struct rig_stats *stats);
+extern HAMLIB_EXPORT(int) rig_reset_stats(RIG *rig);
+extern HAMLIB_EXPORT(const char *) rig_stats_op_name(int op);
+extern HAMLIB_EXPORT(double) rig_stats_percentile(const struct rig_stats_hist *hist,
+        double q);
+
+__END_DECLS
+
+/** @} */
+
+#endif /* _RIG_STATS_H */
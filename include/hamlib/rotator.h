@@ -507,6 +507,9 @@ struct rot_state {
     int current_speed;      /*!< Current speed 1-100, to be used when no change to speed is requested. */
     hamlib_port_t rotport;  /*!< Rotator port (internal use). */
     hamlib_port_t rotport2;  /*!< 2nd Rotator port (internal use). */
+    azimuth_t last_az;      /*!< Last azimuth read by rot_get_position(), for monitoring. */
+    elevation_t last_el;    /*!< Last elevation read by rot_get_position(), for monitoring. */
+    struct timespec last_position_time; /*!< When last_az and last_el were read, zero before. */
 };
 
 
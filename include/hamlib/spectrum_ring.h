@@ -0,0 +1,103 @@
+/*
+ *  Hamlib Interface - spectrum line shared memory ring
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _SPECTRUM_RING_H
+#define _SPECTRUM_RING_H 1
+
+#include <stdint.h>
+#include <hamlib/rig.h>
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file spectrum_ring.h
+ * \brief Shared memory ring of spectrum scope lines
+ *
+ * When the "spectrum_shm" conf parameter names a POSIX shared memory
+ * object, rig_open() creates it and every spectrum line the rig sends is
+ * written there as a fixed size record before any callback runs.  Other
+ * processes on the same host attach with spectrum_ring_attach() and read
+ * without locks or any help from the writer.
+ *
+ * Each record carries a sequence number, 2 * n + 1 while line n is
+ * being written and 2 * n + 2 once it is complete.  A reader wanting
+ * line n checks the sequence, reads the record and checks the sequence
+ * again; if it changed the writer lapped the reader and the line is
+ * lost.  spectrum_ring_read() does exactly this.
+ */
+
+__BEGIN_DECLS
+
+#define SPECTRUM_RING_MAGIC     0x48535052  /* "HSPR" */
+#define SPECTRUM_RING_VERSION   1
+#define SPECTRUM_RING_RECORDS   64          /* lines kept, a power of 2 */
+
+/**
+ * \brief One spectrum line in the ring, fields as in struct rig_spectrum_line
+ */
+struct spectrum_ring_record
+{
+    volatile uint32_t seq;          /*!< 2 * n + 1 while line n is written, 2 * n + 2 when done */
+    int32_t id;                     /*!< Scope ID */
+    int32_t spectrum_mode;          /*!< enum rig_spectrum_mode_e */
+    int32_t data_level_min;
+    int32_t data_level_max;
+    uint32_t data_length;           /*!< Bytes used in data */
+    double signal_strength_min;
+    double signal_strength_max;
+    double center_freq;
+    double span_freq;
+    double low_edge_freq;
+    double high_edge_freq;
+    uint64_t timestamp_us;          /*!< Wall clock time the line was completed, microseconds since the epoch */
+    unsigned char data[HAMLIB_MAX_SPECTRUM_DATA];
+};
+
+/**
+ * \brief Start of the shared memory object, the records follow it
+ */
+struct spectrum_ring_header
+{
+    uint32_t magic;                 /*!< SPECTRUM_RING_MAGIC */
+    uint32_t version;               /*!< SPECTRUM_RING_VERSION */
+    uint32_t record_size;           /*!< sizeof(struct spectrum_ring_record) */
+    uint32_t record_count;          /*!< Number of records */
+    volatile uint32_t head;         /*!< Lines written so far, line n is in record n % record_count */
+    uint32_t reserved[11];
+    struct spectrum_ring_record records[];
+};
+
+struct spectrum_ring;
+
+extern HAMLIB_EXPORT(struct spectrum_ring *) spectrum_ring_attach(const char *name);
+extern HAMLIB_EXPORT(void) spectrum_ring_detach(struct spectrum_ring *ring);
+extern HAMLIB_EXPORT(const struct spectrum_ring_header *) spectrum_ring_header(
+    const struct spectrum_ring *ring);
+extern HAMLIB_EXPORT(int) spectrum_ring_read(const struct spectrum_ring *ring,
+        uint32_t *cursor, struct rig_spectrum_line *line, unsigned char *data);
+
+__END_DECLS
+
+/** @} */
+
+#endif /* _SPECTRUM_RING_H */
@@ -2690,6 +2690,6 @@ DECLARE_INITRIG_BACKEND(dummy)
     rig_register(&dummy_no_vfo_caps);
     rig_register(&aclog_caps);
     rig_register(&sdrsharp_caps);
-//    rig_register(&tci1x_caps);
+    rig_register(&tci1x_caps);
     return RIG_OK;
 }
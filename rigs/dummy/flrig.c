@@ -116,8 +116,14 @@ struct flrig_priv_data
     float powermeter_scale;  /* So we can scale power meter to 0-1 */
     value_t parms[RIG_SETTING_MAX];
     struct ext_list *ext_parms;
+    int has_multicall; /* True if system.multicall works for the poll set */
+    int resync; /* True if the port must be flushed before the next request */
+    struct timespec snapshot_time[2]; /* VFOA/B freq+mode+bw+ptt last polled */
 };
 
+/* how long one multicall poll answers get_freq/get_mode/get_ptt */
+#define FLRIG_SNAPSHOT_MS 100
+
 /* level's and parm's tokens */
 #define TOK_FLRIG_VERIFY_FREQ    TOKEN_BACKEND(1)
 #define TOK_FLRIG_VERIFY_PTT     TOKEN_BACKEND(2)
@@ -138,7 +144,7 @@ const struct rig_caps flrig_caps =
     RIG_MODEL(RIG_MODEL_FLRIG),
     .model_name = "FLRig",
     .mfg_name = "FLRig",
-    .version = "20230703.0",
+    .version = "20230703.1",
     .copyright = "LGPL",
     .status = RIG_STATUS_STABLE,
     .rig_type = RIG_TYPE_TRANSCEIVER,
@@ -273,7 +279,6 @@ static char *xml_build(RIG *rig, char *cmd, char *value, char *xmlbuf,
                        int xmlbuflen)
 {
     char xml[4096]; // we shouldn't need more the 4096 bytes for this
-    char tmp[32];
     char *header;
 
     // We want at least a 4K buf to play with
@@ -285,102 +290,153 @@ static char *xml_build(RIG *rig, char *cmd, char *value, char *xmlbuf,
 
     header =
         "POST /RPC2 HTTP/1.1\r\n" "User-Agent: XMLRPC++ 0.8\r\n"
-        "Host: 127.0.0.1:12345\r\n" "Content-type: text/xml\r\n";
-    SNPRINTF(xmlbuf, xmlbuflen, "%s", header);
+        "Host: 127.0.0.1:12345\r\n" "Connection: keep-alive\r\n"
+        "Content-type: text/xml\r\n";
 
     SNPRINTF(xml, sizeof(xml),
-             "<?xml version=\"1.0\"?>\r\n<?clientid=\"hamlib(%d)\"?>\r\n",
-             rig->state.rigport.client_port);
-
-    strncat(xml, "<methodCall><methodName>", sizeof(xml) - 1);
-    strncat(xml, cmd, sizeof(xml) - strlen(xml) - 1);
-    strncat(xml, "</methodName>\r\n", sizeof(xml) - strlen(xml) - 1);
+             "<?xml version=\"1.0\"?>\r\n<?clientid=\"hamlib(%d)\"?>\r\n"
+             "<methodCall><methodName>%s</methodName>\r\n%s</methodCall>\r\n",
+             rig->state.rigport.client_port, cmd, value ? value : "");
 
-    if (value && strlen(value) > 0)
-    {
-        strncat(xml, value, sizeof(xml) - 1);
-    }
-
-    strncat(xml, "</methodCall>\r\n", sizeof(xml) - 1);
-    strncat(xmlbuf, "Content-length: ", xmlbuflen - 1);
-    SNPRINTF(tmp, sizeof(tmp), "%d\r\n\r\n", (int)strlen(xml));
-    strncat(xmlbuf, tmp, xmlbuflen - 1);
-    strncat(xmlbuf, xml, xmlbuflen - 1);
+    SNPRINTF(xmlbuf, xmlbuflen, "%sContent-length: %d\r\n\r\n%s", header,
+             (int)strlen(xml), xml);
     return xmlbuf;
 }
 
-/*This is a very crude xml parse specific to what we need from FLRig
-* This works for strings, doubles, I4-type values, and arrays
-* Arrays are returned pipe delimited
+/* what xml_next() stopped at */
+enum xml_token
+{
+    XML_END,
+    XML_SCALAR,     /* s/len hold the text of a scalar <value> */
+    XML_ARRAY,      /* entered an <array>, depth already incremented */
+    XML_STRUCT      /* entered a <struct>, only faults use them here */
+};
+
+struct xml_scan
+{
+    const char *p;  /* where to continue */
+    int depth;      /* <array> nesting */
+    const char *s;  /* scalar text, not terminated */
+    int len;
+};
+
+/*
+* xml_next
+* Walks the <value> elements of an XML-RPC response in place, so no
+* copies and no allocation.  Containers and empty values are stepped
+* into, scalars are returned with surrounding whitespace trimmed.
 */
-static char *xml_parse2(char *xml, char *value, int valueLen)
+static enum xml_token xml_next(struct xml_scan *x)
 {
-    char *delims = "<>\r\n ";
-    char *xmltmp = strdup(xml);
-    //rig_debug(RIG_DEBUG_TRACE, "%s: xml='%s'\n", __func__,xml);
-    char *pr = xml;
-    char *p = strtok_r(xmltmp, delims, &pr);
-    value[0] = 0;
+    static const char *const types[] =
+    {
+        "i4>", "int>", "double>", "string>", "boolean>", NULL
+    };
 
-    while (p)
+    while (x->p && (x->p = strchr(x->p, '<')) != NULL)
     {
-        if (streq(p, "value"))
+        const char *end;
+        int i;
+
+        x->p++;
+
+        if (!strncmp(x->p, "array>", 6))
         {
-            p = strtok_r(NULL, delims, &pr);
+            x->depth++;
+            return XML_ARRAY;
+        }
 
-            if (streq(p, "array")) { continue; }
+        if (!strncmp(x->p, "/array>", 7))
+        {
+            x->depth--;
+            continue;
+        }
 
-            if (streq(p, "/value")) { continue; } // empty value
+        if (!strncmp(x->p, "struct>", 7))
+        {
+            return XML_STRUCT;
+        }
 
-            if (streq(p, "i4") || streq(p, "double") || streq(p, "int")
-                    || streq(p, "string"))
-            {
-                p = strtok_r(NULL, delims, &pr);
-            }
-            else if (streq(p, "array"))
-            {
-                strtok_r(NULL, delims, &pr);
-                p = strtok_r(NULL, delims, &pr);
-            }
+        if (strncmp(x->p, "value>", 6))
+        {
+            continue;
+        }
+
+        x->p += 6;
 
-            if (strlen(value) + strlen(p) + 1 < valueLen)
+        while (*x->p == ' ' || *x->p == '\r' || *x->p == '\n' || *x->p == '\t')
+        {
+            x->p++;
+        }
+
+        if (*x->p == '<')
+        {
+            for (i = 0; types[i]; i++)
             {
-                if (value[0] != 0) { strcat(value, "|"); }
+                int n = strlen(types[i]);
 
-                strcat(value, p);
+                if (!strncmp(x->p + 1, types[i], n))
+                {
+                    x->p += 1 + n;
+                    break;
+                }
             }
-            else   // we'll just stop adding stuff
+
+            if (types[i] == NULL)
             {
-                rig_debug(RIG_DEBUG_ERR, "%s: max value length exceeded\n", __func__);
+                continue;   // container or empty value
             }
         }
-        else
+
+        end = strchr(x->p, '<');
+
+        if (end == NULL)
+        {
+            return XML_END;
+        }
+
+        x->s = x->p;
+        x->len = end - x->p;
+        x->p = end;
+
+        while (x->len > 0 && (x->s[x->len - 1] == ' ' || x->s[x->len - 1] == '\r'
+                              || x->s[x->len - 1] == '\n' || x->s[x->len - 1] == '\t'))
         {
-            p = strtok_r(NULL, delims, &pr);
+            x->len--;
         }
+
+        return XML_SCALAR;
     }
 
-    rig_debug(RIG_DEBUG_TRACE, "%s: value returned='%s'\n", __func__, value);
+    return XML_END;
+}
+
+/* appends a scalar to value, pipe delimited, tracking the length in *n */
+static void xml_append(char *value, int value_len, int *n, const char *s,
+                       int len)
+{
+    int sep = *n > 0;
 
-    if (rig_need_debug(RIG_DEBUG_WARN) && value != NULL && strlen(value) == 0)
+    if (*n + sep + len + 1 > value_len)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: xml='%s'\n", __func__, xml);
+        // we'll just stop adding stuff
+        rig_debug(RIG_DEBUG_ERR, "%s: max value length exceeded\n", __func__);
+        return;
     }
 
-    free(xmltmp);
-    return value;
+    if (sep) { value[(*n)++] = '|'; }
+
+    memcpy(value + *n, s, len);
+    *n += len;
+    value[*n] = 0;
 }
 
 /*
-* xml_parse
-* Assumes xml!=NULL, value!=NULL, value_len big enough
-* returns the string value contained in the xml string
+* xml_body
+* Returns the xml of an HTTP 200 response or NULL
 */
-static char *xml_parse(char *xml, char *value, int value_len)
+static const char *xml_body(const char *xml)
 {
-    char *next;
-    char *pxml;
-
     /* first off we should have an OK on the 1st line */
     if (strstr(xml, " 200 OK") == NULL)
     {
@@ -390,111 +446,196 @@ static char *xml_parse(char *xml, char *value, int value_len)
     rig_debug(RIG_DEBUG_TRACE, "%s XML:\n%s\n", __func__, xml);
 
     // find the xml skipping the other stuff above it
-    pxml = strstr(xml, "<?xml");
+    return strstr(xml, "<?xml");
+}
 
-    if (pxml == NULL)
+/*
+* xml_parse
+* Assumes xml!=NULL, value!=NULL, value_len big enough
+* returns the string value contained in the xml string
+* This works for strings, doubles, I4-type values, and arrays
+* Arrays are returned pipe delimited
+*/
+static char *xml_parse(char *xml, char *value, int value_len)
+{
+    struct xml_scan x = { NULL, 0, NULL, 0 };
+    const char *body = xml_body(xml);
+    enum xml_token t;
+    int n = 0;
+
+    if (body == NULL)
     {
         return (NULL);
     }
 
-    next = strchr(pxml + 1, '<');
+    value[0] = 0;
 
-    if (value != NULL)
+    for (x.p = body; (t = xml_next(&x)) != XML_END;)
     {
-        xml_parse2(next, value, value_len);
+        if (t == XML_SCALAR) { xml_append(value, value_len, &n, x.s, x.len); }
     }
 
-    if (value && strstr(value, "faultString"))
+    if (strstr(body, "<fault>"))
     {
         rig_debug(RIG_DEBUG_ERR, "%s error:\n%s\n", __func__, value);
         value[0] = 0; /* truncate to give empty response */
+        return (value);
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: value returned='%s'\n", __func__, value);
+
+    if (rig_need_debug(RIG_DEBUG_WARN) && n == 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: xml='%s'\n", __func__, xml);
     }
 
     return (value);
 }
 
+/*
+* xml_parse_multicall
+* Splits a system.multicall response into one pipe delimited value per
+* call.  Each result is a one element array, a failed call is a fault
+* struct instead.
+* Returns the number of results or -1 if any call failed
+*/
+static int xml_parse_multicall(char *xml, char values[][MAXARGLEN],
+                               int nvalues)
+{
+    struct xml_scan x = { NULL, 0, NULL, 0 };
+    enum xml_token t;
+    int count = 0;
+    int n = 0;
+
+    x.p = xml_body(xml);
+
+    if (x.p == NULL || strstr(x.p, "<fault>"))
+    {
+        return -1;
+    }
+
+    while ((t = xml_next(&x)) != XML_END)
+    {
+        if (t == XML_STRUCT)
+        {
+            return -1;
+        }
+
+        if (t == XML_ARRAY && x.depth == 2)
+        {
+            if (count == nvalues)
+            {
+                return -1;
+            }
+
+            values[count++][0] = 0;
+            n = 0;
+        }
+        else if (t == XML_SCALAR && x.depth >= 2 && count > 0)
+        {
+            xml_append(values[count - 1], MAXARGLEN, &n, x.s, x.len);
+        }
+    }
+
+    return count;
+}
+
 /*
 * read_transaction
 * Assumes rig!=NULL, xml!=NULL, xml_len>=MAXXMLLEN
+* Reads the status line and headers a line at a time, then the body in
+* one read using the Content-length header.  The connection is kept
+* alive so nothing is left over for the next request unless we lost
+* track of the framing, in which case the port is flushed first.
 */
 static int read_transaction(RIG *rig, char *xml, int xml_len)
 {
-    int retval;
-    int retry;
-    char *delims;
+    int len = 0;
+    int content_length = -1;
     char *terminator = "</methodResponse>";
     struct rig_state *rs = &rig->state;
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rs->priv;
 
     ENTERFUNC;
 
-    retry = 2;
-    delims = "\n";
     xml[0] = 0;
 
-    do
+    for (;;)
     {
-        char tmp_buf[MAXXMLLEN];        // plenty big for expected flrig responses hopefully
+        char *line = xml + len;
+        int n = read_string(&rs->rigport, (unsigned char *) line, xml_len - len - 1,
+                            "\n", 1, 0, 1);
 
-        if (retry < 2)
+        if (n <= 0)
         {
-            rig_debug(RIG_DEBUG_WARN, "%s: retry needed? retry=%d\n", __func__, retry);
+            rig_debug(RIG_DEBUG_ERR, "%s: read_string error=%d\n", __func__, n);
+            break;
         }
 
-        int len = read_string(&rs->rigport, (unsigned char *) tmp_buf, sizeof(tmp_buf),
-                              delims,
-                              strlen(delims), 0, 1);
-        rig_debug(RIG_DEBUG_TRACE, "%s: string='%s'\n", __func__, tmp_buf);
+        rig_debug(RIG_DEBUG_TRACE, "%s: string='%s'\n", __func__, line);
 
         // if our first response we should see the HTTP header
-        if (strlen(xml) == 0 && strstr(tmp_buf, "HTTP/1.1 200 OK") == NULL)
+        if (len == 0 && strncmp(line, "HTTP/1.", 7) != 0)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: Expected 'HTTP/1.1 200 OK', got '%s'\n", __func__,
-                      tmp_buf);
-            continue; // we'll try again
+            rig_debug(RIG_DEBUG_ERR, "%s: Expected 'HTTP/1.1 200 OK', got '%s'\n",
+                      __func__, line);
+            break;
         }
 
-        if (len > 0) { retry = 3; }
+        len += n;
 
-        if (len <= 0)
+        if (len >= xml_len - 1)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: read_string error=%d\n", __func__, len);
-            continue;
+            rig_debug(RIG_DEBUG_ERR, "%s: xml buffer overflow!!\n", __func__);
+            break;
         }
 
-        if (strlen(xml) + strlen(tmp_buf) < xml_len - 1)
+        if (content_length < 0 && strncasecmp(line, "Content-length:", 15) == 0)
         {
-            strncat(xml, tmp_buf, xml_len - 1);
+            content_length = atoi(line + 15);
         }
-        else
+
+        if (line[0] == '\r' || line[0] == '\n')
         {
-            rig_debug(RIG_DEBUG_ERR,
-                      "%s: xml buffer overflow!!\nTrying to add len=%d\nTo len=%d\n", __func__,
-                      (int)strlen(tmp_buf), (int)strlen(xml));
-            RETURNFUNC(-RIG_EPROTO);
+            // end of headers
+            if (content_length < 0)
+            {
+                // no framing, read lines up to the end of the response
+                continue;
+            }
+
+            if (len + content_length >= xml_len)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: xml buffer overflow!!\nContent-length=%d\n",
+                          __func__, content_length);
+                break;
+            }
+
+            n = read_block(&rs->rigport, (unsigned char *) xml + len, content_length);
+
+            if (n != content_length)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: read_block error=%d\n", __func__, n);
+                break;
+            }
+
+            len += n;
+            xml[len] = 0;
+            RETURNFUNC(RIG_OK);
         }
-    }
-    while (retry-- > 0 && strstr(xml, terminator) == NULL);
 
-    if (retry == 0)
-    {
-        rig_debug(RIG_DEBUG_WARN, "%s: retry timeout\n", __func__);
-        RETURNFUNC(-RIG_ETIMEOUT);
+        if (content_length < 0 && strstr(line, terminator))
+        {
+            rig_debug(RIG_DEBUG_TRACE, "%s: got %s\n", __func__, terminator);
+            RETURNFUNC(RIG_OK);
+        }
     }
 
-    if (strstr(xml, terminator))
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: got %s\n", __func__, terminator);
-        // Slow down just a bit -- not sure this is needed anymore but not a big deal here
-        hl_usleep(2 * 1000);
-        retval = RIG_OK;
-    }
-    else
-    {
-        rig_debug(RIG_DEBUG_VERBOSE, "%s: did not get %s\n", __func__, terminator);
-        retval = -(101 + RIG_EPROTO);
-    }
+    // lost the framing, start the next request clean
+    priv->resync = 1;
+    xml[0] = 0;
 
-    RETURNFUNC(retval);
+    RETURNFUNC(-RIG_EPROTO);
 }
 
 /*
@@ -509,6 +650,7 @@ static int write_transaction(RIG *rig, char *xml, int xml_len)
     int retval = -RIG_EPROTO;
 
     struct rig_state *rs = &rig->state;
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rs->priv;
 
     ENTERFUNC;
 
@@ -520,9 +662,13 @@ static int write_transaction(RIG *rig, char *xml, int xml_len)
         RETURNFUNC(retval);
     }
 
-    // appears we can lose sync if we don't clear things out
-    // shouldn't be anything for us now anyways
-    rig_flush(&rig->state.rigport);
+    // responses are framed so the port only needs clearing out when
+    // a read failed and something may still be on its way
+    if (priv->resync)
+    {
+        rig_flush(&rig->state.rigport);
+        priv->resync = 0;
+    }
 
     while (try-- >= 0 && retval != RIG_OK)
         {
@@ -553,6 +699,15 @@ static int flrig_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
         value[0] = 0;
     }
 
+    // anything but a query may change what the last poll saw
+    if (strncmp(cmd, "rig.get_", 8) != 0 && strncmp(cmd, "main.get_", 9) != 0)
+    {
+        struct flrig_priv_data *priv = (struct flrig_priv_data *) rig->state.priv;
+
+        elapsed_ms(&priv->snapshot_time[0], HAMLIB_ELAPSED_INVALIDATE);
+        elapsed_ms(&priv->snapshot_time[1], HAMLIB_ELAPSED_INVALIDATE);
+    }
+
     do
     {
         char *pxml;
@@ -716,6 +871,102 @@ static rmode_t modeMapGetHamlib(const char *modeFLRig)
     return (RIG_MODE_NONE);
 }
 
+#define FLRIG_CALL(method) \
+    "<value><struct><member><name>methodName</name><value>" method \
+    "</value></member><member><name>params</name><value><array><data>" \
+    "</data></array></value></member></struct></value>"
+
+/*
+* flrig_snapshot
+* Polls freq, mode, bandwidth and ptt of a VFO in one system.multicall
+* round trip and keeps them in priv for FLRIG_SNAPSHOT_MS, so a client
+* polling them one after another only waits on flrig once.
+* Returns -RIG_ENAVAIL if the caller has to query flrig itself
+*/
+static int flrig_snapshot(RIG *rig, vfo_t vfo)
+{
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rig->state.priv;
+    char xml[MAXXMLLEN];
+    char params[2048];
+    char values[4][MAXARGLEN];
+    const char *ab = vfo == RIG_VFO_B ? "B" : "A";
+    int i = vfo == RIG_VFO_B ? 1 : 0;
+    char *pxml;
+    char *p;
+    int retval;
+
+    ENTERFUNC;
+
+    if (!priv->has_multicall || rig->state.cache.timeout_ms == 0)
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    if (elapsed_ms(&priv->snapshot_time[i], HAMLIB_ELAPSED_GET)
+            < FLRIG_SNAPSHOT_MS)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+    SNPRINTF(params, sizeof(params),
+             "<params><param><value><array><data>"
+             FLRIG_CALL("rig.get_vfo%s") FLRIG_CALL("rig.get_mode%s")
+             FLRIG_CALL("rig.get_bw%s") FLRIG_CALL("rig.get_ptt")
+             "</data></array></value></param></params>", ab, ab, ab);
+
+    set_transaction_active(rig);
+
+    pxml = xml_build(rig, "system.multicall", params, xml, sizeof(xml));
+    retval = write_transaction(rig, pxml, strlen(pxml));
+
+    if (retval == RIG_OK)
+    {
+        retval = read_transaction(rig, xml, sizeof(xml));
+    }
+
+    set_transaction_inactive(rig);
+
+    if (retval != RIG_OK)
+    {
+        elapsed_ms(&priv->snapshot_time[i], HAMLIB_ELAPSED_INVALIDATE);
+        RETURNFUNC(retval);
+    }
+
+    if (xml_parse_multicall(xml, values, 4) != 4 || atof(values[0]) == 0)
+    {
+        rig_debug(RIG_DEBUG_WARN,
+                  "%s: system.multicall not usable, polling one call at a time\n", __func__);
+        priv->has_multicall = 0;
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    // we might get two bandwidth values and then we want the 2nd one
+    p = strchr(values[2], '|');
+    p = p ? p + 1 : values[2];
+
+    if (i == 0)
+    {
+        priv->curr_freqA = atof(values[0]);
+        priv->curr_modeA = modeMapGetHamlib(values[1]);
+        priv->curr_widthA = atoi(p);
+    }
+    else
+    {
+        priv->curr_freqB = atof(values[0]);
+        priv->curr_modeB = modeMapGetHamlib(values[1]);
+        priv->curr_widthB = atoi(p);
+    }
+
+    priv->ptt = atoi(values[3]);
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: vfo%s freq=%s mode=%s bw=%s ptt=%s\n",
+              __func__, ab, values[0], values[1], values[2], values[3]);
+
+    elapsed_ms(&priv->snapshot_time[i], HAMLIB_ELAPSED_SET);
+
+    RETURNFUNC(RIG_OK);
+}
+
 
 /*
 * modeMapAdd
@@ -790,6 +1041,9 @@ static int flrig_open(RIG *rig)
     ENTERFUNC;
     rig_debug(RIG_DEBUG_VERBOSE, "%s version %s\n", __func__, rig->caps->version);
 
+    priv->has_multicall = 0;
+    priv->resync = 1;
+
     retval = flrig_transaction(rig, "main.get_version", NULL, value, sizeof(value));
 
     if (retval != RIG_OK)
@@ -1045,6 +1299,16 @@ static int flrig_open(RIG *rig)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s: hamlib modes=%s\n", __func__, value);
 
+    /* see if we can poll freq+mode+bw+ptt in one request */
+    priv->has_multicall = priv->has_get_modeA && priv->has_get_bwA;
+    elapsed_ms(&priv->snapshot_time[0], HAMLIB_ELAPSED_INVALIDATE);
+    elapsed_ms(&priv->snapshot_time[1], HAMLIB_ELAPSED_INVALIDATE);
+
+    if (flrig_snapshot(rig, rig->state.current_vfo) == RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: system.multicall is available\n", __func__);
+    }
+
     rig_get_split_vfo(rig, RIG_VFO_A, &split, &tx_vfo);
 
     RETURNFUNC(retval);
@@ -1134,6 +1398,13 @@ static int flrig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
                   __func__, rig_strvfo(vfo));
     }
 
+    if (flrig_snapshot(rig, vfo) == RIG_OK)
+    {
+        *freq = vfo == RIG_VFO_B ? priv->curr_freqB : priv->curr_freqA;
+        rig_debug(RIG_DEBUG_TRACE, "%s: freq=%.0f\n", __func__, *freq);
+        RETURNFUNC(RIG_OK);
+    }
+
     char *cmd = vfo == RIG_VFO_A ? "rig.get_vfoA" : "rig.get_vfoB";
     int retval;
 
@@ -1300,6 +1571,12 @@ static int flrig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
     int retval;
 
+    if (flrig_snapshot(rig, rig->state.current_vfo) == RIG_OK)
+    {
+        *ptt = priv->ptt;
+        RETURNFUNC(RIG_OK);
+    }
+
     retval = flrig_transaction(rig, "rig.get_ptt", NULL, value, sizeof(value));
 
     if (retval != RIG_OK)
@@ -1619,6 +1896,15 @@ static int flrig_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
         RETURNFUNC(RIG_OK);  // just return OK and ignore this
     }
 
+    if (flrig_snapshot(rig, vfo) == RIG_OK)
+    {
+        *mode = vfo == RIG_VFO_B ? priv->curr_modeB : priv->curr_modeA;
+        *width = vfo == RIG_VFO_B ? priv->curr_widthB : priv->curr_widthA;
+        rig_debug(RIG_DEBUG_TRACE, "%s: mode=%s width=%d\n", __func__,
+                  rig_strrmode(*mode), (int) *width);
+        RETURNFUNC(RIG_OK);
+    }
+
     // Switch to VFOB if appropriate
     vfoSwitched = 0;
 
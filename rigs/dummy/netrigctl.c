@@ -23,12 +23,19 @@
 #include <stdlib.h>
 #include <string.h>  /* String function definitions */
 #include <unistd.h>  /* UNIX standard function definitions */
+#include <errno.h>
 
 #include "hamlib/rig.h"
 #include "serial.h"
 #include "iofunc.h"
 #include "misc.h"
 #include "num_stdio.h"
+#include "network.h"
+#include "event.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
 
 #include "dummy.h"
 
@@ -43,8 +50,22 @@ struct netrigctl_priv_data
     int rigctld_vfo_mode;
     vfo_t rx_vfo;
     vfo_t tx_vfo;
+    int subscribe_available;    /* rigctld advertised \subscribe in dump_state */
+#ifdef HAVE_PTHREAD
+    hamlib_port_t subscribe_port; /* second connection carrying pushed events */
+    pthread_t subscribe_thread;
+    volatile int subscribe_run;
+#endif
+    volatile int subscribe_active;
+    volatile int subscribe_have;  /* NETRIGCTL_HAVE_* values pushed so far */
+    ptt_t subscribe_ptt;
+    split_t subscribe_split;
+    vfo_t subscribe_split_vfo;
 };
 
+#define NETRIGCTL_HAVE_PTT   0x01
+#define NETRIGCTL_HAVE_SPLIT 0x02
+
 int netrigctl_get_vfo_mode(RIG *rig)
 {
     struct netrigctl_priv_data *priv;
@@ -244,6 +265,191 @@ int parse_array_double(const char *s, const char *delim, double *array,
 
 
 
+/*
+ * rigctld pushes "event <item> <vfo> <value...>" lines on the subscription
+ * connection, feed them into the cache exactly like transceive data
+ */
+static void netrigctl_subscription_event(RIG *rig, char *buf)
+{
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
+    char item[16], vfostr[16], arg1[64], arg2[64];
+    vfo_t vfo;
+    int n;
+
+    strtok(buf, "\r\n"); // chop the EOL
+
+    n = sscanf(buf, "event %15s %15s %63s %63s", item, vfostr, arg1, arg2);
+
+    if (n < 3)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: unexpected line '%s'\n", __func__, buf);
+        return;
+    }
+
+    vfo = rig_parse_vfo(vfostr);
+
+    if (strcmp(item, "freq") == 0)
+    {
+        rig_fire_freq_event(rig, vfo, atof(arg1));
+    }
+    else if (strcmp(item, "mode") == 0 && n == 4)
+    {
+        rig_fire_mode_event(rig, vfo, rig_parse_mode(arg1), atol(arg2));
+    }
+    else if (strcmp(item, "ptt") == 0)
+    {
+        priv->subscribe_ptt = atoi(arg1);
+        priv->subscribe_have |= NETRIGCTL_HAVE_PTT;
+        rig_fire_ptt_event(rig, vfo, priv->subscribe_ptt);
+    }
+    else if (strcmp(item, "split") == 0 && n == 4)
+    {
+        priv->subscribe_split = atoi(arg1);
+        priv->subscribe_split_vfo = rig_parse_vfo(arg2);
+        priv->subscribe_have |= NETRIGCTL_HAVE_SPLIT;
+        rig->state.cache.split = priv->subscribe_split;
+        rig->state.cache.split_vfo = priv->subscribe_split_vfo;
+        elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_SET);
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: ignoring '%s'\n", __func__, buf);
+    }
+}
+
+#ifdef HAVE_PTHREAD
+static void *netrigctl_subscription_thread(void *arg)
+{
+    RIG *rig = (RIG *)arg;
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
+    char buf[BUF_MAX];
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    while (priv->subscribe_run)
+    {
+        int ret = read_string(&priv->subscribe_port, (unsigned char *) buf, BUF_MAX,
+                              "\n", 1, 1, 1);
+
+        if (ret == -RIG_ETIMEOUT)
+        {
+            continue;
+        }
+
+        if (ret <= 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: subscription lost: %s\n", __func__,
+                      rigerror(ret));
+            break;
+        }
+
+        netrigctl_subscription_event(rig, buf);
+    }
+
+    /* nothing keeps the cache fresh any more, go back to polling */
+    priv->subscribe_active = 0;
+    priv->subscribe_have = 0;
+    rig->state.use_cached_freq = 0;
+    rig->state.use_cached_mode = 0;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+#endif
+
+/*
+ * Open a second connection to rigctld and subscribe to freq/mode/ptt/split
+ * so the cache stays current without polling.  Failure is not fatal, we
+ * simply keep polling like older rigctld versions require.
+ */
+static int netrigctl_subscription_start(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
+    hamlib_port_t *sp = &priv->subscribe_port;
+    static const char cmd[] = "\\subscribe freq,mode,ptt,split\n";
+    char buf[BUF_MAX];
+    int ret;
+
+    ENTERFUNC;
+
+    memcpy(sp, &rig->state.rigport, sizeof(*sp));
+    sp->fd = -1;
+    sp->asyncio = 0;
+    sp->timeout = 500;
+    sp->timeout_retry = 0;
+    sp->retry = 0;
+    sp->write_delay = 0;
+    sp->post_write_delay = 0;
+
+    ret = network_open(sp, 4532);
+
+    if (ret != RIG_OK)
+    {
+        RETURNFUNC(ret);
+    }
+
+    ret = write_block(sp, (unsigned char *) cmd, strlen(cmd));
+
+    if (ret == RIG_OK)
+    {
+        ret = read_string(sp, (unsigned char *) buf, BUF_MAX, "\n", 1, 0, 1);
+    }
+
+    if (ret > 0 && strncmp(buf, NETRIGCTL_RET "0", strlen(NETRIGCTL_RET) + 1) != 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: subscribe refused: %s", __func__, buf);
+        ret = -RIG_ENAVAIL;
+    }
+
+    if (ret <= 0)
+    {
+        network_close(sp);
+        RETURNFUNC(ret < 0 ? ret : -RIG_EPROTO);
+    }
+
+    priv->subscribe_have = 0;
+    priv->subscribe_run = 1;
+    priv->subscribe_active = 1;
+
+    if (pthread_create(&priv->subscribe_thread, NULL,
+                       netrigctl_subscription_thread, rig))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        priv->subscribe_run = 0;
+        priv->subscribe_active = 0;
+        network_close(sp);
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
+
+    RETURNFUNC(RIG_OK);
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+static void netrigctl_subscription_stop(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
+
+    if (!priv->subscribe_run)
+    {
+        return;
+    }
+
+    priv->subscribe_run = 0;
+    pthread_join(priv->subscribe_thread, NULL);
+    network_close(&priv->subscribe_port);
+#endif
+}
+
 static int netrigctl_open(RIG *rig)
 {
     int ret, i;
@@ -258,6 +464,7 @@ static int netrigctl_open(RIG *rig)
 
     priv = (struct netrigctl_priv_data *)rig->state.priv;
     priv->rx_vfo = RIG_VFO_A;
+    priv->subscribe_available = 0;
     priv->tx_vfo = RIG_VFO_B;
 
     SNPRINTF(cmd, sizeof(cmd), "\\chk_vfo\n");
@@ -657,7 +864,17 @@ static int netrigctl_open(RIG *rig)
             RETURNFUNC((ret < 0) ? ret : -RIG_EPROTO);
         }
 
-        if (strncmp(buf, "done", 4) == 0) { RETURNFUNC(RIG_OK); }
+        if (strncmp(buf, "done", 4) == 0)
+        {
+            if (priv->subscribe_available
+                    && netrigctl_subscription_start(rig) != RIG_OK)
+            {
+                rig_debug(RIG_DEBUG_WARN, "%s: no subscription, polling instead\n",
+                          __func__);
+            }
+
+            RETURNFUNC(RIG_OK);
+        }
 
         if (sscanf(buf, "%31[^=]=%1023[^\t\n]", setting, value) == 2)
         {
@@ -775,6 +992,10 @@ static int netrigctl_open(RIG *rig)
             {
                 rig_debug(RIG_DEBUG_TRACE, "%s: rig_model=%s\n", __func__, value);
             }
+            else if (strcmp(setting, "subscribe") == 0)
+            {
+                priv->subscribe_available = atoi(value);
+            }
             else if (strcmp(setting, "rigctld_version") == 0)
             {
                 rig_debug(RIG_DEBUG_TRACE, "%s: rigctld_version=%s\n", __func__, value);
@@ -914,6 +1135,8 @@ static int netrigctl_close(RIG *rig)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    netrigctl_subscription_stop(rig);
+
     ret = netrigctl_transaction(rig, "q\n", 2, buf);
 
     if (ret != RIG_OK)
@@ -1168,10 +1391,16 @@ static int netrigctl_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
     {
         return -RIG_EPROTO;
     }
-    else
+
+    if (ret == RIG_OK)
     {
-        return ret;
+        struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                           rig->state.priv;
+        /* don't wait for the push to see our own change */
+        priv->subscribe_ptt = ptt;
     }
+
+    return ret;
 }
 
 
@@ -1181,9 +1410,17 @@ static int netrigctl_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
     char cmd[CMD_MAX];
     char buf[BUF_MAX];
     char vfostr[16] = "";
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    if (priv->subscribe_active && (priv->subscribe_have & NETRIGCTL_HAVE_PTT))
+    {
+        *ptt = priv->subscribe_ptt;
+        return RIG_OK;
+    }
+
     ret = netrigctl_vfostr(rig, vfostr, sizeof(vfostr), RIG_VFO_A);
 
     if (ret != RIG_OK) { return ret; }
@@ -1716,10 +1953,17 @@ static int netrigctl_set_split_vfo(RIG *rig, vfo_t vfo, split_t split,
     {
         return -RIG_EPROTO;
     }
-    else
+
+    if (ret == RIG_OK)
     {
-        return ret;
+        struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                           rig->state.priv;
+        /* don't wait for the push to see our own change */
+        priv->subscribe_split = split;
+        priv->subscribe_split_vfo = tx_vfo;
     }
+
+    return ret;
 }
 
 
@@ -1730,9 +1974,18 @@ static int netrigctl_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split,
     char cmd[CMD_MAX];
     char buf[BUF_MAX];
     char vfostr[16] = "";
+    struct netrigctl_priv_data *priv = (struct netrigctl_priv_data *)
+                                       rig->state.priv;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    if (priv->subscribe_active && (priv->subscribe_have & NETRIGCTL_HAVE_SPLIT))
+    {
+        *split = priv->subscribe_split;
+        *tx_vfo = priv->subscribe_split_vfo;
+        return RIG_OK;
+    }
+
     ret = netrigctl_vfostr(rig, vfostr, sizeof(vfostr), RIG_VFO_A);
 
     if (ret != RIG_OK) { return ret; }
@@ -19,14 +19,24 @@
 *
 */
 
+#include <hamlib/config.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>             /* String function definitions */
+#include <errno.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include <hamlib/rig.h>
 #include <serial.h>
 #include <misc.h>
 #include <token.h>
+#include "network.h"
+#include "event.h"
 
 #include "dummy_common.h"
 
@@ -48,11 +58,24 @@
 
 #define TCI_VFOS (RIG_VFO_A|RIG_VFO_B)
 
-#define TCI1X_MODES (RIG_MODE_USB | RIG_MODE_LSB | RIG_MODE_FM | RIG_MODE_AM)
-
-#define TCI1X_LEVELS (RIG_LEVEL_AF | RIG_LEVEL_RF | RIG_LEVEL_MICGAIN | RIG_LEVEL_STRENGTH | RIG_LEVEL_RFPOWER_METER | RIG_LEVEL_RFPOWER_METER_WATTS | RIG_LEVEL_RFPOWER)
-
-#define TCI1X_PARM (TOK_TCI1X_VERIFY_FREQ|TOK_TCI1X_VERIFY_PTT)
+#define TCI1X_MODES (RIG_MODE_AM | RIG_MODE_SAM | RIG_MODE_DSB | RIG_MODE_LSB \
+                     | RIG_MODE_USB | RIG_MODE_CW | RIG_MODE_FM | RIG_MODE_WFM \
+                     | RIG_MODE_PKTLSB | RIG_MODE_PKTUSB | RIG_MODE_SPEC)
+
+/* values the server has pushed to us, see tci1x_notification */
+#define TCI1X_HAVE_FREQA  0x01
+#define TCI1X_HAVE_FREQB  0x02
+#define TCI1X_HAVE_MODE   0x04
+#define TCI1X_HAVE_WIDTH  0x08
+#define TCI1X_HAVE_PTT    0x10
+#define TCI1X_HAVE_SPLIT  0x20
+#define TCI1X_HAVE_READY  0x40
+#define TCI1X_HAVE_SMETER 0x80
+#define TCI1X_HAVE_TXMETER 0x100
+#define TCI1X_HAVE_DRIVE  0x200
+
+#define TCI1X_LEVELS (RIG_LEVEL_STRENGTH | RIG_LEVEL_SWR | RIG_LEVEL_RFPOWER \
+                      | RIG_LEVEL_RFPOWER_METER_WATTS)
 
 #define streq(s1,s2) (strcmp(s1,s2)==0)
 
@@ -71,6 +94,8 @@ static int tci1x_get_vfo(RIG *rig, vfo_t *vfo);
 static int tci1x_set_vfo(RIG *rig, vfo_t vfo);
 static int tci1x_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt);
 static int tci1x_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt);
+static int tci1x_get_level(RIG *rig, vfo_t vfo, setting_t level,
+                           value_t *val);
 static int tci1x_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq);
 static int tci1x_get_split_freq(RIG *rig, vfo_t vfo, freq_t *tx_freq);
 static int tci1x_set_split_vfo(RIG *rig, vfo_t vfo, split_t split,
@@ -81,13 +106,6 @@ static int tci1x_set_split_freq_mode(RIG *rig, vfo_t vfo, freq_t freq,
                                      rmode_t mode, pbwidth_t width);
 static int tci1x_get_split_freq_mode(RIG *rig, vfo_t vfo, freq_t *freq,
                                      rmode_t *mode, pbwidth_t *width);
-#ifdef XXNOTIMPLEMENTED
-static int tci1x_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val);
-static int tci1x_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val);
-
-static int tci1x_set_ext_parm(RIG *rig, token_t token, value_t val);
-static int tci1x_get_ext_parm(RIG *rig, token_t token, value_t *val);
-#endif
 
 static const char *tci1x_get_info(RIG *rig);
 static int tci1x_power2mW(RIG *rig, unsigned int *mwpower, float power,
@@ -111,25 +129,21 @@ struct tci1x_priv_data
     pbwidth_t curr_widthB;
     int has_get_modeA; /* True if this function is available */
     int has_get_bwA; /* True if this function is available */
-    int has_verify_cmds; // has the verify cmd in FLRig 1.3.54.1 or higher
     float powermeter_scale;  /* So we can scale power meter to 0-1 */
-    value_t parms[RIG_SETTING_MAX];
-    struct ext_list *ext_parms;
-};
-
-/* level's and parm's tokens */
-#define TOK_TCI1X_VERIFY_FREQ    TOKEN_BACKEND(1)
-#define TOK_TCI1X_VERIFY_PTT     TOKEN_BACKEND(2)
-
-static const struct confparams tci1x_ext_parms[] =
-{
-    {
-        TOK_TCI1X_VERIFY_FREQ, "VERIFY_FREQ", "Verify set_freq", "If true will verify set_freq otherwise is fire and forget", "0", RIG_CONF_CHECKBUTTON, {}
-    },
-    {
-        TOK_TCI1X_VERIFY_PTT, "VERIFY_PTT", "Verify set_ptt", "If true will verify set_ptt otherwise set_ptt is fire and forget", "0", RIG_CONF_CHECKBUTTON, {}
-    },
-    { RIG_CONF_END, NULL, }
+    int trx_count;
+    int receive_only;
+    int strength;                   /* dB relative to S9 */
+    float swr;
+    float power_watts;
+    float drive;                    /* 0-1 */
+    volatile int have;              /* TCI1X_HAVE_* */
+    volatile int receive_active;    /* receive thread keeps priv current */
+#ifdef HAVE_PTHREAD
+    pthread_t receive_thread;
+    volatile int receive_run;
+    pthread_mutex_t lock;           /* protects have */
+    pthread_cond_t changed;         /* have gained a bit */
+#endif
 };
 
 const struct rig_caps tci1x_caps =
@@ -137,13 +151,13 @@ const struct rig_caps tci1x_caps =
     RIG_MODEL(RIG_MODEL_TCI1X),
     .model_name = "TCI1.X",
     .mfg_name = "Expert Elec",
-    .version = "20211125.0",
+    .version = "20261018.0",
     .copyright = "LGPL",
     .status = RIG_STATUS_ALPHA,
     .rig_type = RIG_TYPE_TRANSCEIVER,
     .targetable_vfo =  RIG_TARGETABLE_FREQ | RIG_TARGETABLE_MODE,
     .ptt_type = RIG_PTT_RIG,
-    .port_type = RIG_PORT_SERIAL,
+    .port_type = RIG_PORT_NETWORK,
     .write_delay = 0,
     .post_write_delay = 0,
     .timeout = 1000,
@@ -152,9 +166,9 @@ const struct rig_caps tci1x_caps =
     .has_get_func = RIG_FUNC_NONE,
     .has_set_func = RIG_FUNC_NONE,
     .has_get_level = TCI1X_LEVELS,
-    .has_set_level = RIG_LEVEL_SET(TCI1X_LEVELS),
-    .has_get_parm =    TCI1X_PARM,
-    .has_set_parm =    RIG_PARM_SET(TCI1X_PARM),
+    .has_set_level = RIG_LEVEL_NONE,
+    .has_get_parm =    RIG_PARM_NONE,
+    .has_set_parm =    RIG_PARM_NONE,
 
     .filters =  {
         {RIG_MODE_ALL, RIG_FLT_ANY},
@@ -178,8 +192,6 @@ const struct rig_caps tci1x_caps =
     .tuning_steps =  { {TCI1X_MODES, 1}, {TCI1X_MODES, RIG_TS_ANY}, RIG_TS_END, },
     .priv = NULL,               /* priv */
 
-    .extparms =     tci1x_ext_parms,
-
     .rig_init = tci1x_init,
     .rig_open = tci1x_open,
     .rig_close = tci1x_close,
@@ -194,6 +206,7 @@ const struct rig_caps tci1x_caps =
     .get_info =      tci1x_get_info,
     .set_ptt = tci1x_set_ptt,
     .get_ptt = tci1x_get_ptt,
+    .get_level = tci1x_get_level,
     .set_split_mode = tci1x_set_split_mode,
     .set_split_freq = tci1x_set_split_freq,
     .get_split_freq = tci1x_get_split_freq,
@@ -201,43 +214,30 @@ const struct rig_caps tci1x_caps =
     .get_split_vfo = tci1x_get_split_vfo,
     .set_split_freq_mode = tci1x_set_split_freq_mode,
     .get_split_freq_mode = tci1x_get_split_freq_mode,
-#ifdef XXNOTIMPLEMENTED
-    .set_level = tci1x_set_level,
-    .get_level = tci1x_get_level,
-    .set_ext_parm =  tci1x_set_ext_parm,
-    .get_ext_parm =  tci1x_get_ext_parm,
-#endif
     .power2mW =   tci1x_power2mW,
     .mW2power =   tci1x_mW2power,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
 };
 
-//Structure for mapping tci1x dynmamic modes to hamlib modes
-//tci1x displays modes as the rig displays them
-struct s_modeMap
+/* TCI modulation names, the server lists the ones it has in modulations_list */
+static const struct
 {
     rmode_t mode_hamlib;
-    char *mode_tci1x;
-};
-
-//FLRig will provide us the modes for the selected rig
-//We will then put them in this struct
-static struct s_modeMap modeMap[] =
+    const char *mode_tci1x;
+} modeMap[] =
 {
-    {RIG_MODE_USB, NULL},
-    {RIG_MODE_LSB, NULL},
-    {RIG_MODE_PKTUSB, NULL},
-    {RIG_MODE_PKTLSB, NULL},
-    {RIG_MODE_AM, NULL},
-    {RIG_MODE_FM, NULL},
-    {RIG_MODE_FMN, NULL},
-    {RIG_MODE_WFM, NULL},
-    {RIG_MODE_CW, NULL},
-    {RIG_MODE_CWR, NULL},
-    {RIG_MODE_RTTY, NULL},
-    {RIG_MODE_RTTYR, NULL},
-    {RIG_MODE_C4FM, NULL},
-    {0, NULL}
+    {RIG_MODE_AM, "AM"},
+    {RIG_MODE_SAM, "SAM"},
+    {RIG_MODE_DSB, "DSB"},
+    {RIG_MODE_LSB, "LSB"},
+    {RIG_MODE_USB, "USB"},
+    {RIG_MODE_CW, "CW"},
+    {RIG_MODE_FM, "NFM"},
+    {RIG_MODE_WFM, "WFM"},
+    {RIG_MODE_PKTLSB, "DIGL"},
+    {RIG_MODE_PKTUSB, "DIGU"},
+    {RIG_MODE_SPEC, "SPEC"},
+    {RIG_MODE_NONE, NULL}
 };
 
 /*
@@ -266,151 +266,418 @@ static int check_vfo(vfo_t vfo)
 }
 
 /*
-*
-* read_transaction
-* Assumes rig!=NULL, buf!=NULL, buf_len big enough to hold response
+* modeMapGetTCI
+* Return the TCI modulation for the given hamlib mode or NULL
 */
-static int read_transaction(RIG *rig, unsigned char *buf, int buf_len)
+static const char *modeMapGetTCI(rmode_t modeHamlib)
 {
-    int retry;
-    struct rig_state *rs = &rig->state;
-    char *delims = ";";
-
-    ENTERFUNC;
-
-    retry = 0;
+    int i;
 
-    do
+    for (i = 0; modeMap[i].mode_tci1x != NULL; ++i)
     {
-        if (retry < 2)
+        if (modeMap[i].mode_hamlib == modeHamlib)
         {
-            rig_debug(RIG_DEBUG_WARN, "%s: retry needed? retry=%d\n", __func__, retry);
+            return (modeMap[i].mode_tci1x);
         }
+    }
 
-        int len = read_string(&rs->rigport, buf, buf_len, delims,
-                              strlen(delims), 0, 1);
-        rig_debug(RIG_DEBUG_TRACE, "%s: string='%s'\n", __func__, buf);
+    rig_debug(RIG_DEBUG_ERR, "%s: TCI does not have mode: %s\n", __func__,
+              rig_strrmode(modeHamlib));
+    return (NULL);
+}
+
+/*
+* modeMapGetHamlib
+* Assumes mode!=NULL
+* Return the hamlib mode from the given TCI string
+*/
+static rmode_t modeMapGetHamlib(const char *modeTCI)
+{
+    int i;
 
-        if (len <= 0)
+    for (i = 0; modeMap[i].mode_tci1x != NULL; ++i)
+    {
+        if (strcasecmp(modeMap[i].mode_tci1x, modeTCI) == 0)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: read_string error=%d\n", __func__, len);
-            continue;
+            return (modeMap[i].mode_hamlib);
         }
-
     }
-    while (retry-- > 0 && strlen((char *) buf) == 0);
 
-    if (retry == 0)
-    {
-        rig_debug(RIG_DEBUG_WARN, "%s: retry timeout\n", __func__);
-        RETURNFUNC(-RIG_ETIMEOUT);
-    }
+    rig_debug(RIG_DEBUG_TRACE, "%s: mode requested: %s, not in modeMap\n", __func__,
+              modeTCI);
+    return (RIG_MODE_NONE);
+}
 
-    RETURNFUNC(RIG_OK);
+/* a value pushed by the server is now in priv, wake anyone waiting for it */
+static void tci1x_have(RIG *rig, int have)
+{
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&priv->lock);
+    priv->have |= have;
+    pthread_cond_broadcast(&priv->changed);
+    pthread_mutex_unlock(&priv->lock);
+#else
+    priv->have |= have;
+#endif
+}
+
+/* the values in priv are about to change, wait for the server to say so */
+static void tci1x_forget(RIG *rig, int have)
+{
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&priv->lock);
+    priv->have &= ~have;
+    pthread_mutex_unlock(&priv->lock);
+#else
+    priv->have &= ~have;
+#endif
+}
+
+static int tci1x_bool(const char *s)
+{
+    return strncasecmp(s, "true", 4) == 0;
 }
 
 /*
-* write_transaction
-* Assumes rig!=NULL, xml!=NULL, xml_len=total size of xml for response
+* tci1x_notification
+* One "name:args" command from the server.  Answers to our queries look
+* exactly like the notifications it pushes on its own, so both end up here
+* and go straight into priv and the rig cache.
 */
-static int write_transaction(RIG *rig, unsigned char *buf, int buf_len)
+static void tci1x_notification(RIG *rig, const char *name, const char *args)
 {
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    struct rig_state *rs = &rig->state;
+    char s[64];
+    int rx, ch, low, high;
+    double f;
 
-    int try = rig->caps->retry;
+    if (strcasecmp(name, "vfo") == 0
+            && sscanf(args, "%d,%d,%lf", &rx, &ch, &f) == 3 && rx == 0)
+    {
+        if (ch == 0)
+        {
+            priv->curr_freqA = f;
+            tci1x_have(rig, TCI1X_HAVE_FREQA);
+        }
+        else
+        {
+            priv->curr_freqB = f;
+            tci1x_have(rig, TCI1X_HAVE_FREQB);
+        }
 
-    int retval = -RIG_EPROTO;
+        rig_fire_freq_event(rig, ch == 0 ? RIG_VFO_A : RIG_VFO_B, f);
+    }
+    else if (strcasecmp(name, "modulation") == 0
+             && sscanf(args, "%d,%63[^,]", &rx, s) == 2 && rx == 0)
+    {
+        // the modulation belongs to the receiver, both its VFOs use it
+        priv->curr_modeA = priv->curr_modeB = modeMapGetHamlib(s);
+        tci1x_have(rig, TCI1X_HAVE_MODE);
+        rig_fire_mode_event(rig, RIG_VFO_A, priv->curr_modeA,
+                            priv->have & TCI1X_HAVE_WIDTH ? priv->curr_widthA : 0);
+    }
+    else if (strcasecmp(name, "rx_filter_band") == 0
+             && sscanf(args, "%d,%d,%d", &rx, &low, &high) == 3 && rx == 0)
+    {
+        priv->curr_widthA = priv->curr_widthB = high - low;
+        tci1x_have(rig, TCI1X_HAVE_WIDTH);
 
-    struct rig_state *rs = &rig->state;
+        if (priv->have & TCI1X_HAVE_MODE)
+        {
+            rig_fire_mode_event(rig, RIG_VFO_A, priv->curr_modeA, priv->curr_widthA);
+        }
+    }
+    else if (strcasecmp(name, "trx") == 0
+             && sscanf(args, "%d,%63[^,]", &rx, s) == 2 && rx == 0)
+    {
+        priv->ptt = tci1x_bool(s) ? RIG_PTT_ON : RIG_PTT_OFF;
 
-    ENTERFUNC;
+        if (priv->ptt == RIG_PTT_OFF)
+        {
+            // the tx meters stop with the transmitter
+            priv->power_watts = 0;
+            priv->swr = 1;
+        }
 
-    // This shouldn't ever happen...but just in case
-    // We need to avoid an empty write as rigctld replies with blank line
-    if (buf_len == 0)
+        tci1x_have(rig, TCI1X_HAVE_PTT);
+        rig_fire_ptt_event(rig, RIG_VFO_A, priv->ptt);
+    }
+    else if (strcasecmp(name, "split_enable") == 0
+             && sscanf(args, "%d,%63[^,]", &rx, s) == 2 && rx == 0)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: len==0??\n", __func__);
-        RETURNFUNC(retval);
+        priv->split = tci1x_bool(s) ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+        rs->cache.split = priv->split;
+        rs->cache.split_vfo = RIG_VFO_B;
+        elapsed_ms(&rs->cache.time_split, HAMLIB_ELAPSED_SET);
+        tci1x_have(rig, TCI1X_HAVE_SPLIT);
+    }
+    else if ((strcasecmp(name, "rx_sensors") == 0
+              && sscanf(args, "%d,%lf", &rx, &f) == 2 && rx == 0)
+             || (strcasecmp(name, "rx_smeter") == 0
+                 && sscanf(args, "%d,%d,%lf", &rx, &ch, &f) == 3 && rx == 0
+                 && ch == 0))
+    {
+        // dBm, S9 is -73 dBm
+        priv->strength = (int)(f + 73 + (f > -73 ? 0.5 : -0.5));
+        tci1x_have(rig, TCI1X_HAVE_SMETER);
+    }
+    else if (strcasecmp(name, "tx_sensors") == 0)
+    {
+        double mic, rms, peak, swr;
+
+        // receiver, mic level dB, rms and peak power W, SWR
+        if (sscanf(args, "%d,%lf,%lf,%lf,%lf", &rx, &mic, &rms, &peak, &swr) == 5
+                && rx == 0)
+        {
+            priv->power_watts = rms;
+            priv->swr = swr;
+            tci1x_have(rig, TCI1X_HAVE_TXMETER);
+        }
     }
+    else if (strcasecmp(name, "drive") == 0)
+    {
+        // "drive:value" before TCI 1.6, "drive:trx,value" since
+        int n = sscanf(args, "%d,%lf", &rx, &f);
 
-    // appears we can lose sync if we don't clear things out
-    // shouldn't be anything for us now anyways
-    rig_flush(&rig->state.rigport);
+        if (n == 1 || (n == 2 && rx == 0))
+        {
+            priv->drive = (n == 1 ? rx : f) / 100.0;
+            tci1x_have(rig, TCI1X_HAVE_DRIVE);
+        }
+    }
+    else if (strcasecmp(name, "device") == 0)
+    {
+        SNPRINTF(priv->info, sizeof(priv->info), "%s", args);
+    }
+    else if (strcasecmp(name, "receive_only") == 0)
+    {
+        priv->receive_only = tci1x_bool(args);
+    }
+    else if (strcasecmp(name, "trx_count") == 0)
+    {
+        priv->trx_count = atoi(args);
+    }
+    else if (strcasecmp(name, "modulations_list") == 0)
+    {
+        const char *p = args;
+        rmode_t modes = 0;
 
-    while (try-- >= 0 && retval != RIG_OK)
+        while (sscanf(p, "%63[^,]", s) == 1)
         {
-            retval = write_block(&rs->rigport, buf, buf_len);
+            modes |= modeMapGetHamlib(s);
+            p += strlen(s);
 
-            if (retval  < 0)
-            {
-                RETURNFUNC(-RIG_EIO);
-            }
+            if (*p != ',') { break; }
+
+            p++;
         }
 
-    RETURNFUNC(retval);
+        rs->mode_list = modes;
+    }
+    else if (strcasecmp(name, "ready") == 0)
+    {
+        tci1x_have(rig, TCI1X_HAVE_READY);
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: ignoring %s:%s\n", __func__, name, args);
+    }
 }
 
-static int tci1x_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
-                             int value_len)
+/*
+* tci1x_process
+* A WebSocket text message, normally one ';' terminated command but
+* several are allowed
+*/
+static void tci1x_process(RIG *rig, char *msg)
 {
-    int retry = 0;
-    unsigned char frame[1024];
+    char *save = NULL;
+    char *cmd;
 
-    ENTERFUNC;
+    rig_debug(RIG_DEBUG_TRACE, "%s: '%s'\n", __func__, msg);
+
+    for (cmd = strtok_r(msg, ";", &save); cmd; cmd = strtok_r(NULL, ";", &save))
+    {
+        char *args;
+
+        while (*cmd == ' ' || *cmd == '\r' || *cmd == '\n') { cmd++; }
+
+        if (*cmd == 0) { continue; }
+
+        args = strchr(cmd, ':');
+
+        if (args) { *args++ = 0; }
+
+        tci1x_notification(rig, cmd, args ? args : "");
+    }
+}
+
+/*
+* tci1x_read
+* Reads and processes one message, only used when no receive thread runs
+*/
+static int tci1x_read(RIG *rig)
+{
+    unsigned char buf[MAXBUFLEN];
+    int opcode;
+    int ret;
 
-    memset(frame, 0, sizeof(frame));
+    ret = network_ws_read(&rig->state.rigport, buf, sizeof(buf), &opcode);
 
-    if (value)
+    if (ret >= 0 && opcode == NETWORK_WS_TEXT)
     {
-        value[0] = 0;
+        tci1x_process(rig, (char *) buf);
     }
 
-    frame[0] = 0x81;
-    frame[1] = strlen(cmd);
-    frame[2] = 0x00;
-    frame[3] = 0x00;
-    frame[4] = 0x00;
-    frame[5] = 0x00;
-    frame[6] = 0x00;
-    frame[7] = 0x00;
-    frame[8] = 0x00;
-    frame[9] = 0x00;
-    frame[10] = 0x00;
-    frame[11] = 0x00;
-    strcat((char *) &frame[12], cmd);
+    return ret < 0 ? ret : RIG_OK;
+}
+
+#ifdef HAVE_PTHREAD
+static void *tci1x_receive_thread(void *arg)
+{
+    RIG *rig = (RIG *)arg;
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    unsigned char buf[MAXBUFLEN];
 
-    do
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    while (priv->receive_run)
     {
-        int retval;
+        int opcode;
+        int ret = network_ws_read(&rig->state.rigport, buf, sizeof(buf), &opcode);
 
-        if (retry < 2)
+        if (ret == -RIG_ETIMEOUT)
         {
-            rig_debug(RIG_DEBUG_VERBOSE, "%s: cmd=%s, retry=%d\n", __func__, cmd, retry);
+            continue;
         }
 
-        retval = write_transaction(rig, frame, strlen(cmd) + 12);
+        if (ret < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: connection lost: %s\n", __func__,
+                      rigerror(ret));
+            break;
+        }
 
-        if (retval != RIG_OK)
+        if (opcode == NETWORK_WS_TEXT)
+        {
+            tci1x_process(rig, (char *) buf);
+        }
+    }
+
+    /* nothing keeps priv and the cache fresh any more */
+    pthread_mutex_lock(&priv->lock);
+    priv->receive_active = 0;
+    priv->have = 0;
+    pthread_cond_broadcast(&priv->changed);
+    pthread_mutex_unlock(&priv->lock);
+    rig->state.use_cached_freq = 0;
+    rig->state.use_cached_mode = 0;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+#endif
+
+/*
+* tci1x_wait
+* Waits until the server has pushed all the values in want
+*/
+static int tci1x_wait(RIG *rig, int want)
+{
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    int retval = RIG_OK;
+
+#ifdef HAVE_PTHREAD
+
+    if (priv->receive_active)
+    {
+        struct timespec ts;
+        int timeout = rig->state.rigport.timeout;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += timeout / 1000;
+        ts.tv_nsec += (timeout % 1000) * 1000000L;
+
+        if (ts.tv_nsec >= 1000000000L)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: write_transaction error=%d\n", __func__, retval);
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
 
-            // if we get RIG_EIO the socket has probably disappeared
-            // so bubble up the error so port can re re-opened
-            if (retval == -RIG_EIO) { RETURNFUNC(retval); }
+        pthread_mutex_lock(&priv->lock);
 
-            hl_usleep(50 * 1000); // 50ms sleep if error
+        while ((priv->have & want) != want && priv->receive_active)
+        {
+            if (pthread_cond_timedwait(&priv->changed, &priv->lock, &ts) == ETIMEDOUT)
+            {
+                break;
+            }
         }
 
-        read_transaction(rig, (unsigned char *) value, value_len);
+        retval = (priv->have & want) == want ? RIG_OK : -RIG_ETIMEOUT;
+        pthread_mutex_unlock(&priv->lock);
+
+        return retval;
+    }
 
-        rig_debug(RIG_DEBUG_VERBOSE, "%s: value=%s\n", __func__, value);
+#endif
 
+    // nobody else reads the socket so do it here
+    while ((priv->have & want) != want && retval == RIG_OK)
+    {
+        retval = tci1x_read(rig);
     }
-    while ((value && (strlen(value) == 0))
-            && retry--); // we'll do retries if needed
 
-    if (value && strlen(value) == 0) { RETURNFUNC(RIG_EPROTO); }
+    return retval;
+}
 
-    RETURNFUNC(RIG_OK);
+/*
+* tci1x_transaction
+* Sends a command.  TCI has no replies as such, the server pushes the new
+* state instead, so when want is non-zero wait for those values.  They
+* are forgotten first so a set only returns once the server confirmed it.
+*/
+static int tci1x_transaction(RIG *rig, const char *cmd, int want)
+{
+    int retval;
+
+    ENTERFUNC;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: cmd=%s\n", __func__, cmd);
+
+    tci1x_forget(rig, want);
+
+    retval = network_ws_write(&rig->state.rigport, NETWORK_WS_TEXT,
+                              (const unsigned char *) cmd, strlen(cmd));
+
+    if (retval != RIG_OK || want == 0)
+    {
+        RETURNFUNC(retval);
+    }
+
+    RETURNFUNC(tci1x_wait(rig, want));
+}
+
+/*
+* tci1x_query
+* Sends the query unless the server already pushed the values
+*/
+static int tci1x_query(RIG *rig, const char *cmd, int want)
+{
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+
+    if (priv->receive_active && (priv->have & want) == want)
+    {
+        return RIG_OK;
+    }
+
+    return tci1x_transaction(rig, cmd, want);
 }
 
 /*
@@ -435,7 +702,6 @@ static int tci1x_init(RIG *rig)
     priv = rig->state.priv;
 
     memset(priv, 0, sizeof(struct tci1x_priv_data));
-    memset(priv->parms, 0, RIG_SETTING_MAX * sizeof(value_t));
 
     /*
      * set arbitrary initial status
@@ -447,6 +713,13 @@ static int tci1x_init(RIG *rig)
     priv->curr_modeB = -1;
     priv->curr_widthA = -1;
     priv->curr_widthB = -1;
+    priv->powermeter_scale = 1;
+    priv->swr = 1;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_init(&priv->lock, NULL);
+    pthread_cond_init(&priv->changed, NULL);
+#endif
 
     if (!rig->caps)
     {
@@ -456,345 +729,100 @@ static int tci1x_init(RIG *rig)
     strncpy(rig->state.rigport.pathname, DEFAULTPATH,
             sizeof(rig->state.rigport.pathname));
 
-    priv->ext_parms = alloc_init_ext(tci1x_ext_parms);
-
-    if (!priv->ext_parms)
-    {
-        RETURNFUNC(-RIG_ENOMEM);
-    }
-
-
     RETURNFUNC(RIG_OK);
 }
 
 /*
-* modeMapGetTCI
-* Assumes mode!=NULL
-* Return the string for TCI for the given hamlib mode
+* tci1x_receive_start
+* Reads everything the server pushes on a thread of its own so gets are
+* answered from priv without a round trip.  Failure is not fatal, the
+* callers then read the socket themselves.
 */
-static const char *modeMapGetTCI(rmode_t modeHamlib)
+static int tci1x_receive_start(RIG *rig)
 {
-    int i;
+#ifdef HAVE_PTHREAD
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
-    rig_debug(RIG_DEBUG_TRACE, "%s: called\n", __func__);
+    priv->receive_run = 1;
+    priv->receive_active = 1;
 
-    for (i = 0; modeMap[i].mode_hamlib != 0; ++i)
+    if (pthread_create(&priv->receive_thread, NULL, tci1x_receive_thread, rig))
     {
-        if (modeMap[i].mode_tci1x == NULL) { continue; }
-
-        rig_debug(RIG_DEBUG_TRACE,
-                  "%s: checking modeMap[%d]=%.0f to modeHamlib=%.0f, mode_tci1x='%s'\n", __func__,
-                  i, (double)modeMap[i].mode_hamlib, (double)modeHamlib, modeMap[i].mode_tci1x);
-
-        if (modeMap[i].mode_hamlib == modeHamlib && strlen(modeMap[i].mode_tci1x) > 0)
-        {
-            rig_debug(RIG_DEBUG_TRACE, "%s matched mode=%.0f, returning '%s'\n", __func__,
-                      (double)modeHamlib, modeMap[i].mode_tci1x);
-            return (modeMap[i].mode_tci1x);
-        }
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        priv->receive_run = 0;
+        priv->receive_active = 0;
+        return -RIG_EINTERNAL;
     }
 
-    rig_debug(RIG_DEBUG_ERR, "%s: FlRig does not have mode: %s\n", __func__,
-              rig_strrmode(modeHamlib));
-    return ("ERROR");
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
 }
 
-/*
-* modeMapGetHamlib
-* Assumes mode!=NULL
-* Return the hamlib mode from the given TCI string
-*/
-static rmode_t modeMapGetHamlib(const char *modeTCI)
+static void tci1x_receive_stop(RIG *rig)
 {
-    int i;
-    char modeTCICheck[MAXBUFLEN + 2];
-
-    SNPRINTF(modeTCICheck, sizeof(modeTCICheck), "|%s|", modeTCI);
+#ifdef HAVE_PTHREAD
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
-    for (i = 0; modeMap[i].mode_hamlib != 0; ++i)
+    if (!priv->receive_run)
     {
-        rig_debug(RIG_DEBUG_TRACE, "%s: find '%s' in '%s'\n", __func__,
-                  modeTCICheck, modeMap[i].mode_tci1x);
-
-        if (modeMap[i].mode_tci1x
-                && strcmp(modeMap[i].mode_tci1x, modeTCICheck) == 0)
-        {
-            return (modeMap[i].mode_hamlib);
-        }
+        return;
     }
 
-    rig_debug(RIG_DEBUG_TRACE, "%s: mode requested: %s, not in modeMap\n", __func__,
-              modeTCI);
-    return (RIG_MODE_NONE);
+    // the server answers the close frame so the thread does not sit out a timeout
+    priv->receive_run = 0;
+    network_ws_write(&rig->state.rigport, NETWORK_WS_CLOSE,
+                     (const unsigned char *) "\x03\xe8", 2);
+    pthread_join(priv->receive_thread, NULL);
+#endif
 }
 
-
 /*
-* modeMapAdd
-* Assumes modes!=NULL
+* tci1x_open
+* Assumes rig!=NULL, rig->state.priv!=NULL
 */
-static void modeMapAdd(rmode_t *modes, rmode_t mode_hamlib, char *mode_tci1x)
+static int tci1x_open(RIG *rig)
 {
-    int i;
-    int len1;
+    int retval;
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
-    rig_debug(RIG_DEBUG_TRACE, "%s:mode_tci1x=%s\n", __func__, mode_tci1x);
+    ENTERFUNC;
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: version %s\n", __func__, rig->caps->version);
 
-    // if we already have it just return
-    // We get ERROR if the mode is not known so non-ERROR is OK
-    if (modeMapGetHamlib(mode_tci1x) != RIG_MODE_NONE) { return; }
+    priv->have = 0;
 
-    len1 = strlen(mode_tci1x) + 3; /* bytes needed for allocating */
+    retval = network_ws_handshake(&rig->state.rigport, "/");
 
-    for (i = 0; modeMap[i].mode_hamlib != 0; ++i)
+    if (retval != RIG_OK)
     {
-        if (modeMap[i].mode_hamlib == mode_hamlib)
-        {
-            int len2;
-            *modes |= modeMap[i].mode_hamlib;
-
-            /* we will pipe delimit all the entries for easier matching */
-            /* all entries will have pipe symbol on both sides */
-            if (modeMap[i].mode_tci1x == NULL)
-            {
-                modeMap[i].mode_tci1x = calloc(1, len1);
-
-                if (modeMap[i].mode_tci1x == NULL)
-                {
-                    rig_debug(RIG_DEBUG_ERR, "%s: error allocating memory for modeMap\n",
-                              __func__);
-                    return;
-                }
-            }
+        RETURNFUNC(retval);
+    }
 
-            len2 = strlen(modeMap[i].mode_tci1x); /* current len w/o null */
-            modeMap[i].mode_tci1x = realloc(modeMap[i].mode_tci1x,
-                                            strlen(modeMap[i].mode_tci1x) + len1);
+    if (tci1x_receive_start(rig) == RIG_OK)
+    {
+        // the meters are only pushed on request
+        tci1x_transaction(rig, "rx_sensors_enable:true,200;"
+                          "tx_sensors_enable:true,200;", 0);
+    }
 
-            if (strlen(modeMap[i].mode_tci1x) == 0) { modeMap[i].mode_tci1x[0] = '|'; }
+    // after the handshake the server pushes its whole state and then "ready;"
+    retval = tci1x_wait(rig, TCI1X_HAVE_READY);
 
-            strncat(modeMap[i].mode_tci1x, mode_tci1x, len1 + len2);
-            strncat(modeMap[i].mode_tci1x, "|", len1 + len2);
-            rig_debug(RIG_DEBUG_TRACE, "%s: Adding mode=%s, index=%d, result=%s\n",
-                      __func__, mode_tci1x, i, modeMap[i].mode_tci1x);
-            return;
-        }
+    if (retval != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: no ready from the server: %s\n", __func__,
+                  rigerror(retval));
     }
-}
 
-/*
-* tci1x_open
-* Assumes rig!=NULL, rig->state.priv!=NULL
-*/
-static int tci1x_open(RIG *rig)
-{
-    int retval;
-    int trx_count = 0;
-    char value[MAXBUFLEN];
-    char arg[MAXBUFLEN];
-    rmode_t modes;
-    char *p;
-    char *pr;
-    //struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: version %s\n", __func__, rig->caps->version);
-    char *websocket =
-        "GET / HTTP/1.1\r\nHost: localhost:50001\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: TnwnvtFT6akIBYQC7nh3vA==\r\nSec-WebSocket-Version: 13\r\n\r\n";
-
-    write_transaction(rig, (unsigned char *) websocket, strlen(websocket));
-
-    do
-    {
-        retval = read_transaction(rig, (unsigned char *) value, sizeof(value));
-        rig_debug(RIG_DEBUG_VERBOSE, "%s: value=%s\n", __func__, value);
-    }
-    while (retval == RIG_OK && strlen(value) > 0);
-
-    retval = tci1x_transaction(rig, "device;", NULL, value, sizeof(value));
-    dump_hex((unsigned char *)value, strlen(value));
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: DEVICE failed: %s\n", __func__,
-                  rigerror(retval));
-        // we fall through and assume old version
-    }
-
-    sscanf(&value[2], "device:%s", value);
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: TCI Device is %s\n", __func__, arg);
-
-    // Receive only
-    retval = tci1x_transaction(rig, "receive_only;", NULL, value, sizeof(value));
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: RECEIVE_ONLY failed: %s\n", __func__,
-                  rigerror(retval));
-    }
-
-    sscanf(&value[2], "receive_only:%s", value);
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: readonly is %s\n", __func__, arg);
-
-    // TRX count
-    retval = tci1x_transaction(rig, "trx_count;", NULL, value, sizeof(value));
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: TRX_COUNT failed..not fatal: %s\n", __func__,
-                  rigerror(retval));
-    }
-
-    sscanf(&value[2], "trx_count:%d", &trx_count);
-    rig_debug(RIG_DEBUG_VERBOSE, "Trx count=%d\n", trx_count);
-
-    freq_t freq;
-    retval = tci1x_get_freq(rig, RIG_VFO_CURR, &freq);
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: tci1x_get_freq not working!!\n", __func__);
-    }
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: TCI Device is %s, trx_count=%d%s\n",
+              __func__, priv->info, priv->trx_count,
+              priv->receive_only ? ", receive only" : "");
 
     rig->state.current_vfo = RIG_VFO_A;
-    rig_debug(RIG_DEBUG_TRACE, "%s: currvfo=%s value=%s\n", __func__,
-              rig_strvfo(rig->state.current_vfo), value);
-    //tci1x_get_split_vfo(rig, vfo, &priv->split, &vfo_tx);
-    RETURNFUNC2(RIG_OK);
-
-    /* find out available widths and modes */
-    retval = tci1x_transaction(rig, "modulations_list;", NULL, value,
-                               sizeof(value));
-
-    if (retval != RIG_OK) { RETURNFUNC2(retval); }
-
-    sscanf(&value[2], "modulations_list:%s", arg);
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: modes=%s\n", __func__, arg);
-    modes = 0;
-    pr = value;
-
-    /* The following modes in TCI are not implemented yet
-        A1A
-        AM-2
-        AM6.0
-        AM-D1 -- doesn't appear to be read/set
-        AM-D2 -- doesn't appear to be read/set
-        AM-D3 -- doesn't appear to be read/set
-        AMW -- don't have mode in rig.h
-        CW2.4 -- could be CW
-        CW500 -- could be CWN but CWN not in rig.h
-        CW-N -- could be CWN but CWN not in rig.h
-        CWN -- dcould be CWN but CWN not in rig.h
-        CW-NR -- don't have mode in rig.h
-        DATA2-LSB
-        DV
-        DV-R
-        F1B
-        FM-D1 -- doesn't appear to be read/set
-        FM-D2 -- doesn't appear to be read/set
-        FM-D3 -- doesn't appear to be read/set
-        H3E
-        M11
-        USB-D -- doesn't appear to be read/set
-        USB-D1 -- doesn't appear to be read/set
-        USB-D2 -- doesn't appear to be read/set
-        USB-D3 -- doesn't appear to be read/set
-        USER-L -- doesn't appear to be read/set
-        USER-U -- doesn't appear to be read/set
-    */
-
-    for (p = strtok_r(value, ",", &pr); p != NULL; p = strtok_r(NULL, ",", &pr))
-    {
-        if (streq(p, "AM-D")) { modeMapAdd(&modes, RIG_MODE_PKTAM, p); }
-        else if (streq(p, "AM")) { modeMapAdd(&modes, RIG_MODE_AM, p); }
-        else if (streq(p, "AM-N")) { modeMapAdd(&modes, RIG_MODE_AMN, p); }
-        else if (streq(p, "AMN")) { modeMapAdd(&modes, RIG_MODE_AMN, p); }
-        else if (streq(p, "CW")) { modeMapAdd(&modes, RIG_MODE_CW, p); }
-        else if (streq(p, "CW-L")) { modeMapAdd(&modes, RIG_MODE_CWR, p); }
-        else if (streq(p, "CW-LSB")) { modeMapAdd(&modes, RIG_MODE_CWR, p); }
-        else if (streq(p, "CW-R")) { modeMapAdd(&modes, RIG_MODE_CWR, p); }
-        else if (streq(p, "CW-U")) { modeMapAdd(&modes, RIG_MODE_CW, p); }
-        else if (streq(p, "CW-USB")) { modeMapAdd(&modes, RIG_MODE_CW, p); }
-        else if (streq(p, "CWL")) { modeMapAdd(&modes, RIG_MODE_CWR, p); }
-        else if (streq(p, "CWU")) { modeMapAdd(&modes, RIG_MODE_CW, p); }
-        else if (streq(p, "D-LSB")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "D-USB")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DATA")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DATA-FM")) { modeMapAdd(&modes, RIG_MODE_PKTFM, p); }
-        else if (streq(p, "DATA-L")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "DATA-R")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "DATA-LSB")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "DATA-USB")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DATA-U")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DIG")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DIGI")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DIGL")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "DIGU")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "DSB")) { modeMapAdd(&modes, RIG_MODE_DSB, p); }
-        else if (streq(p, "FM")) { modeMapAdd(&modes, RIG_MODE_FM, p); }
-        else if (streq(p, "FM-D")) { modeMapAdd(&modes, RIG_MODE_PKTFM, p); }
-        else if (streq(p, "FMN")) { modeMapAdd(&modes, RIG_MODE_FMN, p); }
-        else if (streq(p, "FM-N")) { modeMapAdd(&modes, RIG_MODE_FMN, p); }
-        else if (streq(p, "FMW")) { modeMapAdd(&modes, RIG_MODE_WFM, p); }
-        else if (streq(p, "FSK")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "FSK-R")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "LCW")) { modeMapAdd(&modes, RIG_MODE_CWR, p); }
-        else if (streq(p, "LSB")) { modeMapAdd(&modes, RIG_MODE_LSB, p); }
-        else if (streq(p, "LSB-D")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "LSB-D1")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "LSB-D2")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "LSB-D3")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "NFM")) { modeMapAdd(&modes, RIG_MODE_FMN, p); }
-        else if (streq(p, "PKT")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "PKT-FM")) { modeMapAdd(&modes, RIG_MODE_PKTFM, p); }
-        else if (streq(p, "PKT-L")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "PKT-U")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "PKT(L)")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "PKT(U)")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "PSK")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "PSK-L")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "PSK-R")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "PSK-U")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "RTTY")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "RTTY-L")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "RTTY-R")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "RTTY-U")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "RTTY(U)")) { modeMapAdd(&modes, RIG_MODE_RTTY, p); }
-        else if (streq(p, "RTTY(R")) { modeMapAdd(&modes, RIG_MODE_RTTYR, p); }
-        else if (streq(p, "SAH")) { modeMapAdd(&modes, RIG_MODE_SAH, p); }
-        else if (streq(p, "SAL")) { modeMapAdd(&modes, RIG_MODE_SAL, p); }
-        else if (streq(p, "SAM")) { modeMapAdd(&modes, RIG_MODE_SAM, p); }
-        else if (streq(p, "USB")) { modeMapAdd(&modes, RIG_MODE_USB, p); }
-        else if (streq(p, "USB-D")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "USB-D1")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "USB-D2")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "USB-D3")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "USER-U")) { modeMapAdd(&modes, RIG_MODE_PKTUSB, p); }
-        else if (streq(p, "USER-L")) { modeMapAdd(&modes, RIG_MODE_PKTLSB, p); }
-        else if (streq(p, "W-FM")) { modeMapAdd(&modes, RIG_MODE_WFM, p); }
-        else if (streq(p, "WFM")) { modeMapAdd(&modes, RIG_MODE_WFM, p); }
-        else if (streq(p, "UCW")) { modeMapAdd(&modes, RIG_MODE_CW, p); }
-        else if (streq(p, "C4FM")) { modeMapAdd(&modes, RIG_MODE_C4FM, p); }
-        else if (streq(p, "SPEC")) { modeMapAdd(&modes, RIG_MODE_SPEC, p); }
-        else if (streq(p, "DRM")) // we don't support DRM yet (or maybe ever)
-        {
-            rig_debug(RIG_DEBUG_VERBOSE, "%s: no mapping for mode %s\n", __func__, p);
-        }
-        else { rig_debug(RIG_DEBUG_ERR, "%s: Unknown mode (new?) for this rig='%s'\n", __func__, p); }
-    }
-
-    rig->state.mode_list = modes;
-
-    retval = rig_strrmodes(modes, value, sizeof(value));
-
-    if (retval != RIG_OK)   // we might get TRUNC but we can still print the debug
-    {
-        rig_debug(RIG_DEBUG_VERBOSE, "%s: %s\n", __func__, rigerror(retval));
-    }
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: hamlib modes=%s\n", __func__, value);
 
-    RETURNFUNC2(retval);
+    RETURNFUNC(RIG_OK);
 }
 
 /*
@@ -805,6 +833,8 @@ static int tci1x_close(RIG *rig)
 {
     ENTERFUNC;
 
+    tci1x_receive_stop(rig);
+
     RETURNFUNC(RIG_OK);
 }
 
@@ -825,7 +855,11 @@ static int tci1x_cleanup(RIG *rig)
 
     priv = (struct tci1x_priv_data *)rig->state.priv;
 
-    free(priv->ext_parms);
+#ifdef HAVE_PTHREAD
+    pthread_cond_destroy(&priv->changed);
+    pthread_mutex_destroy(&priv->lock);
+#endif
+
     free(rig->state.priv);
 
     rig->state.priv = NULL;
@@ -839,8 +873,9 @@ static int tci1x_cleanup(RIG *rig)
 */
 static int tci1x_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 {
-    char value[MAXARGLEN];
+    char cmd[MAXARGLEN];
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    int retval;
 
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
@@ -861,11 +896,10 @@ static int tci1x_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
                   __func__, rig_strvfo(vfo));
     }
 
-    char *cmd = vfo == RIG_VFO_A ? "vfo:0:0;" : "vfo:0:1:";
-    int retval;
-    int n;
+    SNPRINTF(cmd, sizeof(cmd), "vfo:0,%d;", vfo == RIG_VFO_A ? 0 : 1);
 
-    retval = tci1x_transaction(rig, cmd, NULL, value, sizeof(value));
+    retval = tci1x_query(rig, cmd,
+                         vfo == RIG_VFO_A ? TCI1X_HAVE_FREQA : TCI1X_HAVE_FREQB);
 
     if (retval != RIG_OK)
     {
@@ -874,29 +908,15 @@ static int tci1x_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
         RETURNFUNC(retval);
     }
 
-    n = sscanf(&value[2], "vfo:%*d,%*d,%lf", freq);
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: got '%s', scanned %d items\n", __func__,
-              value, n);
+    *freq = vfo == RIG_VFO_A ? priv->curr_freqA : priv->curr_freqB;
 
     if (*freq == 0)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: freq==0??\nvalue=%s\n", __func__,
-                  value);
+        rig_debug(RIG_DEBUG_ERR, "%s: freq==0??\n", __func__);
         RETURNFUNC(-RIG_EPROTO);
     }
-    else
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: freq=%.0f\n", __func__, *freq);
-    }
 
-    if (vfo == RIG_VFO_A)
-    {
-        priv->curr_freqA = *freq;
-    }
-    else
-    {
-        priv->curr_freqB = *freq;
-    }
+    rig_debug(RIG_DEBUG_TRACE, "%s: freq=%.0f\n", __func__, *freq);
 
     RETURNFUNC(RIG_OK);
 }
@@ -908,8 +928,7 @@ static int tci1x_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 static int tci1x_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 {
     int retval;
-    char cmd_arg[MAXARGLEN];
-    char *cmd;
+    char cmd[MAXARGLEN];
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
     ENTERFUNC;
@@ -932,40 +951,13 @@ static int tci1x_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
         vfo = RIG_VFO_B; // if split always TX on VFOB
     }
 
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value><double>%.0f</double></value></param></params>", freq);
-
-    value_t val;
-    rig_get_ext_parm(rig, TOK_TCI1X_VERIFY_FREQ, &val);
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: set_verify_vfoA/B=%d\n", __func__, val.i);
-
-    if (vfo == RIG_VFO_A)
-    {
-        cmd = "rig.set_vfoA";
-
-        if (val.i) { cmd = "rig.set_verify_vfoA"; }
-
-        rig_debug(RIG_DEBUG_TRACE, "%s %.0f\n", cmd, freq);
-        priv->curr_freqA = freq;
-    }
-    else
-    {
-        cmd = "rig.set_vfoB";
-
-        if (val.i) { cmd = "rig.set_verify_vfoB"; }
-
-        rig_debug(RIG_DEBUG_TRACE, "%s %.0f\n", cmd, freq);
-        priv->curr_freqB = freq;
-    }
-
-    retval = tci1x_transaction(rig, cmd, cmd_arg, NULL, 0);
+    SNPRINTF(cmd, sizeof(cmd), "vfo:0,%d,%.0f;", vfo == RIG_VFO_A ? 0 : 1, freq);
 
-    if (retval != RIG_OK)
-    {
-        RETURNFUNC(retval);
-    }
+    // priv is updated by the vfo: notification confirming it
+    retval = tci1x_transaction(rig, cmd,
+                               vfo == RIG_VFO_A ? TCI1X_HAVE_FREQA : TCI1X_HAVE_FREQB);
 
-    RETURNFUNC(RIG_OK);
+    RETURNFUNC(retval);
 }
 
 /*
@@ -975,8 +967,7 @@ static int tci1x_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 static int tci1x_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 {
     int retval;
-    char cmd_arg[MAXARGLEN];
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    char cmd[MAXARGLEN];
 
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: ptt=%d\n", __func__, ptt);
@@ -989,27 +980,11 @@ static int tci1x_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
         RETURNFUNC(-RIG_EINVAL);
     }
 
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value><i4>%d</i4></value></param></params>",
-             ptt);
-
-    value_t val;
-    char *cmd = "rig.set_ptt";
-    rig_get_ext_parm(rig, TOK_TCI1X_VERIFY_FREQ, &val);
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: fast_set_ptt=%d\n", __func__, val.i);
-
-    if (val.i) { cmd = "rig.set_ptt_fast"; }
-
-    retval = tci1x_transaction(rig, cmd, cmd_arg, NULL, 0);
-
-    if (retval != RIG_OK)
-    {
-        RETURNFUNC(retval);
-    }
+    SNPRINTF(cmd, sizeof(cmd), "trx:0,%s;", ptt ? "true" : "false");
 
-    priv->ptt = ptt;
+    retval = tci1x_transaction(rig, cmd, TCI1X_HAVE_PTT);
 
-    RETURNFUNC(RIG_OK);
+    RETURNFUNC(retval);
 }
 
 /*
@@ -1018,26 +993,74 @@ static int tci1x_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 */
 static int tci1x_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 {
-    char value[MAXCMDLEN];
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    int retval;
 
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
               rig_strvfo(vfo));
 
-    int retval;
-
-    retval = tci1x_transaction(rig, "rig.get_ptt", NULL, value, sizeof(value));
+    retval = tci1x_query(rig, "trx:0;", TCI1X_HAVE_PTT);
 
     if (retval != RIG_OK)
     {
         RETURNFUNC(retval);
     }
 
-    *ptt = atoi(value);
-    rig_debug(RIG_DEBUG_TRACE, "%s: '%s'\n", __func__, value);
+    *ptt = priv->ptt;
+    rig_debug(RIG_DEBUG_TRACE, "%s: ptt=%d\n", __func__, *ptt);
+
+    RETURNFUNC(RIG_OK);
+}
+/*
+* tci1x_get_level
+* The S meter can be asked for, the tx meters are only pushed while
+* transmitting so read 0 W and an SWR of 1 until the first one arrives
+*/
+static int tci1x_get_level(RIG *rig, vfo_t vfo, setting_t level,
+                           value_t *val)
+{
+    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    int retval;
+
+    ENTERFUNC;
+    rig_debug(RIG_DEBUG_TRACE, "%s: level=%s\n", __func__, rig_strlevel(level));
+
+    switch (level)
+    {
+    case RIG_LEVEL_STRENGTH:
+        retval = tci1x_query(rig, "rx_smeter:0,0;", TCI1X_HAVE_SMETER);
+
+        if (retval != RIG_OK)
+        {
+            RETURNFUNC(retval);
+        }
+
+        val->i = priv->strength;
+        break;
+
+    case RIG_LEVEL_RFPOWER:
+        retval = tci1x_query(rig, "drive;", TCI1X_HAVE_DRIVE);
+
+        if (retval != RIG_OK)
+        {
+            RETURNFUNC(retval);
+        }
+
+        val->f = priv->drive;
+        break;
+
+    case RIG_LEVEL_SWR:
+        val->f = priv->swr;
+        break;
+
+    case RIG_LEVEL_RFPOWER_METER_WATTS:
+        val->f = priv->power_watts;
+        break;
 
-    priv->ptt = *ptt;
+    default:
+        RETURNFUNC(-RIG_EINVAL);
+    }
 
     RETURNFUNC(RIG_OK);
 }
@@ -1092,32 +1115,14 @@ static int tci1x_set_split_mode(RIG *rig, vfo_t vfo, rmode_t mode,
 static int tci1x_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 {
     int retval;
-    int needBW;
-    int vfoSwitched;
-    char cmd_arg[MAXCMDLEN];
-    char *p;
-    char *pttmode;
-    char *ttmode;
+    char cmd[MAXARGLEN];
+    const char *ttmode;
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s mode=%s width=%d\n",
               __func__, rig_strvfo(vfo), rig_strrmode(mode), (int)width);
 
-
-    // if ptt is on do not set mode
-    if (priv->ptt)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: returning because priv->ptt=%d\n", __func__,
-                  (int)priv->ptt);
-        RETURNFUNC(RIG_OK);
-    }
-
-    if (vfo == RIG_VFO_CURR)
-    {
-        vfo = rig->state.current_vfo;
-    }
-
     if (check_vfo(vfo) == FALSE)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: unsupported VFO %s\n",
@@ -1131,163 +1136,58 @@ static int tci1x_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
         RETURNFUNC(RIG_OK);  // just return OK and ignore this
     }
 
-    // Switch to VFOB if appropriate since we can't set mode directly
-    // MDB
-    vfoSwitched = 0;
-    rig_debug(RIG_DEBUG_TRACE, "%s: curr_vfo = %s\n", __func__,
-              rig_strvfo(rig->state.current_vfo));
-
-    // If we don't have the get_bwA call we have to switch VFOs ourself
-    if (!priv->has_get_bwA && vfo == RIG_VFO_B
-            && rig->state.current_vfo != RIG_VFO_B)
-    {
-        vfoSwitched = 1;
-        rig_debug(RIG_DEBUG_TRACE, "%s: switch to VFOB = %d\n", __func__,
-                  vfoSwitched);
-    }
-
-    if (vfoSwitched)   // swap to B and we'll swap back later
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: switching to VFOB = %d\n", __func__,
-                  vfoSwitched);
-        retval = tci1x_set_vfo(rig, RIG_VFO_B);
-
-        if (retval < 0)
-        {
-            RETURNFUNC(retval);
-        }
-    }
-
-    // Set the mode
-    if (modeMapGetTCI(mode))
-    {
-        ttmode = strdup(modeMapGetTCI(mode));
-    }
-    else
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: modeMapGetFlRig failed on mode=%d\n", __func__,
-                  (int)mode);
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    rig_debug(RIG_DEBUG_TRACE, "%s: got ttmode = %s\n", __func__,
-              ttmode == NULL ? "NULL" : ttmode);
+    ttmode = modeMapGetTCI(mode);
 
     if (ttmode == NULL)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: strdup failed\n", __func__);
-        RETURNFUNC(-RIG_EINTERNAL);
-    }
-
-//   if (strncmp(ttmode,"ERROR",5)==0) RETURNFUNC(-RIG_EINTERN);
-
-    pttmode = ttmode;
-
-    if (ttmode[0] == '|') { pttmode = &ttmode[1]; } // remove first pipe symbol
-
-    p = strchr(pttmode, '|');
-
-    if (p) { *p = 0; } // remove any other pipe
-
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value>%s</value></param></params>", pttmode);
-    free(ttmode);
-
-    if (!priv->has_get_modeA)
-    {
-        retval = tci1x_transaction(rig, "rig.set_mode", cmd_arg, NULL, 0);
+        RETURNFUNC(-RIG_EINVAL);
     }
-    else
-    {
-        char *cmd = "rig.set_modeA";
-
-        if (vfo == RIG_VFO_B)
-        {
-            cmd = "rig.set_modeB";
-        }
-        else
-        {
-            // we make VFO_B mode unknown so it expires the cache
-            priv->curr_modeB = RIG_MODE_NONE;
-        }
 
-        retval = tci1x_transaction(rig, cmd, cmd_arg, NULL, 0);
-    }
+    SNPRINTF(cmd, sizeof(cmd), "modulation:0,%s;", ttmode);
 
+    // modulation belongs to the receiver, the notification sets both VFOs
+    retval = tci1x_transaction(rig, cmd, TCI1X_HAVE_MODE);
 
     if (retval != RIG_OK)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: failed: %s\n", __func__,
-                  rigerror(retval));
         RETURNFUNC(retval);
     }
 
-    // Determine if we need to update the bandwidth
-    needBW = 0;
-
-    if (vfo == RIG_VFO_A)
-    {
-        needBW = priv->curr_widthA != width;
-        rig_debug(RIG_DEBUG_TRACE, "%s: bw change on VFOA, curr width=%d  needBW=%d\n",
-                  __func__, (int)width, needBW);
-    }
-    else if (vfo == RIG_VFO_B)
-    {
-        needBW = priv->curr_widthB != width;
-        rig_debug(RIG_DEBUG_TRACE, "%s: bw change on VFOB, curr width=%d  needBW=%d\n",
-                  __func__, (int)width, needBW);
-    }
-    else
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: needBW unknown vfo=%s\n", __func__,
-                  rig_strvfo(vfo));
-    }
-
-    // Need to update the bandwidth
-    if (width > 0 && needBW)
+    if (width != RIG_PASSBAND_NOCHANGE && width != RIG_PASSBAND_NORMAL)
     {
-        SNPRINTF(cmd_arg, sizeof(cmd_arg),
-                 "<params><param><value><i4>%ld</i4></value></param></params>",
-                 width);
+        int low, high;
 
-        retval = tci1x_transaction(rig, "rig.set_bandwidth", cmd_arg, NULL, 0);
-
-        if (retval < 0)
+        switch (mode)
         {
-            RETURNFUNC(retval);
+        case RIG_MODE_LSB:
+        case RIG_MODE_PKTLSB:
+            low = -(int)width;
+            high = 0;
+            break;
+
+        case RIG_MODE_USB:
+        case RIG_MODE_PKTUSB:
+        case RIG_MODE_CW:
+            low = 0;
+            high = (int)width;
+            break;
+
+        default:
+            low = -(int)width / 2;
+            high = (int)width / 2;
+            break;
         }
-    }
 
-    // Return to VFOA if needed
-    rig_debug(RIG_DEBUG_TRACE, "%s: switch to VFOA? = %d\n", __func__,
-              vfoSwitched);
+        SNPRINTF(cmd, sizeof(cmd), "rx_filter_band:0,%d,%d;", low, high);
 
-    if (vfoSwitched)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: switching to VFOA\n", __func__);
-        retval = tci1x_set_vfo(rig, RIG_VFO_A);
+        retval = tci1x_transaction(rig, cmd, TCI1X_HAVE_WIDTH);
 
-        if (retval < 0)
+        if (retval != RIG_OK)
         {
             RETURNFUNC(retval);
         }
     }
 
-    if (vfo == RIG_VFO_A)
-    {
-        priv->curr_modeA = mode;
-        priv->curr_widthA = width;
-    }
-    else
-    {
-        priv->curr_modeB = mode;
-        priv->curr_widthB = width;
-    }
-
-    rig_debug(RIG_DEBUG_TRACE,
-              "%s: return modeA=%s, widthA=%d\n,modeB=%s, widthB=%d\n", __func__,
-              rig_strrmode(priv->curr_modeA), (int)priv->curr_widthA,
-              rig_strrmode(priv->curr_modeB), (int)priv->curr_widthB);
     RETURNFUNC(RIG_OK);
 }
 
@@ -1298,11 +1198,6 @@ static int tci1x_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 static int tci1x_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
 {
     int retval;
-    int vfoSwitched;
-    char value[MAXCMDLEN];
-    char *cmdp;
-    vfo_t curr_vfo;
-    rmode_t my_mode;
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
 
     ENTERFUNC;
@@ -1316,206 +1211,67 @@ static int tci1x_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
         RETURNFUNC(-RIG_EINVAL);
     }
 
-    curr_vfo = rig->state.current_vfo;
+    retval = tci1x_query(rig, "modulation:0;", TCI1X_HAVE_MODE);
 
-    if (vfo == RIG_VFO_CURR)
+    if (retval == RIG_OK)
     {
-        vfo = rig->state.current_vfo;
+        retval = tci1x_query(rig, "rx_filter_band:0;", TCI1X_HAVE_WIDTH);
     }
 
-    rig_debug(RIG_DEBUG_TRACE, "%s: using vfo=%s\n", __func__,
-              rig_strvfo(vfo));
-
-    if (priv->ptt)
+    if (retval != RIG_OK)
     {
-        if (vfo == RIG_VFO_A) { *mode = priv->curr_modeA; }
-        else { *mode = priv->curr_modeB; }
-
-        rig_debug(RIG_DEBUG_VERBOSE, "%s call not made as PTT=1\n", __func__);
-        RETURNFUNC(RIG_OK);  // just return OK and ignore this
+        RETURNFUNC(retval);
     }
 
-    // Switch to VFOB if appropriate
-    vfoSwitched = 0;
-
-    if (priv->has_get_modeA == 0 && vfo == RIG_VFO_B && curr_vfo != RIG_VFO_B)
+    if (vfo == RIG_VFO_B || (vfo == RIG_VFO_TX && priv->split))
     {
-        vfoSwitched = 1;
+        *mode = priv->curr_modeB;
+        *width = priv->curr_widthB;
     }
-
-    if (vfoSwitched)
+    else
     {
-        rig_debug(RIG_DEBUG_TRACE, "%s switch to VFOB=%d\n", __func__,
-                  priv->has_get_modeA);
-        retval = tci1x_set_vfo(rig, RIG_VFO_B);
-
-        if (retval < 0)
-        {
-            RETURNFUNC(retval);
-        }
+        *mode = priv->curr_modeA;
+        *width = priv->curr_widthA;
     }
 
-    cmdp = "rig.get_mode"; /* default to old way */
-
-    if (priv->has_get_modeA)   /* change to new way if we can */
-    {
-        /* calling this way reduces VFO swapping */
-        /* we get the cached value in tci1x */
-        /* vfo B may not be getting polled though in TCI */
-        /* so we may not be 100% accurate if op is twiddling knobs */
-        cmdp = "rig.get_modeA";
+    rig_debug(RIG_DEBUG_TRACE, "%s: mode=%s width=%d\n", __func__,
+              rig_strrmode(*mode), (int)*width);
 
-        if (vfo == RIG_VFO_B) { cmdp = "rig.get_modeB"; }
-    }
+    RETURNFUNC(RIG_OK);
+}
 
-    retval = tci1x_transaction(rig, cmdp, NULL, value, sizeof(value));
+/*
+* tci1x_set_vfo
+* TCI addresses both VFOs directly so this only picks the one
+* RIG_VFO_CURR refers to
+*/
+static int tci1x_set_vfo(RIG *rig, vfo_t vfo)
+{
+    ENTERFUNC;
+    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
+              rig_strvfo(vfo));
 
-    if (retval != RIG_OK)
+    if (check_vfo(vfo) == FALSE)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: %s failed: %s\n", __func__, cmdp,
-                  rigerror(retval));
-        RETURNFUNC(retval);
+        rig_debug(RIG_DEBUG_ERR, "%s: unsupported VFO %s\n",
+                  __func__, rig_strvfo(vfo));
+        RETURNFUNC(-RIG_EINVAL);
     }
 
-    my_mode = modeMapGetHamlib(value);
-    *mode = my_mode;
-    rig_debug(RIG_DEBUG_TRACE, "%s: mode='%s'\n", __func__,
-              rig_strrmode(*mode));
-
-    if (vfo == RIG_VFO_A)
+    if (vfo == RIG_VFO_TX)
     {
-        priv->curr_modeA = *mode;
+        vfo = RIG_VFO_B;
     }
-    else
+    else if (vfo == RIG_VFO_CURR)
     {
-        priv->curr_modeB = *mode;
+        vfo = rig->state.current_vfo;
     }
 
+    rig->state.current_vfo = vfo;
+    rig->state.tx_vfo = RIG_VFO_B;
 
-    /* Get the bandwidth */
-    cmdp = "rig.get_bw"; /* default to old way */
-
-    if (priv->has_get_bwA)   /* change to new way if we can */
-    {
-        /* calling this way reduces VFO swapping */
-        /* we get the cached value in tci1x */
-        /* vfo B may not be getting polled though in TCI */
-        /* so we may not be 100% accurate if op is twiddling knobs */
-        cmdp = "rig.get_bwA";
-
-        if (vfo == RIG_VFO_B) { cmdp = "rig.get_bwB"; }
-    }
-
-    retval = tci1x_transaction(rig, cmdp, NULL, value, sizeof(value));
-
-    if (retval != RIG_OK)
-    {
-        RETURNFUNC(retval);
-    }
-
-    rig_debug(RIG_DEBUG_TRACE, "%s: mode=%s width='%s'\n", __func__,
-              rig_strrmode(*mode), value);
-
-    // we get 2 entries pipe separated for bandwidth, lower and upper
-    if (strlen(value) > 0)
-    {
-        char *p = value;
-
-        /* we might get two values and then we want the 2nd one */
-        if (strchr(value, '|') != NULL) { p = strchr(value, '|') + 1; }
-
-        *width = atoi(p);
-    }
-
-    if (vfo == RIG_VFO_A)
-    {
-        priv->curr_widthA = *width;
-    }
-    else
-    {
-        priv->curr_widthB = *width;
-    }
-
-    // Return to VFOA if needed
-    if (vfoSwitched)
-    {
-        retval = tci1x_set_vfo(rig, RIG_VFO_A);
-
-        if (retval != RIG_OK)
-        {
-            RETURNFUNC(retval);
-        }
-    }
-
-    RETURNFUNC(RIG_OK);
-}
-
-/*
-* tci1x_set_vfo
-* assumes rig!=NULL
-*/
-static int tci1x_set_vfo(RIG *rig, vfo_t vfo)
-{
-    int retval;
-    char cmd_arg[MAXBUFLEN];
-    struct rig_state *rs = &rig->state;
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-
-    ENTERFUNC;
-    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
-              rig_strvfo(vfo));
-
-
-    if (check_vfo(vfo) == FALSE)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: unsupported VFO %s\n",
-                  __func__, rig_strvfo(vfo));
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    if (vfo == RIG_VFO_TX)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: RIG_VFO_TX used\n", __func__);
-        vfo = RIG_VFO_B; // always TX on VFOB
-    }
-
-    if (vfo == RIG_VFO_CURR)
-    {
-        vfo = rig->state.current_vfo;
-    }
-
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value>%s</value></param></params>",
-             vfo == RIG_VFO_A ? "A" : "B");
-    retval = tci1x_transaction(rig, "rig.set_AB", cmd_arg, NULL, 0);
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: rig.set_AB failed: %s\n", __func__,
-                  rigerror(retval));
-        RETURNFUNC(retval);
-    }
-
-    rig->state.current_vfo = vfo;
-    rs->tx_vfo = RIG_VFO_B; // always VFOB
-
-    /* for some rigs TCI turns off split when VFOA is selected */
-    /* so if we are in split and asked for A we have to turn split back on */
-    if (priv->split && vfo == RIG_VFO_A)
-    {
-        SNPRINTF(cmd_arg, sizeof(cmd_arg),
-                 "<params><param><value><i4>%d</i4></value></param></params>",
-                 priv->split);
-        retval = tci1x_transaction(rig, "rig.set_split", cmd_arg, NULL, 0);
-
-        if (retval < 0)
-        {
-            RETURNFUNC(retval);
-        }
-    }
-
-    RETURNFUNC(RIG_OK);
-}
+    RETURNFUNC(RIG_OK);
+}
 
 /*
 * tci1x_get_vfo
@@ -1523,47 +1279,11 @@ static int tci1x_set_vfo(RIG *rig, vfo_t vfo)
 */
 static int tci1x_get_vfo(RIG *rig, vfo_t *vfo)
 {
-    char value[MAXCMDLEN];
-
     ENTERFUNC;
 
+    *vfo = rig->state.current_vfo;
 
-    int retval;
-    retval = tci1x_transaction(rig, "rig.get_AB", NULL, value, sizeof(value));
-
-    if (retval < 0)
-    {
-        RETURNFUNC(retval);
-    }
-
-    rig_debug(RIG_DEBUG_TRACE, "%s: vfo value=%s\n", __func__, value);
-
-    switch (value[0])
-    {
-    case 'A':
-        *vfo = RIG_VFO_A;
-        break;
-
-    case 'B':
-        *vfo = RIG_VFO_B;
-        break;
-
-    default:
-        *vfo = RIG_VFO_CURR;
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    if (check_vfo(*vfo) == FALSE)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: unsupported VFO %s\n",
-                  __func__, rig_strvfo(*vfo));
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    rig->state.current_vfo = *vfo;
-
-    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
-              rig_strvfo(*vfo));
+    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__, rig_strvfo(*vfo));
 
     RETURNFUNC(RIG_OK);
 }
@@ -1574,11 +1294,6 @@ static int tci1x_get_vfo(RIG *rig, vfo_t *vfo)
 */
 static int tci1x_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
 {
-    int retval;
-    char cmd_arg[MAXBUFLEN];
-    freq_t qtx_freq;
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s freq=%.1f\n", __func__,
               rig_strvfo(vfo), tx_freq);
@@ -1590,26 +1305,8 @@ static int tci1x_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
         RETURNFUNC(-RIG_EINVAL);
     }
 
-    // we always split on VFOB so if no change just return
-    retval = tci1x_get_freq(rig, RIG_VFO_B, &qtx_freq);
-
-    if (retval != RIG_OK) { RETURNFUNC(retval); }
-
-    if (tx_freq == qtx_freq) { RETURNFUNC(RIG_OK); }
-
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value><double>%.6f</double></value></param></params>",
-             tx_freq);
-    retval = tci1x_transaction(rig, "rig.set_vfoB", cmd_arg, NULL, 0);
-
-    if (retval < 0)
-    {
-        RETURNFUNC(retval);
-    }
-
-    priv->curr_freqB = tx_freq;
-
-    RETURNFUNC(RIG_OK);
+    // we always split on VFOB
+    RETURNFUNC(tci1x_set_freq(rig, RIG_VFO_B, tx_freq));
 }
 
 /*
@@ -1618,16 +1315,11 @@ static int tci1x_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
 */
 static int tci1x_get_split_freq(RIG *rig, vfo_t vfo, freq_t *tx_freq)
 {
-    int retval;
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
               rig_strvfo(vfo));
 
-    retval = tci1x_get_freq(rig, RIG_VFO_B, tx_freq);
-    priv->curr_freqB = *tx_freq;
-    RETURNFUNC(retval);
+    RETURNFUNC(tci1x_get_freq(rig, RIG_VFO_B, tx_freq));
 }
 
 /*
@@ -1637,20 +1329,18 @@ static int tci1x_get_split_freq(RIG *rig, vfo_t vfo, freq_t *tx_freq)
 static int tci1x_set_split_vfo(RIG *rig, vfo_t vfo, split_t split, vfo_t tx_vfo)
 {
     int retval;
-    vfo_t qtx_vfo;
-    split_t qsplit;
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-    char cmd_arg[MAXBUFLEN];
+    char cmd[MAXARGLEN];
 
     ENTERFUNC;
     rig_debug(RIG_DEBUG_TRACE, "%s: tx_vfo=%s\n", __func__,
               rig_strvfo(tx_vfo));
 
-    retval = tci1x_get_split_vfo(rig, RIG_VFO_A, &qsplit, &qtx_vfo);
-
-    if (retval != RIG_OK) { RETURNFUNC(retval); }
-
-    if (split == qsplit) { RETURNFUNC(RIG_OK); }
+    if (priv->receive_active && (priv->have & TCI1X_HAVE_SPLIT)
+            && split == priv->split)
+    {
+        RETURNFUNC(RIG_OK);
+    }
 
     if (priv->ptt)
     {
@@ -1658,19 +1348,11 @@ static int tci1x_set_split_vfo(RIG *rig, vfo_t vfo, split_t split, vfo_t tx_vfo)
         RETURNFUNC(RIG_OK);  // just return OK and ignore this
     }
 
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value><i4>%d</i4></value></param></params>",
-             split);
-    retval = tci1x_transaction(rig, "rig.set_split", cmd_arg, NULL, 0);
-
-    if (retval < 0)
-    {
-        RETURNFUNC(retval);
-    }
+    SNPRINTF(cmd, sizeof(cmd), "split_enable:0,%s;", split ? "true" : "false");
 
-    priv->split = split;
+    retval = tci1x_transaction(rig, cmd, TCI1X_HAVE_SPLIT);
 
-    RETURNFUNC(RIG_OK);
+    RETURNFUNC(retval);
 }
 
 /*
@@ -1680,13 +1362,12 @@ static int tci1x_set_split_vfo(RIG *rig, vfo_t vfo, split_t split, vfo_t tx_vfo)
 static int tci1x_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split,
                                vfo_t *tx_vfo)
 {
-    char value[MAXCMDLEN];
     struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
+    int retval;
 
     ENTERFUNC;
 
-    int retval;
-    retval = tci1x_transaction(rig, "rig.get_split", NULL, value, sizeof(value));
+    retval = tci1x_query(rig, "split_enable:0;", TCI1X_HAVE_SPLIT);
 
     if (retval < 0)
     {
@@ -1694,13 +1375,11 @@ static int tci1x_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split,
     }
 
     *tx_vfo = RIG_VFO_B;
-    *split = atoi(value);
-    priv->split = *split;
+    *split = priv->split;
     rig_debug(RIG_DEBUG_TRACE, "%s tx_vfo=%s, split=%d\n", __func__,
               rig_strvfo(*tx_vfo), *split);
     RETURNFUNC(RIG_OK);
 }
-
 /*
 * tci1x_set_split_freq_mode
 * assumes rig!=NULL
@@ -1776,134 +1455,6 @@ static int tci1x_get_split_freq_mode(RIG *rig, vfo_t vfo, freq_t *freq,
     RETURNFUNC(retval);
 }
 
-#ifdef XXNOTIMPLEMENTED
-static int tci1x_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
-{
-    int retval;
-    char cmd_arg[MAXARGLEN];
-    char *cmd;
-    char *param_type = "i4";
-
-    ENTERFUNC;
-    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s level=%d, val=%f\n", __func__,
-              rig_strvfo(vfo), (int)level, val.f);
-
-    if (check_vfo(vfo) == FALSE)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: unsupported VFO %s\n",
-                  __func__, rig_strvfo(vfo));
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    switch (level)
-    {
-    case RIG_LEVEL_RF: cmd = "rig.set_rfgain"; val.f *= 100; break;
-
-    case RIG_LEVEL_AF: cmd = "rig.set_volume"; val.f *= 100; break;
-
-    case RIG_LEVEL_MICGAIN: cmd = "rig.set_micgain"; val.f *= 100; break;
-
-    case RIG_LEVEL_RFPOWER: cmd = "rig.set_power"; val.f *= 100; break;
-
-    default:
-        rig_debug(RIG_DEBUG_ERR, "%s: invalid level=%d\n", __func__, (int)level);
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    SNPRINTF(cmd_arg, sizeof(cmd_arg),
-             "<params><param><value><%s>%d</%s></value></param></params>",
-             param_type, (int)val.f, param_type);
-
-
-    retval = tci1x_transaction(rig, cmd, cmd_arg, NULL, 0);
-
-    if (retval < 0)
-    {
-        RETURNFUNC(retval);
-    }
-
-    RETURNFUNC(RIG_OK);
-}
-
-/*
-* tci1x_get_level
-* Assumes rig!=NULL, rig->state.priv!=NULL, val!=NULL
-*/
-static int tci1x_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
-{
-    char value[MAXARGLEN];
-    char *cmd;
-    int retval;
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *) rig->state.priv;
-
-    ENTERFUNC;
-    rig_debug(RIG_DEBUG_TRACE, "%s: vfo=%s\n", __func__,
-              rig_strvfo(vfo));
-
-
-    switch (level)
-    {
-    case RIG_LEVEL_AF: cmd = "rig.get_volume"; break;
-
-    case RIG_LEVEL_RF: cmd = "rig.get_rfgain"; break;
-
-    case RIG_LEVEL_MICGAIN: cmd = "rig.get_micgain"; break;
-
-    case RIG_LEVEL_STRENGTH: cmd = "rig.get_smeter"; break;
-
-    case RIG_LEVEL_RFPOWER: cmd = "rig.get_power"; break;
-
-    case RIG_LEVEL_RFPOWER_METER_WATTS:
-    case RIG_LEVEL_RFPOWER_METER: cmd = "rig.get_pwrmeter"; break;
-
-    default:
-        rig_debug(RIG_DEBUG_ERR, "%s: unknown level=%d\n", __func__, (int)level);
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    retval = tci1x_transaction(rig, cmd, NULL, value, sizeof(value));
-
-    if (retval != RIG_OK)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: tci1x_transaction failed retval=%s\n", __func__,
-                  rigerror(retval));
-        RETURNFUNC(retval);
-    }
-
-    // most levels are 0-100 -- may have to allow for different ranges
-    switch (level)
-    {
-    case RIG_LEVEL_STRENGTH:
-        val->i = atoi(value) - 54;
-        //if (val->i > 0) val->i /= 10;
-        rig_debug(RIG_DEBUG_TRACE, "%s: val.i='%s'(%d)\n", __func__, value, val->i);
-        break;
-
-    case RIG_LEVEL_RFPOWER:
-        val->f = atof(value) / 100.0 * priv->powermeter_scale;
-        rig_debug(RIG_DEBUG_TRACE, "%s: val.f='%s'(%g)\n", __func__, value, val->f);
-        break;
-
-    case RIG_LEVEL_RFPOWER_METER:
-        val->f = atof(value) / 100.0 * priv->powermeter_scale;
-        rig_debug(RIG_DEBUG_TRACE, "%s: val.f='%s'(%g)\n", __func__, value, val->f);
-        break;
-
-    case RIG_LEVEL_RFPOWER_METER_WATTS:
-        val->f = atof(value) * priv->powermeter_scale;
-        rig_debug(RIG_DEBUG_TRACE, "%s: val.f='%s'(%g)\n", __func__, value, val->f);
-        break;
-
-    default:
-        val->f = atof(value) / 100;
-        rig_debug(RIG_DEBUG_TRACE, "%s: val.f='%s'(%f)\n", __func__, value, val->f);
-    }
-
-
-    RETURNFUNC(RIG_OK);
-}
-#endif
-
 /*
 * tci1x_get_info
 * assumes rig!=NULL
@@ -1946,174 +1497,3 @@ static int tci1x_mW2power(RIG *rig, float *power, unsigned int mwpower,
 
 }
 
-#ifdef XXNOTIMPLEMENTED
-static int tci1x_set_ext_parm(RIG *rig, token_t token, value_t val)
-{
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *)rig->state.priv;
-    char lstr[64];
-    const struct confparams *cfp;
-    struct ext_list *epp;
-
-    ENTERFUNC;
-    cfp = rig_ext_lookup_tok(rig, token);
-
-    if (!cfp)
-    {
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    switch (token)
-    {
-    case TOK_TCI1X_VERIFY_FREQ:
-    case TOK_TCI1X_VERIFY_PTT:
-        if (val.i && !priv->has_verify_cmds)
-        {
-            rig_debug(RIG_DEBUG_ERR,
-                      "%s: FLRig version 1.3.54.18 or higher needed to support fast functions\n",
-                      __func__);
-            RETURNFUNC(-RIG_EINVAL);
-        }
-
-        break;
-
-    default:
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    switch (cfp->type)
-    {
-    case RIG_CONF_STRING:
-        strcpy(lstr, val.s);
-        break;
-
-
-    case RIG_CONF_COMBO:
-        SNPRINTF(lstr, sizeof(lstr), "%d", val.i);
-        break;
-
-    case RIG_CONF_NUMERIC:
-        SNPRINTF(lstr, sizeof(lstr), "%f", val.f);
-        break;
-
-    case RIG_CONF_CHECKBUTTON:
-        SNPRINTF(lstr, sizeof(lstr), "%s", val.i ? "ON" : "OFF");
-        break;
-
-    case RIG_CONF_BUTTON:
-        lstr[0] = '\0';
-        break;
-
-    default:
-        RETURNFUNC(-RIG_EINTERNAL);
-    }
-
-    epp = find_ext(priv->ext_parms, token);
-
-    if (!epp)
-    {
-        RETURNFUNC(-RIG_EINTERNAL);
-    }
-
-    /* store value */
-    epp->val = val;
-
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called: %s %s\n", __func__,
-              cfp->name, lstr);
-
-    RETURNFUNC(RIG_OK);
-}
-
-static int tci1x_get_ext_parm(RIG *rig, token_t token, value_t *val)
-{
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *)rig->state.priv;
-    const struct confparams *cfp;
-    struct ext_list *epp;
-
-    ENTERFUNC;
-    /* TODO: load value from priv->ext_parms */
-
-    cfp = rig_ext_lookup_tok(rig, token);
-
-    if (!cfp)
-    {
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    switch (token)
-    {
-    case TOK_TCI1X_VERIFY_FREQ:
-    case TOK_TCI1X_VERIFY_PTT:
-        break;
-
-    default:
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    epp = find_ext(priv->ext_parms, token);
-
-    if (!epp)
-    {
-        RETURNFUNC(-RIG_EINTERNAL);
-    }
-
-    /* load value */
-    *val = epp->val;
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called: %s\n", __func__,
-              cfp->name);
-
-    RETURNFUNC(RIG_OK);
-}
-
-
-static int tci1x_set_ext_parm(RIG *rig, setting_t parm, value_t val)
-{
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *)rig->state.priv;
-    int idx;
-    char pstr[32];
-
-    ENTERFUNC;
-    idx = rig_setting2idx(parm);
-
-    if (idx >= RIG_SETTING_MAX)
-    {
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    if (RIG_PARM_IS_FLOAT(parm))
-    {
-        SNPRINTF(pstr, sizeof(pstr), "%f", val.f);
-    }
-    else
-    {
-        SNPRINTF(pstr, sizeof(pstr), "%d", val.i);
-    }
-
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called: %s %s\n", __func__,
-              rig_strparm(parm), pstr);
-    priv->parms[idx] = val;
-
-    RETURNFUNC(RIG_OK);
-}
-
-static int tci1x_get_ext_parm(RIG *rig, setting_t parm, value_t *val)
-{
-    struct tci1x_priv_data *priv = (struct tci1x_priv_data *)rig->state.priv;
-    int idx;
-
-    ENTERFUNC;
-    idx = rig_setting2idx(parm);
-
-    if (idx >= RIG_SETTING_MAX)
-    {
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    *val = priv->parms[idx];
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called %s\n", __func__,
-              rig_strparm(parm));
-
-    RETURNFUNC(RIG_OK);
-}
-#endif
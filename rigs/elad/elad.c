@@ -35,6 +35,7 @@
 #include "misc.h"
 #include "register.h"
 #include "cal.h"
+#include "probe.h"
 
 #include "elad.h"
 
@@ -3831,6 +3832,27 @@ DECLARE_PROBERIG_BACKEND(elad)
 }
 
 
+/*
+ * elad_probe_id
+ * Models answering id to "ID;", for the probing of src/probe.c
+ */
+int elad_probe_id(const char *id, struct probe_candidate *cand, int max)
+{
+    int i, n = 0;
+
+    for (i = 0; elad_id_string_list[i].model != RIG_MODEL_NONE && n < max; i++)
+    {
+        if (!strcmp(elad_id_string_list[i].id, id))
+        {
+            cand[n].model = elad_id_string_list[i].model;
+            cand[n++].confidence = 100;
+        }
+    }
+
+    return n;
+}
+
+
 /*
  * initrigs_elad is called by rig_backend_load
  */
@@ -0,0 +1,722 @@
+/*
+ *  Hamlib CI-V backend - CI-V bus shared by several rigs
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Several Icom rigs on one CI-V bus (or behind a CI-V hub) opened in one
+ * process with the "civ_bus" conf share a single bus object per port:
+ *
+ * - the bus owns the port, member rigs keep a dup of its fd that is
+ *   never read, so the line settings are restored only when the last
+ *   member leaves
+ * - a reader thread splits everything on the bus into frames and routes
+ *   them by sender address: replies go to the member that is waiting,
+ *   transceive and scope frames are processed for the rig that sent them
+ * - the wire is held by one member from its write until its echo is
+ *   back, then the next member may send while the first still waits for
+ *   its reply, so transactions to different rigs overlap
+ *
+ * The async data handler reads the port itself and cannot be combined
+ * with the bus, transceive frames are handled by the bus reader instead.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#if defined(HAVE_PTHREAD) && !defined(_WIN32)
+#include <pthread.h>
+#include <sys/select.h>
+#define ICOM_CIV_BUS 1
+#endif
+
+#include "hamlib/rig.h"
+#include "serial.h"
+#include "misc.h"
+#include "ioreactor.h"
+#include "icom.h"
+#include "icom_defs.h"
+#include "frame.h"
+#include "civ_bus.h"
+
+#ifdef ICOM_CIV_BUS
+
+#define ICOM_CIV_BUS_MAX        4       /* ports */
+#define ICOM_CIV_BUS_MEMBERS    8       /* rigs per port */
+#define ICOM_CIV_BUS_POLL_MS    200     /* reader wake up to check for shutdown */
+
+enum icom_civ_bus_echo_e
+{
+    ICOM_CIV_BUS_ECHO_IDLE,
+    ICOM_CIV_BUS_ECHO_WAIT,
+    ICOM_CIV_BUS_ECHO_SEEN,
+    ICOM_CIV_BUS_ECHO_COLLISION
+};
+
+struct icom_civ_bus_member
+{
+    RIG *rig;
+    unsigned char addr;                 /* re_civ_addr */
+    unsigned char ctrl;                 /* our address in the pending request */
+    int waiting;                        /* a transaction waits for a reply */
+    int dispatching;                    /* the reader is processing a frame for it */
+    int reply_len;
+    unsigned char reply[MAXFRAMELEN];
+};
+
+struct icom_civ_bus
+{
+    char pathname[HAMLIB_FILPATHLEN];
+    int users;
+    hamlib_port_t port;
+    struct icom_deframer rx;
+    pthread_t thread;
+    volatile int run;
+    pthread_mutex_t wire;               /* held from a write until its echo is back */
+    pthread_mutex_t lock;               /* everything below and the members */
+    pthread_cond_t cond;
+    const unsigned char *echo_frame;
+    int echo_len;
+    enum icom_civ_bus_echo_e echo_state;
+    int echo;                           /* -1 unknown, 0 the bus does not echo, 1 it does */
+    struct icom_civ_bus_member member[ICOM_CIV_BUS_MEMBERS];
+};
+
+static struct icom_civ_bus *icom_civ_buses[ICOM_CIV_BUS_MAX];
+static pthread_mutex_t icom_civ_buses_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct icom_civ_bus_member *icom_civ_bus_member(struct icom_civ_bus *bus,
+        const RIG *rig)
+{
+    int i;
+
+    for (i = 0; i < ICOM_CIV_BUS_MEMBERS; i++)
+    {
+        if (bus->member[i].rig == rig)
+        {
+            return &bus->member[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void icom_civ_bus_deadline(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/* called with bus->lock held, drops it while a frame is processed */
+static void icom_civ_bus_route(struct icom_civ_bus *bus,
+                               const unsigned char *frame, int len)
+{
+    struct icom_civ_bus_member *m = NULL;
+    int i;
+
+    if (bus->echo_state == ICOM_CIV_BUS_ECHO_WAIT)
+    {
+        if (frame[len - 1] == COL)
+        {
+            bus->echo_state = ICOM_CIV_BUS_ECHO_COLLISION;
+            pthread_cond_broadcast(&bus->cond);
+            return;
+        }
+
+        if (len == bus->echo_len && memcmp(frame, bus->echo_frame, len) == 0)
+        {
+            bus->echo_state = ICOM_CIV_BUS_ECHO_SEEN;
+            bus->echo = 1;
+            pthread_cond_broadcast(&bus->cond);
+            return;
+        }
+    }
+
+    if (frame[len - 1] != FI || len < ACKFRMLEN)
+    {
+        return;
+    }
+
+    for (i = 0; i < ICOM_CIV_BUS_MEMBERS; i++)
+    {
+        if (bus->member[i].rig && bus->member[i].addr == frame[3])
+        {
+            m = &bus->member[i];
+            break;
+        }
+    }
+
+    if (m == NULL)
+    {
+        // another controller or a rig that is not ours
+        rig_debug(RIG_DEBUG_TRACE, "%s: frame from %02x to %02x ignored\n", __func__,
+                  frame[3], frame[2]);
+        return;
+    }
+
+    if (icom_is_async_frame(m->rig, len, frame))
+    {
+        RIG *rig = m->rig;
+
+        m->dispatching = 1;
+        pthread_mutex_unlock(&bus->lock);
+        icom_process_async_frame(rig, len, frame);
+        pthread_mutex_lock(&bus->lock);
+        m->dispatching = 0;
+        pthread_cond_broadcast(&bus->cond);
+        return;
+    }
+
+    if (m->waiting && frame[2] == m->ctrl)
+    {
+        if (bus->echo < 0 && bus->echo_state == ICOM_CIV_BUS_ECHO_WAIT)
+        {
+            // the reply came before any echo
+            bus->echo = 0;
+        }
+
+        memcpy(m->reply, frame, len);
+        m->reply_len = len;
+        m->waiting = 0;
+        pthread_cond_broadcast(&bus->cond);
+        return;
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: unexpected frame from %02x\n", __func__,
+              frame[3]);
+}
+
+static void *icom_civ_bus_reader(void *arg)
+{
+    struct icom_civ_bus *bus = arg;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started on %s\n", __func__, bus->pathname);
+
+    while (bus->run)
+    {
+        unsigned char *frame;
+        int len;
+
+        if (bus->rx.head >= bus->rx.tail)
+        {
+            // idle, wait here so the deframer does not log timeouts
+            int result = io_reactor_wait(&bus->port, 1);
+
+            if (result == -RIG_ENIMPL)
+            {
+                fd_set rfds;
+                struct timeval tv;
+
+                FD_ZERO(&rfds);
+                FD_SET(bus->port.fd, &rfds);
+                tv.tv_sec = 0;
+                tv.tv_usec = ICOM_CIV_BUS_POLL_MS * 1000;
+
+                result = select(bus->port.fd + 1, &rfds, NULL, NULL, &tv) > 0 ?
+                         RIG_OK : -RIG_ETIMEOUT;
+            }
+
+            if (result != RIG_OK)
+            {
+                continue;
+            }
+        }
+
+        len = icom_deframer_next(&bus->port, &bus->rx, 1, &frame);
+
+        if (len == -RIG_ETIMEOUT)
+        {
+            continue;
+        }
+
+        if (len < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, bus->pathname,
+                      rigerror(len));
+            hl_usleep(100 * 1000);
+            continue;
+        }
+
+        pthread_mutex_lock(&bus->lock);
+        icom_civ_bus_route(bus, frame, len);
+        pthread_mutex_unlock(&bus->lock);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped on %s\n", __func__, bus->pathname);
+
+    return NULL;
+}
+
+static int icom_civ_bus_open(struct icom_civ_bus *bus, RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+    int retval;
+
+    SNPRINTF(bus->pathname, sizeof(bus->pathname), "%s", rs->rigport.pathname);
+    bus->port = rs->rigport;
+    bus->port.timeout = ICOM_CIV_BUS_POLL_MS;
+    bus->port.timeout_retry = 0;
+    bus->port.retry = 0;
+    bus->echo = -1;
+    icom_deframer_reset(&bus->rx);
+
+    // reopened by the bus so the member's close cannot change the line settings
+    port_close(&rs->rigport, rs->rigport.type.rig);
+
+    retval = port_open(&bus->port);
+
+    if (retval != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: cannot open %s: %s\n", __func__, bus->pathname,
+                  rigerror(retval));
+        return retval;
+    }
+
+    pthread_mutex_init(&bus->wire, NULL);
+    pthread_mutex_init(&bus->lock, NULL);
+    pthread_cond_init(&bus->cond, NULL);
+
+    bus->run = 1;
+
+    if (pthread_create(&bus->thread, NULL, icom_civ_bus_reader, bus))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        port_close(&bus->port, bus->port.type.rig);
+        pthread_mutex_destroy(&bus->wire);
+        pthread_mutex_destroy(&bus->lock);
+        pthread_cond_destroy(&bus->cond);
+        return -RIG_EINTERNAL;
+    }
+
+    return RIG_OK;
+}
+
+static void icom_civ_bus_close(struct icom_civ_bus *bus)
+{
+    bus->run = 0;
+    pthread_join(bus->thread, NULL);
+    port_close(&bus->port, bus->port.type.rig);
+    pthread_mutex_destroy(&bus->wire);
+    pthread_mutex_destroy(&bus->lock);
+    pthread_cond_destroy(&bus->cond);
+}
+
+/*
+ * Join the bus of the rig's port, creating it for the first rig.
+ * Called by icom_rig_open() with the port opened by the frontend.
+ */
+int icom_civ_bus_attach(RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+    struct icom_priv_data *priv = (struct icom_priv_data *) rs->priv;
+    struct icom_civ_bus *bus = NULL;
+    struct icom_civ_bus_member *m = NULL;
+    int slot = -1;
+    int i, retval;
+
+    ENTERFUNC;
+
+    if (rs->async_data_enabled)
+    {
+        rig_debug(RIG_DEBUG_ERR,
+                  "%s: async cannot be used with civ_bus, the bus processes transceive frames\n",
+                  __func__);
+        RETURNFUNC(-RIG_ECONF);
+    }
+
+    if (rs->rigport.type.rig != RIG_PORT_SERIAL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: civ_bus needs a serial port\n", __func__);
+        RETURNFUNC(-RIG_ECONF);
+    }
+
+    pthread_mutex_lock(&icom_civ_buses_lock);
+
+    for (i = 0; i < ICOM_CIV_BUS_MAX; i++)
+    {
+        if (icom_civ_buses[i]
+                && strcmp(icom_civ_buses[i]->pathname, rs->rigport.pathname) == 0)
+        {
+            bus = icom_civ_buses[i];
+            break;
+        }
+
+        if (icom_civ_buses[i] == NULL && slot < 0)
+        {
+            slot = i;
+        }
+    }
+
+    if (bus == NULL)
+    {
+        if (slot < 0)
+        {
+            pthread_mutex_unlock(&icom_civ_buses_lock);
+            rig_debug(RIG_DEBUG_ERR, "%s: more than %d CI-V buses\n", __func__,
+                      ICOM_CIV_BUS_MAX);
+            RETURNFUNC(-RIG_ENOMEM);
+        }
+
+        bus = calloc(1, sizeof(*bus));
+
+        if (bus == NULL)
+        {
+            pthread_mutex_unlock(&icom_civ_buses_lock);
+            RETURNFUNC(-RIG_ENOMEM);
+        }
+
+        retval = icom_civ_bus_open(bus, rig);
+
+        if (retval != RIG_OK)
+        {
+            pthread_mutex_unlock(&icom_civ_buses_lock);
+            free(bus);
+            RETURNFUNC(retval);
+        }
+
+        icom_civ_buses[slot] = bus;
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: new CI-V bus on %s\n", __func__,
+                  bus->pathname);
+    }
+    else
+    {
+        pthread_mutex_lock(&bus->lock);
+
+        for (i = 0; i < ICOM_CIV_BUS_MEMBERS; i++)
+        {
+            if (bus->member[i].rig && bus->member[i].addr == priv->re_civ_addr)
+            {
+                break;
+            }
+        }
+
+        pthread_mutex_unlock(&bus->lock);
+
+        if (i < ICOM_CIV_BUS_MEMBERS || bus->users == ICOM_CIV_BUS_MEMBERS)
+        {
+            pthread_mutex_unlock(&icom_civ_buses_lock);
+            rig_debug(RIG_DEBUG_ERR, "%s: CI-V address %02x is already used on %s"
+                      " or the bus is full\n", __func__, priv->re_civ_addr, bus->pathname);
+            RETURNFUNC(-RIG_ECONF);
+        }
+
+        if (rs->rigport.parm.serial.rate != bus->port.parm.serial.rate)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: %s is already open at %d baud, ignoring %d\n",
+                      __func__, bus->pathname, bus->port.parm.serial.rate,
+                      rs->rigport.parm.serial.rate);
+        }
+
+        port_close(&rs->rigport, rs->rigport.type.rig);
+    }
+
+    pthread_mutex_lock(&bus->lock);
+
+    for (i = 0; bus->member[i].rig != NULL; i++) { }
+
+    m = &bus->member[i];
+    memset(m, 0, sizeof(*m));
+    m->rig = rig;
+    m->addr = priv->re_civ_addr;
+    bus->users++;
+
+    pthread_mutex_unlock(&bus->lock);
+
+    // the frontend closes this one, never read
+    rs->rigport.fd = dup(bus->port.fd);
+    priv->civ_bus = bus;
+
+    pthread_mutex_unlock(&icom_civ_buses_lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: CI-V address %02x joined %s, %d rigs\n",
+              __func__, m->addr, bus->pathname, bus->users);
+
+    RETURNFUNC(RIG_OK);
+}
+
+/*
+ * Leave the bus, the last rig closes the port.
+ */
+void icom_civ_bus_detach(RIG *rig)
+{
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    struct icom_civ_bus *bus = priv->civ_bus;
+    struct icom_civ_bus_member *m;
+    int i;
+
+    if (bus == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&icom_civ_buses_lock);
+    pthread_mutex_lock(&bus->lock);
+
+    m = icom_civ_bus_member(bus, rig);
+
+    if (m)
+    {
+        while (m->dispatching)
+        {
+            pthread_cond_wait(&bus->cond, &bus->lock);
+        }
+
+        m->rig = NULL;
+        bus->users--;
+    }
+
+    pthread_mutex_unlock(&bus->lock);
+
+    if (bus->users == 0)
+    {
+        for (i = 0; i < ICOM_CIV_BUS_MAX; i++)
+        {
+            if (icom_civ_buses[i] == bus)
+            {
+                icom_civ_buses[i] = NULL;
+            }
+        }
+
+        icom_civ_bus_close(bus);
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: closed CI-V bus on %s\n", __func__,
+                  bus->pathname);
+        free(bus);
+    }
+
+    pthread_mutex_unlock(&icom_civ_buses_lock);
+
+    priv->civ_bus = NULL;
+}
+
+/*
+ * Send a frame made by icom_one_transaction() and wait for the reply
+ * routed to this rig.  Returns like icom_one_transaction().
+ */
+int icom_civ_bus_transaction(RIG *rig, const unsigned char *sendbuf,
+                             int send_len, unsigned char *data, int *data_len)
+{
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    struct icom_civ_bus *bus = priv->civ_bus;
+    struct icom_civ_bus_member *m;
+    struct timespec deadline;
+    int timeout = rig->state.rigport.timeout;
+    int collision_retry = 0;
+    int wire = 0;
+    int retval, frm_len;
+
+    if (data_len) { *data_len = 0; }
+
+    m = icom_civ_bus_member(bus, rig);
+
+    if (m == NULL)
+    {
+        return -RIG_EINTERNAL;
+    }
+
+retry:
+    pthread_mutex_lock(&bus->wire);
+    wire = 1;
+
+    pthread_mutex_lock(&bus->lock);
+    m->ctrl = sendbuf[3];
+    m->waiting = data_len != NULL;
+    m->reply_len = 0;
+    bus->echo_frame = sendbuf;
+    bus->echo_len = send_len;
+    bus->echo_state = ICOM_CIV_BUS_ECHO_WAIT;
+    pthread_mutex_unlock(&bus->lock);
+
+    retval = write_block(&bus->port, sendbuf, send_len);
+
+    pthread_mutex_lock(&bus->lock);
+
+    if (retval != RIG_OK)
+    {
+        goto done;
+    }
+
+    icom_civ_bus_deadline(&deadline, timeout);
+
+    // the wire is ours until our echo is back, or the reply on a bus without echo
+    while (bus->echo_state == ICOM_CIV_BUS_ECHO_WAIT && bus->echo != 0
+            && (m->waiting || data_len == NULL))
+    {
+        if (pthread_cond_timedwait(&bus->cond, &bus->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    if (bus->echo_state == ICOM_CIV_BUS_ECHO_COLLISION)
+    {
+        bus->echo_state = ICOM_CIV_BUS_ECHO_IDLE;
+        m->waiting = 0;
+        pthread_mutex_unlock(&bus->lock);
+        pthread_mutex_unlock(&bus->wire);
+
+        if (collision_retry++ < 20)
+        {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: collision retry#%d\n", __func__,
+                      collision_retry);
+            hl_usleep(20 * 1000);
+            goto retry;
+        }
+
+        return -RIG_BUSBUSY;
+    }
+
+    if (bus->echo_state == ICOM_CIV_BUS_ECHO_WAIT && bus->echo == 1)
+    {
+        /* Nothing received, CI-V interface is not echoing */
+        retval = -RIG_BUSERROR;
+        goto done;
+    }
+
+    if (bus->echo_state == ICOM_CIV_BUS_ECHO_SEEN)
+    {
+        // others may send while we wait for the reply
+        pthread_mutex_unlock(&bus->wire);
+        wire = 0;
+    }
+
+    bus->echo_state = ICOM_CIV_BUS_ECHO_IDLE;
+    bus->echo_frame = NULL;
+
+    if (data_len == NULL)
+    {
+        retval = RIG_OK;
+        goto done;
+    }
+
+    while (m->waiting)
+    {
+        if (pthread_cond_timedwait(&bus->cond, &bus->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    if (m->waiting)
+    {
+        if (priv->re_civ_addr != ((struct icom_priv_caps *) rig->caps->priv)->re_civ_addr)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: Icom timeout civ expected=%02x, used=%02x\n",
+                      __func__, ((struct icom_priv_caps *) rig->caps->priv)->re_civ_addr,
+                      priv->re_civ_addr);
+        }
+
+        retval = -RIG_ETIMEOUT;
+        goto done;
+    }
+
+    frm_len = m->reply_len;
+
+    // if we send a bad command we will get back a NAK packet
+    // e.g. fe fe e0 50 fa fd
+    if (frm_len == 6 && NAK == m->reply[frm_len - 2])
+    {
+        retval = -RIG_ERJCTED;
+        goto done;
+    }
+
+    *data_len = frm_len - (ACKFRMLEN - 1);
+
+    if (data != NULL) { memcpy(data, m->reply + 4, *data_len); }
+
+    retval = RIG_OK;
+
+done:
+    if (bus->echo_frame == sendbuf)
+    {
+        bus->echo_state = ICOM_CIV_BUS_ECHO_IDLE;
+        bus->echo_frame = NULL;
+    }
+
+    m->waiting = 0;
+    pthread_mutex_unlock(&bus->lock);
+
+    if (wire)
+    {
+        pthread_mutex_unlock(&bus->wire);
+    }
+
+    return retval;
+}
+
+/*
+ * Write raw bytes that are not a frame, e.g. the 0xfe wake up run of
+ * icom_set_powerstat(), while no other member is on the wire.  The
+ * reader drops their echo as preamble bytes.
+ */
+int icom_civ_bus_write(RIG *rig, const unsigned char *buf, int len)
+{
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    struct icom_civ_bus *bus = priv->civ_bus;
+    int retval;
+
+    pthread_mutex_lock(&bus->wire);
+    retval = write_block(&bus->port, buf, len);
+    pthread_mutex_unlock(&bus->wire);
+
+    return retval;
+}
+
+#else /* ICOM_CIV_BUS */
+
+int icom_civ_bus_attach(RIG *rig)
+{
+    rig_debug(RIG_DEBUG_ERR, "%s: civ_bus needs pthreads\n", __func__);
+    return -RIG_ENIMPL;
+}
+
+void icom_civ_bus_detach(RIG *rig)
+{
+}
+
+int icom_civ_bus_transaction(RIG *rig, const unsigned char *sendbuf,
+                             int send_len, unsigned char *data, int *data_len)
+{
+    return -RIG_ENIMPL;
+}
+
+int icom_civ_bus_write(RIG *rig, const unsigned char *buf, int len)
+{
+    return -RIG_ENIMPL;
+}
+
+#endif /* ICOM_CIV_BUS */
@@ -0,0 +1,34 @@
+/*
+ *  Hamlib CI-V backend - CI-V bus shared by several rigs
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _CIV_BUS_H
+#define _CIV_BUS_H 1
+
+#include "hamlib/rig.h"
+
+struct icom_civ_bus;
+
+int icom_civ_bus_attach(RIG *rig);
+void icom_civ_bus_detach(RIG *rig);
+int icom_civ_bus_transaction(RIG *rig, const unsigned char *sendbuf,
+                             int send_len, unsigned char *data, int *data_len);
+int icom_civ_bus_write(RIG *rig, const unsigned char *buf, int len);
+
+#endif /* _CIV_BUS_H */
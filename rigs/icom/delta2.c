@@ -154,6 +154,7 @@ const struct rig_caps delta2_caps =
     .decode_event =  icom_decode_event,
     .set_mem =  icom_set_mem,
     .vfo_op =  icom_vfo_op,
+    .write_through = -1,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
 };
 
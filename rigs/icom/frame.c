@@ -112,6 +112,51 @@ int icom_frame_fix_preamble(int frame_len, unsigned char *frame)
     return frame_len;
 }
 
+/*
+ * Transceive frames the rig sent since the last transaction update the
+ * cache before the port is used again, other frames still pending are
+ * stale replies and are dropped.  A frame only partly received stays in
+ * the deframer and is completed by the next read.
+ *
+ * return 1 when everything pending was handled, 0 when the port has to be
+ * flushed instead
+ */
+static int icom_process_pending(RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+    struct icom_priv_data *priv = (struct icom_priv_data *)rs->priv;
+    unsigned char *frame;
+    int i;
+
+    // a rig sending scope data may never be idle, flush after a while
+    for (i = 0; i < 64; i++)
+    {
+        int frm_len = icom_deframer_next(&rs->rigport, &priv->rx,
+                                         ICOM_DEFRAMER_PENDING, &frame);
+
+        if (frm_len == 0)
+        {
+            return 1;
+        }
+
+        if (frm_len < 0)
+        {
+            return 0;
+        }
+
+        if (icom_is_async_frame(rig, frm_len, frame))
+        {
+            icom_process_async_frame(rig, frm_len, frame);
+            continue;
+        }
+
+        rig_debug(RIG_DEBUG_TRACE, "%s: dropped stale frame\n", __func__);
+        dump_hex(frame, frm_len);
+    }
+
+    return 0;
+}
+
 /*
  * icom_one_transaction
  *
@@ -121,6 +166,10 @@ int icom_frame_fix_preamble(int frame_len, unsigned char *frame)
  * subcmd can be equal to -1 (no subcmd wanted)
  * if no answer is to be expected, data_len must be set to NULL to tell so
  *
+ * Frames come from the streaming deframer: our echo, transceive frames
+ * and the reply are taken in whatever order they arrive, transceive
+ * frames are processed in place.
+ *
  * return RIG_OK if transaction completed,
  * or a negative value otherwise indicating the error.
  */
@@ -132,37 +181,46 @@ int icom_one_transaction(RIG *rig, unsigned char cmd, int subcmd,
     const struct icom_priv_caps *priv_caps;
     struct rig_state *rs;
     struct timeval start_time, current_time, elapsed_time;
-    // this buf needs to be large enough for 0xfe strings for power up
-    // at 115,200 this is now at least 150
-    unsigned char buf[200];
     unsigned char sendbuf[MAXFRAMELEN];
-    int frm_len, frm_data_len, retval;
+    unsigned char *frame;
+    int frm_len, frm_data_len, send_len, retval;
     unsigned char ctrl_id;
     int collision_retry = 0;
+    int echo;
 
     ENTERFUNC;
-    memset(buf, 0, 200);
-    memset(sendbuf, 0, MAXFRAMELEN);
     rs = &rig->state;
     priv = (struct icom_priv_data *)rs->priv;
     priv_caps = (struct icom_priv_caps *)rig->caps->priv;
 
     ctrl_id = priv_caps->serial_full_duplex == 0 ? CTRLID : 0x80;
 
-    frm_len = make_cmd_frame(sendbuf, priv->re_civ_addr, ctrl_id, cmd,
-                             subcmd, payload, payload_len);
+    send_len = make_cmd_frame(sendbuf, priv->re_civ_addr, ctrl_id, cmd,
+                              subcmd, payload, payload_len);
 
     /*
      * should check return code and that write wrote cmd_len chars!
      */
     set_transaction_active(rig);
 
+    if (priv->civ_bus)
+    {
+        retval = icom_civ_bus_transaction(rig, sendbuf, send_len, data, data_len);
+        set_transaction_inactive(rig);
+        RETURNFUNC(retval);
+    }
+
 collision_retry:
-    rig_flush(&rs->rigport);
+
+    if (rs->rigport.asyncio || !icom_process_pending(rig))
+    {
+        rig_flush(&rs->rigport);
+        icom_deframer_reset(&priv->rx);
+    }
 
     if (data_len) { *data_len = 0; }
 
-    retval = write_block(&rs->rigport, sendbuf, frm_len);
+    retval = write_block(&rs->rigport, sendbuf, send_len);
 
     if (retval != RIG_OK)
     {
@@ -170,255 +228,159 @@ collision_retry:
         RETURNFUNC(retval);
     }
 
-    if (!priv_caps->serial_full_duplex && !priv->serial_USB_echo_off)
+    /*
+     * TX and RX are looped, so what we just sent comes back first
+     * - if what we read is not what we sent, then it means
+     *          a collision on the CI-V bus occurred!
+     */
+    echo = !priv_caps->serial_full_duplex && !priv->serial_USB_echo_off;
+
+    /*
+     * expect an answer?
+     */
+    if (!echo && data_len == NULL)
     {
+        set_transaction_inactive(rig);
+        RETURNFUNC(RIG_OK);
+    }
 
-        /*
-         * read what we just sent, because TX and RX are looped,
-         * and discard it...
-         * - if what we read is not what we sent, then it means
-         *          a collision on the CI-V bus occurred!
-         *      - if we get a timeout, then retry to send the frame,
-         *          up to rs->retry times.
-         */
+    gettimeofday(&start_time, NULL);
 
-        retval = read_icom_frame(&rs->rigport, buf, sizeof(buf));
+    for (;;)
+    {
+        frm_len = icom_deframer_next(&rs->rigport, &priv->rx, 0, &frame);
 
-        if (retval == -RIG_ETIMEOUT || retval == 0)
+        if (echo)
         {
-            /* Nothing received, CI-V interface is not echoing */
-            set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_BUSERROR);
-        }
+            if (frm_len == -RIG_ETIMEOUT)
+            {
+                /* Nothing received, CI-V interface is not echoing */
+                set_transaction_inactive(rig);
+                RETURNFUNC(-RIG_BUSERROR);
+            }
 
-        if (retval < 0)
-        {
-            set_transaction_inactive(rig);
-            /* Other error, return it */
-            RETURNFUNC(retval);
-        }
+            if (frm_len < 0)
+            {
+                /* Other error, return it */
+                set_transaction_inactive(rig);
+                RETURNFUNC(frm_len);
+            }
 
-        if (retval < 1)
-        {
-            set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_EPROTO);
-        }
+            if (frame[frm_len - 1] == COL)
+            {
+                // IC746 for example responds 0xfc when tuning is active so we will retry
+                if (collision_retry++ < 20)
+                {
+                    rig_debug(RIG_DEBUG_VERBOSE, "%s: collision retry#%d\n", __func__,
+                              collision_retry);
+                    hl_usleep(500 *
+                              1000); // 500ms 20 times for ~15 second max before we back out for a retry if needed
+                    goto collision_retry;
+                }
+
+                set_transaction_inactive(rig);
+                RETURNFUNC(-RIG_BUSBUSY);
+            }
 
-        // we might have 0xfe string during rig wakeup
-        rig_debug(RIG_DEBUG_TRACE, "%s: DEBUG retval=%d, frm_len=%d, cmd=0x%02x\n",
-                  __func__, retval, frm_len, cmd);
+            if (frm_len == send_len && memcmp(frame, sendbuf, send_len) == 0)
+            {
+                echo = 0;
 
-        if (retval != frm_len && cmd == C_SET_PWR)
-        {
-            rig_debug(RIG_DEBUG_TRACE, "%s: removing 0xfe power up echo, len=%d", __func__,
-                      frm_len);
+                if (data_len == NULL)
+                {
+                    set_transaction_inactive(rig);
+                    RETURNFUNC(RIG_OK);
+                }
 
-            while (buf[2] == 0xfe)
+                gettimeofday(&start_time, NULL);
+                continue;
+            }
+
+            // the rig got a transceive frame on the bus just before ours
+            if (icom_is_async_frame(rig, frm_len, frame))
             {
-                memmove(buf, &buf[1], frm_len--);
+                icom_process_async_frame(rig, frm_len, frame);
+                continue;
             }
 
-            dump_hex(buf, frm_len);
+            /* Problem on ci-v bus? */
+            /* Someone else got a packet in? */
+            rig_debug(RIG_DEBUG_TRACE, "%s: expected echo, got %d bytes\n", __func__,
+                      frm_len);
+            dump_hex(frame, frm_len);
+            set_transaction_inactive(rig);
+            RETURNFUNC(-RIG_EPROTO);
         }
 
-        switch (buf[retval - 1])
+        if (frm_len < 0)
         {
-        case COL:
+            set_transaction_inactive(rig);
 
-            /* Collision */
-            // IC746 for example responds 0xfc when tuning is active so we will retry
-            if (collision_retry++ < 20)
+            if (priv_caps->re_civ_addr != priv->re_civ_addr)
             {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: collision retry#%d\n", __func__,
-                          collision_retry);
-                hl_usleep(500 *
-                          1000); // 500ms 20 times for ~15 second max before we back out for a retry if needed
-                goto collision_retry;
+                rig_debug(RIG_DEBUG_ERR, "%s: Icom timeout civ expected=%02x, used=%02x\n",
+                          __func__, priv_caps->re_civ_addr, priv->re_civ_addr);
             }
 
-            set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_BUSBUSY);
-
-        case FI:
-            /* Ok, normal frame */
-            break;
-
-        default:
-            /* Timeout after reading at least one character */
-            /* Problem on ci-v bus? */
-            set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_BUSERROR);
+            /* RIG_TIMEOUT: timeout getting response, return timeout */
+            /* other error: return it */
+            RETURNFUNC(frm_len);
         }
 
-        if (retval != frm_len)
+        if (frame[frm_len - 1] == COL)
         {
-            /* Not the same length??? */
-            /* Problem on ci-v bus? */
-            /* Someone else got a packet in? */
             set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_EPROTO);
+            /* Collision */
+            RETURNFUNC(-RIG_BUSBUSY);
         }
 
-        if (memcmp(buf, sendbuf, frm_len) != 0)
+        if (frm_len < ACKFRMLEN)
         {
-            /* Frames are different? */
-            /* Problem on ci-v bus? */
-            /* Someone else got a packet in? */
             set_transaction_inactive(rig);
             RETURNFUNC(-RIG_EPROTO);
         }
-    }
 
-    /*
-     * expect an answer?
-     */
-    if (data_len == NULL)
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(RIG_OK);
-    }
-
-    gettimeofday(&start_time, NULL);
-
-read_another_frame:
-    /*
-     * wait for ACK ...
-     * FIXME: handle padding/collisions
-     * ACKFRMLEN is the smallest frame we can expect from the rig
-     */
-    buf[0] = 0;
-    frm_len = read_icom_frame(&rs->rigport, buf, sizeof(buf));
-
-#if 0
-
-    // this was causing rigctld to fail on IC706 and WSJT-X
-    // This dynamic detection is therefore disabled for now
-    if (memcmp(buf, sendbuf, frm_len) == 0 && priv->serial_USB_echo_off)
-    {
-        // Hmmm -- got an echo back when not expected so let's change
-        priv->serial_USB_echo_off = 0;
-        // And try again
-        frm_len = read_icom_frame(&rs->rigport, buf, sizeof(buf));
-    }
-
-#endif
-
-    if (frm_len < 0)
-    {
-        set_transaction_inactive(rig);
-
-        if (priv_caps->re_civ_addr != priv->re_civ_addr)
+        // if we send a bad command we will get back a NAK packet
+        // e.g. fe fe e0 50 fa fd
+        if (frm_len == 6 && NAK == frame[frm_len - 2])
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: Icom timeout civ expected=%02x, used=%02x\n",
-                      __func__, priv_caps->re_civ_addr, priv->re_civ_addr);
+            set_transaction_inactive(rig);
+            RETURNFUNC(-RIG_ERJCTED);
         }
 
-        /* RIG_TIMEOUT: timeout getting response, return timeout */
-        /* other error: return it */
-        RETURNFUNC(frm_len);
-    }
-
-    if (frm_len < 1)
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_EPROTO);
-    }
+        rig_debug(RIG_DEBUG_TRACE, "%s: frm_len=%d, frm_len-1=%02x, frm_len-2=%02x\n",
+                  __func__, frm_len, frame[frm_len - 1], frame[frm_len - 2]);
 
-    retval = icom_frame_fix_preamble(frm_len, buf);
+        frm_data_len = frm_len - (ACKFRMLEN - 1);
 
-    if (retval < 0)
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(retval);
-    }
-
-    frm_len = retval;
-
-    if (frm_len < 1)
-    {
-        rig_debug(RIG_DEBUG_ERR, "Unexpected frame len=%d\n", frm_len);
-        RETURNFUNC(-RIG_EPROTO);
-    }
-
-    switch (buf[frm_len - 1])
-    {
-    case COL:
-        set_transaction_inactive(rig);
-        /* Collision */
-        RETURNFUNC(-RIG_BUSBUSY);
-
-    case FI:
-        /* Ok, normal frame */
-        break;
-
-    case NAK:
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_ERJCTED);
-
-    default:
-        set_transaction_inactive(rig);
-        /* Timeout after reading at least one character */
-        /* Problem on ci-v bus? */
-        RETURNFUNC(-RIG_EPROTO);
-    }
-
-    if (frm_len < ACKFRMLEN)
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_EPROTO);
-    }
-
-    // if we send a bad command we will get back a NAK packet
-    // e.g. fe fe e0 50 fa fd
-    if (frm_len == 6 && NAK == buf[frm_len - 2])
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_ERJCTED);
-    }
-
-    rig_debug(RIG_DEBUG_TRACE, "%s: frm_len=%d, frm_len-1=%02x, frm_len-2=%02x\n",
-              __func__, frm_len, buf[frm_len - 1], buf[frm_len - 2]);
-
-    // has to be one of these two now or frame is corrupt
-    if (FI != buf[frm_len - 1] && ACK != buf[frm_len - 1])
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_BUSBUSY);
-    }
-
-    frm_data_len = frm_len - (ACKFRMLEN - 1);
-
-    if (frm_data_len <= 0)
-    {
-        set_transaction_inactive(rig);
-        RETURNFUNC(-RIG_EPROTO);
-    }
+        // TODO: Does ctrlid (detected by icom_is_async_frame) vary (seeing some code above using 0x80 for non-full-duplex)?
+        if (icom_is_async_frame(rig, frm_len, frame))
+        {
+            int elapsed_ms;
+            icom_process_async_frame(rig, frm_len, frame);
 
-    // TODO: Does ctrlid (detected by icom_is_async_frame) vary (seeing some code above using 0x80 for non-full-duplex)?
-    if (icom_is_async_frame(rig, frm_len, buf))
-    {
-        int elapsed_ms;
-        icom_process_async_frame(rig, frm_len, buf);
+            gettimeofday(&current_time, NULL);
+            timersub(&current_time, &start_time, &elapsed_time);
 
-        gettimeofday(&current_time, NULL);
-        timersub(&current_time, &start_time, &elapsed_time);
+            elapsed_ms = (int)(elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000);
 
-        elapsed_ms = (int)(elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000);
+            if (elapsed_ms > rs->rigport.timeout)
+            {
+                set_transaction_inactive(rig);
+                RETURNFUNC(-RIG_ETIMEOUT);
+            }
 
-        if (elapsed_ms > rs->rigport.timeout)
-        {
-            set_transaction_inactive(rig);
-            RETURNFUNC(-RIG_ETIMEOUT);
+            continue;
         }
 
-        goto read_another_frame;
+        break;
     }
 
     set_transaction_inactive(rig);
 
     *data_len = frm_data_len;
 
-    if (data != NULL && data_len != NULL) { memcpy(data, buf + 4, *data_len); }
+    if (data != NULL) { memcpy(data, frame + 4, frm_data_len); }
 
     /*
      * TODO: check addresses in reply frame
@@ -565,6 +527,157 @@ int read_icom_frame_direct(hamlib_port_t *p, const unsigned char rxbuffer[],
     return read_icom_frame_generic(p, rxbuffer, rxbuffer_len, 1);
 }
 
+/*
+ * Drop everything buffered, e.g. after a port flush.
+ */
+void icom_deframer_reset(struct icom_deframer *d)
+{
+    d->head = d->tail = 1;
+}
+
+/*
+ * Get the next CI-V frame from the port.
+ *
+ * Reads as many bytes as the port has in one go and splits them into
+ * frames: noise before a preamble is skipped, runs of 0xfe (rig wake up)
+ * are reduced to two, a missing second 0xfe is put back and a frame cut
+ * short by a new preamble is dropped.  A collision ends the frame early,
+ * the frame returned then ends with 0xfc instead of 0xfd.
+ *
+ * *frame points into the deframer buffer and is valid until the next call.
+ * With direct == ICOM_DEFRAMER_PENDING it does not wait and returns 0 when
+ * no complete frame has been received yet.
+ *
+ * return the frame length, or a negative value on error/timeout
+ */
+int icom_deframer_next(hamlib_port_t *p, struct icom_deframer *d, int direct,
+                       unsigned char **frame)
+{
+    int retries = 10;
+
+    if (d->head < 1 || d->head > d->tail)
+    {
+        icom_deframer_reset(d);
+    }
+
+    for (;;)
+    {
+        int start = d->head;
+        int truncated = 0;
+        int i, n;
+
+        while (start < d->tail && d->buf[start] != PR && d->buf[start] != COL)
+        {
+            start++;
+        }
+
+        if (start > d->head)
+        {
+            rig_debug(RIG_DEBUG_TRACE, "%s: skipped %d bytes of noise\n", __func__,
+                      start - d->head);
+            d->head = start;
+        }
+
+        if (start < d->tail && d->buf[start] == COL)
+        {
+            // jammer outside of a frame
+            d->head = start + 1;
+            *frame = &d->buf[start];
+            return 1;
+        }
+
+        while (start + 2 < d->tail && d->buf[start + 1] == PR
+                && d->buf[start + 2] == PR)
+        {
+            start++;
+        }
+
+        for (i = start + 1; i < d->tail; i++)
+        {
+            unsigned char c = d->buf[i];
+
+            if (c == FI || c == COL)
+            {
+                break;
+            }
+
+            if (c == PR && i > start + 1 && d->buf[i - 1] != PR)
+            {
+                truncated = 1;
+                break;
+            }
+        }
+
+        if (truncated)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: dropped a truncated frame\n", __func__);
+            d->head = i;
+            continue;
+        }
+
+        if (i < d->tail && i - start + 1 <= MAXFRAMELEN)
+        {
+            // sometimes the second preamble byte is missing
+            if (d->buf[start + 1] != PR)
+            {
+                d->buf[--start] = PR;
+            }
+
+            d->head = i + 1;
+            *frame = &d->buf[start];
+            return i - start + 1;
+        }
+
+        if (i - start >= MAXFRAMELEN)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: dropped %d bytes without end of frame\n",
+                      __func__, i - start);
+            d->head = i;
+            continue;
+        }
+
+        // need more, keep the partial frame and buf[0] free
+        if (d->head > 1)
+        {
+            memmove(d->buf + 1, d->buf + d->head, d->tail - d->head);
+            d->tail -= d->head - 1;
+            d->head = 1;
+        }
+
+        if (direct == ICOM_DEFRAMER_PENDING)
+        {
+            n = read_block_pending_direct(p, d->buf + d->tail,
+                                          ICOM_DEFRAMER_BUFSZ - d->tail);
+
+            if (n == 0)
+            {
+                return 0;
+            }
+        }
+        else if (direct)
+        {
+            n = read_block_partial_direct(p, d->buf + d->tail,
+                                          ICOM_DEFRAMER_BUFSZ - d->tail);
+        }
+        else
+        {
+            n = read_block_partial(p, d->buf + d->tail, ICOM_DEFRAMER_BUFSZ - d->tail);
+        }
+
+        if (n < 0)
+        {
+            return n;
+        }
+
+        if (n == 0 && --retries <= 0)
+        {
+            return -RIG_ETIMEOUT;
+        }
+
+        d->tail += n;
+    }
+}
+
 /*
  * convert mode and width as expressed by Hamlib frontend
  * to mode and passband data understandable by a CI-V rig
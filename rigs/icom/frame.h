@@ -29,6 +29,24 @@
 // Has to be big enough for 0xfe sequence to wake up rig
 #define MAXFRAMELEN 200
 
+// bytes buffered by the deframer, several frames per read
+#define ICOM_DEFRAMER_BUFSZ 1024
+
+// icom_deframer_next() "direct" value: only what the rig has already sent
+#define ICOM_DEFRAMER_PENDING 2
+
+/*
+ * Streaming CI-V deframer: bytes are read in bulk and frames are handed
+ * out as pointers into buf, valid until the next call.
+ * buf[0] is kept free to restore a missing second preamble byte in place.
+ */
+struct icom_deframer
+{
+    unsigned char buf[ICOM_DEFRAMER_BUFSZ];
+    int head;   /* first byte not handed out yet */
+    int tail;   /* end of the bytes read */
+};
+
 /*
  * helper functions
  */
@@ -41,6 +59,9 @@ int icom_transaction (RIG *rig, int cmd, int subcmd, const unsigned char *payloa
 int read_icom_frame(hamlib_port_t *p, const unsigned char rxbuffer[], size_t rxbuffer_len);
 int read_icom_frame_direct(hamlib_port_t *p, const unsigned char rxbuffer[], size_t rxbuffer_len);
 
+void icom_deframer_reset(struct icom_deframer *d);
+int icom_deframer_next(hamlib_port_t *p, struct icom_deframer *d, int direct, unsigned char **frame);
+
 int rig2icom_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width, unsigned char *md, signed char *pd);
 void icom2rig_mode(RIG *rig, unsigned char md, int pd, rmode_t *mode, pbwidth_t *width);
 
@@ -39,6 +39,7 @@
 #include "frame.h"
 #include "misc.h"
 #include "event.h"
+#include "probe.h"
 
 // we automatically determine availability of the 1A 03 command
 enum { ENUM_1A_03_UNK, ENUM_1A_03_YES, ENUM_1A_03_NO };
@@ -434,6 +435,7 @@ struct icom_addr
 #define TOK_CIVADDR TOKEN_BACKEND(1)
 #define TOK_MODE731 TOKEN_BACKEND(2)
 #define TOK_NOXCHG TOKEN_BACKEND(3)
+#define TOK_CIV_BUS TOKEN_BACKEND(4)
 
 const struct confparams icom_cfg_params[] =
 {
@@ -451,6 +453,12 @@ const struct confparams icom_cfg_params[] =
         "Don't Use VFO XCHG to set other VFO mode and Frequency",
         "0", RIG_CONF_CHECKBUTTON
     },
+    {
+        TOK_CIV_BUS, "civ_bus", "Shared CI-V bus",
+        "Share the port with other Icom rigs opened on it in this process, "
+        "each needs its own civaddr",
+        "0", RIG_CONF_CHECKBUTTON
+    },
     {RIG_CONF_END, NULL,}
 };
 
@@ -585,6 +593,7 @@ static const struct icom_addr icom_addr_list[] =
     {RIG_MODEL_ICR8500, 0x4a},
     {RIG_MODEL_ICR9000, 0x2a},
     {RIG_MODEL_ICR9500, 0x72},
+    {RIG_MODEL_IC7300, 0x94},
     {RIG_MODEL_MINISCOUT, 0x94},
     {RIG_MODEL_IC718, 0x5e},
     {RIG_MODEL_OS535, 0x80},  /* same address as IC-7410 */
@@ -599,6 +608,8 @@ static const struct icom_addr icom_addr_list[] =
     {RIG_MODEL_X6100, 0x70},
     {RIG_MODEL_ICR8600, 0x96},
     {RIG_MODEL_ICR30, 0x9c},
+    {RIG_MODEL_IC705, 0xa4},
+    {RIG_MODEL_IC905, 0xac},
     {RIG_MODEL_NONE, 0},
 };
 
@@ -787,11 +798,11 @@ int icom_get_usb_echo_off(RIG *rig)
 
     if (ack_len == 1) // then we got an echo of the cmd
     {
-        unsigned char buf[16];
+        unsigned char *frame;
         priv->serial_USB_echo_off = 0;
         // we should have a freq response so we'll read it and don't really care
         // flushing doesn't always work as it depends on timing
-        retval = read_icom_frame(&rs->rigport, buf, sizeof(buf));
+        retval = icom_deframer_next(&rs->rigport, &priv->rx, 0, &frame);
         rig_debug(RIG_DEBUG_VERBOSE, "%s: USB echo on detected, get freq retval=%d\n",
                   __func__, retval);
 
@@ -971,12 +982,45 @@ static void icom_satmode_fix(RIG *rig, int satmode)
     }
 }
 
+static int icom_rig_open_radio(RIG *rig);
+
 /*
  * ICOM rig open routine
- * Detect echo state of USB serial port
+ * Join the shared CI-V bus if asked to and talk to the radio
  */
 int
 icom_rig_open(RIG *rig)
+{
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    int retval;
+
+    ENTERFUNC;
+
+    if (priv->use_civ_bus)
+    {
+        retval = icom_civ_bus_attach(rig);
+
+        if (retval != RIG_OK)
+        {
+            RETURNFUNC(retval);
+        }
+    }
+
+    retval = icom_rig_open_radio(rig);
+
+    if (retval != RIG_OK)
+    {
+        icom_civ_bus_detach(rig);
+    }
+
+    RETURNFUNC(retval);
+}
+
+/*
+ * Detect echo state of USB serial port
+ */
+static int
+icom_rig_open_radio(RIG *rig)
 {
     int retval, retval_echo;
     int satmode = 0;
@@ -1141,8 +1185,6 @@ icom_rig_close(RIG *rig)
 
     ENTERFUNC;
 
-    if (priv->poweron == 0) { RETURNFUNC(RIG_OK); } // nothing to do
-
     if (priv->poweron == 1 && rs->auto_power_off)
     {
         // maybe we need power off?
@@ -1158,11 +1200,14 @@ icom_rig_close(RIG *rig)
 
             rig_debug(RIG_DEBUG_WARN, "%s: rig_set_powerstat failed: =%s\n", __func__,
                       rigerror(retval));
+            icom_civ_bus_detach(rig);
             RETURNFUNC(retval);
         }
 
     }
 
+    icom_civ_bus_detach(rig);
+
     RETURNFUNC(RIG_OK);
 }
 
@@ -5038,6 +5083,14 @@ int icom_set_conf(RIG *rig, token_t token, const char *val)
         priv->no_xchg = atoi(val) ? 1 : 0;
         break;
 
+    case TOK_CIV_BUS:
+        priv->use_civ_bus = atoi(val) ? 1 : 0;
+
+        // the bus reader processes transceive frames instead
+        if (priv->use_civ_bus) { rig->state.async_data_enabled = 0; }
+
+        break;
+
     default:
         RETURNFUNC(-RIG_EINVAL);
     }
@@ -5071,6 +5124,9 @@ int icom_get_conf2(RIG *rig, token_t token, char *val, int val_len)
     case TOK_NOXCHG: SNPRINTF(val, val_len, "%d", priv->no_xchg);
         break;
 
+    case TOK_CIV_BUS: SNPRINTF(val, val_len, "%d", priv->use_civ_bus);
+        break;
+
     default: RETURNFUNC(-RIG_EINVAL);
     }
 
@@ -8090,7 +8146,16 @@ int icom_set_powerstat(RIG *rig, powerstat_t status)
         // we'll just send a few more to be sure for all speeds
         memset(fe_buf, 0xfe, fe_max);
         // sending more than enough 0xfe's to wake up the rs232
-        write_block(&rs->rigport, fe_buf, fe_max);
+        if (priv->civ_bus)
+        {
+            // not in the middle of another rig's frame on the shared bus
+            icom_civ_bus_write(rig, fe_buf, fe_max);
+        }
+        else
+        {
+            write_block(&rs->rigport, fe_buf, fe_max);
+        }
+
         hl_usleep(200 *
                   1000); // need to wait a bit for RigPI and others to queue the echo
 
@@ -9119,7 +9184,17 @@ int icom_process_async_frame(RIG *rig, size_t frame_length,
         // TODO: The freq length might be less than 4 or 5 bytes on older rigs!
         // TODO: Disable cache timeout for frequency after first transceive packet once we figure out how to get active VFO reliably with transceive updates
         // TODO: rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_FREQ, HAMLIB_CACHE_ALWAYS);
-        freq_t freq = (freq_t) from_bcd(frame + 5, (priv->civ_731_mode ? 4 : 5) * 2);
+        int freq_len = priv->civ_731_mode ? 4 : 5;
+        freq_t freq;
+
+        if (frame_length < 5 + freq_len + 1)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: short transceive frequency frame, len=%d\n",
+                      __func__, (int) frame_length);
+            RETURNFUNC(-RIG_EPROTO);
+        }
+
+        freq = (freq_t) from_bcd(frame + 5, freq_len * 2);
         rig_fire_freq_event(rig, RIG_VFO_CURR, freq);
 
 #if 0
@@ -9176,15 +9251,15 @@ int icom_decode_event(RIG *rig)
 {
     struct icom_priv_data *priv;
     struct rig_state *rs;
-    unsigned char buf[MAXFRAMELEN];
-    int retval, frm_len;
+    unsigned char *buf;
+    int frm_len;
 
     ENTERFUNC;
 
     rs = &rig->state;
     priv = (struct icom_priv_data *) rs->priv;
 
-    frm_len = read_icom_frame(&rs->rigport, buf, sizeof(buf));
+    frm_len = icom_deframer_next(&rs->rigport, &priv->rx, 0, &buf);
 
     if (frm_len == -RIG_ETIMEOUT)
     {
@@ -9198,21 +9273,6 @@ int icom_decode_event(RIG *rig)
         RETURNFUNC(RIG_OK);
     }
 
-    retval = icom_frame_fix_preamble(frm_len, buf);
-
-    if (retval < 0)
-    {
-        RETURNFUNC(retval);
-    }
-
-    frm_len = retval;
-
-    if (frm_len < 1)
-    {
-        rig_debug(RIG_DEBUG_ERR, "Unexpected frame len=%d\n", frm_len);
-        RETURNFUNC(-RIG_EPROTO);
-    }
-
 
     switch (buf[frm_len - 1])
     {
@@ -9243,7 +9303,25 @@ int icom_decode_event(RIG *rig)
 int icom_read_frame_direct(RIG *rig, size_t buffer_length,
                            const unsigned char *buffer)
 {
-    return read_icom_frame_direct(&rig->state.rigport, buffer, buffer_length);
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    unsigned char *frame;
+    int frm_len;
+
+    frm_len = icom_deframer_next(&rig->state.rigport, &priv->rx_direct, 1, &frame);
+
+    if (frm_len < 0)
+    {
+        return frm_len;
+    }
+
+    if (frm_len > buffer_length)
+    {
+        frm_len = buffer_length;
+    }
+
+    memcpy((unsigned char *) buffer, frame, frm_len);
+
+    return frm_len;
 }
 
 int icom_set_raw(RIG *rig, int cmd, int subcmd, int subcmdbuflen,
@@ -9851,6 +9929,67 @@ DECLARE_PROBERIG_BACKEND(icom)
     return (model);
 }
 
+/*
+ * icom_probe_civ_id
+ * Models at CI-V address civ_id, for the probing of src/probe.c
+ */
+int icom_probe_civ_id(unsigned char civ_id, struct probe_candidate *cand,
+                      int max)
+{
+    int i, n = 0;
+
+    for (i = 0; icom_addr_list[i].model != RIG_MODEL_NONE && n < max; i++)
+    {
+        if (icom_addr_list[i].re_civ_addr == civ_id)
+        {
+            cand[n].model = icom_addr_list[i].model;
+            cand[n++].confidence = 100;
+        }
+    }
+
+    return n;
+}
+
+/*
+ * icom_probe_civ_addrs
+ * The addresses of icom_addr_list, those of current rigs first
+ */
+int icom_probe_civ_addrs(unsigned char *addr, int max)
+{
+    static const unsigned char likely[] =
+    {
+        0x94, /* IC-7300 */
+        0xa4, /* IC-705 */
+        0xa2, /* IC-9700 */
+        0x98, /* IC-7610 */
+        0x88, /* IC-7100 */
+        0x70, /* IC-7000, Xiegu */
+        0x58, /* IC-706MkIIG */
+        0x8e, /* IC-7851 */
+        0x76, /* IC-7200 */
+        0x80, /* IC-7410 */
+        0x7a, /* IC-7600 */
+    };
+    int i, j, n = 0;
+
+    for (i = 0; i < (int)sizeof(likely) && n < max; i++)
+    {
+        addr[n++] = likely[i];
+    }
+
+    for (i = 0; icom_addr_list[i].model != RIG_MODEL_NONE && n < max; i++)
+    {
+        for (j = 0; j < n && addr[j] != icom_addr_list[i].re_civ_addr; j++) {}
+
+        if (j == n)
+        {
+            addr[n++] = icom_addr_list[i].re_civ_addr;
+        }
+    }
+
+    return n;
+}
+
 /*
  * initrigs_icom is called by rig_backend_load
  */
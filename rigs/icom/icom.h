@@ -30,6 +30,8 @@
 #include "cal.h"
 #include "tones.h"
 #include "idx_builtin.h"
+#include "frame.h"
+#include "civ_bus.h"
 
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
@@ -279,6 +281,10 @@ struct icom_priv_data
     struct icom_spectrum_scope_cache spectrum_scope_cache[HAMLIB_MAX_SPECTRUM_SCOPES]; /*!< Cached Icom spectrum scope data used during reception of the data. The array index must match the scope ID. */
     freq_t other_freq; /*!< Our other freq depending on which vfo is selected */
     int vfo_flag; // used to skip vfo check when frequencies are equal
+    struct icom_deframer rx; /*!< Frames read by transactions */
+    struct icom_deframer rx_direct; /*!< Frames read directly from the device by the async data handler */
+    int use_civ_bus; /*!< Share the port with other rigs opened on it, see civ_bus.c */
+    struct icom_civ_bus *civ_bus; /*!< The shared bus while open */
 };
 
 extern const struct ts_sc_list r8500_ts_sc_list[];
@@ -380,6 +380,36 @@ int elecraft_close(RIG *rig)
     return kenwood_close(rig);
 }
 
+
+/* elecraft_set_serial_rate()
+ *
+ * BR switches the rig at once and answers nothing, so the command is
+ * written without the read back of kenwood_transaction()
+ */
+int elecraft_set_serial_rate(RIG *rig, int rate)
+{
+    char cmd[8];
+    int n;
+
+    switch (rate)
+    {
+    case 4800: n = 0; break;
+
+    case 9600: n = 1; break;
+
+    case 19200: n = 2; break;
+
+    case 38400: n = 3; break;
+
+    default:
+        return -RIG_EINVAL;
+    }
+
+    SNPRINTF(cmd, sizeof(cmd), "BR%d;", n);
+
+    return write_block(&rig->state.rigport, (unsigned char *) cmd, strlen(cmd));
+}
+
 /* Private helper functions */
 
 /* Tests for Kenwood ID string of "017" */
@@ -76,6 +76,7 @@ extern const struct confparams elecraft_ext_levels[];
 /* Elecraft extension function declarations */
 int elecraft_open(RIG *rig);
 int elecraft_close(RIG *rig);
+int elecraft_set_serial_rate(RIG *rig, int rate);
 
 /* S-meter calibration tables */
 
@@ -332,6 +332,7 @@ const struct rig_caps k3_caps =
     .set_ant =      kenwood_set_ant_no_ack,
     .get_ant =      kenwood_get_ant,
     .send_morse =       kenwood_send_morse,
+    .set_serial_rate =  elecraft_set_serial_rate,
     .wait_morse =       rig_wait_morse,
     .power2mW =     k3_power2mW,
 
@@ -485,6 +486,7 @@ const struct rig_caps k3s_caps =
     .set_ant =      kenwood_set_ant_no_ack,
     .get_ant =      kenwood_get_ant,
     .send_morse =       kenwood_send_morse,
+    .set_serial_rate =  elecraft_set_serial_rate,
     .wait_morse =       rig_wait_morse,
     .power2mW =     k3_power2mW,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
@@ -794,6 +796,7 @@ const struct rig_caps kx3_caps =
     .set_ant =      kenwood_set_ant_no_ack,
     .get_ant =      kenwood_get_ant,
     .send_morse =       kenwood_send_morse,
+    .set_serial_rate =  elecraft_set_serial_rate,
     .wait_morse =       rig_wait_morse,
     .power2mW =     k3_power2mW,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
@@ -945,6 +948,7 @@ const struct rig_caps kx2_caps =
     .set_ant =      kenwood_set_ant_no_ack,
     .get_ant =      kenwood_get_ant,
     .send_morse =       kenwood_send_morse,
+    .set_serial_rate =  elecraft_set_serial_rate,
     .wait_morse =       rig_wait_morse,
     .power2mW =     k3_power2mW,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
@@ -35,6 +35,8 @@
 #include "cal.h"
 #include "cache.h"
 #include "misc.h"
+#include "event.h"
+#include "probe.h"
 
 #include "kenwood.h"
 #include "ts990s.h"
@@ -302,6 +304,21 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data,
 
 transaction_write:
 
+    /*
+     * the async data handler must hand this reply to us, not treat it as AI,
+     * the reply to the verify command when nothing else is expected
+     */
+    priv->async_reply[0] = '\0';
+
+    if (cmdstr)
+    {
+        const char *reply = datasize ? cmdstr : priv->verify_cmd;
+
+        strncpy(priv->async_reply, reply, sizeof(priv->async_reply) - 1);
+        priv->async_reply[sizeof(priv->async_reply) - 1] = '\0';
+        priv->async_reply[strcspn(priv->async_reply, cmdtrm_str)] = '\0';
+    }
+
     if (cmdstr)
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cmdstr = %s\n", __func__, cmdstr);
@@ -655,6 +672,7 @@ transaction_quit:
         strncpy(priv->last_if_response, buffer, caps->if_len);
     }
 
+    priv->async_reply[0] = '\0';
     rs->transaction_active = 0;
     RETURNFUNC2(retval);
 }
@@ -1050,9 +1068,16 @@ int kenwood_open(RIG *rig)
             /* get current AI state so it can be restored */
             kenwood_get_trn(rig, &priv->trn_state);  /* ignore errors */
 
-            /* Currently we cannot cope with AI mode so turn it off in
-               case last client left it on */
-            if (priv->trn_state != RIG_TRN_OFF)
+            if (rig->state.async_data_enabled && rig->caps->async_data_supported)
+            {
+                /* the async data handler decodes AI frames, let the rig
+                   push FA/FB/MD/IF/TX changes instead of being polled */
+                kenwood_set_trn(rig, RIG_TRN_RIG); /* ignore status in case
+                                                     it's not supported */
+            }
+            /* Without async data we cannot cope with AI mode so turn it
+               off in case last client left it on */
+            else if (priv->trn_state != RIG_TRN_OFF)
             {
                 kenwood_set_trn(rig, RIG_TRN_OFF); /* ignore status in case
                                                       it's not supported */
@@ -4991,6 +5016,9 @@ int kenwood_set_trn(RIG *rig, int trn)
         RETURNFUNC(-RIG_ENAVAIL);
 
     case RIG_MODEL_TS990S:
+    case RIG_MODEL_TS890S:
+    case RIG_MODEL_TS590S:
+    case RIG_MODEL_TS590SG:
         RETURNFUNC(kenwood_transaction(rig, (trn == RIG_TRN_RIG) ? "AI2" : "AI0", NULL,
                                        0));
 
@@ -5053,6 +5081,116 @@ int kenwood_get_trn(RIG *rig, int *trn)
     RETURNFUNC(RIG_OK);
 }
 
+/*
+ * Frames read by the async data handler in rig.c, the reply
+ * kenwood_transaction waits for goes to the sync pipe and everything else
+ * is auto information (AI) pushed by the rig
+ */
+int kenwood_read_frame_direct(RIG *rig, size_t buffer_length,
+                              const unsigned char *buffer)
+{
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    char cmdtrm_str[2];
+
+    cmdtrm_str[0] = caps->cmdtrm;
+    cmdtrm_str[1] = '\0';
+
+    return read_string_direct(&rig->state.rigport, (unsigned char *) buffer,
+                              buffer_length, cmdtrm_str, 1, 0, 1);
+}
+
+/*
+ * Everything but the reply kenwood_transaction() waits for is AI, of
+ * which kenwood_process_async_frame() decodes the commands it knows.
+ */
+int kenwood_is_async_frame(RIG *rig, size_t frame_length,
+                           const unsigned char *frame)
+{
+    const struct kenwood_priv_data *priv = rig->state.priv;
+    const char *reply = priv->async_reply;
+
+    if (reply[0] == '\0')
+    {
+        return 1;
+    }
+
+    /* "?;" and friends */
+    if (frame_length <= 2)
+    {
+        return 0;
+    }
+
+    return strncmp((const char *) frame, reply, strlen(reply)) != 0;
+}
+
+int kenwood_process_async_frame(RIG *rig, size_t frame_length,
+                                const unsigned char *frame)
+{
+    struct rig_state *rs = &rig->state;
+    struct kenwood_priv_data *priv = rs->priv;
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    char buf[KENWOOD_MAX_BUF_LEN];
+    freq_t freq;
+
+    ENTERFUNC;
+
+    if (frame_length >= sizeof(buf))
+    {
+        RETURNFUNC(-RIG_EPROTO);
+    }
+
+    memcpy(buf, frame, frame_length);
+    buf[frame_length] = '\0';
+
+    if (buf[0] == 'F' && (buf[1] == 'A' || buf[1] == 'B'))
+    {
+        sscanf(buf + 2, "%"SCNfreq, &freq);
+        rig_fire_freq_event(rig, buf[1] == 'A' ? RIG_VFO_A : RIG_VFO_B, freq);
+    }
+    else if (strncmp(buf, "MD", 2) == 0)
+    {
+        int kmode = buf[2] <= '9' ? buf[2] - '0' : buf[2] - 'A' + 10;
+
+        rig_fire_mode_event(rig, rs->current_vfo,
+                            kenwood2rmode(kmode, caps->mode_table),
+                            RIG_PASSBAND_NOCHANGE);
+        /* the passband is not pushed so keep asking for it */
+        rs->use_cached_mode = 0;
+    }
+    else if (strncmp(buf, "TX", 2) == 0 || strncmp(buf, "RX", 2) == 0)
+    {
+        rig_fire_ptt_event(rig, RIG_VFO_CURR,
+                           buf[0] == 'T' ? RIG_PTT_ON : RIG_PTT_OFF);
+    }
+    else if (strncmp(buf, "FR", 2) == 0)
+    {
+        rig_fire_vfo_event(rig, buf[2] == '1' ? RIG_VFO_B : RIG_VFO_A);
+    }
+    else if (strncmp(buf, "IF", 2) == 0 && frame_length >= caps->if_len)
+    {
+        char freqbuf[16];
+        vfo_t vfo = buf[30] == '1' ? RIG_VFO_B : RIG_VFO_A;
+
+        /* same freshness as a solicited IF for kenwood_transaction */
+        strncpy(priv->last_if_response, buf, caps->if_len);
+        elapsed_ms(&priv->cache_start, HAMLIB_ELAPSED_SET);
+
+        memcpy(freqbuf, buf, 13);
+        freqbuf[13] = '\0';
+        sscanf(freqbuf + 2, "%"SCNfreq, &freq);
+        rig_fire_freq_event(rig, vfo, freq);
+        rig_fire_ptt_event(rig, vfo, buf[28] == '1' ? RIG_PTT_ON : RIG_PTT_OFF);
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: AI frame unsupported '%s'\n", __func__,
+                  buf);
+        RETURNFUNC(-RIG_ENIMPL);
+    }
+
+    RETURNFUNC(RIG_OK);
+}
+
 /*
  * kenwood_set_powerstat
  */
@@ -5357,6 +5495,40 @@ int kenwood_stop_morse(RIG *rig, vfo_t vfo)
     RETURNFUNC(kenwood_transaction(rig, "KY0", NULL, 0));
 }
 
+/*
+ * kenwood_get_morse_state
+ * KY0 has room (sending or not), KY1 is full, KY2 is idle where the rig
+ * tells idle apart
+ * Only in the caps of the TS-480, TS-590S/SG, TS-890S, TS-990S and TS-2000,
+ * whose KY answer is known to be the buffer state, the others fall back to
+ * the time estimate of src/morse.c
+ */
+int kenwood_get_morse_state(RIG *rig, vfo_t vfo, int *state)
+{
+    char buf[8];
+    int retval;
+
+    ENTERFUNC;
+
+    retval = kenwood_transaction(rig, "KY;", buf, 4);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    if (!strncmp(buf, "KY0", 3)) { *state = RIG_MORSE_SENDING; }
+    else if (!strncmp(buf, "KY1", 3)) { *state = RIG_MORSE_FULL; }
+    else if (!strncmp(buf, "KY2", 3)) { *state = RIG_MORSE_IDLE; }
+    else
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: unexpected answer '%s'\n", __func__, buf);
+        RETURNFUNC(-RIG_EPROTO);
+    }
+
+    RETURNFUNC(RIG_OK);
+}
+
 /*
  * kenwood_send_voice
  */
@@ -6044,6 +6216,85 @@ DECLARE_PROBERIG_BACKEND(kenwood)
 }
 
 
+/*
+ * kenwood_probe_id
+ * Models answering id to "ID;", for the probing of src/probe.c
+ */
+int kenwood_probe_id(const char *id, struct probe_candidate *cand, int max)
+{
+    int i, k_id, n = 0;
+
+    for (i = 0; kenwood_id_string_list[i].model != RIG_MODEL_NONE && n < max; i++)
+    {
+        if (!strcmp(kenwood_id_string_list[i].id, id))
+        {
+            cand[n].model = kenwood_id_string_list[i].model;
+            cand[n++].confidence = 100;
+        }
+    }
+
+    k_id = atoi(id);
+
+    /* some rigs do not pad the number */
+    for (i = 0; n == 0 && kenwood_id_list[i].model != RIG_MODEL_NONE; i++)
+    {
+        if (kenwood_id_list[i].id == k_id && isdigit((unsigned char)id[0]))
+        {
+            cand[n].model = kenwood_id_list[i].model;
+            cand[n++].confidence = 80;
+        }
+    }
+
+    /* Elecraft answers as a TS-570D, see kenwood_probe_elecraft() */
+    if (k_id == 17 && n > 0)
+    {
+        const rig_model_t elecraft[] =
+        {
+            RIG_MODEL_K2, RIG_MODEL_K3, RIG_MODEL_K3S, RIG_MODEL_KX2, RIG_MODEL_KX3
+        };
+
+        for (i = 0; i < 5 && n < max; i++)
+        {
+            cand[n].model = elecraft[i];
+            cand[n++].confidence = cand[0].confidence;
+        }
+    }
+
+    return n;
+}
+
+
+/*
+ * kenwood_probe_elecraft
+ * Tells apart the rigs answering "ID017;" by their answers to "K3;",
+ * "K2;" and "OM;", NULL for the ones not answered.  The K3 family
+ * answers "K3n;" and tells its model in "OM;" like elecraft_open(), the
+ * K2 only answers "K2n;" and the TS-570D neither.
+ */
+rig_model_t kenwood_probe_elecraft(const char *k3, const char *k2,
+                                   const char *om)
+{
+    if (k3 && !strncmp(k3, "K3", 2))
+    {
+        if (om && strlen(om) >= 15 && om[13] == '0')
+        {
+            if (om[14] == '1') { return RIG_MODEL_KX2; }
+
+            if (om[14] == '2') { return RIG_MODEL_KX3; }
+        }
+
+        return om && strchr(om, 'R') ? RIG_MODEL_K3S : RIG_MODEL_K3;
+    }
+
+    if (k2 && !strncmp(k2, "K2", 2))
+    {
+        return RIG_MODEL_K2;
+    }
+
+    return RIG_MODEL_TS570D;
+}
+
+
 /*
  * initrigs_kenwood is called by rig_backend_load
  */
@@ -178,6 +178,7 @@ struct kenwood_priv_data
     int question_mark_response_means_rejected; /* the question mark response has multiple meanings */
     int save_k2_ext_lvl; // so we can restore to original
     int save_k3_ext_lvl; // so we can restore to original -- for future use if needed
+    char async_reply[3]; /* reply kenwood_transaction waits for, see kenwood_is_async_frame */
 };
 
 
@@ -236,6 +237,7 @@ int kenwood_get_powerstat(RIG *rig, powerstat_t *status);
 int kenwood_reset(RIG *rig, reset_t reset);
 int kenwood_send_morse(RIG *rig, vfo_t vfo, const char *msg);
 int kenwood_stop_morse(RIG *rig, vfo_t vfo);
+int kenwood_get_morse_state(RIG *rig, vfo_t vfo, int *state);
 int kenwood_set_ant(RIG *rig, vfo_t vfo, ant_t ant, value_t option);
 int kenwood_set_ant_no_ack(RIG *rig, vfo_t vfo, ant_t ant, value_t option);
 int kenwood_get_ant(RIG *rig, vfo_t vfo, ant_t dummy, value_t *option, ant_t *ant_curr, ant_t *ant_tx, ant_t *ant_rx);
@@ -257,6 +259,12 @@ int kenwood_send_voice_mem(RIG *rig, vfo_t vfo, int bank);
 
 int kenwood_set_trn(RIG *rig, int trn);
 int kenwood_get_trn(RIG *rig, int *trn);
+int kenwood_read_frame_direct(RIG *rig, size_t buffer_length,
+                              const unsigned char *buffer);
+int kenwood_is_async_frame(RIG *rig, size_t frame_length,
+                           const unsigned char *frame);
+int kenwood_process_async_frame(RIG *rig, size_t frame_length,
+                                const unsigned char *frame);
 
 /* only use if returned string has length 6, e.g. 'SQ011;' */
 int get_kenwood_level(RIG *rig, const char *cmd, float *fval, int *ival);
@@ -1895,6 +1895,7 @@ const struct rig_caps ts2000_caps =
     .set_ant =  kenwood_set_ant,
     .get_ant =  kenwood_get_ant,
     .send_morse =  kenwood_send_morse,
+    .get_morse_state =  kenwood_get_morse_state,
     .wait_morse = rig_wait_morse,
     .vfo_op =  kenwood_vfo_op,
     .scan =  kenwood_scan,
@@ -1432,6 +1432,7 @@ const struct rig_caps ts480_caps =
     .set_ext_func = ts480_set_ext_func,
     .get_ext_func = ts480_get_ext_func,
     .send_morse = kenwood_send_morse,
+    .get_morse_state = kenwood_get_morse_state,
     .wait_morse =  rig_wait_morse,
     .vfo_op = kenwood_vfo_op,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
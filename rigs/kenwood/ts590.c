@@ -1551,7 +1551,7 @@ const struct rig_caps ts590_caps =
     RIG_MODEL(RIG_MODEL_TS590S),
     .model_name = "TS-590S",
     .mfg_name = "Kenwood",
-    .version = BACKEND_VER ".7",
+    .version = BACKEND_VER ".8",
     .copyright = "LGPL",
     .status = RIG_STATUS_STABLE,
     .rig_type = RIG_TYPE_TRANSCEIVER,
@@ -1684,6 +1684,11 @@ const struct rig_caps ts590_caps =
     .extfuncs = ts590_ext_funcs,
     .extlevels = ts590_ext_levels,
 
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
+
     .priv = (void *)& ts590_priv_caps,
     .rig_init = kenwood_init,
     .rig_cleanup = kenwood_cleanup,
@@ -1730,6 +1735,7 @@ const struct rig_caps ts590_caps =
     .set_trn =  kenwood_set_trn,
     .get_trn =  kenwood_get_trn,
     .send_morse =  kenwood_send_morse,
+    .get_morse_state =  kenwood_get_morse_state,
     .stop_morse =  kenwood_stop_morse,
     .wait_morse =  rig_wait_morse,
     .set_mem =  kenwood_set_mem,
@@ -1941,7 +1947,7 @@ const struct rig_caps ts590sg_caps =
     RIG_MODEL(RIG_MODEL_TS590SG),
     .model_name = "TS-590SG",
     .mfg_name = "Kenwood",
-    .version = BACKEND_VER ".5",
+    .version = BACKEND_VER ".6",
     .copyright = "LGPL",
     .status = RIG_STATUS_STABLE,
     .rig_type = RIG_TYPE_TRANSCEIVER,
@@ -2073,6 +2079,11 @@ const struct rig_caps ts590sg_caps =
     .extfuncs = ts590_ext_funcs,
     .extlevels = ts590_ext_levels,
 
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
+
     .priv = (void *)& ts590_priv_caps,
     .rig_init = kenwood_init,
     .rig_cleanup = kenwood_cleanup,
@@ -2119,6 +2130,7 @@ const struct rig_caps ts590sg_caps =
     .set_trn =  kenwood_set_trn,
     .get_trn =  kenwood_get_trn,
     .send_morse =  kenwood_send_morse,
+    .get_morse_state =  kenwood_get_morse_state,
     .stop_morse =  kenwood_stop_morse,
     .wait_morse =  rig_wait_morse,
     .set_mem =  kenwood_set_mem,
@@ -416,7 +416,7 @@ const struct rig_caps ts890s_caps =
     RIG_MODEL(RIG_MODEL_TS890S),
     .model_name = "TS-890S",
     .mfg_name = "Kenwood",
-    .version = BACKEND_VER ".11",
+    .version = BACKEND_VER ".12",
     .copyright = "LGPL",
     .status = RIG_STATUS_STABLE,
     .rig_type = RIG_TYPE_TRANSCEIVER,
@@ -529,6 +529,11 @@ const struct rig_caps ts890s_caps =
 
     .swr_cal = TS890_SWR_CAL,
 
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
+
     .priv = (void *)& ts890s_priv_caps,
     .rig_init = kenwood_init,
     .rig_open = kenwood_open,
@@ -555,6 +560,7 @@ const struct rig_caps ts890s_caps =
     .set_ant = kenwood_set_ant,
     .get_ant = kenwood_get_ant,
     .send_morse =  kenwood_send_morse,
+    .get_morse_state =  kenwood_get_morse_state,
     .stop_morse =  kenwood_stop_morse,
     .send_voice_mem = kenwood_send_voice_mem,
     .wait_morse =  rig_wait_morse,
@@ -199,7 +199,7 @@ int v4l_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
     int ret;
 
     /* AM or WFM */
-    range = rig_get_range(rs->rx_range_list, freq, RIG_MODE_AM | RIG_MODE_WFM);
+    range = rig_find_range(rig, 0, freq, RIG_MODE_AM | RIG_MODE_WFM);
 
     if (!range)
     {
@@ -237,7 +237,6 @@ int v4l_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 
 int v4l_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 {
-    struct rig_state *rs = &rig->state;
     const freq_range_t *range;
     unsigned long f;
     double fact;
@@ -253,7 +252,7 @@ int v4l_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
     }
 
     /* FIXME: remember tuner and current *fact* */
-    range = rig_get_range(rs->rx_range_list, f / 16, RIG_MODE_AM | RIG_MODE_WFM);
+    range = rig_find_range(rig, 0, f / 16, RIG_MODE_AM | RIG_MODE_WFM);
 
     if (!range)
     {
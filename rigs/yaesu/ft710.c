@@ -137,7 +137,7 @@ const struct rig_caps ft710_caps =
     RIG_MODEL(RIG_MODEL_FT710),
     .model_name =         "FT-710",
     .mfg_name =           "Yaesu",
-    .version =            NEWCAT_VER ".3",
+    .version =            NEWCAT_VER ".4",
     .copyright =          "LGPL",
     .status =             RIG_STATUS_STABLE,
     .rig_type =           RIG_TYPE_TRANSCEIVER,
@@ -256,6 +256,11 @@ const struct rig_caps ft710_caps =
     .ext_tokens =         ft710_ext_tokens,
     .extlevels =          ft710_ext_levels,
 
+    .async_data_supported = 1,
+    .read_frame_direct = newcat_read_frame_direct,
+    .is_async_frame = newcat_is_async_frame,
+    .process_async_frame = newcat_process_async_frame,
+
     .priv =               &ft710_priv_caps,
 
     .rig_init =           newcat_init,
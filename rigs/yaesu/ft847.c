@@ -529,6 +529,7 @@ const struct rig_caps ft847_caps =
     .set_dcs_sql    = ft847_set_dcs_sql,
     .set_rptr_shift = ft847_set_rptr_shift,
     .set_rptr_offs  = ft847_set_rptr_offs,
+    .write_through = -1,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
 };
 
@@ -672,6 +673,7 @@ const struct rig_caps ft650_caps =
 //    .set_dcs_sql    = ft847_set_dcs_sql,
 //    .set_rptr_shift = ft847_set_rptr_shift,
 //    .set_rptr_offs  = ft847_set_rptr_offs,
+    .write_through = -1,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
 };
 
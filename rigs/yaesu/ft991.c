@@ -138,7 +138,7 @@ const struct rig_caps ft991_caps =
     RIG_MODEL(RIG_MODEL_FT991),
     .model_name =         "FT-991",
     .mfg_name =           "Yaesu",
-    .version =            NEWCAT_VER ".16",
+    .version =            NEWCAT_VER ".17",
     .copyright =          "LGPL",
     .status =             RIG_STATUS_STABLE,
     .rig_type =           RIG_TYPE_TRANSCEIVER,
@@ -289,6 +289,11 @@ const struct rig_caps ft991_caps =
     .ext_tokens =         ft991_ext_tokens,
     .extlevels =          ft991_ext_levels,
 
+    .async_data_supported = 1,
+    .read_frame_direct = newcat_read_frame_direct,
+    .is_async_frame = newcat_is_async_frame,
+    .process_async_frame = newcat_process_async_frame,
+
     .priv =               NULL,           /* private data FIXME: */
 
     .rig_init =           ft991_init,
@@ -135,7 +135,7 @@ const struct rig_caps ftdx10_caps =
     RIG_MODEL(RIG_MODEL_FTDX10),
     .model_name =         "FTDX-10",
     .mfg_name =           "Yaesu",
-    .version =            NEWCAT_VER ".7",
+    .version =            NEWCAT_VER ".8",
     .copyright =          "LGPL",
     .status =             RIG_STATUS_STABLE,
     .rig_type =           RIG_TYPE_TRANSCEIVER,
@@ -255,6 +255,11 @@ const struct rig_caps ftdx10_caps =
     .ext_tokens =         ftdx10_ext_tokens,
     .extlevels =          ftdx10_ext_levels,
 
+    .async_data_supported = 1,
+    .read_frame_direct = newcat_read_frame_direct,
+    .is_async_frame = newcat_is_async_frame,
+    .process_async_frame = newcat_process_async_frame,
+
     .priv =               &ftdx10_priv_caps,
 
     .rig_init =           newcat_init,
@@ -28,13 +28,16 @@
  */
 
 #include <stdlib.h>
+#include <ctype.h>
 #include <string.h>  /* String function definitions */
 #include <math.h>
 
 #include "hamlib/rig.h"
 #include "iofunc.h"
+#include "ioreactor.h"
 #include "misc.h"
 #include "cal.h"
+#include "event.h"
 #include "newcat.h"
 
 /* global variables */
@@ -394,6 +397,7 @@ static int newcat_get_faststep(RIG *rig, ncboolean *fast_step);
 static int newcat_get_rigid(RIG *rig);
 static int newcat_get_vfo_mode(RIG *rig, vfo_t vfo, rmode_t *vfo_mode);
 static int newcat_vfomem_toggle(RIG *rig);
+static void newcat_expect_reply(struct newcat_priv_data *priv, const char *cmd);
 static int set_roofing_filter(RIG *rig, vfo_t vfo, int index);
 static int set_roofing_filter_for_width(RIG *rig, vfo_t vfo, int width);
 static int get_roofing_filter(RIG *rig, vfo_t vfo,
@@ -578,9 +582,15 @@ int newcat_open(RIG *rig)
     rig->state.rigport.timeout = 100;
     newcat_get_trn(rig, &priv->trn_state);  /* ignore errors */
 
-    /* Currently we cannot cope with AI mode so turn it off in case
-       last client left it on */
-    if (priv->trn_state > 0)
+    if (rig_s->async_data_enabled && rig->caps->async_data_supported)
+    {
+        /* the async data handler decodes AI frames so let the rig push
+           FA/FB/MD/TX changes instead of being polled */
+        newcat_set_trn(rig, RIG_TRN_RIG);
+    } /* ignore status in case it's not supported */
+    /* Without async data we cannot cope with AI mode so turn it off in
+       case last client left it on */
+    else if (priv->trn_state > 0)
     {
         newcat_set_trn(rig, RIG_TRN_OFF);
     } /* ignore status in case it's not supported */
@@ -7289,6 +7299,103 @@ int newcat_get_trn(RIG *rig, int *trn)
 }
 
 
+/*
+ * Remember which reply we are waiting for so the async data handler
+ * passes it on to us rather than decoding it as an AI frame.
+ * A NULL cmd means nothing is outstanding.
+ */
+static void newcat_expect_reply(struct newcat_priv_data *priv, const char *cmd)
+{
+    if (cmd == NULL || cmd[0] == '\0' || cmd[0] == cat_term)
+    {
+        priv->async_reply[0] = '\0';
+        return;
+    }
+
+    priv->async_reply[0] = cmd[0];
+    priv->async_reply[1] = cmd[1] == cat_term ? '\0' : cmd[1];
+    priv->async_reply[2] = '\0';
+}
+
+
+int newcat_read_frame_direct(RIG *rig, size_t buffer_length,
+                             const unsigned char *buffer)
+{
+    return read_string_direct(&rig->state.rigport, (unsigned char *) buffer,
+                              buffer_length, &cat_term, sizeof(cat_term), 0, 1);
+}
+
+
+/*
+ * With AI on the rig may push any frame at any time, so everything is
+ * treated as async except the reply (or error) to the command we are
+ * currently waiting for
+ */
+int newcat_is_async_frame(RIG *rig, size_t frame_length,
+                          const unsigned char *frame)
+{
+    const struct newcat_priv_data *priv = rig->state.priv;
+    const char *reply = priv->async_reply;
+
+    if (reply[0] == '\0')
+    {
+        return 1;
+    }
+
+    /* "?;" and friends */
+    if (frame_length <= 2)
+    {
+        return 0;
+    }
+
+    return strncmp((const char *) frame, reply, strlen(reply)) != 0;
+}
+
+
+int newcat_process_async_frame(RIG *rig, size_t frame_length,
+                               const unsigned char *frame)
+{
+    struct rig_state *rs = &rig->state;
+    char buf[NEWCAT_DATA_LEN];
+
+    ENTERFUNC;
+
+    if (frame_length >= sizeof(buf))
+    {
+        RETURNFUNC(-RIG_EPROTO);
+    }
+
+    memcpy(buf, frame, frame_length);
+    buf[frame_length] = '\0';
+
+    if (buf[0] == 'F' && (buf[1] == 'A' || buf[1] == 'B') && isdigit(buf[2]))
+    {
+        rig_fire_freq_event(rig, buf[1] == 'A' ? RIG_VFO_A : RIG_VFO_B,
+                            atof(buf + 2));
+    }
+    else if (strncmp(buf, "MD", 2) == 0 && frame_length >= 5)
+    {
+        rig_fire_mode_event(rig, buf[2] == '1' ? RIG_VFO_B : RIG_VFO_A,
+                            newcat_rmode(buf[3]), RIG_PASSBAND_NOCHANGE);
+        /* the width is not pushed so keep asking for it */
+        rs->use_cached_mode = 0;
+    }
+    else if (strncmp(buf, "TX", 2) == 0 && frame_length >= 4)
+    {
+        rig_fire_ptt_event(rig, RIG_VFO_CURR,
+                           buf[2] == '0' ? RIG_PTT_OFF : RIG_PTT_ON);
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: AI frame unsupported '%s'\n", __func__,
+                  buf);
+        RETURNFUNC(-RIG_ENIMPL);
+    }
+
+    RETURNFUNC(RIG_OK);
+}
+
+
 int newcat_decode_event(RIG *rig)
 {
     ENTERFUNC;
@@ -10639,6 +10746,7 @@ int newcat_get_cmd(RIG *rig)
     while (rc != RIG_OK && retry_count++ <= state->rigport.retry)
     {
         rig_flush(&state->rigport);  /* discard any unsolicited data */
+        newcat_expect_reply(priv, priv->cmd_str);
         if (rc != -RIG_BUSBUSY)
         {
             /* send the command */
@@ -10647,14 +10755,17 @@ int newcat_get_cmd(RIG *rig)
             rc = write_block(&state->rigport, (unsigned char *) priv->cmd_str, strlen(priv->cmd_str));
             if (rc != RIG_OK)
             {
+                newcat_expect_reply(priv, NULL);
                 RETURNFUNC(rc);
             }
         }
 
         /* read the reply */
-        if ((rc = read_string(&state->rigport, (unsigned char *) priv->ret_data,
-                              sizeof(priv->ret_data),
-                              &cat_term, sizeof(cat_term), 0, 1)) <= 0)
+        rc = read_string(&state->rigport, (unsigned char *) priv->ret_data,
+                         sizeof(priv->ret_data), &cat_term, sizeof(cat_term), 0, 1);
+        newcat_expect_reply(priv, NULL);
+
+        if (rc <= 0)
         {
             // if we get a timeout from PS probably means power is off
             if (rc == -RIG_ETIMEOUT && is_power_status_cmd)
@@ -10912,20 +11023,28 @@ int newcat_set_cmd_validate(RIG *rig)
         repeat:
         rig_flush(&state->rigport);  /* discard any unsolicited data */
         SNPRINTF(cmd, sizeof(cmd), "%s", priv->cmd_str);
+
+        // the set and its verify query can share one write
+        if (strlen(valcmd) > 0) { io_reactor_cork(&state->rigport); }
+
         rc = write_block(&state->rigport, (unsigned char *) cmd, strlen(cmd));
 
-        if (rc != RIG_OK) { RETURNFUNC(-RIG_EIO); }
+        if (rc != RIG_OK) { io_reactor_uncork(&state->rigport); RETURNFUNC(-RIG_EIO); }
 
         if (strlen(valcmd) == 0) { RETURNFUNC(RIG_OK); }
 
         SNPRINTF(cmd, sizeof(cmd), "%s", valcmd);
+        newcat_expect_reply(priv, valcmd);
         rc = write_block(&state->rigport, (unsigned char *) cmd, strlen(cmd));
 
-        if (rc != RIG_OK) { RETURNFUNC(-RIG_EIO); }
+        if (io_reactor_uncork(&state->rigport) != RIG_OK) { rc = -RIG_EIO; }
+
+        if (rc != RIG_OK) { newcat_expect_reply(priv, NULL); RETURNFUNC(-RIG_EIO); }
 
         bytes = read_string(&state->rigport, (unsigned char *) priv->ret_data,
                             sizeof(priv->ret_data),
                             &cat_term, sizeof(cat_term), 0, 1);
+        newcat_expect_reply(priv, NULL);
 
         // FA and FB success is now verified in rig.c with a followup query
         // so no validation is needed
@@ -11047,17 +11166,21 @@ int newcat_set_cmd(RIG *rig)
 
         /* send the verification command */
         rig_debug(RIG_DEBUG_TRACE, "cmd_str = %s\n", verify_cmd);
+        newcat_expect_reply(priv, verify_cmd);
 
         if (RIG_OK != (rc = write_block(&state->rigport, (unsigned char *) verify_cmd,
                                         strlen(verify_cmd))))
         {
+            newcat_expect_reply(priv, NULL);
             RETURNFUNC(rc);
         }
 
         /* read the reply */
-        if ((rc = read_string(&state->rigport, (unsigned char *) priv->ret_data,
-                              sizeof(priv->ret_data),
-                              &cat_term, sizeof(cat_term), 0, 1)) <= 0)
+        rc = read_string(&state->rigport, (unsigned char *) priv->ret_data,
+                         sizeof(priv->ret_data), &cat_term, sizeof(cat_term), 0, 1);
+        newcat_expect_reply(priv, NULL);
+
+        if (rc <= 0)
         {
             continue;             /* usually a timeout - retry */
         }
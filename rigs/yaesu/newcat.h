@@ -129,6 +129,7 @@ struct newcat_priv_data
     int poweron; /* to prevent powering on more than once */
     int question_mark_response_means_rejected; /* the question mark response has multiple meanings */
     char front_rear_status; /* e.g. FTDX5000 EX103 status */
+    char async_reply[3]; /* prefix of the reply being waited for, AI frames otherwise */
 };
 
 /*
@@ -222,6 +223,12 @@ int newcat_set_ts(RIG * rig, vfo_t vfo, shortfreq_t ts);
 int newcat_get_ts(RIG * rig, vfo_t vfo, shortfreq_t * ts);
 int newcat_set_trn(RIG * rig, int trn);
 int newcat_get_trn(RIG * rig, int *trn);
+int newcat_read_frame_direct(RIG *rig, size_t buffer_length,
+                             const unsigned char *buffer);
+int newcat_is_async_frame(RIG *rig, size_t frame_length,
+                          const unsigned char *frame);
+int newcat_process_async_frame(RIG *rig, size_t frame_length,
+                               const unsigned char *frame);
 int newcat_set_channel(RIG * rig, vfo_t vfo, const channel_t * chan);
 int newcat_get_channel(RIG * rig, vfo_t vfo, channel_t * chan, int read_only);
 rmode_t newcat_rmode(char mode);
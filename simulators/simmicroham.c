@@ -0,0 +1,250 @@
+// microHam router simulator with a Kenwood TS-450 style radio behind it
+// can run this using rigctl/rigctld with -r uh-rig:<pty name> -p uh-ptt:<pty name>
+// run one per router to test more than one microHam device, the optional
+// argument sets the VFOA frequency so the routers can be told apart
+// gcc -o simmicroham simmicroham.c
+#define _XOPEN_SOURCE 700
+// since we are POSIX here we need this
+struct ip_mreq
+{
+    int dummy;
+};
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <hamlib/rig.h>
+
+#define BUFSIZE 256
+
+int freqA = 14074000;
+int freqB = 14074500;
+int modeA = 2;
+int ptt;
+
+int fd;
+
+#if defined(WIN32) || defined(_WIN32)
+int openPort(char *comport) // doesn't matter for using pts devices
+{
+    int fd;
+    fd = open(comport, O_RDWR);
+
+    if (fd < 0)
+    {
+        perror(comport);
+    }
+
+    return fd;
+}
+
+#else
+int openPort(char *comport) // doesn't matter for using pts devices
+{
+    int fd = posix_openpt(O_RDWR);
+    char *name = ptsname(fd);
+
+    if (name == NULL)
+    {
+        perror("pstname");
+        return -1;
+    }
+
+    printf("name=%s\n", name);
+    fflush(stdout);
+
+    if (fd == -1 || grantpt(fd) == -1 || unlockpt(fd) == -1)
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+
+    return fd;
+}
+#endif
+
+// send a byte from the radio to the computer in a frame of its own
+void sendRadio(unsigned char byte)
+{
+    unsigned char frame[4];
+
+    frame[0] = 0x20;
+    frame[1] = 0x80 | (byte & 0x7f);
+    frame[2] = 0x80;
+    frame[3] = 0x80;
+
+    if (byte & 0x80) { frame[0] |= 0x04; }
+
+    if (write(fd, frame, 4) != 4) { perror("write"); }
+}
+
+void reply(const char *s)
+{
+    while (*s) { sendRadio(*s++); }
+}
+
+// the radio behind the router
+void radioCommand(const char *buf)
+{
+    char rbuf[BUFSIZE];
+
+    printf("Cmd:%s\n", buf);
+
+    if (strcmp(buf, "FA;") == 0)
+    {
+        sprintf(rbuf, "FA%011d;", freqA);
+        reply(rbuf);
+    }
+    else if (strcmp(buf, "FB;") == 0)
+    {
+        sprintf(rbuf, "FB%011d;", freqB);
+        reply(rbuf);
+    }
+    else if (strncmp(buf, "FA", 2) == 0)
+    {
+        sscanf(buf, "FA%d", &freqA);
+    }
+    else if (strncmp(buf, "FB", 2) == 0)
+    {
+        sscanf(buf, "FB%d", &freqB);
+    }
+    else if (strcmp(buf, "IF;") == 0)
+    {
+        sprintf(rbuf, "IF%011d0000+00000000%d%d000000000;", freqA, ptt, modeA);
+        reply(rbuf);
+    }
+    else if (strcmp(buf, "ID;") == 0)
+    {
+        reply("ID006;");
+    }
+    else if (strcmp(buf, "MD;") == 0)
+    {
+        sprintf(rbuf, "MD%d;", modeA);
+        reply(rbuf);
+    }
+    else if (strncmp(buf, "MD", 2) == 0)
+    {
+        sscanf(buf, "MD%d", &modeA);
+    }
+    else if (strcmp(buf, "AI;") == 0)
+    {
+        reply("AI0;");
+    }
+    else if (strcmp(buf, "PS;") == 0)
+    {
+        reply("PS1;");
+    }
+    else if (strcmp(buf, "TX;") == 0)
+    {
+        ptt = 1;
+    }
+    else if (strcmp(buf, "RX;") == 0)
+    {
+        ptt = 0;
+    }
+    else if (strlen(buf) > 3 && buf[2] != ';')
+    {
+        // other set commands are accepted silently
+    }
+    else
+    {
+        reply("?;");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned char frame[4];
+    unsigned char control[BUFSIZE];
+    char buf[BUFSIZE];
+    int framepos = 0, frameseq = 0;
+    int ncontrol = 0, incontrol = 0;
+    int len = 0;
+    int statusbyte = 0;
+
+    if (argc > 1) { freqA = atoi(argv[1]); }
+
+    fd = openPort(NULL);
+
+    if (fd < 0) { return 1; }
+
+    while (1)
+    {
+        unsigned char c;
+
+        if (read(fd, &c, 1) != 1)
+        {
+            // nobody has the slave side open yet
+            hl_usleep(10 * 1000);
+            continue;
+        }
+
+        // frames are a header byte with the MSB unset and three bytes with it set
+        if (!(c & 0x80)) { framepos = 0; }
+        else if (framepos == 0) { continue; }
+
+        frame[framepos++] = c;
+
+        if (framepos < 4) { continue; }
+
+        framepos = 0;
+
+        if ((frame[0] & 0x40) == 0) { frameseq = 0; }
+        else { frameseq++; }
+
+        if (frame[0] & 0x20)
+        {
+            c = (frame[1] & 0x7f) | ((frame[0] & 0x04) ? 0x80 : 0);
+
+            if (len < BUFSIZE - 1) { buf[len++] = c; }
+
+            if (c == ';')
+            {
+                buf[len] = 0;
+                radioCommand(buf);
+                len = 0;
+            }
+        }
+
+        c = (frame[3] & 0x7f) | ((frame[0] & 0x01) ? 0x80 : 0);
+
+        if (frameseq == 0 && (frame[0] & 0x08) && c != statusbyte)
+        {
+            statusbyte = c;
+            printf("Flags=%02x PTT=%d\n", statusbyte, (statusbyte & 0x04) ? 1 : 0);
+        }
+        else if (frameseq == 1)
+        {
+            // first and last byte of a control string are not marked valid
+            if (ncontrol < BUFSIZE) { control[ncontrol++] = c; }
+
+            if (!(frame[0] & 0x08) && incontrol)
+            {
+                int i;
+
+                printf("Control:");
+
+                for (i = 0; i < ncontrol; i++) { printf(" %02x", control[i]); }
+
+                printf("\n");
+                incontrol = 0;
+            }
+            else if (!(frame[0] & 0x08))
+            {
+                ncontrol = 1;
+                control[0] = c;
+                incontrol = 1;
+            }
+        }
+        else if (frameseq == 2 && (frame[0] & 0x08))
+        {
+            printf("WinKey=%02x\n", c);
+        }
+
+        fflush(stdout);
+    }
+
+    return 0;
+}
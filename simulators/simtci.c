@@ -0,0 +1,440 @@
+// TCI 1.x server simulator, an ExpertSDR style transceiver behind a WebSocket
+// can run this using rigctl/rigctld with -m 7 -r 127.0.0.1:50001
+// the optional argument is the TCP port to listen on
+// gcc -o simtci simtci.c
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BUFSIZE 4096
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+long freqA = 14074000;
+long freqB = 14074500;
+char modulation[16] = "USB";
+int filter_low = 0;
+int filter_high = 3000;
+int trx;
+int split;
+int drive = 50;
+int rx_sensors;
+int tx_sensors;
+
+static uint32_t rol(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+// SHA-1 of key + GUID for Sec-WebSocket-Accept, data is short so pad in place
+static void sha1(const unsigned char *data, size_t len, unsigned char *digest)
+{
+    unsigned char msg[256];
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t total = ((len + 8) / 64 + 1) * 64;
+    size_t blk;
+    int i;
+
+    memset(msg, 0, sizeof(msg));
+    memcpy(msg, data, len);
+    msg[len] = 0x80;
+
+    for (i = 0; i < 8; i++)
+    {
+        msg[total - 1 - i] = (unsigned char)(((uint64_t) len * 8) >> (8 * i));
+    }
+
+    for (blk = 0; blk < total; blk += 64)
+    {
+        uint32_t w[80], a, b, c, d, e;
+
+        for (i = 0; i < 16; i++)
+        {
+            const unsigned char *p = msg + blk + 4 * i;
+            w[i] = (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16
+                   | (uint32_t) p[2] << 8 | p[3];
+        }
+
+        for (i = 16; i < 80; i++)
+        {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+
+        for (i = 0; i < 80; i++)
+        {
+            uint32_t f, k, t;
+
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+            t = rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (i = 0; i < 20; i++)
+    {
+        digest[i] = (unsigned char)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static void base64(const unsigned char *in, int len, char *out)
+{
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int i;
+
+    for (i = 0; i < len; i += 3)
+    {
+        uint32_t v = (uint32_t) in[i] << 16;
+
+        if (i + 1 < len) { v |= (uint32_t) in[i + 1] << 8; }
+
+        if (i + 2 < len) { v |= in[i + 2]; }
+
+        *out++ = b64[(v >> 18) & 0x3f];
+        *out++ = b64[(v >> 12) & 0x3f];
+        *out++ = i + 1 < len ? b64[(v >> 6) & 0x3f] : '=';
+        *out++ = i + 2 < len ? b64[v & 0x3f] : '=';
+    }
+
+    *out = 0;
+}
+
+static int readall(int fd, unsigned char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = read(fd, buf, len);
+
+        if (n <= 0) { return -1; }
+
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+// server frames are not masked
+static void ws_send(int fd, int opcode, const char *data, size_t len)
+{
+    unsigned char hdr[4];
+    size_t n = 2;
+
+    hdr[0] = 0x80 | opcode;
+
+    if (len < 126)
+    {
+        hdr[1] = len;
+    }
+    else
+    {
+        hdr[1] = 126;
+        hdr[2] = len >> 8;
+        hdr[3] = len & 0xff;
+        n = 4;
+    }
+
+    if (write(fd, hdr, n) != (ssize_t) n || write(fd, data, len) != (ssize_t) len)
+    {
+        perror("write");
+    }
+}
+
+static void tci_send(int fd, const char *msg)
+{
+    printf("> %s\n", msg);
+    ws_send(fd, 1, msg, strlen(msg));
+}
+
+// returns the payload length, -1 when the client is gone
+static int ws_recv(int fd, char *buf, size_t size, int *opcode)
+{
+    unsigned char hdr[8], mask[4] = { 0, 0, 0, 0 };
+    uint64_t len;
+    size_t i;
+    int masked;
+
+    if (readall(fd, hdr, 2) < 0) { return -1; }
+
+    *opcode = hdr[0] & 0x0f;
+    masked = hdr[1];
+    len = hdr[1] & 0x7f;
+
+    if (len == 126)
+    {
+        if (readall(fd, hdr, 2) < 0) { return -1; }
+
+        len = (uint64_t) hdr[0] << 8 | hdr[1];
+    }
+    else if (len == 127)
+    {
+        if (readall(fd, hdr, 8) < 0) { return -1; }
+
+        for (len = 0, i = 0; i < 8; i++) { len = len << 8 | hdr[i]; }
+    }
+
+    if (len >= size) { return -1; }
+
+    if ((masked & 0x80) && readall(fd, mask, 4) < 0) { return -1; }
+
+    if (readall(fd, (unsigned char *) buf, len) < 0) { return -1; }
+
+    for (i = 0; i < len; i++) { buf[i] ^= mask[i % 4]; }
+
+    buf[len] = 0;
+
+    return (int) len;
+}
+
+static int handshake(int fd)
+{
+    char buf[BUFSIZE], key[64] = "", accept[64], reply[256];
+    unsigned char digest[20];
+    size_t n = 0;
+    char *p;
+
+    buf[0] = 0;
+
+    // the frames only start after our answer, so read up to the blank line
+    while (strstr(buf, "\r\n\r\n") == NULL)
+    {
+        if (n == sizeof(buf) - 1 || read(fd, buf + n, 1) != 1) { return -1; }
+
+        buf[++n] = 0;
+    }
+
+    for (p = strtok(buf, "\r\n"); p; p = strtok(NULL, "\r\n"))
+    {
+        if (strncasecmp(p, "Sec-WebSocket-Key:", 18) == 0)
+        {
+            sscanf(p + 18, " %63s", key);
+        }
+    }
+
+    if (key[0] == 0) { return -1; }
+
+    snprintf(buf, sizeof(buf), "%s" WS_GUID, key);
+    sha1((unsigned char *) buf, strlen(buf), digest);
+    base64(digest, sizeof(digest), accept);
+    snprintf(reply, sizeof(reply),
+             "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+             "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+
+    return write(fd, reply, strlen(reply)) == (ssize_t) strlen(reply) ? 0 : -1;
+}
+
+// what the server pushes for each setting, on a change or when asked
+static void tci_state(int fd, const char *name)
+{
+    char msg[128];
+
+    if (strcmp(name, "vfo") == 0)
+    {
+        snprintf(msg, sizeof(msg), "vfo:0,0,%ld;", freqA);
+        tci_send(fd, msg);
+        snprintf(msg, sizeof(msg), "vfo:0,1,%ld;", freqB);
+    }
+    else if (strcmp(name, "modulation") == 0)
+    {
+        snprintf(msg, sizeof(msg), "modulation:0,%s;", modulation);
+    }
+    else if (strcmp(name, "rx_filter_band") == 0)
+    {
+        snprintf(msg, sizeof(msg), "rx_filter_band:0,%d,%d;", filter_low,
+                 filter_high);
+    }
+    else if (strcmp(name, "trx") == 0)
+    {
+        snprintf(msg, sizeof(msg), "trx:0,%s;", trx ? "true" : "false");
+
+        if (trx && tx_sensors)
+        {
+            tci_send(fd, msg);
+            snprintf(msg, sizeof(msg), "tx_sensors:0,-20.0,25.0,30.0,1.3;");
+        }
+    }
+    else if (strcmp(name, "rx_smeter") == 0)
+    {
+        snprintf(msg, sizeof(msg), "rx_smeter:0,0,-79;");
+    }
+    else if (strcmp(name, "rx_sensors_enable") == 0 && rx_sensors)
+    {
+        // a real server repeats this every interval
+        snprintf(msg, sizeof(msg), "rx_sensors:0,-67;");
+    }
+    else if (strcmp(name, "drive") == 0)
+    {
+        snprintf(msg, sizeof(msg), "drive:%d;", drive);
+    }
+    else if (strcmp(name, "split_enable") == 0)
+    {
+        snprintf(msg, sizeof(msg), "split_enable:0,%s;", split ? "true" : "false");
+    }
+    else
+    {
+        return;
+    }
+
+    tci_send(fd, msg);
+}
+
+static void tci_command(int fd, char *cmd)
+{
+    char *args = strchr(cmd, ':');
+    char s[32];
+    long f;
+    int rx, ch, low, high;
+
+    if (args) { *args++ = 0; }
+    else { args = ""; }
+
+    printf("< %s:%s\n", cmd, args);
+
+    if (strcmp(cmd, "vfo") == 0 && sscanf(args, "%d,%d,%ld", &rx, &ch, &f) == 3)
+    {
+        if (ch == 0) { freqA = f; }
+        else { freqB = f; }
+    }
+    else if (strcmp(cmd, "modulation") == 0
+             && sscanf(args, "%d,%15[^,]", &rx, s) == 2)
+    {
+        strcpy(modulation, s);
+    }
+    else if (strcmp(cmd, "rx_filter_band") == 0
+             && sscanf(args, "%d,%d,%d", &rx, &low, &high) == 3)
+    {
+        filter_low = low;
+        filter_high = high;
+    }
+    else if (strcmp(cmd, "trx") == 0 && sscanf(args, "%d,%31[^,]", &rx, s) == 2)
+    {
+        trx = strcasecmp(s, "true") == 0;
+    }
+    else if (strcmp(cmd, "split_enable") == 0
+             && sscanf(args, "%d,%31[^,]", &rx, s) == 2)
+    {
+        split = strcasecmp(s, "true") == 0;
+    }
+    else if (strcmp(cmd, "rx_sensors_enable") == 0 && sscanf(args, "%31[^,]", s) == 1)
+    {
+        rx_sensors = strcasecmp(s, "true") == 0;
+    }
+    else if (strcmp(cmd, "tx_sensors_enable") == 0 && sscanf(args, "%31[^,]", s) == 1)
+    {
+        tx_sensors = strcasecmp(s, "true") == 0;
+    }
+    else if (strcmp(cmd, "drive") == 0 && sscanf(args, "%d", &rx) == 1)
+    {
+        drive = rx;
+    }
+
+    // sets are confirmed and queries answered the same way
+    tci_state(fd, cmd);
+}
+
+static void serve(int fd)
+{
+    static const char *init[] =
+    {
+        "protocol:ExpertSDR3,1.5;", "device:SunSDR2PRO;", "receive_only:false;",
+        "trx_count:2;", "channels_count:2;", "vfo_limits:10000,30000000;",
+        "modulations_list:AM,SAM,DSB,LSB,USB,CW,NFM,WFM,DIGL,DIGU,SPEC;", NULL
+    };
+    char buf[BUFSIZE];
+    int i;
+
+    if (handshake(fd) < 0)
+    {
+        printf("handshake failed\n");
+        return;
+    }
+
+    for (i = 0; init[i]; i++) { tci_send(fd, init[i]); }
+
+    tci_state(fd, "vfo");
+    tci_state(fd, "modulation");
+    tci_state(fd, "rx_filter_band");
+    tci_state(fd, "trx");
+    tci_state(fd, "split_enable");
+    tci_send(fd, "ready;");
+
+    for (;;)
+    {
+        char *save = NULL;
+        char *cmd;
+        int opcode;
+        int len = ws_recv(fd, buf, sizeof(buf), &opcode);
+
+        if (len < 0 || opcode == 8) { break; }
+
+        if (opcode == 9)
+        {
+            ws_send(fd, 10, buf, len);
+            continue;
+        }
+
+        for (cmd = strtok_r(buf, ";", &save); cmd; cmd = strtok_r(NULL, ";", &save))
+        {
+            tci_command(fd, cmd);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_in addr;
+    int port = argc > 1 ? atoi(argv[1]) : 50001;
+    int on = 1;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (sock < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0
+            || listen(sock, 1) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    printf("TCI server on 127.0.0.1:%d\n", port);
+    fflush(stdout);
+
+    for (;;)
+    {
+        int fd = accept(sock, NULL, NULL);
+
+        if (fd < 0) { continue; }
+
+        serve(fd);
+        close(fd);
+        printf("client gone\n");
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -17,7 +17,18 @@ LOCAL_SRC_FILES := \
         rot_reg.c \
         rot_conf.c \
         iofunc.c \
+        ioreactor.c \
         ext.c \
+        cfpindex.c \
+        spectrum_ring.c \
+        spectrum_proc.c \
+        rig_stats.c \
+        async_set.c \
+        morse.c \
+        rangeindex.c \
+        statefile.c \
+        probe.c \
+        rig_worker.c \
         mem.c \
         settings.c \
         parallel.c \
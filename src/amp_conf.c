@@ -40,6 +40,7 @@
 
 #include "amp_conf.h"
 #include "token.h"
+#include "cfpindex.h"
 
 
 /*
@@ -534,6 +535,21 @@ int HAMLIB_API amp_token_foreach(AMP *amp,
 }
 
 
+/* hashed lookup of the conf tables, in the order searched below */
+static const struct cfp_index *amp_conf_index(const AMP *amp)
+{
+    const struct confparams *const tables[] =
+    {
+        amp->caps->cfgparams,
+        ampfrontend_cfg_params,
+        amp->caps->port_type == RIG_PORT_SERIAL ? ampfrontend_serial_cfg_params : NULL
+    };
+
+    return cfp_index_get(amp->caps, CFP_INDEX_AMP_CONF, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
+
 /**
  * \brief Query an amplifier configuration parameter token by its name.
  *
@@ -550,13 +566,14 @@ int HAMLIB_API amp_token_foreach(AMP *amp,
  *
  * \sa amp_token_lookup()
  *
- * TODO: Should use Lex to speed it up, strcmp() hurts!
+ * Uses a hash index of the tables, built on first use.
  */
 const struct confparams *HAMLIB_API amp_confparam_lookup(AMP *amp,
         const char *name)
 {
     const struct confparams *cfp;
     token_t token;
+    const struct cfp_index *idx;
 
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -568,6 +585,13 @@ const struct confparams *HAMLIB_API amp_confparam_lookup(AMP *amp,
     /* 0 returned for invalid format */
     token = strtol(name, NULL, 0);
 
+    idx = amp_conf_index(amp);
+
+    if (idx)
+    {
+        return cfp_index_name_or_token(idx, name, token);
+    }
+
     for (cfp = amp->caps->cfgparams; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name) || token == cfp->token)
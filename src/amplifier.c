@@ -61,6 +61,7 @@
 #include "parallel.h"
 #include "usb_port.h"
 #include "network.h"
+#include "ioreactor.h"
 #include "token.h"
 
 //! @cond Doxygen_Suppress
@@ -232,6 +233,7 @@ AMP *HAMLIB_API amp_init(amp_model_t amp_model)
     rs->ampport.timeout = caps->timeout;
     rs->ampport.retry = caps->retry;
     rs->has_get_level = caps->has_get_level;
+    rs->last_powerstat = RIG_POWER_UNKNOWN;
 
     switch (caps->port_type)
     {
@@ -398,6 +400,13 @@ int HAMLIB_API amp_open(AMP *amp)
         return -RIG_EINVAL;
     }
 
+    if (rs->ampport.type.rig == RIG_PORT_SERIAL
+            || rs->ampport.type.rig == RIG_PORT_NETWORK
+            || rs->ampport.type.rig == RIG_PORT_UDP_NETWORK)
+    {
+        io_reactor_add(&rs->ampport);
+    }
+
     add_opened_amp(amp);
 
     rs->comm_state = 1;
@@ -476,6 +485,8 @@ int HAMLIB_API amp_close(AMP *amp)
     }
 
 
+    io_reactor_remove(&rs->ampport);
+
     if (rs->ampport.fd != -1)
     {
         switch (rs->ampport.type.rig)
@@ -765,6 +776,8 @@ int HAMLIB_API amp_set_level(AMP *amp, setting_t level, value_t val)
  */
 int HAMLIB_API amp_get_level(AMP *amp, setting_t level, value_t *val)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -777,7 +790,20 @@ int HAMLIB_API amp_get_level(AMP *amp, setting_t level, value_t *val)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->get_level(amp, level, val);
+    retval = amp->caps->get_level(amp, level, val);
+
+    if (retval == RIG_OK && !AMP_LEVEL_IS_STRING(level))
+    {
+        int idx = rig_setting2idx(level);
+
+        if (idx >= 0 && idx < RIG_SETTING_MAX)
+        {
+            amp->state.last_level[idx] = AMP_LEVEL_IS_FLOAT(level) ? val->f : val->i;
+            amp->state.has_last_level |= level;
+        }
+    }
+
+    return retval;
 }
 
 
@@ -911,6 +937,8 @@ int HAMLIB_API amp_set_powerstat(AMP *amp, powerstat_t status)
  */
 int HAMLIB_API amp_get_powerstat(AMP *amp, powerstat_t *status)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -923,7 +951,14 @@ int HAMLIB_API amp_get_powerstat(AMP *amp, powerstat_t *status)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->get_powerstat(amp, status);
+    retval = amp->caps->get_powerstat(amp, status);
+
+    if (retval == RIG_OK)
+    {
+        amp->state.last_powerstat = *status;
+    }
+
+    return retval;
 }
 
 
@@ -0,0 +1,633 @@
+/*
+ *  Hamlib Interface - latest value wins queue for set calls
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file async_set.c
+ * \brief Latest value wins queue for set_freq, set_mode, set_level and
+ * set_split_freq
+ *
+ * A tuning knob or a Doppler correction sends far more values than a rig
+ * can take.  rig_set_freq_async() and friends only queue the value and
+ * return; a worker thread sends the queued sets one after the other.  A
+ * set for the same call, VFO and level as one still waiting replaces it,
+ * so only the newest value is sent and the rig never lags behind.  The
+ * replaced set completes right away.
+ *
+ * The queue has a fixed number of entries.  As entries are only added
+ * for different call/VFO/level keys it hardly ever fills up; when it does
+ * the set fails with -RIG_BUSBUSY instead of blocking the caller, who may
+ * hold the very lock the worker waits for.
+ *
+ * Applications serializing rig access with a lock of their own pass a
+ * callback taking it to rig_async_set_start(), the worker holds it while
+ * it talks to the rig.  rig_async_set_flush() sends what is queued from
+ * the calling thread, so callers use it like any other rig call, with
+ * that lock held, before a call that must see the sets done.
+ */
+
+#include <hamlib/config.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "async_set.h"
+#include "misc.h"
+
+#define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
+
+#define ASYNC_SET_DEPTH 16
+#define ASYNC_SET_MAX_DEPTH 256
+
+enum async_set_op_e
+{
+    ASYNC_SET_FREQ,
+    ASYNC_SET_MODE,
+    ASYNC_SET_LEVEL,
+    ASYNC_SET_SPLIT_FREQ
+};
+
+struct async_set_entry
+{
+    enum async_set_op_e op;
+    vfo_t vfo;
+    setting_t level;
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    value_t val;
+    async_set_cb_t cb;
+    rig_ptr_t arg;
+};
+
+struct async_set
+{
+    RIG *rig;
+    void (*sync_cb)(int lock);
+    int depth;
+    int count;
+    struct async_set_entry *entry;  /* oldest first */
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_mutex_t lock;           /* the queue */
+    pthread_mutex_t send;           /* held while an entry is sent */
+    pthread_cond_t queued;
+    int run;
+#endif
+};
+
+static int async_set_send(RIG *rig, const struct async_set_entry *e)
+{
+    int retcode;
+
+    switch (e->op)
+    {
+    case ASYNC_SET_FREQ:
+        retcode = rig_set_freq(rig, e->vfo, e->freq);
+        break;
+
+    case ASYNC_SET_MODE:
+        retcode = rig_set_mode(rig, e->vfo, e->mode, e->width);
+        break;
+
+    case ASYNC_SET_LEVEL:
+        retcode = rig_set_level(rig, e->vfo, e->level, e->val);
+        break;
+
+    case ASYNC_SET_SPLIT_FREQ:
+        retcode = rig_set_split_freq(rig, e->vfo, e->freq);
+        break;
+
+    default:
+        retcode = -RIG_EINTERNAL;
+    }
+
+    if (retcode != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: queued set on %s failed: %s\n", __func__,
+                  rig_strvfo(e->vfo), rigerror(retcode));
+    }
+
+    if (e->cb)
+    {
+        e->cb(rig, retcode, e->arg);
+    }
+
+    return retcode;
+}
+
+/* takes the oldest entry off the queue, the queue lock is held */
+static int async_set_pop(struct async_set *q, struct async_set_entry *e)
+{
+    if (q->count == 0)
+    {
+        return 0;
+    }
+
+    *e = q->entry[0];
+    q->count--;
+    memmove(&q->entry[0], &q->entry[1], q->count * sizeof(q->entry[0]));
+
+    return 1;
+}
+
+#ifdef HAVE_PTHREAD
+static void *async_set_worker(void *arg)
+{
+    struct async_set *q = (struct async_set *)arg;
+    struct async_set_entry e;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    pthread_mutex_lock(&q->lock);
+
+    while (q->run)
+    {
+        int popped;
+
+        if (q->count == 0)
+        {
+            pthread_cond_wait(&q->queued, &q->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&q->lock);
+
+        /*
+         * take the application lock before the entry, a flush from a
+         * thread holding that lock then always finds it still queued
+         */
+        if (q->sync_cb) { q->sync_cb(1); }
+
+        pthread_mutex_lock(&q->send);
+        pthread_mutex_lock(&q->lock);
+        popped = async_set_pop(q, &e);
+        pthread_mutex_unlock(&q->lock);
+
+        if (popped)
+        {
+            async_set_send(q->rig, &e);
+        }
+
+        pthread_mutex_unlock(&q->send);
+
+        if (q->sync_cb) { q->sync_cb(0); }
+
+        pthread_mutex_lock(&q->lock);
+    }
+
+    pthread_mutex_unlock(&q->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+#endif
+
+static int async_set_queue(RIG *rig, const struct async_set_entry *e)
+{
+    struct async_set *q = (struct async_set *)rig->state.async_set;
+    struct async_set_entry replaced;
+    int have_replaced = 0;
+    int i;
+
+    if (q == NULL)
+    {
+        /* not started, behave like the plain call */
+        return async_set_send(rig, e);
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&q->lock);
+
+    for (i = 0; i < q->count; i++)
+    {
+        const struct async_set_entry *old = &q->entry[i];
+
+        if (old->op == e->op && old->vfo == e->vfo
+                && (e->op != ASYNC_SET_LEVEL || old->level == e->level))
+        {
+            /* latest wins and goes to the end to keep the order of the sets */
+            replaced = *old;
+            have_replaced = 1;
+            q->count--;
+            memmove(&q->entry[i], &q->entry[i + 1],
+                    (q->count - i) * sizeof(q->entry[0]));
+            break;
+        }
+    }
+
+    if (q->count == q->depth)
+    {
+        pthread_mutex_unlock(&q->lock);
+        rig_debug(RIG_DEBUG_WARN, "%s: queue full with %d sets\n", __func__,
+                  q->depth);
+        return -RIG_BUSBUSY;
+    }
+
+    q->entry[q->count++] = *e;
+    pthread_cond_signal(&q->queued);
+    pthread_mutex_unlock(&q->lock);
+
+    if (have_replaced)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: replaced a queued set on %s\n", __func__,
+                  rig_strvfo(e->vfo));
+
+        if (replaced.cb)
+        {
+            replaced.cb(rig, RIG_OK, replaced.arg);
+        }
+    }
+
+    return RIG_OK;
+#else
+    (void)replaced;
+    (void)have_replaced;
+    (void)i;
+    return async_set_send(rig, e);
+#endif
+}
+
+/**
+ * \brief start queueing set calls for a rig
+ * \param rig   The rig handle
+ * \param depth Number of sets that can wait, 0 for the default of 16
+ * \param sync_cb Called with 1 before and 0 after the worker uses the rig,
+ * NULL if the application does not serialize rig calls itself
+ *
+ * Starts the worker thread for rig_set_freq_async(), rig_set_mode_async(),
+ * rig_set_level_async() and rig_set_split_freq_async().  Without it, or
+ * without thread support, those call the plain set functions right away.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_async_set_stop(), rig_async_set_flush()
+ */
+int HAMLIB_API rig_async_set_start(RIG *rig, int depth,
+                                   void (*sync_cb)(int lock))
+{
+    struct async_set *q;
+
+    ENTERFUNC;
+
+    if (CHECK_RIG_ARG(rig) || depth < 0 || depth > ASYNC_SET_MAX_DEPTH)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    if (rig->state.async_set != NULL)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+#ifdef HAVE_PTHREAD
+    q = calloc(1, sizeof(*q));
+
+    if (q == NULL)
+    {
+        RETURNFUNC(-RIG_ENOMEM);
+    }
+
+    q->depth = depth ? depth : ASYNC_SET_DEPTH;
+    q->entry = calloc(q->depth, sizeof(q->entry[0]));
+
+    if (q->entry == NULL)
+    {
+        free(q);
+        RETURNFUNC(-RIG_ENOMEM);
+    }
+
+    q->rig = rig;
+    q->sync_cb = sync_cb;
+    q->run = 1;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_mutex_init(&q->send, NULL);
+    pthread_cond_init(&q->queued, NULL);
+
+    if (pthread_create(&q->thread, NULL, async_set_worker, q))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        pthread_cond_destroy(&q->queued);
+        pthread_mutex_destroy(&q->send);
+        pthread_mutex_destroy(&q->lock);
+        free(q->entry);
+        free(q);
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
+
+    rig->state.async_set = q;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: queueing up to %d sets\n", __func__,
+              q->depth);
+#else
+    (void)q;
+    (void)sync_cb;
+#endif
+
+    RETURNFUNC(RIG_OK);
+}
+
+/**
+ * \brief send the queued set calls now
+ * \param rig   The rig handle
+ *
+ * Sends everything queued from the calling thread and waits for a set the
+ * worker is sending.  Call it the way any other rig call is made, with
+ * the lock given to rig_async_set_start() held.
+ *
+ * \return RIG_OK, errors of the sets only go to their callbacks.
+ *
+ * \sa rig_async_set_start()
+ */
+int HAMLIB_API rig_async_set_flush(RIG *rig)
+{
+    struct async_set *q;
+
+    if (!rig || !rig->caps)
+    {
+        return -RIG_EINVAL;
+    }
+
+    q = (struct async_set *)rig->state.async_set;
+
+    if (q == NULL)
+    {
+        return RIG_OK;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&q->send);
+
+    for (;;)
+    {
+        struct async_set_entry e;
+        int popped;
+
+        pthread_mutex_lock(&q->lock);
+        popped = async_set_pop(q, &e);
+        pthread_mutex_unlock(&q->lock);
+
+        if (!popped)
+        {
+            break;
+        }
+
+        async_set_send(rig, &e);
+    }
+
+    pthread_mutex_unlock(&q->send);
+#endif
+
+    return RIG_OK;
+}
+
+/* stops the worker, sets still queued complete with -RIG_EIO */
+void async_set_free(RIG *rig)
+{
+    struct async_set *q = (struct async_set *)rig->state.async_set;
+
+    if (q == NULL)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    {
+        struct async_set_entry e;
+
+        pthread_mutex_lock(&q->lock);
+        q->run = 0;
+        pthread_cond_signal(&q->queued);
+        pthread_mutex_unlock(&q->lock);
+        pthread_join(q->thread, NULL);
+
+        while (async_set_pop(q, &e))
+        {
+            if (e.cb)
+            {
+                e.cb(rig, -RIG_EIO, e.arg);
+            }
+        }
+
+        pthread_cond_destroy(&q->queued);
+        pthread_mutex_destroy(&q->send);
+        pthread_mutex_destroy(&q->lock);
+    }
+#endif
+
+    free(q->entry);
+    free(q);
+    rig->state.async_set = NULL;
+}
+
+/**
+ * \brief stop queueing set calls for a rig
+ * \param rig   The rig handle
+ *
+ * Sends the sets still queued and stops the worker.  Call it without the
+ * lock given to rig_async_set_start() held, the worker may wait for it.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_async_set_start()
+ */
+int HAMLIB_API rig_async_set_stop(RIG *rig)
+{
+    struct async_set *q;
+
+    ENTERFUNC;
+
+    if (!rig || !rig->caps)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    q = (struct async_set *)rig->state.async_set;
+
+    if (q == NULL)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+    if (q->sync_cb) { q->sync_cb(1); }
+
+    rig_async_set_flush(rig);
+
+    if (q->sync_cb) { q->sync_cb(0); }
+
+    async_set_free(rig);
+
+    RETURNFUNC(RIG_OK);
+}
+
+/**
+ * \brief queue a frequency for the target VFO
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param freq  The frequency to set to
+ * \param cb    Called with the result of rig_set_freq(), may be NULL
+ * \param arg   Passed to \a cb
+ *
+ * Like rig_set_freq() but returns as soon as the value is queued, see
+ * rig_async_set_start().  A frequency still queued for the same VFO is
+ * replaced and its callback called with RIG_OK.
+ *
+ * \return RIG_OK if the value is queued, -RIG_BUSBUSY if the queue is full.
+ *
+ * \sa rig_set_freq()
+ */
+int HAMLIB_API rig_set_freq_async(RIG *rig, vfo_t vfo, freq_t freq,
+                                  async_set_cb_t cb, rig_ptr_t arg)
+{
+    struct async_set_entry e;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.op = ASYNC_SET_FREQ;
+    e.vfo = vfo;
+    e.freq = freq;
+    e.cb = cb;
+    e.arg = arg;
+
+    return async_set_queue(rig, &e);
+}
+
+/**
+ * \brief queue a mode for the target VFO
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param mode  The mode to set to
+ * \param width The passband width to set to
+ * \param cb    Called with the result of rig_set_mode(), may be NULL
+ * \param arg   Passed to \a cb
+ *
+ * Like rig_set_mode() but returns as soon as the value is queued, see
+ * rig_set_freq_async().
+ *
+ * \return RIG_OK if the value is queued, -RIG_BUSBUSY if the queue is full.
+ *
+ * \sa rig_set_mode()
+ */
+int HAMLIB_API rig_set_mode_async(RIG *rig, vfo_t vfo, rmode_t mode,
+                                  pbwidth_t width, async_set_cb_t cb, rig_ptr_t arg)
+{
+    struct async_set_entry e;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.op = ASYNC_SET_MODE;
+    e.vfo = vfo;
+    e.mode = mode;
+    e.width = width;
+    e.cb = cb;
+    e.arg = arg;
+
+    return async_set_queue(rig, &e);
+}
+
+/**
+ * \brief queue a level for the target VFO
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param level The level setting
+ * \param val   The value to set the level to
+ * \param cb    Called with the result of rig_set_level(), may be NULL
+ * \param arg   Passed to \a cb
+ *
+ * Like rig_set_level() but returns as soon as the value is queued, see
+ * rig_set_freq_async().  Only a value for the same level and VFO is
+ * replaced.  String values must stay valid until \a cb is called.
+ *
+ * \return RIG_OK if the value is queued, -RIG_BUSBUSY if the queue is full.
+ *
+ * \sa rig_set_level()
+ */
+int HAMLIB_API rig_set_level_async(RIG *rig, vfo_t vfo, setting_t level,
+                                   value_t val, async_set_cb_t cb, rig_ptr_t arg)
+{
+    struct async_set_entry e;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.op = ASYNC_SET_LEVEL;
+    e.vfo = vfo;
+    e.level = level;
+    e.val = val;
+    e.cb = cb;
+    e.arg = arg;
+
+    return async_set_queue(rig, &e);
+}
+
+/**
+ * \brief queue a split TX frequency
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param tx_freq The transmit split frequency to set to
+ * \param cb    Called with the result of rig_set_split_freq(), may be NULL
+ * \param arg   Passed to \a cb
+ *
+ * Like rig_set_split_freq() but returns as soon as the value is queued,
+ * meant for Doppler corrected uplinks, see rig_set_freq_async().
+ *
+ * \return RIG_OK if the value is queued, -RIG_BUSBUSY if the queue is full.
+ *
+ * \sa rig_set_split_freq()
+ */
+int HAMLIB_API rig_set_split_freq_async(RIG *rig, vfo_t vfo, freq_t tx_freq,
+                                        async_set_cb_t cb, rig_ptr_t arg)
+{
+    struct async_set_entry e;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.op = ASYNC_SET_SPLIT_FREQ;
+    e.vfo = vfo;
+    e.freq = tx_freq;
+    e.cb = cb;
+    e.arg = arg;
+
+    return async_set_queue(rig, &e);
+}
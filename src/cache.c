@@ -20,18 +20,44 @@
  *
  */
 
+#include <hamlib/config.h>
+
 #include "cache.h"
 #include "misc.h"
 
 #define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
 
+/*
+ * rs->mutex_cache is recursive, so a caller can hold it across
+ * rig_get_cache() and the decision it makes on the values
+ */
+#ifdef HAVE_PTHREAD
+#define CACHE_LOCK(rig) pthread_mutex_lock(&(rig)->state.mutex_cache)
+#define CACHE_UNLOCK(rig) pthread_mutex_unlock(&(rig)->state.mutex_cache)
+#else
+#define CACHE_LOCK(rig)
+#define CACHE_UNLOCK(rig)
+#endif
+
 /**
  * \file cache.c
  * \addtogroup rig
  * @{
  */
 
-int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
+void rig_cache_lock(RIG *rig, int lock)
+{
+    if (lock)
+    {
+        CACHE_LOCK(rig);
+    }
+    else
+    {
+        CACHE_UNLOCK(rig);
+    }
+}
+
+static int cache_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 {
     ENTERFUNC;
 
@@ -119,7 +145,18 @@ int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
     RETURNFUNC(RIG_OK);
 }
 
-int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
+int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
+{
+    int retval;
+
+    CACHE_LOCK(rig);
+    retval = cache_set_mode(rig, vfo, mode, width);
+    CACHE_UNLOCK(rig);
+
+    return retval;
+}
+
+static int cache_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 {
     int flag = HAMLIB_ELAPSED_SET;
 
@@ -230,29 +267,27 @@ int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
     return (RIG_OK);
 }
 
-/**
- * \brief get cached values for a VFO
- * \param rig           The rig handle
- * \param vfo           The VFO to get information from
- * \param freq          The frequency is stored here
- * \param cache_ms_freq The age of the last frequency update in ms
- * \param mode          The mode is stored here
- * \param cache_ms_mode The age of the last mode update in ms
- * \param width         The width is stored here
- * \param cache_ms_width The age of the last width update in ms
- *
- * Use this to query the cache and then determine to actually fetch data from
- * the rig.
- *
- * \note All pointers must be given. No pointer can be left at NULL
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- */
-int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
-                  rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width)
+int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
+{
+    int retval;
+
+    CACHE_LOCK(rig);
+    retval = cache_set_freq(rig, vfo, freq);
+    CACHE_UNLOCK(rig);
+
+    return retval;
+}
+
+void rig_set_cache_ptt(RIG *rig, ptt_t ptt)
+{
+    CACHE_LOCK(rig);
+    rig->state.cache.ptt = ptt;
+    elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+    CACHE_UNLOCK(rig);
+}
+
+static int cache_get(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
+                     rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width)
 {
     if (CHECK_RIG_ARG(rig) || !freq || !cache_ms_freq ||
             !mode || !cache_ms_mode || !width || !cache_ms_width)
@@ -466,6 +501,45 @@ int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
     return RIG_OK;
 }
 
+/**
+ * \brief get cached values for a VFO
+ * \param rig           The rig handle
+ * \param vfo           The VFO to get information from
+ * \param freq          The frequency is stored here
+ * \param cache_ms_freq The age of the last frequency update in ms
+ * \param mode          The mode is stored here
+ * \param cache_ms_mode The age of the last mode update in ms
+ * \param width         The width is stored here
+ * \param cache_ms_width The age of the last width update in ms
+ *
+ * Use this to query the cache and then determine to actually fetch data from
+ * the rig.
+ *
+ * \note All pointers must be given. No pointer can be left at NULL
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ */
+int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
+                  rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width)
+{
+    int retval;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    CACHE_LOCK(rig);
+    retval = cache_get(rig, vfo, freq, cache_ms_freq, mode, cache_ms_mode, width,
+                       cache_ms_width);
+    CACHE_UNLOCK(rig);
+
+    return retval;
+}
+
 /**
  * \brief get cached values for a VFO
  * \param rig           The rig handle
@@ -27,6 +27,8 @@
 
 int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width);
 int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq);
+void rig_set_cache_ptt(RIG *rig, ptt_t ptt);
+void rig_cache_lock(RIG *rig, int lock);
 void rig_cache_show(RIG *rig, const char *func, int line);
 
 #endif
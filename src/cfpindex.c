@@ -0,0 +1,393 @@
+/*
+ *  Hamlib Interface - confparams lookup index
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file cfpindex.c
+ * \brief Hashed name and token lookup of ext and conf parameter tables
+ *
+ * The ext and conf lookups used to strcmp their way through every table
+ * on each call.  Each caps structure now gets a name index and a token
+ * index per table set, built on first use and kept for the life of the
+ * process since caps are static.  Tables are indexed in the order the
+ * old loops searched them and the first entry wins, so results are the
+ * same as before.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "cfpindex.h"
+
+struct cfp_index_slot
+{
+    const struct confparams *cfp;   /* NULL when free */
+    int order;                      /* position in search order */
+};
+
+struct cfp_index
+{
+    unsigned int mask;
+    struct cfp_index_slot *by_name;
+    struct cfp_index_slot *by_token;
+};
+
+/* caps+kind -> index */
+struct cfp_index_reg
+{
+    const void *caps;
+    enum cfp_index_kind kind;
+    struct cfp_index *idx;
+};
+
+static struct cfp_index_reg *cfp_index_reg;
+static unsigned int cfp_index_reg_mask;
+static unsigned int cfp_index_reg_count;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cfp_index_lock = PTHREAD_MUTEX_INITIALIZER;
+#define cfp_index_lock()   pthread_mutex_lock(&cfp_index_lock)
+#define cfp_index_unlock() pthread_mutex_unlock(&cfp_index_lock)
+#else
+#define cfp_index_lock()
+#define cfp_index_unlock()
+#endif
+
+/* FNV-1a */
+static unsigned int cfp_hash_name(const char *name)
+{
+    unsigned int h = 2166136261u;
+
+    while (*name)
+    {
+        h ^= (unsigned char) * name++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static unsigned int cfp_hash_token(token_t token)
+{
+    return (unsigned int)((unsigned long) token * 2654435761ul);
+}
+
+static unsigned int cfp_hash_reg(const void *caps, enum cfp_index_kind kind)
+{
+    return cfp_hash_token((token_t)(size_t) caps) ^ (unsigned int) kind;
+}
+
+static int cfp_conf_kind(enum cfp_index_kind kind)
+{
+    return kind == CFP_INDEX_RIG_CONF || kind == CFP_INDEX_ROT_CONF
+           || kind == CFP_INDEX_AMP_CONF;
+}
+
+static void cfp_index_insert_name(struct cfp_index *idx,
+                                  const struct confparams *cfp, int order)
+{
+    unsigned int i = cfp_hash_name(cfp->name) & idx->mask;
+
+    while (idx->by_name[i].cfp)
+    {
+        if (!strcmp(idx->by_name[i].cfp->name, cfp->name))
+        {
+            return;     /* an earlier table has it */
+        }
+
+        i = (i + 1) & idx->mask;
+    }
+
+    idx->by_name[i].cfp = cfp;
+    idx->by_name[i].order = order;
+}
+
+static void cfp_index_insert_token(struct cfp_index *idx,
+                                   const struct confparams *cfp, int order)
+{
+    unsigned int i = cfp_hash_token(cfp->token) & idx->mask;
+
+    while (idx->by_token[i].cfp)
+    {
+        if (idx->by_token[i].cfp->token == cfp->token)
+        {
+            return;
+        }
+
+        i = (i + 1) & idx->mask;
+    }
+
+    idx->by_token[i].cfp = cfp;
+    idx->by_token[i].order = order;
+}
+
+/*
+ * Conf tables are searched until the NULL name for both name and token,
+ * ext tables stop their token search at the first 0 token.
+ */
+static struct cfp_index *cfp_index_build(enum cfp_index_kind kind,
+        const struct confparams *const *tables, int ntables)
+{
+    struct cfp_index *idx;
+    const struct confparams *cfp;
+    unsigned int size = 8;
+    int count = 0;
+    int order = 0;
+    int conf = cfp_conf_kind(kind);
+    int t;
+
+    for (t = 0; t < ntables; t++)
+    {
+        for (cfp = tables[t]; cfp && (cfp->name || (!conf && cfp->token)); cfp++)
+        {
+            count++;
+        }
+    }
+
+    while (size < 2 * (unsigned int) count)
+    {
+        size <<= 1;
+    }
+
+    idx = calloc(1, sizeof(*idx));
+
+    if (!idx)
+    {
+        return NULL;
+    }
+
+    idx->mask = size - 1;
+    idx->by_name = calloc(size, sizeof(*idx->by_name));
+    idx->by_token = calloc(size, sizeof(*idx->by_token));
+
+    if (!idx->by_name || !idx->by_token)
+    {
+        free(idx->by_name);
+        free(idx->by_token);
+        free(idx);
+        return NULL;
+    }
+
+    for (t = 0; t < ntables; t++)
+    {
+        for (cfp = tables[t]; cfp && cfp->name; cfp++)
+        {
+            cfp_index_insert_name(idx, cfp, order++);
+
+            if (conf)
+            {
+                cfp_index_insert_token(idx, cfp, order - 1);
+            }
+        }
+
+        for (cfp = tables[t]; !conf && cfp && cfp->token; cfp++)
+        {
+            cfp_index_insert_token(idx, cfp, order++);
+        }
+    }
+
+    return idx;
+}
+
+static int cfp_index_reg_grow(void)
+{
+    unsigned int size = cfp_index_reg ? 2 * (cfp_index_reg_mask + 1) : 64;
+    struct cfp_index_reg *reg = calloc(size, sizeof(*reg));
+    unsigned int i;
+
+    if (!reg)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    for (i = 0; cfp_index_reg && i <= cfp_index_reg_mask; i++)
+    {
+        unsigned int j;
+
+        if (!cfp_index_reg[i].caps)
+        {
+            continue;
+        }
+
+        j = cfp_hash_reg(cfp_index_reg[i].caps, cfp_index_reg[i].kind) & (size - 1);
+
+        while (reg[j].caps)
+        {
+            j = (j + 1) & (size - 1);
+        }
+
+        reg[j] = cfp_index_reg[i];
+    }
+
+    free(cfp_index_reg);
+    cfp_index_reg = reg;
+    cfp_index_reg_mask = size - 1;
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Get the index of a caps structure's tables, building it if needed
+ * \param caps the rig, rot or amp caps the tables belong to
+ * \param kind which of the caps' table sets this is
+ * \param tables the tables in search order, entries may be NULL
+ * \param ntables number of tables
+ *
+ * The caps pointer and kind identify the index, tables are only read
+ * when it is built.
+ *
+ * \return the index or NULL when out of memory, callers then search the
+ * tables themselves
+ */
+const struct cfp_index *HAMLIB_API cfp_index_get(const void *caps,
+        enum cfp_index_kind kind, const struct confparams *const *tables,
+        int ntables)
+{
+    struct cfp_index *idx = NULL;
+    unsigned int i;
+
+    if (!caps)
+    {
+        return NULL;
+    }
+
+    cfp_index_lock();
+
+    if (cfp_index_reg_count * 2 >= cfp_index_reg_mask
+            && cfp_index_reg_grow() != RIG_OK)
+    {
+        cfp_index_unlock();
+        return NULL;
+    }
+
+    i = cfp_hash_reg(caps, kind) & cfp_index_reg_mask;
+
+    while (cfp_index_reg[i].caps)
+    {
+        if (cfp_index_reg[i].caps == caps && cfp_index_reg[i].kind == kind)
+        {
+            idx = cfp_index_reg[i].idx;
+            cfp_index_unlock();
+            return idx;
+        }
+
+        i = (i + 1) & cfp_index_reg_mask;
+    }
+
+    idx = cfp_index_build(kind, tables, ntables);
+
+    if (idx)
+    {
+        cfp_index_reg[i].caps = caps;
+        cfp_index_reg[i].kind = kind;
+        cfp_index_reg[i].idx = idx;
+        cfp_index_reg_count++;
+    }
+
+    cfp_index_unlock();
+
+    return idx;
+}
+
+static const struct cfp_index_slot *cfp_index_find_name(
+    const struct cfp_index *idx, const char *name)
+{
+    unsigned int i = cfp_hash_name(name) & idx->mask;
+
+    while (idx->by_name[i].cfp)
+    {
+        if (!strcmp(idx->by_name[i].cfp->name, name))
+        {
+            return &idx->by_name[i];
+        }
+
+        i = (i + 1) & idx->mask;
+    }
+
+    return NULL;
+}
+
+static const struct cfp_index_slot *cfp_index_find_token(
+    const struct cfp_index *idx, token_t token)
+{
+    unsigned int i = cfp_hash_token(token) & idx->mask;
+
+    while (idx->by_token[i].cfp)
+    {
+        if (idx->by_token[i].cfp->token == token)
+        {
+            return &idx->by_token[i];
+        }
+
+        i = (i + 1) & idx->mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief First entry with this name, or NULL
+ */
+const struct confparams *HAMLIB_API cfp_index_name(const struct cfp_index *idx,
+        const char *name)
+{
+    const struct cfp_index_slot *slot = cfp_index_find_name(idx, name);
+
+    return slot ? slot->cfp : NULL;
+}
+
+/**
+ * \brief First entry with this token, or NULL
+ */
+const struct confparams *HAMLIB_API cfp_index_token(const struct cfp_index *idx,
+        token_t token)
+{
+    const struct cfp_index_slot *slot = cfp_index_find_token(idx, token);
+
+    return slot ? slot->cfp : NULL;
+}
+
+/**
+ * \brief First entry matching either the name or the token, or NULL
+ */
+const struct confparams *HAMLIB_API cfp_index_name_or_token(
+    const struct cfp_index *idx, const char *name, token_t token)
+{
+    const struct cfp_index_slot *by_name = cfp_index_find_name(idx, name);
+    const struct cfp_index_slot *by_token = cfp_index_find_token(idx, token);
+
+    if (by_name && by_token)
+    {
+        return by_name->order <= by_token->order ? by_name->cfp : by_token->cfp;
+    }
+
+    if (by_name)
+    {
+        return by_name->cfp;
+    }
+
+    return by_token ? by_token->cfp : NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ *  Hamlib Interface - confparams lookup index header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _CFPINDEX_H
+#define _CFPINDEX_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* which set of tables of a caps structure an index covers */
+enum cfp_index_kind
+{
+    CFP_INDEX_RIG_EXT,
+    CFP_INDEX_RIG_CONF,
+    CFP_INDEX_ROT_EXT,
+    CFP_INDEX_ROT_CONF,
+    CFP_INDEX_AMP_EXT,
+    CFP_INDEX_AMP_CONF,
+};
+
+struct cfp_index;
+
+extern HAMLIB_EXPORT(const struct cfp_index *) cfp_index_get(const void *caps,
+        enum cfp_index_kind kind, const struct confparams *const *tables,
+        int ntables);
+
+extern HAMLIB_EXPORT(const struct confparams *) cfp_index_name(
+    const struct cfp_index *idx, const char *name);
+extern HAMLIB_EXPORT(const struct confparams *) cfp_index_token(
+    const struct cfp_index *idx, token_t token);
+extern HAMLIB_EXPORT(const struct confparams *) cfp_index_name_or_token(
+    const struct cfp_index *idx, const char *name, token_t token);
+
+__END_DECLS
+
+#endif /* _CFPINDEX_H */
@@ -39,6 +39,8 @@
 
 #include <hamlib/rig.h>
 #include "token.h"
+#include "cfpindex.h"
+#include "rangeindex.h"
 
 
 /*
@@ -130,6 +132,26 @@ static const struct confparams frontend_cfg_params[] =
         "Cache timeout, value of 0 disables caching",
         "500", RIG_CONF_NUMERIC, { .n = {0, 5000, 1}}
     },
+    {
+        TOK_WRITE_THROUGH, "write_through", "Write-through delay in ms",
+        "A frequency or mode set is served from the cache and read back from the rig this many ms later, 0 reads it back right away",
+        "200", RIG_CONF_NUMERIC, { .n = {0, 5000, 1}}
+    },
+    {
+        TOK_VFO_SWAP_HOLD, "vfo_swap_hold", "VFO swap hold in ms",
+        "A VFO selected for a call on a non-targetable VFO stays selected this many ms for the next such call, 0 swaps back right away",
+        "0", RIG_CONF_NUMERIC, { .n = {0, 10000, 1}}
+    },
+    {
+        TOK_STATE_FILE, "state_file", "State file",
+        "File the cached VFO, split, frequencies and modes are saved to on close and loaded from on open, empty to disable",
+        "", RIG_CONF_STRING, { }
+    },
+    {
+        TOK_AUTO_BAUD, "auto_baud", "Serial speed detection",
+        "1 tries the other serial speeds when the rig does not answer on open, 2 also switches rigs that can to their fastest speed",
+        "0", RIG_CONF_NUMERIC, { .n = {0, 2, 1}}
+    },
     {
         TOK_AUTO_POWER_ON, "auto_power_on", "Auto power on",
         "True enables compatible rigs to be powered up on open",
@@ -180,6 +202,31 @@ static const struct confparams frontend_cfg_params[] =
         "Path name to a script/program to control a tuner with 1 argument of 0/1 for Tuner Off/On",
         "hamlib_tuner_control", RIG_CONF_STRING,
     },
+    {
+        TOK_SPECTRUM_SHM, "spectrum_shm", "Spectrum shared memory name",
+        "POSIX shared memory object spectrum scope lines are written to for local readers, e.g. /hamlib-spectrum, empty to disable",
+        "", RIG_CONF_STRING,
+    },
+    {
+        TOK_SPECTRUM_BINS, "spectrum_bins", "Spectrum bins",
+        "Reduce spectrum lines to at most this many bins keeping the strongest point of each, 0 to disable",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, HAMLIB_MAX_SPECTRUM_DATA, 1 } }
+    },
+    {
+        TOK_SPECTRUM_AVG, "spectrum_avg", "Spectrum averaging",
+        "Weight of a new spectrum line in the exponential average, 0 to disable",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, 1, 0.01 } }
+    },
+    {
+        TOK_SPECTRUM_MAX_HOLD, "spectrum_max_hold", "Spectrum max hold",
+        "True passes on the maximum of all spectrum lines since the scope was last tuned",
+        "0", RIG_CONF_CHECKBUTTON, { }
+    },
+    {
+        TOK_SPECTRUM_RATE, "spectrum_rate", "Spectrum line rate",
+        "Maximum spectrum lines per second per scope, 0 for no limit",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, 100, 0.1 } }
+    },
     {
         TOK_OFFSET_VFOA, "offset_vfoa", "Offset value in Hz",
         "Add Hz to VFOA/Main frequency set",
@@ -247,6 +294,7 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
     const struct rig_caps *caps;
     struct rig_state *rs;
     long val_i;
+    double val_f;
 
     caps = rig->caps;
     rs = &rig->state;
@@ -515,6 +563,7 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
             return -RIG_EINVAL;
         }
 
+        range_index_build(rig);
         break;
 
     case TOK_PTT_TYPE:
@@ -658,6 +707,40 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, atol(val));
         break;
 
+    case TOK_WRITE_THROUGH:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->write_through_ms = val_i;
+        rs->verify_freq = RIG_VFO_NONE;
+        rs->verify_mode = RIG_VFO_NONE;
+        break;
+
+    case TOK_VFO_SWAP_HOLD:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->vfo_swap_hold_ms = val_i;
+        break;
+
+    case TOK_STATE_FILE:
+        free(rs->state_file);
+        rs->state_file = val[0] ? strdup(val) : NULL;
+        break;
+
+    case TOK_AUTO_BAUD:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0 || val_i > 2)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->auto_baud = val_i;
+        break;
+
     case TOK_AUTO_POWER_ON:
         if (1 != sscanf(val, "%ld", &val_i))
         {
@@ -743,6 +826,48 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         rs->tuner_control_pathname = strdup(val); // yeah -- need to free it
         break;
 
+    case TOK_SPECTRUM_SHM:
+        free(rs->spectrum_shm_name);
+        rs->spectrum_shm_name = val[0] ? strdup(val) : NULL;
+        break;
+
+    case TOK_SPECTRUM_BINS:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0
+                || val_i > HAMLIB_MAX_SPECTRUM_DATA)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->spectrum_bins = val_i;
+        break;
+
+    case TOK_SPECTRUM_AVG:
+        if (1 != sscanf(val, "%lf", &val_f) || val_f < 0 || val_f > 1)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->spectrum_avg = val_f;
+        break;
+
+    case TOK_SPECTRUM_MAX_HOLD:
+        if (1 != sscanf(val, "%ld", &val_i))
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->spectrum_max_hold = val_i ? 1 : 0;
+        break;
+
+    case TOK_SPECTRUM_RATE:
+        if (1 != sscanf(val, "%lf", &val_f) || val_f < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->spectrum_rate = val_f;
+        break;
+
     case TOK_TIMEOUT_RETRY:
         if (1 != sscanf(val, "%ld", &val_i))
         {
@@ -1089,6 +1214,22 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rig_get_cache_timeout_ms(rig, HAMLIB_CACHE_ALL));
         break;
 
+    case TOK_WRITE_THROUGH:
+        SNPRINTF(val, val_len, "%d", rs->write_through_ms);
+        break;
+
+    case TOK_VFO_SWAP_HOLD:
+        SNPRINTF(val, val_len, "%d", rs->vfo_swap_hold_ms);
+        break;
+
+    case TOK_STATE_FILE:
+        SNPRINTF(val, val_len, "%s", rs->state_file ? rs->state_file : "");
+        break;
+
+    case TOK_AUTO_BAUD:
+        SNPRINTF(val, val_len, "%d", rs->auto_baud);
+        break;
+
     case TOK_AUTO_POWER_ON:
         SNPRINTF(val, val_len, "%d", rs->auto_power_on);
         break;
@@ -1129,6 +1270,27 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rs->rigport.timeout_retry);
         break;
 
+    case TOK_SPECTRUM_SHM:
+        SNPRINTF(val, val_len, "%s",
+                 rs->spectrum_shm_name ? rs->spectrum_shm_name : "");
+        break;
+
+    case TOK_SPECTRUM_BINS:
+        SNPRINTF(val, val_len, "%d", rs->spectrum_bins);
+        break;
+
+    case TOK_SPECTRUM_AVG:
+        SNPRINTF(val, val_len, "%g", rs->spectrum_avg);
+        break;
+
+    case TOK_SPECTRUM_MAX_HOLD:
+        SNPRINTF(val, val_len, "%d", rs->spectrum_max_hold);
+        break;
+
+    case TOK_SPECTRUM_RATE:
+        SNPRINTF(val, val_len, "%g", rs->spectrum_rate);
+        break;
+
     default:
         return -RIG_EINVAL;
     }
@@ -1206,6 +1368,21 @@ int HAMLIB_API rig_token_foreach(RIG *rig,
 }
 
 
+/* hashed lookup of the conf tables, in the order searched below */
+static const struct cfp_index *rig_conf_index(const RIG *rig)
+{
+    const struct confparams *const tables[] =
+    {
+        rig->caps->cfgparams,
+        frontend_cfg_params,
+        rig->caps->port_type == RIG_PORT_SERIAL ? frontend_serial_cfg_params : NULL
+    };
+
+    return cfp_index_get(rig->caps, CFP_INDEX_RIG_CONF, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
+
 /**
  * \brief lookup a confparam struct
  * \param rig   The rig handle
@@ -1220,6 +1397,7 @@ const struct confparams *HAMLIB_API rig_confparam_lookup(RIG *rig,
 {
     const struct confparams *cfp;
     token_t token;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called for %s\n", __func__, name);
 
@@ -1231,6 +1409,13 @@ const struct confparams *HAMLIB_API rig_confparam_lookup(RIG *rig,
     /* 0 returned for invalid format */
     token = strtol(name, NULL, 0);
 
+    idx = rig_conf_index(rig);
+
+    if (idx)
+    {
+        return cfp_index_name_or_token(idx, name, token);
+    }
+
     for (cfp = rig->caps->cfgparams; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name) || token == cfp->token)
@@ -49,6 +49,9 @@
 #include "misc.h"
 #include "cache.h"
 #include "network.h"
+#include "spectrum_ring.h"
+#include "spectrum_proc.h"
+#include "morse.h"
 
 #define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
 
@@ -658,8 +661,10 @@ int rig_fire_ptt_event(RIG *rig, vfo_t vfo, ptt_t ptt)
     rig_debug(RIG_DEBUG_TRACE, "Event: PTT changed to %i on %s\n", ptt,
               rig_strvfo(vfo));
 
-    rig->state.cache.ptt = ptt;
-    elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+    rig_set_cache_ptt(rig, ptt);
+
+    /* wakes rig_wait_morse() */
+    morse_ptt_event(rig, ptt);
 
     network_publish_rig_transceive_data(rig);
 
@@ -772,6 +777,19 @@ int rig_fire_spectrum_event(RIG *rig, struct rig_spectrum_line *line)
 {
     ENTERFUNC;
 
+    line = spectrum_proc_line(rig, line);
+
+    if (!line)
+    {
+        // held back by the rate limit
+        RETURNFUNC(RIG_OK);
+    }
+
+    if (rig->state.spectrum_ring)
+    {
+        spectrum_ring_write(rig->state.spectrum_ring, line);
+    }
+
     if (rig_need_debug(RIG_DEBUG_TRACE))
     {
         char spectrum_debug[line->spectrum_data_length * 4];
@@ -43,6 +43,7 @@
 #include <hamlib/rig.h>
 
 #include "token.h"
+#include "cfpindex.h"
 
 static int rig_has_ext_token(RIG *rig, token_t token)
 {
@@ -218,6 +219,18 @@ int HAMLIB_API rig_ext_parm_foreach(RIG *rig,
 }
 
 
+/* hashed lookup of the ext tables, in the order searched below */
+static const struct cfp_index *rig_ext_index(const RIG *rig)
+{
+    const struct confparams *const tables[] =
+    {
+        rig->caps->extlevels, rig->caps->extfuncs, rig->caps->extparms
+    };
+
+    return cfp_index_get(rig->caps, CFP_INDEX_RIG_EXT, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
 /**
  * \param rig
  * \param name
@@ -227,11 +240,12 @@ int HAMLIB_API rig_ext_parm_foreach(RIG *rig,
  *
  * Returns NULL if nothing found
  *
- * TODO: should use Lex to speed it up, strcmp hurts!
+ * Uses a hash index of the tables, built on first use.
  */
 const struct confparams *HAMLIB_API rig_ext_lookup(RIG *rig, const char *name)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -240,6 +254,13 @@ const struct confparams *HAMLIB_API rig_ext_lookup(RIG *rig, const char *name)
         return NULL;
     }
 
+    idx = rig_ext_index(rig);
+
+    if (idx)
+    {
+        return cfp_index_name(idx, name);
+    }
+
     for (cfp = rig->caps->extlevels; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name))
@@ -279,6 +300,7 @@ const struct confparams *HAMLIB_API rig_ext_lookup(RIG *rig, const char *name)
 const struct confparams *HAMLIB_API rig_ext_lookup_tok(RIG *rig, token_t token)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -287,6 +309,13 @@ const struct confparams *HAMLIB_API rig_ext_lookup_tok(RIG *rig, token_t token)
         return NULL;
     }
 
+    idx = rig_ext_index(rig);
+
+    if (idx)
+    {
+        return cfp_index_token(idx, token);
+    }
+
     for (cfp = rig->caps->extlevels; cfp && cfp->token; cfp++)
     {
         if (cfp->token == token)
@@ -49,6 +49,7 @@
 #include <hamlib/amplifier.h>
 
 #include "token.h"
+#include "cfpindex.h"
 
 
 /**
@@ -153,6 +154,18 @@ int HAMLIB_API amp_ext_parm_foreach(AMP *amp,
 }
 
 
+/* hashed lookup of the ext tables, in the order searched below */
+static const struct cfp_index *amp_ext_index(const AMP *amp)
+{
+    const struct confparams *const tables[] =
+    {
+        amp->caps->extlevels, amp->caps->extparms
+    };
+
+    return cfp_index_get(amp->caps, CFP_INDEX_AMP_EXT, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
 /**
  * \brief Lookup an extension levels or parameters token by its name and return
  * a pointer to the containing #confparams structure member.
@@ -171,11 +184,12 @@ int HAMLIB_API amp_ext_parm_foreach(AMP *amp,
  *
  * \sa amp_ext_token_lookup()
  *
- * \todo Should use Lex to speed it up, strcmp() hurts!
+ * Uses a hash index of the tables, built on first use.
  */
 const struct confparams *HAMLIB_API amp_ext_lookup(AMP *amp, const char *name)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -184,6 +198,13 @@ const struct confparams *HAMLIB_API amp_ext_lookup(AMP *amp, const char *name)
         return NULL;
     }
 
+    idx = amp_ext_index(amp);
+
+    if (idx)
+    {
+        return cfp_index_name(idx, name);
+    }
+
     for (cfp = amp->caps->extlevels; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name))
@@ -220,6 +241,7 @@ const struct confparams *HAMLIB_API amp_ext_lookup(AMP *amp, const char *name)
 const struct confparams *HAMLIB_API amp_ext_lookup_tok(AMP *amp, token_t token)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -228,6 +250,13 @@ const struct confparams *HAMLIB_API amp_ext_lookup_tok(AMP *amp, token_t token)
         return NULL;
     }
 
+    idx = amp_ext_index(amp);
+
+    if (idx)
+    {
+        return cfp_index_token(idx, token);
+    }
+
     for (cfp = amp->caps->extlevels; cfp && cfp->token; cfp++)
     {
         if (cfp->token == token)
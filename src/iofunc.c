@@ -51,6 +51,8 @@
 #include "network.h"
 #include "cm108.h"
 #include "asyncpipe.h"
+#include "ioreactor.h"
+#include "rig_stats.h"
 
 #if defined(WIN32) && defined(HAVE_WINDOWS_H)
 #include <windows.h>
@@ -363,6 +365,13 @@ int HAMLIB_API port_open(hamlib_port_t *p)
         return (-RIG_EINVAL);
     }
 
+    /* the other port types are not read through read_block/read_string */
+    if (p->type.rig == RIG_PORT_SERIAL || p->type.rig == RIG_PORT_NETWORK
+            || p->type.rig == RIG_PORT_UDP_NETWORK)
+    {
+        io_reactor_add(p);  /* falls back to select() on failure */
+    }
+
     return (RIG_OK);
 }
 
@@ -377,6 +386,8 @@ int HAMLIB_API port_close(hamlib_port_t *p, rig_port_t port_type)
 {
     int ret = RIG_OK;
 
+    io_reactor_remove(p);
+
     if (p->fd != -1)
     {
         switch (port_type)
@@ -795,6 +806,20 @@ int HAMLIB_API port_flush_sync_pipes(hamlib_port_t *p)
 
 /* POSIX */
 
+static ssize_t port_read_fd(hamlib_port_t *p, int fd, void *buf, size_t count,
+                            int direct)
+{
+    ssize_t ret = direct ? io_reactor_read(p, buf, count) : -RIG_ENIMPL;
+
+    if (ret == -RIG_ENIMPL)
+    {
+        io_reactor_count(0, 1, 1);
+        ret = read(fd, buf, count);
+    }
+
+    return ret;
+}
+
 static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
                                  int direct)
 {
@@ -804,7 +829,7 @@ static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
     {
         unsigned char *pbuf = buf;
 
-        ssize_t ret = read(fd, buf, count);
+        ssize_t ret = port_read_fd(p, fd, buf, count, direct);
 
         /* clear MSB */
         ssize_t i;
@@ -818,7 +843,7 @@ static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
     }
     else
     {
-        return read(fd, buf, count);
+        return port_read_fd(p, fd, buf, count, direct);
     }
 }
 
@@ -890,6 +915,22 @@ static int port_wait_for_data(hamlib_port_t *p, int direct)
     struct timeval tv, tv_timeout;
     int result;
 
+    result = io_reactor_wait(p, direct);
+
+    if (result == 1)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s(): attempting to read error code, direct=%d\n",
+                  __func__, direct);
+        return port_read_sync_data_error_code(p, p->fd_sync_error_read, 0);
+    }
+
+    if (result != -RIG_ENIMPL)
+    {
+        return result;
+    }
+
+    io_reactor_count(1, 0, 0);
+
     fd = direct ? p->fd : p->fd_sync_read;
     errorfd = direct ? -1 : p->fd_sync_error_read;
     maxfd = (fd > errorfd) ? fd : errorfd;
@@ -1040,6 +1081,7 @@ int HAMLIB_API port_flush_sync_pipes(hamlib_port_t *p)
 int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
                            size_t count)
 {
+    struct timespec begin;
     int ret;
     int method = 0;
 
@@ -1049,6 +1091,20 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
         return (-RIG_EIO);
     }
 
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
+
+    /* paced ports write from the reactor so the caller does not sleep */
+    ret = io_reactor_write(p, txbuffer, count);
+
+    if (ret != -RIG_ENIMPL)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s(): TX %d bytes, queued\n", __func__,
+                  (int)count);
+        dump_hex((unsigned char *) txbuffer, count);
+        rig_stats_port(p, RIG_STATS_PORT_WRITE, &begin);
+        return ret;
+    }
+
 #ifdef WANT_NON_ACTIVE_POST_WRITE_DELAY
 
     if (p->post_write_date.tv_sec != 0)
@@ -1117,6 +1173,8 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
         }
     }
 
+    io_reactor_count_write(1, method == 1 ? (int)count : 1);
+
     rig_debug(RIG_DEBUG_TRACE, "%s(): TX %d bytes, method=%d\n", __func__,
               (int)count, method);
     dump_hex((unsigned char *) txbuffer, count);
@@ -1144,13 +1202,26 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
         /* with sequential fast writes*/
     }
 
+    rig_stats_port(p, RIG_STATS_PORT_WRITE, &begin);
+
     return RIG_OK;
 }
 
+/* the async reader thread waits for anything the rig sends, not counted */
+static void port_read_stats(const hamlib_port_t *p, int direct,
+                            enum rig_stats_port_e what, const struct timespec *begin)
+{
+    if (!p->asyncio || !direct)
+    {
+        rig_stats_port(p, what, begin);
+    }
+}
+
 static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
-                              size_t count, int direct)
+                              size_t count, int direct, int partial)
 {
     struct timeval start_time, end_time, elapsed_time;
+    struct timespec begin;
     int total_count = 0;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called, direct=%d\n", __func__, direct);
@@ -1162,6 +1233,7 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
 
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     short timeout_retries = p->timeout_retry;
 
@@ -1177,6 +1249,7 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
             if (timeout_retries > 0)
             {
                 timeout_retries--;
+                port_read_stats(p, direct, RIG_STATS_PORT_RETRY, &begin);
                 rig_debug(RIG_DEBUG_CACHE, "%s(%d): retrying read timeout %d/%d timeout=%dms\n", __func__, __LINE__,
                     p->timeout_retry - timeout_retries, p->timeout_retry, p->timeout);
                 hl_usleep(10 * 1000);
@@ -1200,6 +1273,7 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
                       total_count,
                       direct);
 
+            port_read_stats(p, direct, RIG_STATS_PORT_TIMEOUT, &begin);
             return -RIG_ETIMEOUT;
         }
 
@@ -1228,8 +1302,21 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
             return -RIG_EIO;
         }
 
+        /* readable but nothing to read, the server hung up */
+        if (rd_count == 0 && direct && p->type.rig == RIG_PORT_NETWORK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(): connection closed after %d chars\n",
+                      __func__, total_count);
+            return -RIG_EIO;
+        }
+
         total_count += rd_count;
         count -= rd_count;
+
+        if (partial && total_count > 0)
+        {
+            break;
+        }
     }
 
     if (direct)
@@ -1239,6 +1326,8 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
         dump_hex((unsigned char *) rxbuffer, total_count);
     }
 
+    port_read_stats(p, direct, RIG_STATS_PORT_READ, &begin);
+
     return total_count;           /* return bytes count read */
 }
 
@@ -1264,7 +1353,7 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
 int HAMLIB_API read_block(hamlib_port_t *p, unsigned char *rxbuffer,
                           size_t count)
 {
-    return read_block_generic(p, rxbuffer, count, !p->asyncio);
+    return read_block_generic(p, rxbuffer, count, !p->asyncio, 0);
 }
 
 /**
@@ -1288,7 +1377,84 @@ int HAMLIB_API read_block(hamlib_port_t *p, unsigned char *rxbuffer,
 int HAMLIB_API read_block_direct(hamlib_port_t *p, unsigned char *rxbuffer,
                                  size_t count)
 {
-    return read_block_generic(p, rxbuffer, count, 1);
+    return read_block_generic(p, rxbuffer, count, 1, 0);
+}
+
+/**
+ * \brief Read whatever bytes are available, up to a buffer full
+ * \param p rig port descriptor
+ * \param rxbuffer buffer to receive data
+ * \param count size of rxbuffer
+ * \return count of bytes received, at least one, or < 0 on error
+ *
+ * Like read_block(), but returns as soon as one read got some data
+ * instead of waiting for "count" bytes, so framing code can consume
+ * everything the device has in one call.
+ */
+int HAMLIB_API read_block_partial(hamlib_port_t *p, unsigned char *rxbuffer,
+                                  size_t count)
+{
+    return read_block_generic(p, rxbuffer, count, !p->asyncio, 1);
+}
+
+/**
+ * \brief Read whatever bytes are available directly from the device
+ * \param p rig port descriptor
+ * \param rxbuffer buffer to receive data
+ * \param count size of rxbuffer
+ * \return count of bytes received, at least one, or < 0 on error
+ *
+ * Like read_block_direct(), see read_block_partial().
+ */
+int HAMLIB_API read_block_partial_direct(hamlib_port_t *p,
+        unsigned char *rxbuffer, size_t count)
+{
+    return read_block_generic(p, rxbuffer, count, 1, 1);
+}
+
+/**
+ * \brief Read bytes the device has already sent, without waiting
+ * \param p rig port descriptor
+ * \param rxbuffer buffer to receive data
+ * \param count size of rxbuffer
+ * \return count of bytes received, 0 when nothing is pending, or < 0 on error
+ *
+ * Lets a backend pick up unsolicited data between its transactions.
+ */
+int HAMLIB_API read_block_pending_direct(hamlib_port_t *p,
+        unsigned char *rxbuffer, size_t count)
+{
+    int timeout = p->timeout;
+    int result;
+
+    p->timeout = 0;
+    result = port_wait_for_data(p, 1);
+    p->timeout = timeout;
+
+    if (result == -RIG_ETIMEOUT)
+    {
+        return 0;
+    }
+
+    if (result < 0)
+    {
+        return result;
+    }
+
+    result = (int) port_read_generic(p, rxbuffer, count, 1);
+
+    if (result < 0)
+    {
+        return errno == EAGAIN ? 0 : -RIG_EIO;
+    }
+
+    if (result > 0)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s(): RX %d bytes\n", __func__, result);
+        dump_hex(rxbuffer, result);
+    }
+
+    return result;
 }
 
 static int read_string_generic(hamlib_port_t *p,
@@ -1301,6 +1467,7 @@ static int read_string_generic(hamlib_port_t *p,
                                int direct)
 {
     struct timeval start_time, end_time, elapsed_time;
+    struct timespec begin;
     int total_count = 0;
     int i = 0;
     static int minlen = 1; // dynamic minimum length of rig response data
@@ -1329,6 +1496,7 @@ static int read_string_generic(hamlib_port_t *p,
 
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     memset(rxbuffer, 0, rxmax);
 
@@ -1344,6 +1512,7 @@ static int read_string_generic(hamlib_port_t *p,
             if (timeout_retries > 0)
             {
                 timeout_retries--;
+                port_read_stats(p, direct, RIG_STATS_PORT_RETRY, &begin);
                 rig_debug(RIG_DEBUG_CACHE, "%s(%d): retrying read timeout %d/%d timeout=%d\n", __func__, __LINE__,
                     p->timeout_retry - timeout_retries, p->timeout_retry, p->timeout);
                 hl_usleep(10 * 1000);
@@ -1373,6 +1542,12 @@ static int read_string_generic(hamlib_port_t *p,
                               direct);
                 }
 
+                // a flush reads until nothing comes, that is no timeout
+                if (!flush_flag)
+                {
+                    port_read_stats(p, direct, RIG_STATS_PORT_TIMEOUT, &begin);
+                }
+
                 return -RIG_ETIMEOUT;
             }
 
@@ -1482,6 +1657,11 @@ static int read_string_generic(hamlib_port_t *p,
         dump_hex((unsigned char *) rxbuffer, total_count);
     }
 
+    if (!flush_flag)
+    {
+        port_read_stats(p, direct, RIG_STATS_PORT_READ, &begin);
+    }
+
     return total_count;           /* return bytes count read */
 }
 
@@ -37,6 +37,18 @@ extern HAMLIB_EXPORT(int) read_block_direct(hamlib_port_t *p,
                                             unsigned char *rxbuffer,
                                             size_t count);
 
+extern HAMLIB_EXPORT(int) read_block_partial(hamlib_port_t *p,
+                                             unsigned char *rxbuffer,
+                                             size_t count);
+
+extern HAMLIB_EXPORT(int) read_block_partial_direct(hamlib_port_t *p,
+                                                    unsigned char *rxbuffer,
+                                                    size_t count);
+
+extern HAMLIB_EXPORT(int) read_block_pending_direct(hamlib_port_t *p,
+                                                    unsigned char *rxbuffer,
+                                                    size_t count);
+
 extern HAMLIB_EXPORT(int) write_block(hamlib_port_t *p,
                                       const unsigned char *txbuffer,
                                       size_t count);
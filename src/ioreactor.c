@@ -0,0 +1,1168 @@
+/*
+ *  Hamlib Interface - port I/O reactor
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file ioreactor.c
+ * \brief Event driven waits and buffered reads for opened ports
+ *
+ * Where epoll is available every opened port gets a persistent epoll
+ * set for its device fd and one for its sync data/error pipes, so a wait
+ * is a single epoll_wait() instead of rebuilding fd_sets for select(),
+ * and fds above FD_SETSIZE work.  Device reads are buffered: one read()
+ * fetches everything the rig has sent and read_string() then consumes
+ * the reply byte by byte without further syscalls.
+ *
+ * Ports with a write_delay or post_write_delay also get an output
+ * scheduler: a writer thread paces the bytes out with a timerfd, and
+ * write_block() returns as soon as its command is queued, so neither
+ * the write_delay nor the post_write_delay is slept by the caller.  The
+ * next read of the port is the completion point: it waits for the queue
+ * to drain, so replies are not timed out while a command is still going
+ * out, and returns the error of a queued command that failed.  Commands
+ * written between io_reactor_cork() and io_reactor_uncork() leave in a
+ * single write, and io_reactor_uncork() waits for that write.
+ *
+ * Ports are looked up by address in a small table so hamlib_port_t does
+ * not change.  A lookup holds a reference on the slot until the call is
+ * done, and io_reactor_remove() waits for those before the slot can be
+ * reused.  A port that is not registered (probing, copied ports,
+ * platforms without epoll) makes every call here return -RIG_ENIMPL and
+ * iofunc.c falls back to select()/read().
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "ioreactor.h"
+
+#define IO_REACTOR_MAX_PORTS 32
+#define IO_REACTOR_BUFSIZE 512
+
+#if defined(HAVE_SYS_TIMERFD_H) && defined(HAVE_PTHREAD)
+#define IO_REACTOR_SCHED 1
+#endif
+
+/* counted by every thread doing I/O and by the writer threads */
+#if defined(__GNUC__) || defined(__clang__)
+#define io_stats_add(f, v) __atomic_fetch_add(&io_reactor_stats.f, (v), __ATOMIC_RELAXED)
+#define io_stats_load(f) __atomic_load_n(&io_reactor_stats.f, __ATOMIC_RELAXED)
+#define io_stats_store(f, v) __atomic_store_n(&io_reactor_stats.f, (v), __ATOMIC_RELAXED)
+#else
+#define io_stats_add(f, v) (io_reactor_stats.f += (v))
+#define io_stats_load(f) (io_reactor_stats.f)
+#define io_stats_store(f, v) (io_reactor_stats.f = (v))
+#endif
+
+static struct io_reactor_stats io_reactor_stats;
+
+void HAMLIB_API io_reactor_get_stats(struct io_reactor_stats *stats)
+{
+    stats->waits = io_stats_load(waits);
+    stats->wait_syscalls = io_stats_load(wait_syscalls);
+    stats->read_calls = io_stats_load(read_calls);
+    stats->read_syscalls = io_stats_load(read_syscalls);
+    stats->write_calls = io_stats_load(write_calls);
+    stats->write_syscalls = io_stats_load(write_syscalls);
+}
+
+void HAMLIB_API io_reactor_reset_stats(void)
+{
+    io_stats_store(waits, 0);
+    io_stats_store(wait_syscalls, 0);
+    io_stats_store(read_calls, 0);
+    io_stats_store(read_syscalls, 0);
+    io_stats_store(write_calls, 0);
+    io_stats_store(write_syscalls, 0);
+}
+
+void HAMLIB_API io_reactor_count(int wait_syscalls, int read_calls,
+                                 int read_syscalls)
+{
+    if (wait_syscalls)
+    {
+        io_stats_add(waits, 1);
+        io_stats_add(wait_syscalls, 1);
+    }
+
+    io_stats_add(read_calls, read_calls);
+    io_stats_add(read_syscalls, read_syscalls);
+}
+
+void HAMLIB_API io_reactor_count_write(int write_calls, int write_syscalls)
+{
+    io_stats_add(write_calls, write_calls);
+    io_stats_add(write_syscalls, write_syscalls);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* one queued command, freed by the caller waiting for it if any */
+struct io_reactor_out
+{
+    struct io_reactor_out *next;
+    int waited;                 /* a caller waits for done */
+    int done;                   /* written or dropped, retcode is set */
+    int retcode;                /* RIG_OK or the error of its write */
+    size_t len;
+    size_t off;                 /* bytes already written */
+    unsigned char data[];
+};
+
+struct io_reactor_port
+{
+    const hamlib_port_t *port;  /* NULL when the slot is free */
+    int refs;                   /* io_reactor_find() not yet put back */
+    int removing;               /* io_reactor_remove() waits for refs */
+    int fd;                     /* device fd the epoll sets were built for */
+    int epfd_direct;
+    int epfd_sync;
+    int fd_sync_error_read;
+    size_t head;
+    size_t tail;
+    unsigned char buf[IO_REACTOR_BUFSIZE];
+
+    int corked;                 /* io_reactor_cork() nesting */
+    struct io_reactor_out *cork_head;
+    struct io_reactor_out *cork_tail;
+
+#ifdef IO_REACTOR_SCHED
+    int sched_running;          /* writer thread started */
+    int sched_run;              /* cleared to stop the writer thread */
+    int timerfd;
+    pthread_t sched_thread;
+    pthread_mutex_t sched_lock;
+    pthread_cond_t sched_cond;  /* queue not empty or stop */
+    pthread_cond_t sched_idle;  /* a write completed */
+    struct io_reactor_out *out_head;
+    struct io_reactor_out *out_tail;
+    int out_busy;               /* writer is using out_head */
+    struct io_reactor_out *failed_head; /* not waited for, to be reported */
+    struct io_reactor_out *failed_tail; /* by the next io_reactor_drain() */
+    struct timespec next_write; /* CLOCK_MONOTONIC */
+#endif
+};
+
+static struct io_reactor_port io_reactor_ports[IO_REACTOR_MAX_PORTS];
+static int io_reactor_enabled = 1;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t io_reactor_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t io_reactor_unref = PTHREAD_COND_INITIALIZER;
+#define io_reactor_lock()   pthread_mutex_lock(&io_reactor_lock)
+#define io_reactor_unlock() pthread_mutex_unlock(&io_reactor_lock)
+#else
+#define io_reactor_lock()
+#define io_reactor_unlock()
+#endif
+
+/* the slot of a port with a reference taken, io_reactor_put() it */
+static struct io_reactor_port *io_reactor_find(const hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = NULL;
+    int i;
+
+    if (!io_reactor_enabled)
+    {
+        return NULL;
+    }
+
+    io_reactor_lock();
+
+    for (i = 0; i < IO_REACTOR_MAX_PORTS; i++)
+    {
+        if (io_reactor_ports[i].port == p && io_reactor_ports[i].fd == p->fd
+                && !io_reactor_ports[i].removing)
+        {
+            rp = &io_reactor_ports[i];
+            rp->refs++;
+            break;
+        }
+    }
+
+    io_reactor_unlock();
+
+    return rp;
+}
+
+static void io_reactor_put(struct io_reactor_port *rp)
+{
+    if (rp == NULL)
+    {
+        return;
+    }
+
+    io_reactor_lock();
+
+    if (--rp->refs == 0 && rp->removing)
+    {
+#ifdef HAVE_PTHREAD
+        pthread_cond_broadcast(&io_reactor_unref);
+#endif
+    }
+
+    io_reactor_unlock();
+}
+
+static int io_reactor_scheduled(const struct io_reactor_port *rp)
+{
+#ifdef IO_REACTOR_SCHED
+    return rp->sched_running;
+#else
+    return 0;
+#endif
+}
+
+static void io_reactor_free_list(struct io_reactor_out *out)
+{
+    while (out)
+    {
+        struct io_reactor_out *next = out->next;
+
+        free(out);
+        out = next;
+    }
+}
+
+#ifdef IO_REACTOR_SCHED
+static void io_reactor_sched_stop(struct io_reactor_port *rp);
+#endif
+
+static void io_reactor_release(struct io_reactor_port *rp)
+{
+#ifdef IO_REACTOR_SCHED
+    io_reactor_sched_stop(rp);
+#endif
+
+    io_reactor_free_list(rp->cork_head);
+
+    if (rp->epfd_direct >= 0)
+    {
+        close(rp->epfd_direct);
+    }
+
+    if (rp->epfd_sync >= 0)
+    {
+        close(rp->epfd_sync);
+    }
+
+    memset(rp, 0, sizeof(*rp));
+}
+
+static int io_reactor_watch(int epfd, int fd)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+#ifdef IO_REACTOR_SCHED
+
+static void io_reactor_timespec_add_ms(struct timespec *ts, int ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/* block on the timerfd until the port may be written again */
+static void io_reactor_pace(struct io_reactor_port *rp)
+{
+    struct itimerspec its;
+    struct timespec now;
+    uint64_t expirations;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (now.tv_sec > rp->next_write.tv_sec
+            || (now.tv_sec == rp->next_write.tv_sec
+                && now.tv_nsec >= rp->next_write.tv_nsec))
+    {
+        return;
+    }
+
+    memset(&its, 0, sizeof(its));
+    its.it_value = rp->next_write;
+
+    if (timerfd_settime(rp->timerfd, TFD_TIMER_ABSTIME, &its, NULL) < 0
+            || read(rp->timerfd, &expirations, sizeof(expirations)) < 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: timerfd failed: %s\n", __func__,
+                  strerror(errno));
+    }
+}
+
+/*
+ * Hands a command back to its waiter, or keeps it for the next drain
+ * when it failed and nobody waits.  Called with sched_lock held.
+ */
+static void io_reactor_out_done(struct io_reactor_port *rp,
+                                struct io_reactor_out *out, int retcode)
+{
+    out->next = NULL;
+    out->retcode = retcode;
+    out->done = 1;
+
+    if (out->waited)
+    {
+        return;
+    }
+
+    if (retcode == RIG_OK)
+    {
+        free(out);
+    }
+    else if (rp->failed_tail)
+    {
+        rp->failed_tail->next = out;
+        rp->failed_tail = out;
+    }
+    else
+    {
+        rp->failed_head = rp->failed_tail = out;
+    }
+}
+
+static void *io_reactor_writer(void *arg)
+{
+    struct io_reactor_port *rp = arg;
+    const hamlib_port_t *p = rp->port;
+
+    for (;;)
+    {
+        struct io_reactor_out *out;
+        ssize_t ret;
+        size_t n;
+
+        pthread_mutex_lock(&rp->sched_lock);
+
+        while (rp->out_head == NULL && rp->sched_run)
+        {
+            pthread_cond_wait(&rp->sched_cond, &rp->sched_lock);
+        }
+
+        /* queued commands are still sent when the port is closing */
+        if (rp->out_head == NULL)
+        {
+            pthread_mutex_unlock(&rp->sched_lock);
+            break;
+        }
+
+        out = rp->out_head;
+        rp->out_busy = 1;
+        pthread_mutex_unlock(&rp->sched_lock);
+
+        io_reactor_pace(rp);
+
+        n = p->write_delay > 0 ? 1 : out->len - out->off;
+        ret = write(rp->fd, out->data + out->off, n);
+
+        pthread_mutex_lock(&rp->sched_lock);
+        io_stats_add(write_syscalls, 1);
+
+        if (ret != (ssize_t) n)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: write failed %d - %s\n", __func__,
+                      (int) ret, strerror(errno));
+
+            /* the rest would only confuse the rig, each of them fails */
+            while (rp->out_head)
+            {
+                out = rp->out_head;
+                rp->out_head = out->next;
+                io_reactor_out_done(rp, out, -RIG_EIO);
+            }
+
+            rp->out_tail = NULL;
+        }
+        else
+        {
+            clock_gettime(CLOCK_MONOTONIC, &rp->next_write);
+            io_reactor_timespec_add_ms(&rp->next_write, p->write_delay);
+            out->off += n;
+
+            if (out->off == out->len)
+            {
+                rp->out_head = out->next;
+
+                if (rp->out_head == NULL)
+                {
+                    rp->out_tail = NULL;
+                }
+
+                io_reactor_out_done(rp, out, RIG_OK);
+                io_reactor_timespec_add_ms(&rp->next_write, p->post_write_delay);
+            }
+        }
+
+        rp->out_busy = 0;
+        pthread_cond_broadcast(&rp->sched_idle);
+        pthread_mutex_unlock(&rp->sched_lock);
+    }
+
+    return NULL;
+}
+
+static int io_reactor_sched_start(struct io_reactor_port *rp)
+{
+    rp->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+    if (rp->timerfd < 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: timerfd_create failed: %s\n", __func__,
+                  strerror(errno));
+        return -RIG_EIO;
+    }
+
+    pthread_mutex_init(&rp->sched_lock, NULL);
+    pthread_cond_init(&rp->sched_cond, NULL);
+    pthread_cond_init(&rp->sched_idle, NULL);
+    rp->sched_run = 1;
+
+    if (pthread_create(&rp->sched_thread, NULL, io_reactor_writer, rp) != 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: pthread_create failed\n", __func__);
+        pthread_cond_destroy(&rp->sched_idle);
+        pthread_cond_destroy(&rp->sched_cond);
+        pthread_mutex_destroy(&rp->sched_lock);
+        close(rp->timerfd);
+        return -RIG_EINTERNAL;
+    }
+
+    rp->sched_running = 1;
+
+    return RIG_OK;
+}
+
+static void io_reactor_sched_stop(struct io_reactor_port *rp)
+{
+    if (!rp->sched_running)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&rp->sched_lock);
+    rp->sched_run = 0;
+    pthread_cond_signal(&rp->sched_cond);
+    pthread_mutex_unlock(&rp->sched_lock);
+
+    pthread_join(rp->sched_thread, NULL);
+
+    io_reactor_free_list(rp->out_head);
+    io_reactor_free_list(rp->failed_head);
+    pthread_cond_destroy(&rp->sched_idle);
+    pthread_cond_destroy(&rp->sched_cond);
+    pthread_mutex_destroy(&rp->sched_lock);
+    close(rp->timerfd);
+    rp->sched_running = 0;
+}
+
+#endif /* IO_REACTOR_SCHED */
+
+/**
+ * \brief Register an opened port with the reactor
+ * \param p port whose fd (and sync pipes when asyncio) are open
+ *
+ * Re-registering a port replaces its previous entry, so this is called
+ * again whenever the port is reopened.
+ *
+ * \return RIG_OK, -RIG_ENIMPL if the port is not pollable, -RIG_ENOMEM
+ * if the table is full or -RIG_EIO if epoll fails
+ */
+int HAMLIB_API io_reactor_add(hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = NULL;
+    int i;
+
+    if (p->fd < 0)
+    {
+        return -RIG_ENIMPL;
+    }
+
+    io_reactor_remove(p);
+
+    io_reactor_lock();
+
+    for (i = 0; i < IO_REACTOR_MAX_PORTS; i++)
+    {
+        if (io_reactor_ports[i].port == NULL)
+        {
+            rp = &io_reactor_ports[i];
+            break;
+        }
+    }
+
+    if (rp == NULL)
+    {
+        io_reactor_unlock();
+        rig_debug(RIG_DEBUG_WARN, "%s: no free slot, using select()\n", __func__);
+        return -RIG_ENOMEM;
+    }
+
+    rp->epfd_direct = epoll_create1(EPOLL_CLOEXEC);
+    rp->epfd_sync = -1;
+    rp->fd_sync_error_read = -1;
+
+    if (rp->epfd_direct < 0 || io_reactor_watch(rp->epfd_direct, p->fd) < 0)
+    {
+        /* regular files and some devices cannot be polled */
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: fd=%d not pollable (%s), using select()\n",
+                  __func__, p->fd, strerror(errno));
+        io_reactor_release(rp);
+        io_reactor_unlock();
+        return -RIG_ENIMPL;
+    }
+
+    if (p->asyncio && p->fd_sync_read >= 0)
+    {
+        rp->epfd_sync = epoll_create1(EPOLL_CLOEXEC);
+
+        if (rp->epfd_sync < 0
+                || io_reactor_watch(rp->epfd_sync, p->fd_sync_read) < 0
+                || io_reactor_watch(rp->epfd_sync, p->fd_sync_error_read) < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: epoll on sync pipes failed: %s\n",
+                      __func__, strerror(errno));
+            io_reactor_release(rp);
+            io_reactor_unlock();
+            return -RIG_EIO;
+        }
+
+        rp->fd_sync_error_read = p->fd_sync_error_read;
+    }
+
+    rp->fd = p->fd;
+    rp->port = p;
+
+#ifdef IO_REACTOR_SCHED
+
+    /* paced ports write from their own thread, others write directly */
+    if (p->write_delay > 0 || p->post_write_delay > 0)
+    {
+        io_reactor_sched_start(rp);  /* write_block() sleeps on failure */
+    }
+
+#endif
+
+    io_reactor_unlock();
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: fd=%d registered%s%s\n", __func__, p->fd,
+              rp->epfd_sync >= 0 ? " with sync pipes" : "",
+              io_reactor_scheduled(rp) ? ", output scheduler" : "");
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Forget a port, called before its fd is closed
+ *
+ * Waits for calls of other threads still using the port, e.g. a read
+ * waiting out its timeout, new calls fall back to select()/read().
+ */
+void HAMLIB_API io_reactor_remove(const hamlib_port_t *p)
+{
+    int i;
+
+    io_reactor_lock();
+
+    for (i = 0; i < IO_REACTOR_MAX_PORTS; i++)
+    {
+        struct io_reactor_port *rp = &io_reactor_ports[i];
+
+        if (rp->port != p)
+        {
+            continue;
+        }
+
+        rp->removing = 1;
+
+#ifdef HAVE_PTHREAD
+
+        while (rp->refs > 0)
+        {
+            pthread_cond_wait(&io_reactor_unref, &io_reactor_lock);
+        }
+
+#endif
+
+        io_reactor_release(rp);
+    }
+
+    io_reactor_unlock();
+}
+
+/**
+ * \brief Drop buffered device data, as a flush of the port would
+ */
+void HAMLIB_API io_reactor_discard(const hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+
+    if (rp && rp->head != rp->tail)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: discarding %d buffered bytes\n", __func__,
+                  (int)(rp->tail - rp->head));
+        rp->head = rp->tail = 0;
+    }
+
+    io_reactor_put(rp);
+}
+
+static int io_reactor_port_drain(struct io_reactor_port *rp);
+
+static int io_reactor_port_wait(struct io_reactor_port *rp, hamlib_port_t *p,
+                                int direct)
+{
+    struct epoll_event ev[2];
+    int epfd;
+    int result;
+    int i;
+
+    if (direct && io_reactor_scheduled(rp))
+    {
+        /* the reply cannot start before the command has gone out */
+        result = io_reactor_port_drain(rp);
+
+        if (result != RIG_OK)
+        {
+            return result;
+        }
+    }
+
+    io_stats_add(waits, 1);
+
+    if (direct && rp->head != rp->tail)
+    {
+        return RIG_OK;
+    }
+
+    epfd = direct ? rp->epfd_direct : rp->epfd_sync;
+
+    if (epfd < 0)
+    {
+        return -RIG_ENIMPL;
+    }
+
+    io_stats_add(wait_syscalls, 1);
+
+    do
+    {
+        result = epoll_wait(epfd, ev, direct ? 1 : 2, p->timeout);
+    }
+    while (result < 0 && errno == EINTR);
+
+    if (result == 0)
+    {
+        return -RIG_ETIMEOUT;
+    }
+    else if (result < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s(): epoll_wait() error, direct=%d: %s\n",
+                  __func__, direct, strerror(errno));
+        return -RIG_EIO;
+    }
+
+    for (i = 0; i < result; i++)
+    {
+        if (ev[i].events & EPOLLERR)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(): fd %d error, direct=%d\n", __func__,
+                      ev[i].data.fd, direct);
+            return -RIG_EIO;
+        }
+    }
+
+    for (i = 0; !direct && i < result; i++)
+    {
+        if (ev[i].data.fd == rp->fd_sync_error_read)
+        {
+            return 1;
+        }
+    }
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Wait for the port to become readable
+ * \param p the port
+ * \param direct wait on the device when true, on the sync pipes otherwise
+ *
+ * \return RIG_OK when data can be read, 1 when an error code is waiting
+ * in the sync error pipe, -RIG_ETIMEOUT, -RIG_EIO, or -RIG_ENIMPL when
+ * the caller has to use select() itself
+ */
+int HAMLIB_API io_reactor_wait(hamlib_port_t *p, int direct)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+    int result;
+
+    if (rp == NULL)
+    {
+        return -RIG_ENIMPL;
+    }
+
+    result = io_reactor_port_wait(rp, p, direct);
+    io_reactor_put(rp);
+
+    return result;
+}
+
+static ssize_t io_reactor_port_read(struct io_reactor_port *rp,
+                                    hamlib_port_t *p, void *buf, size_t count)
+{
+    size_t avail;
+
+    io_stats_add(read_calls, 1);
+
+    if (rp->head == rp->tail)
+    {
+        ssize_t ret;
+
+        io_stats_add(read_syscalls, 1);
+        ret = read(p->fd, rp->buf, sizeof(rp->buf));
+
+        if (ret <= 0)
+        {
+            return ret;
+        }
+
+        rp->head = 0;
+        rp->tail = ret;
+    }
+
+    avail = rp->tail - rp->head;
+
+    if (count > avail)
+    {
+        count = avail;
+    }
+
+    memcpy(buf, rp->buf + rp->head, count);
+    rp->head += count;
+
+    return (ssize_t) count;
+}
+
+/**
+ * \brief Read device data through the port buffer
+ *
+ * \return the byte count, 0 or -1 as read() would, or -RIG_ENIMPL when
+ * the caller has to read() itself
+ */
+ssize_t HAMLIB_API io_reactor_read(hamlib_port_t *p, void *buf, size_t count)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+    ssize_t ret;
+
+    if (rp == NULL)
+    {
+        return -RIG_ENIMPL;
+    }
+
+    ret = io_reactor_port_read(rp, p, buf, count);
+    io_reactor_put(rp);
+
+    return ret;
+}
+
+static struct io_reactor_out *io_reactor_out_new(const unsigned char *buf,
+        size_t count)
+{
+    struct io_reactor_out *out = malloc(sizeof(*out) + count);
+
+    if (out)
+    {
+        out->next = NULL;
+        out->done = 0;
+        out->retcode = RIG_OK;
+        out->len = count;
+        out->off = 0;
+        memcpy(out->data, buf, count);
+    }
+
+    return out;
+}
+
+#ifdef IO_REACTOR_SCHED
+/*
+ * Queues a command.  With wait set it waits until the writer has written
+ * it, not for the delay after it, and returns the error of that write;
+ * otherwise a failure is left for the next io_reactor_drain().
+ */
+static int io_reactor_enqueue(struct io_reactor_port *rp,
+                              struct io_reactor_out *out, int wait)
+{
+    int ret;
+
+    out->waited = wait;
+
+    pthread_mutex_lock(&rp->sched_lock);
+
+    if (rp->out_tail)
+    {
+        rp->out_tail->next = out;
+    }
+    else
+    {
+        rp->out_head = out;
+    }
+
+    rp->out_tail = out;
+    pthread_cond_signal(&rp->sched_cond);
+
+    if (!wait)
+    {
+        pthread_mutex_unlock(&rp->sched_lock);
+        return RIG_OK;
+    }
+
+    while (!out->done)
+    {
+        pthread_cond_wait(&rp->sched_idle, &rp->sched_lock);
+    }
+
+    pthread_mutex_unlock(&rp->sched_lock);
+
+    ret = out->retcode;
+    free(out);
+
+    return ret;
+}
+#endif
+
+static int io_reactor_port_write(struct io_reactor_port *rp,
+                                 const unsigned char *buf, size_t count)
+{
+    struct io_reactor_out *out;
+
+    if (!rp->corked && !io_reactor_scheduled(rp))
+    {
+        return -RIG_ENIMPL;
+    }
+
+    io_stats_add(write_calls, 1);
+
+    out = io_reactor_out_new(buf, count);
+
+    if (out == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    if (rp->corked)
+    {
+        if (rp->cork_tail)
+        {
+            rp->cork_tail->next = out;
+        }
+        else
+        {
+            rp->cork_head = out;
+        }
+
+        rp->cork_tail = out;
+        return RIG_OK;
+    }
+
+#ifdef IO_REACTOR_SCHED
+    return io_reactor_enqueue(rp, out, 0);
+#else
+    free(out);
+    return -RIG_ENIMPL;
+#endif
+}
+
+/**
+ * \brief Hand a command to the port output scheduler or cork buffer
+ *
+ * Does not wait for the command to be written, the next read of the
+ * port or io_reactor_drain() does and reports a failed write.
+ *
+ * \return RIG_OK once queued or corked, or -RIG_ENIMPL when the caller
+ * has to write the command itself
+ */
+int HAMLIB_API io_reactor_write(hamlib_port_t *p, const unsigned char *buf,
+                                size_t count)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+    int ret;
+
+    if (rp == NULL)
+    {
+        return -RIG_ENIMPL;
+    }
+
+    ret = io_reactor_port_write(rp, buf, count);
+    io_reactor_put(rp);
+
+    return ret;
+}
+
+/**
+ * \brief Hold back writes on the port until io_reactor_uncork()
+ *
+ * For commands that can go out back to back, e.g. a set followed by
+ * the query that verifies it.  Calls nest.
+ */
+void HAMLIB_API io_reactor_cork(hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+
+    if (rp)
+    {
+        rp->corked++;
+    }
+
+    io_reactor_put(rp);
+}
+
+static int io_reactor_port_uncork(struct io_reactor_port *rp,
+                                  hamlib_port_t *p)
+{
+    struct io_reactor_out *out, *all;
+    size_t len = 0;
+    ssize_t ret;
+
+    if (rp->corked == 0 || --rp->corked > 0 || rp->cork_head == NULL)
+    {
+        return RIG_OK;
+    }
+
+    for (out = rp->cork_head; out; out = out->next)
+    {
+        len += out->len;
+    }
+
+    all = malloc(sizeof(*all) + len);
+
+    if (all == NULL)
+    {
+        io_reactor_free_list(rp->cork_head);
+        rp->cork_head = rp->cork_tail = NULL;
+        return -RIG_ENOMEM;
+    }
+
+    all->next = NULL;
+    all->done = 0;
+    all->retcode = RIG_OK;
+    all->len = 0;
+    all->off = 0;
+
+    for (out = rp->cork_head; out; out = out->next)
+    {
+        memcpy(all->data + all->len, out->data, out->len);
+        all->len += out->len;
+    }
+
+    io_reactor_free_list(rp->cork_head);
+    rp->cork_head = rp->cork_tail = NULL;
+
+#ifdef IO_REACTOR_SCHED
+
+    if (io_reactor_scheduled(rp))
+    {
+        return io_reactor_enqueue(rp, all, 1);
+    }
+
+#endif
+
+    io_stats_add(write_syscalls, 1);
+    ret = write(p->fd, all->data, all->len);
+
+    if (ret != (ssize_t) all->len)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: write failed %d - %s\n", __func__,
+                  (int) ret, strerror(errno));
+        free(all);
+        return -RIG_EIO;
+    }
+
+    free(all);
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Send everything written since io_reactor_cork() in one write
+ * \return RIG_OK or -RIG_EIO
+ */
+int HAMLIB_API io_reactor_uncork(hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+    int ret;
+
+    if (rp == NULL)
+    {
+        return RIG_OK;
+    }
+
+    ret = io_reactor_port_uncork(rp, p);
+    io_reactor_put(rp);
+
+    return ret;
+}
+
+static int io_reactor_port_drain(struct io_reactor_port *rp)
+{
+    int ret = RIG_OK;
+#ifdef IO_REACTOR_SCHED
+    struct io_reactor_out *failed;
+
+    if (!io_reactor_scheduled(rp))
+    {
+        return RIG_OK;
+    }
+
+    pthread_mutex_lock(&rp->sched_lock);
+
+    while (rp->out_head != NULL || rp->out_busy)
+    {
+        pthread_cond_wait(&rp->sched_idle, &rp->sched_lock);
+    }
+
+    failed = rp->failed_head;
+    rp->failed_head = rp->failed_tail = NULL;
+
+    pthread_mutex_unlock(&rp->sched_lock);
+
+    if (failed)
+    {
+        ret = failed->retcode;
+        rig_debug(RIG_DEBUG_ERR, "%s: a queued command could not be written: %s\n",
+                  __func__, rigerror(ret));
+        io_reactor_free_list(failed);
+    }
+#endif
+
+    return ret;
+}
+
+/**
+ * \brief Wait until every command queued by any thread has been written
+ *
+ * E.g. for the PTT lines to change only after the commands before them,
+ * and before every read of the port.
+ *
+ * \return RIG_OK, or -RIG_EIO if a command queued by write_block() since
+ * the last drain could not be written
+ */
+int HAMLIB_API io_reactor_drain(const hamlib_port_t *p)
+{
+    struct io_reactor_port *rp = io_reactor_find(p);
+    int ret;
+
+    if (rp == NULL)
+    {
+        return RIG_OK;
+    }
+
+    ret = io_reactor_port_drain(rp);
+    io_reactor_put(rp);
+
+    return ret;
+}
+
+/**
+ * \brief Bypass the reactor for all ports (or stop bypassing it)
+ *
+ * Mainly for tests/ioreactor_bench to compare against the select() path.
+ */
+void HAMLIB_API io_reactor_set_enabled(int enabled)
+{
+    io_reactor_enabled = enabled;
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+int HAMLIB_API io_reactor_add(hamlib_port_t *p)
+{
+    return -RIG_ENIMPL;
+}
+
+void HAMLIB_API io_reactor_remove(const hamlib_port_t *p)
+{
+}
+
+void HAMLIB_API io_reactor_discard(const hamlib_port_t *p)
+{
+}
+
+int HAMLIB_API io_reactor_wait(hamlib_port_t *p, int direct)
+{
+    return -RIG_ENIMPL;
+}
+
+ssize_t HAMLIB_API io_reactor_read(hamlib_port_t *p, void *buf, size_t count)
+{
+    return -RIG_ENIMPL;
+}
+
+int HAMLIB_API io_reactor_write(hamlib_port_t *p, const unsigned char *buf,
+                                size_t count)
+{
+    return -RIG_ENIMPL;
+}
+
+void HAMLIB_API io_reactor_cork(hamlib_port_t *p)
+{
+}
+
+int HAMLIB_API io_reactor_uncork(hamlib_port_t *p)
+{
+    return RIG_OK;
+}
+
+int HAMLIB_API io_reactor_drain(const hamlib_port_t *p)
+{
+    return RIG_OK;
+}
+
+void HAMLIB_API io_reactor_set_enabled(int enabled)
+{
+}
+
+#endif
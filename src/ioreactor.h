@@ -0,0 +1,67 @@
+/*
+ *  Hamlib Interface - port I/O reactor header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _IOREACTOR_H
+#define _IOREACTOR_H 1
+
+#include <sys/types.h>
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* I/O counters summed over all ports, used by tests/ioreactor_bench */
+struct io_reactor_stats
+{
+    unsigned long waits;            /* port_wait_for_data calls */
+    unsigned long wait_syscalls;    /* select/epoll_wait calls actually made */
+    unsigned long read_calls;       /* port reads requested by iofunc */
+    unsigned long read_syscalls;    /* read() calls actually made */
+    unsigned long write_calls;      /* commands passed to write_block */
+    unsigned long write_syscalls;   /* write() calls actually made */
+};
+
+extern HAMLIB_EXPORT(int) io_reactor_add(hamlib_port_t *p);
+extern HAMLIB_EXPORT(void) io_reactor_remove(const hamlib_port_t *p);
+extern HAMLIB_EXPORT(void) io_reactor_discard(const hamlib_port_t *p);
+
+extern HAMLIB_EXPORT(int) io_reactor_wait(hamlib_port_t *p, int direct);
+extern HAMLIB_EXPORT(ssize_t) io_reactor_read(hamlib_port_t *p, void *buf,
+                                              size_t count);
+
+extern HAMLIB_EXPORT(int) io_reactor_write(hamlib_port_t *p,
+                                           const unsigned char *buf,
+                                           size_t count);
+extern HAMLIB_EXPORT(void) io_reactor_cork(hamlib_port_t *p);
+extern HAMLIB_EXPORT(int) io_reactor_uncork(hamlib_port_t *p);
+extern HAMLIB_EXPORT(int) io_reactor_drain(const hamlib_port_t *p);
+
+extern HAMLIB_EXPORT(void) io_reactor_set_enabled(int enabled);
+extern HAMLIB_EXPORT(void) io_reactor_get_stats(struct io_reactor_stats *stats);
+extern HAMLIB_EXPORT(void) io_reactor_reset_stats(void);
+
+/* for the select() fallback in iofunc.c */
+extern HAMLIB_EXPORT(void) io_reactor_count(int wait_syscalls, int read_calls,
+                                            int read_syscalls);
+extern HAMLIB_EXPORT(void) io_reactor_count_write(int write_calls,
+                                                  int write_syscalls);
+
+__END_DECLS
+
+#endif /* _IOREACTOR_H */
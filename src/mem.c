@@ -41,6 +41,7 @@
 #include <sys/stat.h>
 
 #include <hamlib/rig.h>
+#include "misc.h"
 
 #ifndef DOC_HIDDEN
 
@@ -78,6 +79,8 @@ int HAMLIB_API rig_set_mem(RIG *rig, vfo_t vfo, int ch)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_mem == NULL)
@@ -141,6 +144,8 @@ int HAMLIB_API rig_get_mem(RIG *rig, vfo_t vfo, int *ch)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_mem == NULL)
@@ -204,6 +209,8 @@ int HAMLIB_API rig_set_bank(RIG *rig, vfo_t vfo, int bank)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_bank == NULL)
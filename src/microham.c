@@ -71,116 +71,142 @@
 #define PATH_MAX 256
 #endif
 
-#if !(defined(WIN32) || !defined(HAVE_GLOB_H))
-static char
-uh_device_path[PATH_MAX];  // use PATH_MAX since udev names can be VERY long!
-#endif
-static int uh_device_fd = -1;
-static int uh_is_initialized = 0;
 
-static int uh_radio_pair[2] = { -1, -1};
-static int uh_ptt_pair[2]   = { -1, -1};
-static int uh_wkey_pair[2]  = { -1, -1};
+//
+// Several microHam devices can be used at the same time (e.g. two
+// routers in an SO2R station).  Each one has a slot in uh_devices with
+// its own router thread, channels and frame parser.
+//
+// The router thread is the only one touching the device fd, so no lock
+// is needed for device I/O.  Hamlib talks to it through socketpairs,
+// one per channel: RADIO and WKEY carry the byte streams, PTT only
+// provides the fd hamlib needs, and CTL is a datagram queue for flag
+// and control string requests from uh_set_ptt() and uh_open_radio().
+//
+// uh_lock is only held while opening or closing channels.  The lookups
+// done by serial.c on every DTR/RTS/flush scan uh_devices without it;
+// slots are never freed, and a channel fd is marked unused before it is
+// closed.
+//
+#define UH_MAX_DEVICES 4
+
+enum uh_channel
+{
+    UH_RADIO,
+    UH_PTT,
+    UH_WKEY,
+    UH_CTL,
+    UH_NCHAN
+};
+
+// requests queued on the CTL channel, first byte of each datagram
+#define UH_REQ_PTT      'P'     // followed by 0 or 1
+#define UH_REQ_CONTROL  'C'     // followed by the control string
+
+struct uh_device
+{
+    int used;                   // slot taken, protected by uh_lock
+    int autodetected;           // opened as plain "uh-rig"/"uh-ptt"
+    char path[PATH_MAX];        // use PATH_MAX since udev names can be VERY long!
+    int fd;
+
+    // [0] is the router side, [1] is handed out to hamlib
+    int pair[UH_NCHAN][2];
+    volatile int in_use[UH_NCHAN];
 
-static int uh_radio_in_use;
-static int uh_ptt_in_use;
-static int uh_wkey_in_use;
+    volatile int running;
+    volatile int ptt;           // mirrors the PTT bit for uh_get_ptt()
 
-static int statusbyte = 0;
+    // owned by the router thread
+    int statusbyte;
+    time_t lastbeat;
+    time_t starttime;
+    unsigned char frame[4];
+    int framepos;
+    int frameseq;
+    int incontrol;
+    unsigned char controlstring[256];
+    int numcontrolbytes;
+
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+#endif
+};
+
+static struct uh_device uh_devices[UH_MAX_DEVICES];
 
 #ifdef HAVE_PTHREAD
 
 #include <pthread.h>
 
-static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_t readthread;
-#define getlock()  if (pthread_mutex_lock(&mutex))   perror("GETLOCK:")
-#define freelock() if (pthread_mutex_unlock(&mutex)) perror("FREELOCK:")
+static pthread_mutex_t uh_lock = PTHREAD_MUTEX_INITIALIZER;
+#define getlock()  if (pthread_mutex_lock(&uh_lock))   perror("GETLOCK:")
+#define freelock() if (pthread_mutex_unlock(&uh_lock)) perror("FREELOCK:")
 #else
 #define getlock()
 #define freelock()
 #endif
 
-#if defined(HAVE_SELECT)
-//
-// time of last heartbeat. Updated by heartbeat()
-//
-static time_t lastbeat = 0;
-#endif
+#define TIME(d) ((int) (time(NULL) - (d)->starttime))
 
 #if defined(HAVE_PTHREAD) && defined(HAVE_SOCKETPAIR) && defined(HAVE_SELECT)
-static time_t starttime;
-
-#define TIME ((int) (time(NULL) - starttime))
+#define UH_ROUTER 1
 #endif
 
 //
-// close all sockets and mark them free
+// close all sockets of a device and mark them free
 //
-static void close_all_files()
+static void close_all_files(struct uh_device *d)
 {
-    if (uh_radio_pair[0] >= 0)
-    {
-        close(uh_radio_pair[0]);
-    }
-
-    if (uh_radio_pair[1] >= 0)
-    {
-        close(uh_radio_pair[1]);
-    }
+    int i;
 
-    if (uh_ptt_pair[0]   >= 0)
+    for (i = 0; i < UH_NCHAN; i++)
     {
-        close(uh_ptt_pair[0]);
-    }
+        d->in_use[i] = 0;
 
-    if (uh_ptt_pair[1]   >= 0)
-    {
-        close(uh_ptt_pair[1]);
-    }
+        if (d->pair[i][0] >= 0)
+        {
+            close(d->pair[i][0]);
+        }
 
-    if (uh_wkey_pair[0]  >= 0)
-    {
-        close(uh_wkey_pair[0]);
-    }
+        if (d->pair[i][1] >= 0)
+        {
+            close(d->pair[i][1]);
+        }
 
-    if (uh_wkey_pair[1]  >= 0)
-    {
-        close(uh_wkey_pair[1]);
+        d->pair[i][0] = -1;
+        d->pair[i][1] = -1;
     }
 
-    uh_radio_pair[0] = -1;
-    uh_radio_pair[1] = -1;
-    uh_ptt_pair[0] = -1;
-    uh_ptt_pair[1] = -1;
-    uh_wkey_pair[0] = -1;
-    uh_wkey_pair[1] = -1;
-    uh_radio_in_use = 0;
-    uh_ptt_in_use = 0;
-    uh_wkey_in_use = 0;
-
 //  finally, close connection to microHam device
-    if (uh_device_fd >= 0)
+    if (d->fd >= 0)
     {
-        close(uh_device_fd);
+        close(d->fd);
     }
+
+    d->fd = -1;
 }
 
 
-static void close_microham()
+//
+// stop the router thread and release the slot, called with uh_lock held
+//
+static void close_microham(struct uh_device *d)
 {
-    if (!uh_is_initialized)
-    {
-        return;
-    }
+    TRACE("%10d:Closing MicroHam device %s\n", TIME(d), d->path);
 
-    TRACE("%10d:Closing MicroHam device\n", TIME);
-    uh_is_initialized = 0;
+    if (d->running)
+    {
+        d->running = 0;
 #ifdef HAVE_PTHREAD
-    // wait for read_device thread to finish
-    pthread_join(readthread, NULL);
+        // wait for the router thread to finish
+        pthread_join(d->thread, NULL);
 #endif
-    close_all_files();
+    }
+
+    close_all_files(d);
+    d->used = 0;
+    d->autodetected = 0;
 }
 
 
@@ -191,25 +217,37 @@ static void close_microham()
  *
  * I do now know how to "find" a microham device under Windows.
  *
- * Therefore, a dummy version of finddevices() is included such that it compiles
- * well on WIN32. Since the dummy version does not find anything, no reading thread
- * and no sockets are created.
+ * Therefore, dummy versions of finddevice() and opendevice() are
+ * included such that it compiles well on WIN32. Since they do not find
+ * anything, no reading thread and no sockets are created.
  *
  *
  * For those who want to implement the WIN32 case here properly:
  *
- * What finddevices() must do:
+ * What finddevice() must do:
  * Scan all USB-serial ports with an FTDI chip, and look
  * for its serial number, take the first port you can find where the serial
- * number begins with MK, M2, CK, DK, D2, 2R, 2P or UR. Then, open the serial
- * line with correct serial speed etc. and put a valid fd into uh_device_fd.
- */
-/* Commenting out the following dummy function to quell the warning from
- * MinGW's GCC of a defined but not used function.
+ * number begins with MK, M2, CK, DK, D2, 2R, 2P or UR and that is not
+ * already in use by another slot. Then, open the serial line with
+ * correct serial speed etc. and return a valid fd.
  */
-/* static void finddevices() */
-/* { */
-/* } */
+#ifdef UH_ROUTER
+static int resolvepath(const char *device, char *path)
+{
+    snprintf(path, PATH_MAX, "%s", device);
+    return 0;
+}
+
+static int opendevice(const char *path)
+{
+    return -1;
+}
+
+static int finddevice(char *path)
+{
+    return -1;
+}
+#endif
 
 #else
 
@@ -239,6 +277,9 @@ static void close_microham()
  *
  * We are using the glob() function to obtain a list
  * of candidates.
+ *
+ * A second router is selected by giving its path explicitly,
+ * e.g. "uh-rig:/dev/serial/by-id/usb-microHAM_M2...".
  */
 
 #define NUMUHTYPES 9
@@ -273,131 +314,197 @@ static struct uhtypes
 };
 
 
+
+#include <stdlib.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include <glob.h>
+
+#ifdef UH_ROUTER
+//
+// Open a microHam device and set up the serial line.
+// microHam devices always use 230400 baud, 8N1, only TxD/RxD is used
+// (no h/w handshake).
+//
+static int opendevice(const char *path)
+{
+    struct termios TTY;
+    int fd;
+
+    fd = open(path, O_RDWR | O_NONBLOCK | O_NOCTTY);
+
+    if (fd < 0)
+    {
+        MYERROR("Cannot open serial port %s\n", path);
+        perror("Open:");
+        return -1;
+    }
+
+    tcflush(fd, TCIFLUSH);
+
+    if (tcgetattr(fd, &TTY))
+    {
+        MYERROR("Cannot get comm params\n");
+        close(fd);
+        return -1;
+    }
+
+    // 8 data bits
+    TTY.c_cflag &= ~CSIZE;
+    TTY.c_cflag |= CS8;
+    // enable receiver, set local mode
+    TTY.c_cflag |= (CLOCAL | CREAD);
+    // no parity
+    TTY.c_cflag &= ~PARENB;
+    // 1 stop bit
+    TTY.c_cflag &= ~CSTOPB;
+
+    cfsetispeed(&TTY, B230400);
+    cfsetospeed(&TTY, B230400);
+
+    // NO h/w handshake
+    // TTY.c_cflag &= ~CRTSCTS;
+    // raw input
+    TTY.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+    // raw output
+    TTY.c_oflag &= ~OPOST;
+    // software flow control disabled
+    // TTY.c_iflag &= ~IXON;
+    // do not translate CR to NL
+    // TTY.c_iflag &= ~ICRNL;
+
+    // timeouts
+    TTY.c_cc[VMIN] = 0;
+    TTY.c_cc[VTIME] = 255;
+
+    if (tcsetattr(fd, TCSANOW, &TTY))
+    {
+        MYERROR("Can't set device communication parameters");
+        close(fd);
+        return -1;
+    }
+
+    TRACE("SerialPort opened: %s fd=%d\n", path, fd);
+    return fd;
+}
+
+static int resolvepath(const char *device, char *path)
+{
+    return realpath(device, path) ? 0 : -1;
+}
+
+static int path_in_use(const char *path)
+{
+    int i;
+
+    for (i = 0; i < UH_MAX_DEVICES; i++)
+    {
+        if (uh_devices[i].used && !strcmp(uh_devices[i].path, path))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 //
 // Find a microHamDevice. Here we assume that the device special
 // file has a name from which we can tell this is a microHam device
 // This is the case for MacOS and LINUX (for LINUX: use udev)
+// Devices already used by another slot are skipped.
+// On success path holds the canonical name of the device.
 //
-#include <termios.h>
-#include <sys/stat.h>
-#include <glob.h>
-static void finddevices()
+static int finddevice(char *path)
 {
     struct stat st;
     glob_t gbuf;
     int i, j;
-    struct termios TTY;
     int fd;
 
-    uh_device_fd = -1; // indicates "no device is found"
-
     //
     // Check ALL device special files that might be relevant,
     //
     for (i = 0; i < NUMUHTYPES; i++)
     {
         DEBUG("Checking for %s device\n", uhtypes[i].device);
-        glob(uhtypes[i].device, 0, NULL, &gbuf);
+
+        if (glob(uhtypes[i].device, 0, NULL, &gbuf))
+        {
+            continue;
+        }
 
         for (j = 0; j < gbuf.gl_pathc; j++)
         {
             DEBUG("Found file: %s\n", gbuf.gl_pathv[j]);
 
-            if (!stat(gbuf.gl_pathv[j], &st))
+            if (stat(gbuf.gl_pathv[j], &st) || !S_ISCHR(st.st_mode))
+            {
+                continue;
+            }
+
+            // found a character special device with correct name
+            if (!realpath(gbuf.gl_pathv[j], path))
             {
-                if (S_ISCHR(st.st_mode))
-                {
-                    // found a character special device with correct name
-                    if (strlen(gbuf.gl_pathv[j]) >= PATH_MAX)
-                    {
-                        // I do not know if this can happen, but if it happens, we just skip the device.
-                        MYERROR("Name too long: %s\n", gbuf.gl_pathv[j]);
-                        continue;
-                    }
-
-                    DEBUG("%s is a character special file\n", gbuf.gl_pathv[j]);
-                    strcpy(uh_device_path, gbuf.gl_pathv[j]);
-                    TRACE("Found a %s, Device=%s\n", uhtypes[i].name, uh_device_path);
-
-                    fd = open(uh_device_path, O_RDWR | O_NONBLOCK | O_NOCTTY);
-
-                    if (fd < 0)
-                    {
-                        MYERROR("Cannot open serial port %s\n", uh_device_path);
-                        perror("Open:");
-                        continue;
-                    }
-
-                    tcflush(fd, TCIFLUSH);
-
-                    if (tcgetattr(fd, &TTY))
-                    {
-                        MYERROR("Cannot get comm params\n");
-                        close(fd);
-                        continue;
-                    }
-
-                    // microHam devices always use 230400 baud, 8N1, only TxD/RxD is used (no h/w handshake)
-                    // 8 data bits
-                    TTY.c_cflag &= ~CSIZE;
-                    TTY.c_cflag |= CS8;
-                    // enable receiver, set local mode
-                    TTY.c_cflag |= (CLOCAL | CREAD);
-                    // no parity
-                    TTY.c_cflag &= ~PARENB;
-                    // 1 stop bit
-                    TTY.c_cflag &= ~CSTOPB;
-
-                    cfsetispeed(&TTY, B230400);
-                    cfsetospeed(&TTY, B230400);
-
-                    // NO h/w handshake
-                    // TTY.c_cflag &= ~CRTSCTS;
-                    // raw input
-                    TTY.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-                    // raw output
-                    TTY.c_oflag &= ~OPOST;
-                    // software flow control disabled
-                    // TTY.c_iflag &= ~IXON;
-                    // do not translate CR to NL
-                    // TTY.c_iflag &= ~ICRNL;
-
-                    // timeouts
-                    TTY.c_cc[VMIN] = 0;
-                    TTY.c_cc[VTIME] = 255;
-
-                    if (tcsetattr(fd, TCSANOW, &TTY))
-                    {
-                        MYERROR("Can't set device communication parameters");
-                        close(fd);
-                        continue;
-                    }
-
-                    TRACE("SerialPort opened: %s fd=%d\n", uh_device_path, fd);
-                    uh_device_fd = fd;
-                    // The first time we were successful, we skip all what might come
-                    return;
-                }
+                // I do not know if this can happen, but if it happens, we just skip the device.
+                MYERROR("Cannot resolve: %s\n", gbuf.gl_pathv[j]);
+                continue;
+            }
+
+            if (path_in_use(path))
+            {
+                continue;
+            }
+
+            TRACE("Found a %s, Device=%s\n", uhtypes[i].name, path);
+
+            fd = opendevice(path);
+
+            if (fd >= 0)
+            {
+                // The first time we were successful, we skip all what might come
+                globfree(&gbuf);
+                return fd;
             }
         }
+
+        globfree(&gbuf);
     }
+
+    return -1;
 }
+#endif /* UH_ROUTER */
 
 #endif
 
-#if defined(HAVE_SELECT)
+
+#ifdef UH_ROUTER
 //
-// parse a frame received from the keyer
-// This is called from the "device reading" thread
-// once a complete frame has been received
-// Send Radio and Winkey bytes received to the client sockets.
+// write to the microHam device, router thread only
 //
-static int frameseq = 0;
-static int incontrol = 0;
-static unsigned char controlstring[256];
-static int numcontrolbytes = 0;
+static void writeDevice(struct uh_device *d, const unsigned char *seq, int len,
+                        const char *what)
+{
+    int ret;
+
+    if ((ret = write(d->fd, seq, len)) < len)
+    {
+        MYERROR("%s failed with %d\n", what, ret);
+
+        if (ret < 0)
+        {
+            perror(what);
+        }
+    }
+}
+
 
-static void parseFrame(const unsigned char *frame)
+//
+// parse a frame received from the keyer
+// This is called from the router thread once a complete frame has been
+// received.  Send Radio and Winkey bytes received to the client sockets.
+//
+static void parseFrame(struct uh_device *d, const unsigned char *frame)
 {
     unsigned char byte;
     FRAME("RCV frame %02x %02x %02x %02x\n", frame[0], frame[1], frame[2],
@@ -406,11 +513,11 @@ static void parseFrame(const unsigned char *frame)
     // frames come in sequences. The first frame of a sequence has bit6 cleared in the headerbyte.
     if ((frame[0] & 0x40) == 0)
     {
-        frameseq = 0;
+        d->frameseq = 0;
     }
     else
     {
-        frameseq++;
+        d->frameseq++;
     }
 
     // A frame is of the form header-byte1-byte2-byte3
@@ -431,9 +538,9 @@ static void parseFrame(const unsigned char *frame)
             byte |= 0x80;
         }
 
-        DEBUG("%10d:FromRadio: %02x\n", TIME, byte);
+        DEBUG("%10d:FromRadio: %02x\n", TIME(d), byte);
 
-        if (write(uh_radio_pair[0], &byte, 1) != 1)
+        if (write(d->pair[UH_RADIO][0], &byte, 1) != 1)
         {
             MYERROR("Write Radio Socket\n");
         }
@@ -442,7 +549,7 @@ static void parseFrame(const unsigned char *frame)
     // ignore AUX/RADIO2 for the time being
 
     // check the shared channel for validity, if it is the CONTROL channel it is always valid
-    if ((frame[0] & 0x08) || (frameseq == 1))
+    if ((frame[0] & 0x08) || (d->frameseq == 1))
     {
         byte = frame[3] & 0x7F;
 
@@ -451,34 +558,34 @@ static void parseFrame(const unsigned char *frame)
             byte |= 0x80;
         }
 
-        switch (frameseq)
+        switch (d->frameseq)
         {
         case 0:  // Flag byte
-            DEBUG("%10d:RCV: Flags=%02x\n", TIME, byte);
+            DEBUG("%10d:RCV: Flags=%02x\n", TIME(d), byte);
             // No reason to pass the flags to clients
             break;
 
         case 1:  // part of control string
-            if ((frame[0] & 0x08) == 0 && !incontrol)
+            if ((frame[0] & 0x08) == 0 && !d->incontrol)
             {
                 // start or end of a control sequence
-                numcontrolbytes = 1;
-                controlstring[0] = byte;
-                incontrol = 1;
+                d->numcontrolbytes = 1;
+                d->controlstring[0] = byte;
+                d->incontrol = 1;
                 break;
             }
 
-            if ((frame[0] & 0x08) == 0 && incontrol)
+            if ((frame[0] & 0x08) == 0 && d->incontrol)
             {
                 int i;
                 // end of a control sequence
-                controlstring[numcontrolbytes++] = byte;
-                DEBUG("%10d:FromControl:", TIME);
+                d->controlstring[d->numcontrolbytes++] = byte;
+                DEBUG("%10d:FromControl:", TIME(d));
 
-                for (i = 0; i < numcontrolbytes; i++) { DEBUG(" %02x", controlstring[i]); }
+                for (i = 0; i < d->numcontrolbytes; i++) { DEBUG(" %02x", d->controlstring[i]); }
 
                 DEBUG(".\n");
-                incontrol = 0;
+                d->incontrol = 0;
                 // printing control messages is only used for debugging.
                 // Note that we can get a lot of unsolicited control messages
                 // here (squelch, voltage change, etc.)
@@ -486,13 +593,17 @@ static void parseFrame(const unsigned char *frame)
             }
 
             // in the middle of a control string
-            controlstring[numcontrolbytes++] = byte;
+            if (d->numcontrolbytes < sizeof(d->controlstring) - 1)
+            {
+                d->controlstring[d->numcontrolbytes++] = byte;
+            }
+
             break;
 
         case 2: // message from WinKey chip
-            DEBUG("%10d:RCV: WinKey=%02x\n", TIME, byte);
+            DEBUG("%10d:RCV: WinKey=%02x\n", TIME(d), byte);
 
-            if (write(uh_wkey_pair[0], &byte, 1) != 1)
+            if (write(d->pair[UH_WKEY][0], &byte, 1) != 1)
             {
                 MYERROR("Write Winkey socket\n");
             }
@@ -500,41 +611,35 @@ static void parseFrame(const unsigned char *frame)
             break;
 
         case 3: // Key pressed on PS2 keyboard connected to microHam device
-            DEBUG("%10d:RCV: PS2=%02x\n", TIME, byte);
+            DEBUG("%10d:RCV: PS2=%02x\n", TIME(d), byte);
             break;
         }
     }
 }
-#endif  /* HAVE_SELECT */
 
 
-#if defined(HAVE_SELECT)
 //
 // Send radio bytes to microHam device
 //
-static void writeRadio(const unsigned char *bytes, int len)
+static void writeRadio(struct uh_device *d, const unsigned char *bytes, int len)
 {
     unsigned char seq[4];
     int i;
 
-    DEBUG("%10d:Send radio data: ", TIME);
+    DEBUG("%10d:Send radio data: ", TIME(d));
 
     for (i = 0; i < len; i++) { DEBUG(" %02x", (int) bytes[i]); }
 
     DEBUG(".\n");
 
-    getlock();
-
     for (i = 0; i < len; i++)
     {
-        int ret;
-
         seq[0] = 0x28;
         seq[1] = 0x80 | bytes[i];
         seq[2] = 0x80;
-        seq[3] = 0X80 | statusbyte;
+        seq[3] = 0X80 | d->statusbyte;
 
-        if (statusbyte & 0x80)
+        if (d->statusbyte & 0x80)
         {
             seq[0] |= 0x01;
         }
@@ -544,82 +649,55 @@ static void writeRadio(const unsigned char *bytes, int len)
             seq[0] |= 0x04;
         }
 
-        if ((ret = write(uh_device_fd, seq, 4)) < 4)
-        {
-            MYERROR("WriteRadio failed with %d\n", ret);
-
-            if (ret < 0)
-            {
-                perror("WriteRadioError:");
-            }
-        }
+        writeDevice(d, seq, 4, "WriteRadio");
     }
-
-    freelock();
 }
-#endif  /* HAVE_SELECT */
 
 
 //
 // send statusbyte to microHam device
 //
-static void writeFlags()
+static void writeFlags(struct uh_device *d)
 {
     unsigned char seq[4];
-    int ret;
 
-    DEBUG("%10d:Sending FlagByte: %02x\n", TIME, statusbyte);
-    getlock();
+    DEBUG("%10d:Sending FlagByte: %02x\n", TIME(d), d->statusbyte);
     seq[0] = 0x08;
 
-    if (statusbyte & 0x80)
+    if (d->statusbyte & 0x80)
     {
         seq[0] = 0x09;
     }
 
     seq[1] = 0x80;
     seq[2] = 0x80;
-    seq[3] = 0x80 | statusbyte;
-
-    if ((ret = write(uh_device_fd, seq, 4)) < 4)
-    {
-        MYERROR("WriteFlags failed with %d\n", ret);
-
-        if (ret < 0)
-        {
-            perror("WriteFlagsError:");
-        }
-    }
+    seq[3] = 0x80 | d->statusbyte;
 
-    freelock();
+    writeDevice(d, seq, 4, "WriteFlags");
 }
 
 
-#if defined(HAVE_SELECT)
 //
 // Send bytes to the WinKeyer within microHam device
 //
-static void writeWkey(const unsigned char *bytes, int len)
+static void writeWkey(struct uh_device *d, const unsigned char *bytes, int len)
 {
     unsigned char seq[12];
     int i;
-    DEBUG("%10d:Send WinKey data: ", TIME);
+    DEBUG("%10d:Send WinKey data: ", TIME(d));
 
     for (i = 0; i < len; i++) { DEBUG(" %02x", (int) bytes[i]); }
 
     DEBUG(".\n");
+
     // Winkey data is in the third frame of a sequence,
     // So send two no-ops first. Include statusbyte in first frame
-    getlock();
-
     for (i = 0; i < len; i++)
     {
-        int ret;
-
         seq[ 0] = 0x08;
         seq[ 1] = 0x80;
         seq[ 2] = 0x80;
-        seq[ 3] = 0X80 | statusbyte;
+        seq[ 3] = 0X80 | d->statusbyte;
         seq[ 4] = 0x40;
         seq[ 5] = 0x80;
         seq[ 6] = 0x80;
@@ -629,7 +707,7 @@ static void writeWkey(const unsigned char *bytes, int len)
         seq[10] = 0x80;
         seq[11] = 0x80 | bytes[i];
 
-        if (statusbyte & 0x80)
+        if (d->statusbyte & 0x80)
         {
             seq[ 0] |= 0x01;
         }
@@ -639,55 +717,42 @@ static void writeWkey(const unsigned char *bytes, int len)
             seq[ 8] |= 0x01;
         }
 
-        if ((ret = write(uh_device_fd, seq, 12)) < 12)
-        {
-            MYERROR("WriteWINKEY failed with %d\n", ret);
-
-            if (ret < 0)
-            {
-                perror("WriteWinkeyError:");
-            }
-        }
+        writeDevice(d, seq, 12, "WriteWinkey");
     }
-
-    freelock();
 }
-#endif  /* HAVE_SELECT */
 
 
 //
 // Write a control string to the microHam device
 //
-static void writeControl(const unsigned char *data, int len)
+static void writeControl(struct uh_device *d, const unsigned char *data,
+                         int len)
 {
     int i;
     unsigned char seq[8];
 
-    DEBUG("%10d:WriteControl:", TIME);
+    DEBUG("%10d:WriteControl:", TIME(d));
 
     for (i = 0; i < len; i++) { DEBUG(" %02x", data[i]); }
 
     DEBUG(".\n");
+
     // Control data is in the second frame of a sequence,
     // So send a no-op first. Include statusbyte in first frame.
     // First and last byte of the control message is NOT marked "valid"
-    getlock();
-
     for (i = 0; i < len; i++)
     {
-        int ret;
-
         // encode statusbyte in first frame
         seq[0] = 0x08;
         seq[1] = 0x80;
         seq[2] = 0x80;
-        seq[3] = 0x80 | statusbyte;
+        seq[3] = 0x80 | d->statusbyte;
         seq[4] = 0x48; // marked valid
         seq[5] = 0x80;
         seq[6] = 0x80;
         seq[7] = 0x80 | data[i];
 
-        if (statusbyte & 0x80)
+        if (d->statusbyte & 0x80)
         {
             seq[0] |= 1;
         }
@@ -702,41 +767,109 @@ static void writeControl(const unsigned char *data, int len)
             seq[4] |= 0x01;
         }
 
-        if ((ret = write(uh_device_fd, seq, 8)) < 8)
+        writeDevice(d, seq, 8, "WriteControl");
+    }
+}
+
+
+//
+// send a heartbeat and record time, the router thread sends a new one
+// when it is due
+//
+static void heartbeat(struct uh_device *d)
+{
+    unsigned char seq[2];
+
+    seq[0] = 0x7e;
+    seq[1] = 0xfe;
+    writeControl(d, seq, 2);
+    d->lastbeat = time(NULL);
+}
+
+
+//
+// compose frames from the bytes read from the microHam device
+// the bytes from the microHam device come in "frames"
+// a frame is a four-byte sequence. The first byte has the MSB unset,
+// then come three bytes with the MSB set
+//
+static void readDevice(struct uh_device *d)
+{
+    unsigned char buf[64];
+    int n;
+
+    while ((n = read(d->fd, buf, sizeof(buf))) > 0)
+    {
+        int i;
+
+        for (i = 0; i < n; i++)
         {
-            MYERROR("WriteControl failed, ret=%d\n", ret);
+            if (!(buf[i] & 0x80) && d->framepos != 0)
+            {
+                MYERROR("FrameSyncStartError\n");
+                d->framepos = 0;
+            }
+
+            if ((buf[i] & 0x80) && d->framepos == 0)
+            {
+                MYERROR("FrameSyncStartError\n");
+                continue;
+            }
+
+            d->frame[d->framepos++] = buf[i];
 
-            if (ret < 0)
+            if (d->framepos >= 4)
             {
-                perror("WriteControlError:");
+                d->framepos = 0;
+                parseFrame(d, d->frame);
             }
         }
     }
-
-    freelock();
 }
 
 
-#if defined(HAVE_PTHREAD) && defined(HAVE_SOCKETPAIR) && defined(HAVE_SELECT)
 //
-// send a heartbeat and record time
-// The "last heartbeat" time is recorded in a global variable
-// such that the service thread can decice whether a new
-// heartbeat is due.
+// handle the requests queued on the CTL channel
 //
-static void heartbeat()
+static void readRequests(struct uh_device *d)
 {
-    unsigned char seq[2];
+    unsigned char req[260];
+    ssize_t n;
 
-    seq[0] = 0x7e;
-    seq[1] = 0xfe;
-    writeControl(seq, 2);
-    lastbeat = time(NULL);
+    while ((n = recv(d->pair[UH_CTL][0], req, sizeof(req), 0)) > 0)
+    {
+        switch (req[0])
+        {
+        case UH_REQ_PTT:
+            if (n < 2)
+            {
+                break;
+            }
+
+            if (req[1])
+            {
+                d->statusbyte |= 0x04;
+            }
+            else
+            {
+                d->statusbyte &= ~0x04;
+            }
+
+            writeFlags(d);
+            break;
+
+        case UH_REQ_CONTROL:
+            writeControl(d, req + 1, n - 1);
+            break;
+
+        default:
+            MYERROR("Unknown request %02x\n", req[0]);
+            break;
+        }
+    }
 }
-#endif /* defined(HAVE_PTHREAD) && defined(HAVE_SOCKETPAIR) && defined(HAVE_SELECT) */
 
 
-#if defined(HAVE_SELECT)
 //
 // This thread reads from the microHam device and puts data on the sockets
 // it also issues periodic heartbeat messages
@@ -744,73 +877,47 @@ static void heartbeat()
 //
 static void *read_device(void *p)
 {
-    unsigned char frame[4];
-    int framepos = 0;
-    unsigned char buf[2];
+    struct uh_device *d = p;
+    unsigned char buf[64];
     fd_set fds;
     struct timeval tv;
 
-    // the bytes from the microHam decive come in "frames"
-    // a frame is a four-byte sequence. The first byte has the MSB unset,
-    // then come three bytes with the MSB set
     // What comes here is an "infinite" loop. However this thread
     // terminates if the device is closed.
-    for (;;)
+    while (d->running)
     {
         int ret;
         int maxdev;
-
-        //
-        // setting uh_is_initialized to zero in the main thread
-        // tells this one that it is all over now
-        //
-        if (!uh_is_initialized)
-        {
-            return NULL;
-        }
-
-
-#if defined(HAVE_PTHREAD) && defined(HAVE_SOCKETPAIR) && defined(HAVE_SELECT)
+        int i;
+        int n;
 
         //
         // This is the right place to ensure that a heartbeat is sent
         // to the microham device regularly (15 sec delay is the maximum
         // allowed, let us use 5 secs to be on the safe side).
         //
-        if ((time(NULL) - lastbeat) > 5)
+        if ((time(NULL) - d->lastbeat) > 5)
         {
-            heartbeat();
+            heartbeat(d);
         }
 
-#endif
-
         //
         // Wait for something to arrive, either from the microham device
         // or from the sockets used for I/O from hamlib.
         // If nothing arrives within 100 msec, restart the "infinite loop".
         //
         FD_ZERO(&fds);
-        FD_SET(uh_device_fd, &fds);
-        FD_SET(uh_radio_pair[0], &fds);
-        FD_SET(uh_ptt_pair[0], &fds);
-        FD_SET(uh_wkey_pair[0], &fds);
-
-        // determine max of these fd's for use in select()
-        maxdev = uh_device_fd;
+        FD_SET(d->fd, &fds);
+        maxdev = d->fd;
 
-        if (uh_radio_pair[0] > maxdev)
+        for (i = 0; i < UH_NCHAN; i++)
         {
-            maxdev = uh_radio_pair[0];
-        }
+            FD_SET(d->pair[i][0], &fds);
 
-        if (uh_ptt_pair[0]   > maxdev)
-        {
-            maxdev = uh_ptt_pair[0];
-        }
-
-        if (uh_wkey_pair[0]  > maxdev)
-        {
-            maxdev = uh_wkey_pair[0];
+            if (d->pair[i][0] > maxdev)
+            {
+                maxdev = d->pair[i][0];
+            }
         }
 
         tv.tv_usec = 100000;
@@ -829,65 +936,60 @@ static void *read_device(void *p)
         //
         // Take care of the incoming data (microham device, sockets)
         //
-        if (FD_ISSET(uh_device_fd, &fds))
+        if (FD_ISSET(d->fd, &fds))
         {
-            // compose frame, if it is complete, all parseFrame
-            while (read(uh_device_fd, buf, 1) > 0)
-            {
-                if (!(buf[0] & 0x80) && framepos != 0)
-                {
-                    MYERROR("FrameSyncStartError\n");
-                    framepos = 0;
-                }
-
-                if ((buf[0] & 0x80) && framepos == 0)
-                {
-                    MYERROR("FrameSyncStartError\n");
-                    framepos = 0;
-                    continue;
-                }
-
-                frame[framepos++] = buf[0];
-
-                if (framepos >= 4)
-                {
-                    framepos = 0;
-                    parseFrame(frame);
-                }
-            }
+            readDevice(d);
         }
 
-        if (FD_ISSET(uh_ptt_pair[0], &fds))
+        if (FD_ISSET(d->pair[UH_CTL][0], &fds))
+        {
+            readRequests(d);
+        }
+
+        if (FD_ISSET(d->pair[UH_PTT][0], &fds))
         {
             // we do not expect any data here, but drain the socket
-            while (read(uh_ptt_pair[0], buf, 1) > 0)
+            while (read(d->pair[UH_PTT][0], buf, sizeof(buf)) > 0)
             {
                 // do nothing
             }
         }
 
-        if (FD_ISSET(uh_radio_pair[0], &fds))
+        if (FD_ISSET(d->pair[UH_RADIO][0], &fds))
         {
             // read everything that is there, and send it to the radio
-            while (read(uh_radio_pair[0], buf, 1) > 0)
+            while ((n = read(d->pair[UH_RADIO][0], buf, sizeof(buf))) > 0)
             {
-                writeRadio(buf, 1);
+                writeRadio(d, buf, n);
             }
         }
 
-        if (FD_ISSET(uh_wkey_pair[0], &fds))
+        if (FD_ISSET(d->pair[UH_WKEY][0], &fds))
         {
             // read everything that is there, and send it to the WinKey chip
-            while (read(uh_wkey_pair[0], buf, 1) > 0)
+            while ((n = read(d->pair[UH_WKEY][0], buf, sizeof(buf))) > 0)
             {
-                writeWkey(buf, 1);
+                writeWkey(d, buf, n);
             }
         }
     }
 
-//    return NULL;
+    return NULL;
 }
-#endif
+
+
+static int set_nonblock(int fd)
+{
+    int ret = fcntl(fd, F_GETFL, 0);
+
+    if (ret != -1)
+    {
+        ret = fcntl(fd, F_SETFL, ret | O_NONBLOCK);
+    }
+
+    return ret;
+}
+#endif /* UH_ROUTER */
 
 
 /*
@@ -896,141 +998,103 @@ static void *read_device(void *p)
  * (e.g. voltage change) and since we have to send periodic
  * heartbeats.
  * Nevertheless, the program should compile well even we we do not
- * have pthreads, in this case start_thread is a dummy since uh_is_initialized
- * is never set.
+ * have pthreads, in this case start_device always fails.
  *
  * If we do not have socketpair(), the same thing applies.
  *
  * If we do not have select(), then the read thread cannot work so we
  * do not spawn it.
+ *
+ * device is the path of the microHam device or NULL to use the first
+ * one found.  Returns the slot of an already running device for the
+ * same path, called with uh_lock held.
  */
-static void start_thread()
+static struct uh_device *start_device(const char *device)
 {
-#if defined(HAVE_PTHREAD) && defined(HAVE_SOCKETPAIR) && defined(HAVE_SELECT)
+#ifdef UH_ROUTER
     /*
      * Find a microHam device and open serial port to it.
      * If successful, create sockets for doing I/O from within hamlib
      * and start a thread to listen to the "other ends" of the sockets
      */
+    struct uh_device *d = NULL;
+    char path[PATH_MAX];
     int ret, fail;
     unsigned char buf[4];
-    pthread_attr_t attr;
-
-    if (uh_is_initialized)
-    {
-        return;  // PARANOIA: this should not happen
-    }
-
-    finddevices();
-
-    if (uh_device_fd  < 0)
-    {
-        MYERROR("Could not open any microHam device.\n");
-        return;
-    }
-
-    // Create socket pairs
-    if (socketpair(AF_UNIX, SOCK_STREAM, 0, uh_radio_pair)  < 0)
-    {
-        perror("RadioPair:");
-        return;
-    }
-
-    if (socketpair(AF_UNIX, SOCK_STREAM, 0, uh_ptt_pair)    < 0)
-    {
-        perror("PTTPair:");
-        return;
-    }
-
-    if (socketpair(AF_UNIX, SOCK_STREAM, 0, uh_wkey_pair) < 0)
-    {
-        perror("WkeyPair:");
-        return;
-    }
-
-    DEBUG("RADIO  sockets: server=%d  client=%d\n", uh_radio_pair[0],
-          uh_radio_pair[1]);
-    DEBUG("PTT    sockets: server=%d  client=%d\n", uh_ptt_pair[0], uh_ptt_pair[1]);
-    DEBUG("WinKey sockets: server=%d  client=%d\n", uh_wkey_pair[0],
-          uh_wkey_pair[1]);
-
-    //
-    // Make the sockets nonblocking
-    // First try if we can set flags, then do set the flags
-    //
-
-    fail = 0;
-
-    ret = fcntl(uh_radio_pair[0], F_GETFL, 0);
+    int i;
 
-    if (ret != -1)
+    if (device && resolvepath(device, path))
     {
-        ret = fcntl(uh_radio_pair[0], F_SETFL, ret | O_NONBLOCK);
+        MYERROR("Cannot resolve %s\n", device);
+        return NULL;
     }
 
-    if (ret == -1)
+    for (i = 0; i < UH_MAX_DEVICES; i++)
     {
-        fail = 1;
-    }
+        if (!uh_devices[i].used)
+        {
+            if (!d)
+            {
+                d = &uh_devices[i];
+            }
 
-    ret = fcntl(uh_ptt_pair[0], F_GETFL, 0);
+            continue;
+        }
 
-    if (ret != -1)
-    {
-        ret = fcntl(uh_ptt_pair[0], F_SETFL, ret | O_NONBLOCK);
+        if (device ? !strcmp(uh_devices[i].path, path) : uh_devices[i].autodetected)
+        {
+            return &uh_devices[i];
+        }
     }
 
-    if (ret == -1)
+    if (!d)
     {
-        fail = 1;
+        MYERROR("Too many microHam devices\n");
+        return NULL;
     }
 
-    ret = fcntl(uh_wkey_pair[0], F_GETFL, 0);
-
-    if (ret != -1)
-    {
-        ret = fcntl(uh_wkey_pair[0], F_SETFL, ret | O_NONBLOCK);
-    }
+    memset(d, 0, sizeof(*d));
 
-    if (ret == -1)
+    for (i = 0; i < UH_NCHAN; i++)
     {
-        fail = 1;
+        d->pair[i][0] = -1;
+        d->pair[i][1] = -1;
     }
 
-    ret = fcntl(uh_radio_pair[1], F_GETFL, 0);
+    d->fd = device ? opendevice(path) : finddevice(path);
 
-    if (ret != -1)
-    {
-        ret = fcntl(uh_radio_pair[1], F_SETFL, ret | O_NONBLOCK);
-    }
-
-    if (ret == -1)
+    if (d->fd < 0)
     {
-        fail = 1;
+        MYERROR("Could not open any microHam device.\n");
+        return NULL;
     }
 
-    ret = fcntl(uh_ptt_pair[1], F_GETFL, 0);
+    snprintf(d->path, sizeof(d->path), "%s", path);
+    d->autodetected = device == NULL;
 
-    if (ret != -1)
-    {
-        ret = fcntl(uh_ptt_pair[1], F_SETFL, ret | O_NONBLOCK);
-    }
+    // Create socket pairs, requests on CTL keep their boundaries
+    fail = 0;
 
-    if (ret == -1)
+    for (i = 0; i < UH_NCHAN && !fail; i++)
     {
-        fail = 1;
-    }
-
-    ret = fcntl(uh_wkey_pair[1], F_GETFL, 0);
+        if (socketpair(AF_UNIX, i == UH_CTL ? SOCK_DGRAM : SOCK_STREAM, 0,
+                       d->pair[i]) < 0)
+        {
+            perror("SocketPair:");
+            fail = 1;
+            break;
+        }
 
-    if (ret != -1)
-    {
-        ret = fcntl(uh_wkey_pair[1], F_SETFL, ret | O_NONBLOCK);
-    }
+        DEBUG("Channel %d sockets: server=%d  client=%d\n", i, d->pair[i][0],
+              d->pair[i][1]);
 
-    if (ret == -1)
-    {
-        fail = 1;
+        //
+        // Make the sockets nonblocking
+        //
+        if (set_nonblock(d->pair[i][0]) == -1 || set_nonblock(d->pair[i][1]) == -1)
+        {
+            fail = 1;
+        }
     }
 
     //
@@ -1038,129 +1102,196 @@ static void start_thread()
     //
     if (fail)
     {
-        close_all_files();
-        return;
+        close_all_files(d);
+        return NULL;
     }
 
     // drain input from microHam device
-    while (read(uh_device_fd, buf, 1) > 0)
+    while (read(d->fd, buf, 1) > 0)
     {
         // do_nothing
     }
 
-    uh_is_initialized = 1;
-    starttime = time(NULL);
+    d->starttime = time(NULL);
 
-    // Do some heartbeats to sync-in
-    heartbeat();
-    heartbeat();
-    heartbeat();
+    // Do some heartbeats to sync-in, the router thread is not running yet
+    heartbeat(d);
+    heartbeat(d);
+    heartbeat(d);
 
     // Set keyer mode to DIGITAL
-    buf[0] = 0x0A; buf[1] = 0x03; buf[2] = 0x8a; writeControl(buf, 3);
+    buf[0] = 0x0A; buf[1] = 0x03; buf[2] = 0x8a; writeControl(d, buf, 3);
 
     // Start background thread reading the microham device and the sockets
-    pthread_attr_init(&attr);
-    ret = pthread_create(&readthread, &attr, read_device, NULL);
+    d->running = 1;
+    ret = pthread_create(&d->thread, NULL, read_device, d);
 
     if (ret != 0)
     {
         MYERROR("Could not start read_device thread\n");
-        close_all_files();
-        uh_is_initialized = 0;
-        return;
+        d->running = 0;
+        close_all_files(d);
+        return NULL;
     }
 
-    //TRACE("Started daemonized thread reading microHam\n");
-#endif
+    d->used = 1;
+
+    return d;
+#else
 // if we do not have pthreads, this function does nothing.
+    return NULL;
+#endif
 }
 
 
-/*
- * What comes now are "public" functions that can be called from outside
- *
-   void uh_close_XXX()        XXX= ptt, radio, wkey
-   void uh_open_XXX()         XXX= ptt, wkey
-   void uh_open_radio(int baud, int databits, int stopbits, int rtscts)
-   void uh_set_ptt(int ptt)
-   int  uh_get_ptt()
+//
+// find the device owning a channel fd handed out to hamlib
+//
+static struct uh_device *find_fd(int fd, int channel)
+{
+    int i;
 
- * Note that it is not intended that any I/O is done via the PTT sockets
- * but hamlib needs a valid file descriptor!
- *
- */
+    if (fd < 0)
+    {
+        return NULL;
+    }
 
-/*
- * Close routines:
- * Mark the channel as closed, but close the connection
- * to the microHam device only if ALL channels are closed
- *
- * NOTE: hamlib repeatedly opens/closes the PTT port while keeping the
- *       the radio port open.
- */
-void uh_close_ptt()
+    for (i = 0; i < UH_MAX_DEVICES; i++)
+    {
+        struct uh_device *d = &uh_devices[i];
+
+        if (d->in_use[channel] && d->pair[channel][1] == fd)
+        {
+            return d;
+        }
+    }
+
+    return NULL;
+}
+
+
+//
+// queue a request for the router thread
+//
+static int queue_request(struct uh_device *d, const unsigned char *req,
+                         int len)
 {
-    uh_ptt_in_use = 0;
+#ifdef UH_ROUTER
 
-    if (!uh_radio_in_use && ! uh_wkey_in_use)
+    if (send(d->pair[UH_CTL][1], req, len, 0) != len)
     {
-        close_microham();
+        MYERROR("Queue request failed\n");
+        return -1;
     }
+
+    return 0;
+#else
+    return -1;
+#endif
 }
 
 
-void uh_close_radio()
+//
+// Open a channel of a device, starting it if needed
+//
+static struct uh_device *open_channel(const char *device, int channel)
 {
-    uh_radio_in_use = 0;
+    struct uh_device *d;
 
-    if (!uh_ptt_in_use && ! uh_wkey_in_use)
+    getlock();
+    d = start_device(device);
+
+    if (d)
     {
-        close_microham();
+        d->in_use[channel] = 1;
     }
+
+    freelock();
+
+    return d;
 }
 
-void uh_close_wkey()
+
+//
+// Mark the channel as closed, but close the connection
+// to the microHam device only if ALL channels are closed
+//
+static void close_channel(struct uh_device *d, int channel)
 {
-    uh_wkey_in_use = 0;
+    getlock();
+    d->in_use[channel] = 0;
 
-    if (!uh_ptt_in_use && ! uh_radio_in_use)
+    if (d->used && !d->in_use[UH_RADIO] && !d->in_use[UH_PTT]
+            && !d->in_use[UH_WKEY])
     {
-        close_microham();
+        close_microham(d);
     }
+
+    freelock();
 }
 
-int uh_open_ptt()
+
+//
+// the device plain "uh-rig"/"uh-ptt" refers to
+//
+static struct uh_device *default_device(void)
 {
-    if (!uh_is_initialized)
-    {
-        start_thread();
+    int i;
 
-        if (!uh_is_initialized)
+    for (i = 0; i < UH_MAX_DEVICES; i++)
+    {
+        if (uh_devices[i].used && uh_devices[i].autodetected)
         {
-            return -1;
+            return &uh_devices[i];
         }
     }
 
-    uh_ptt_in_use = 1;
-    return uh_ptt_pair[1];
+    return NULL;
 }
 
-int uh_open_wkey()
+
+/*
+ * What comes now are "public" functions that can be called from outside
+ *
+   int  uh_open_radio_dev(const char *device, int baud, int databits, int stopbits, int rtscts)
+   int  uh_open_ptt_dev(const char *device)
+   int  uh_open_wkey_dev(const char *device)
+   int  uh_close_fd(int fd)
+   int  uh_set_ptt_fd(int fd, int ptt)
+   int  uh_get_ptt_fd(int fd)
+   int  uh_is_radio_fd(int fd)
+   int  uh_is_ptt_fd(int fd)
+
+ * device is the path of the microHam device, or NULL for the first one
+ * found.  The fd returned by the open functions identifies the device
+ * in the other calls.
+ *
+ * The older functions below work on that first device only:
+ *
+   void uh_close_XXX()        XXX= ptt, radio, wkey
+   void uh_open_XXX()         XXX= ptt, wkey
+   void uh_open_radio(int baud, int databits, int stopbits, int rtscts)
+   void uh_set_ptt(int ptt)
+   int  uh_get_ptt()
+
+ * Note that it is not intended that any I/O is done via the PTT sockets
+ * but hamlib needs a valid file descriptor!
+ *
+ */
+
+int uh_open_ptt_dev(const char *device)
 {
-    if (!uh_is_initialized)
-    {
-        start_thread();
+    struct uh_device *d = open_channel(device, UH_PTT);
 
-        if (!uh_is_initialized)
-        {
-            return -1;
-        }
-    }
+    return d ? d->pair[UH_PTT][1] : -1;
+}
 
 
-    uh_wkey_in_use = 1;
-    return uh_wkey_pair[1];
+int uh_open_wkey_dev(const char *device)
+{
+    struct uh_device *d = open_channel(device, UH_WKEY);
+
+    return d ? d->pair[UH_WKEY][1] : -1;
 }
 
 
@@ -1170,94 +1301,192 @@ int uh_open_wkey()
 // Hardware handshake (rtscts) can be on of off.
 // microHam devices ALWAYS use "no parity".
 //
-int uh_open_radio(int baud, int databits, int stopbits, int rtscts)
+int uh_open_radio_dev(const char *device, int baud, int databits,
+                      int stopbits, int rtscts)
 {
-    unsigned char string[5];
+    struct uh_device *d;
+    unsigned char string[6];
     int baudrateConst;
 
-    if (!uh_is_initialized)
+    if (baud <= 0)
     {
-        start_thread();
-
-        if (!uh_is_initialized)
-        {
-            return -1;
-        }
+        return -1;
     }
 
     baudrateConst = 11059200 / baud ;
-    string[0] = 0x01;
-    string[1] = baudrateConst & 0xff ;
-    string[2] = baudrateConst / 256 ;
+    string[0] = UH_REQ_CONTROL;
+    string[1] = 0x01;
+    string[2] = baudrateConst & 0xff ;
+    string[3] = baudrateConst / 256 ;
 
     switch (stopbits)
     {
-    case 1:  string[3] = 0x00; break;
+    case 1:  string[4] = 0x00; break;
 
-    case 2:  string[3] = 0x40; break;
+    case 2:  string[4] = 0x40; break;
 
     default: return -1;
     }
 
     if (rtscts)
     {
-        string[3] |= 0x10;
+        string[4] |= 0x10;
     }
 
     switch (databits)
     {
     case 5: break;
 
-    case 6: string[3] |= 0x20; break;
+    case 6: string[4] |= 0x20; break;
 
-    case 7: string[3] |= 0x40; break;
+    case 7: string[4] |= 0x40; break;
 
-    case 8: string[3] |= 0x60; break;
+    case 8: string[4] |= 0x60; break;
 
     default: return -1;
     }
 
-    string[4] = 0x81;
-    writeControl(string, 5);
+    string[5] = 0x81;
+
+    d = open_channel(device, UH_RADIO);
+
+    if (!d)
+    {
+        return -1;
+    }
+
+    queue_request(d, string, 6);
 
-    uh_radio_in_use = 1;
-    return uh_radio_pair[1];
+    return d->pair[UH_RADIO][1];
 }
 
 
-void uh_set_ptt(int ptt)
+//
+// Returns 0 if fd was a microHam channel, -1 otherwise
+//
+int uh_close_fd(int fd)
 {
-    if (!uh_ptt_in_use)
+    int channel;
+
+    for (channel = 0; channel < UH_CTL; channel++)
     {
-        MYERROR("%10d:SetPTT but not open\n", TIME);
-        return;
+        struct uh_device *d = find_fd(fd, channel);
+
+        if (d)
+        {
+            close_channel(d, channel);
+            return 0;
+        }
     }
 
-    DEBUG("%10d:SET PTT = %d\n", TIME, ptt);
+    return -1;
+}
 
-    if (ptt)
-    {
-        statusbyte |= 0x04;
-    }
-    else
+
+int uh_set_ptt_fd(int fd, int ptt)
+{
+    struct uh_device *d = find_fd(fd, UH_PTT);
+    unsigned char req[2];
+
+    if (!d)
     {
-        statusbyte &= ~0x04;
+        MYERROR("SetPTT but not open\n");
+        return -1;
     }
 
-    writeFlags();
+    DEBUG("%10d:SET PTT = %d\n", TIME(d), ptt);
+
+    d->ptt = ptt ? 1 : 0;
+    req[0] = UH_REQ_PTT;
+    req[1] = d->ptt;
+
+    return queue_request(d, req, 2);
 }
 
 
-int uh_get_ptt()
+int uh_get_ptt_fd(int fd)
 {
+    struct uh_device *d = find_fd(fd, UH_PTT);
+
     // Possibly we can do better, but we just reflect
     // what we have done via uh_set_ptt.
-    if (statusbyte & 0x04)
+    return d ? d->ptt : 0;
+}
+
+
+int uh_is_radio_fd(int fd)
+{
+    return find_fd(fd, UH_RADIO) != NULL;
+}
+
+
+int uh_is_ptt_fd(int fd)
+{
+    return find_fd(fd, UH_PTT) != NULL;
+}
+
+
+void uh_close_ptt()
+{
+    struct uh_device *d = default_device();
+
+    if (d)
     {
-        return 1;
+        close_channel(d, UH_PTT);
     }
-    else
+}
+
+
+void uh_close_radio()
+{
+    struct uh_device *d = default_device();
+
+    if (d)
     {
-        return 0;
+        close_channel(d, UH_RADIO);
     }
 }
+
+void uh_close_wkey()
+{
+    struct uh_device *d = default_device();
+
+    if (d)
+    {
+        close_channel(d, UH_WKEY);
+    }
+}
+
+int uh_open_ptt()
+{
+    return uh_open_ptt_dev(NULL);
+}
+
+int uh_open_wkey()
+{
+    return uh_open_wkey_dev(NULL);
+}
+
+int uh_open_radio(int baud, int databits, int stopbits, int rtscts)
+{
+    return uh_open_radio_dev(NULL, baud, databits, stopbits, rtscts);
+}
+
+
+void uh_set_ptt(int ptt)
+{
+    struct uh_device *d = default_device();
+
+    if (d)
+    {
+        uh_set_ptt_fd(d->pair[UH_PTT][1], ptt);
+    }
+}
+
+
+int uh_get_ptt()
+{
+    struct uh_device *d = default_device();
+
+    return d ? uh_get_ptt_fd(d->pair[UH_PTT][1]) : 0;
+}
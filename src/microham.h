@@ -22,10 +22,24 @@
 //
 // declaration of functions implemented in microham.c
 //
+// device is the path of a microHam device or NULL for the first one
+// found, the returned fd selects the device in the *_fd calls
 //
 
+extern int  uh_open_radio_dev(const char *device, int baud, int databits,
+                              int stopbits, int rtscts);
+extern int  uh_open_ptt_dev(const char *device);
+extern int  uh_open_wkey_dev(const char *device);
+extern int  uh_close_fd(int fd);
+extern int  uh_set_ptt_fd(int fd, int ptt);
+extern int  uh_get_ptt_fd(int fd);
+extern int  uh_is_radio_fd(int fd);
+extern int  uh_is_ptt_fd(int fd);
+
+// first device only
 extern int  uh_open_radio(int baud, int databits, int stopbits, int rtscts);
 extern int  uh_open_ptt();
+extern int  uh_open_wkey();
 extern void uh_close_wkey();
 extern void uh_set_ptt(int ptt);
 extern int  uh_get_ptt();
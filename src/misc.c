@@ -52,6 +52,7 @@
 #include "misc.h"
 #include "serial.h"
 #include "network.h"
+#include "ioreactor.h"
 
 #if defined(_WIN32)
 #  include <time.h>
@@ -118,6 +119,27 @@ static int clock_gettime(clockid_t clock_id, struct timespec *tp)
 
 #endif // __APPLE__
 
+//! @cond Doxygen_Suppress
+/* value of a packed BCD byte, invalid digits weigh in like the arithmetic did */
+#define BCD_ROW(h) h*10+0, h*10+1, h*10+2, h*10+3, h*10+4, h*10+5, h*10+6, \
+    h*10+7, h*10+8, h*10+9, h*10+10, h*10+11, h*10+12, h*10+13, h*10+14, h*10+15
+static const unsigned char bcd2bin[256] =
+{
+    BCD_ROW(0), BCD_ROW(1), BCD_ROW(2), BCD_ROW(3), BCD_ROW(4), BCD_ROW(5),
+    BCD_ROW(6), BCD_ROW(7), BCD_ROW(8), BCD_ROW(9), BCD_ROW(10), BCD_ROW(11),
+    BCD_ROW(12), BCD_ROW(13), BCD_ROW(14), BCD_ROW(15)
+};
+
+/* packed BCD byte of 0..99 */
+#define BIN_ROW(t) t<<4|0, t<<4|1, t<<4|2, t<<4|3, t<<4|4, t<<4|5, t<<4|6, \
+    t<<4|7, t<<4|8, t<<4|9
+static const unsigned char bin2bcd[100] =
+{
+    BIN_ROW(0), BIN_ROW(1), BIN_ROW(2), BIN_ROW(3), BIN_ROW(4), BIN_ROW(5),
+    BIN_ROW(6), BIN_ROW(7), BIN_ROW(8), BIN_ROW(9)
+};
+//! @endcond
+
 /**
  * \brief Convert from binary to 4-bit BCD digits, little-endian
  * \param bcd_data
@@ -132,7 +154,7 @@ static int clock_gettime(clockid_t clock_id, struct timespec *tp)
  * bcd_len is the number of BCD digits, usually 10 or 8 in 1-Hz units,
  * and 6 digits in 100-Hz units for Tx offset data.
  *
- * Hope the compiler will do a good job optimizing it (esp. w/the 64bit freq)
+ * Two digits are converted at a time with a lookup table.
  *
  * Returns a pointer to (unsigned char *)bcd_data.
  *
@@ -144,18 +166,13 @@ unsigned char *HAMLIB_API to_bcd(unsigned char bcd_data[],
 {
     int i;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
     /* '450'/4-> 5,0;0,4 */
     /* '450'/3-> 5,0;x,4 */
 
     for (i = 0; i < bcd_len / 2; i++)
     {
-        unsigned char a = freq % 10;
-        freq /= 10;
-        a |= (freq % 10) << 4;
-        freq /= 10;
-        bcd_data[i] = a;
+        bcd_data[i] = bin2bcd[freq % 100];
+        freq /= 100;
     }
 
     if (bcd_len & 1)
@@ -179,7 +196,7 @@ unsigned char *HAMLIB_API to_bcd(unsigned char bcd_data[],
  *
  * bcd_len is the number of BCD digits.
  *
- * Hope the compiler will do a good job optimizing it (esp. w/ the 64bit freq)
+ * Two digits are converted at a time with a lookup table.
  *
  * Returns frequency in Hz an unsigned long long integer.
  *
@@ -191,8 +208,6 @@ unsigned long long HAMLIB_API from_bcd(const unsigned char bcd_data[],
     int i;
     freq_t f = 0;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
     if (bcd_len & 1)
     {
         f = bcd_data[bcd_len / 2] & 0x0f;
@@ -200,10 +215,7 @@ unsigned long long HAMLIB_API from_bcd(const unsigned char bcd_data[],
 
     for (i = (bcd_len / 2) - 1; i >= 0; i--)
     {
-        f *= 10;
-        f += bcd_data[i] >> 4;
-        f *= 10;
-        f += bcd_data[i] & 0x0f;
+        f = f * 100 + bcd2bin[bcd_data[i]];
     }
 
     return f;
@@ -231,8 +243,6 @@ unsigned char *HAMLIB_API to_bcd_be(unsigned char bcd_data[],
     /* '450'/4 -> 0,4;5,0 */
     /* '450'/3 -> 4,5;0,x */
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
     if (bcd_len & 1)
     {
         bcd_data[bcd_len / 2] &= 0x0f;
@@ -243,11 +253,8 @@ unsigned char *HAMLIB_API to_bcd_be(unsigned char bcd_data[],
 
     for (i = (bcd_len / 2) - 1; i >= 0; i--)
     {
-        unsigned char a = freq % 10;
-        freq /= 10;
-        a |= (freq % 10) << 4;
-        freq /= 10;
-        bcd_data[i] = a;
+        bcd_data[i] = bin2bcd[freq % 100];
+        freq /= 100;
     }
 
     return bcd_data;
@@ -271,14 +278,9 @@ unsigned long long HAMLIB_API from_bcd_be(const unsigned char bcd_data[],
     int i;
     freq_t f = 0;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
     for (i = 0; i < bcd_len / 2; i++)
     {
-        f *= 10;
-        f += bcd_data[i] >> 4;
-        f *= 10;
-        f += bcd_data[i] & 0x0f;
+        f = f * 100 + bcd2bin[bcd_data[i]];
     }
 
     if (bcd_len & 1)
@@ -2187,6 +2189,10 @@ int HAMLIB_API rig_flush_force(hamlib_port_t *port, int flush_async_data)
         port_flush_sync_pipes(port);
     }
 
+    /* what is still queued for the rig belongs before the flush */
+    io_reactor_drain(port);
+    io_reactor_discard(port);
+
 #ifndef RIG_FLUSH_REMOVE
 //    rig_debug(RIG_DEBUG_TRACE, "%s: called for %s device\n", __func__,
 //              port->type.rig == RIG_PORT_SERIAL ? "serial" : "network");
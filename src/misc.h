@@ -157,9 +157,18 @@ extern HAMLIB_EXPORT(char *)date_strget(char *buf, int buflen, int localtime);
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 void errmsg(int err, char *s, const char *func, const char *file, int line);
 #define ERRMSG(err, s) errmsg(err,  s, __func__, __FILENAME__, __LINE__)
+// an API call swaps back a VFO left selected by a previous call before it talks to the rig
 #define ENTERFUNC {     ++rig->state.depth; \
                         rig_debug(RIG_DEBUG_VERBOSE, "%.*s%d:%s(%d):%s entered\n", rig->state.depth-1, spaces(), rig->state.depth, __FILENAME__, __LINE__, __func__); \
+                        if (rig->state.vfo_parked != RIG_VFO_NONE && rig->state.depth >= rig->state.vfo_parked_depth) { rig_vfo_settle(rig, 1); } \
                   }
+// for calls that select their VFO with vfo_plan_select() and keep a VFO left selected
+#define ENTERFUNC_VFO_PLAN { ++rig->state.depth; \
+                        rig_debug(RIG_DEBUG_VERBOSE, "%.*s%d:%s(%d):%s entered\n", rig->state.depth-1, spaces(), rig->state.depth, __FILENAME__, __LINE__, __func__); \
+                  }
+// API calls entered with ENTERFUNC2 swap back a VFO left selected themselves,
+// frontend levels above the API call that left it selected do not
+#define VFO_PLAN_SETTLE(r) { if ((r)->state.vfo_parked != RIG_VFO_NONE && (r)->state.depth + 1 >= (r)->state.vfo_parked_depth) { rig_vfo_settle((r), 1); } }
 #define ENTERFUNC2 {    rig_debug(RIG_DEBUG_VERBOSE, "%s(%d):%s entered\n", __FILENAME__, __LINE__, __func__); \
                    }
 // we need to refer to rc just once as it 
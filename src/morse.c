@@ -0,0 +1,789 @@
+/*
+ *  Hamlib Interface - keyer timing and queued morse
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file morse.c
+ * \brief Waiting for the keyer and streaming long messages into it
+ *
+ * rig_wait_morse() used to ask the rig for PTT every 25 ms until it
+ * dropped, keeping the CAT link busy for the whole message.  Every text
+ * handed to the rig now moves an estimate of when the keyer runs dry,
+ * from the keyer speed and 50 dots for every 6 characters (PARIS and the
+ * word gap).  The wait asks the rig once after the rig had time to key
+ * up, as before, then sleeps half of what the estimate says is left
+ * before asking again, and backs off from 25 ms to 400 ms once past it.
+ * PTT events, from transceive or the poll routine, end a sleep right
+ * away and answer the check without asking the rig.  Rigs reporting
+ * their keyer buffer (rig_caps::get_morse_state) are asked for that
+ * first: an empty buffer ends the wait, a full one skips the PTT query.
+ *
+ * rig_send_morse_queued() takes text of any length and returns.  A worker
+ * started with rig_morse_queue_start() hands it to the rig in chunks as
+ * the keyer runs low, holding the application lock only while a chunk is
+ * sent, so other clients are not held up for the whole message.
+ * rig_wait_morse() sends what is still queued from the calling thread
+ * first, like rig_async_set_flush().
+ */
+
+#include <hamlib/config.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "morse.h"
+#include "misc.h"
+
+#define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
+
+#define MORSE_QUEUE_SIZE 1024   /* chars rig_send_morse_queued() holds */
+#define MORSE_CHUNK 24          /* chars per send_morse, what KY takes */
+#define MORSE_AHEAD_CHARS 8     /* chars left in the keyer when the next chunk goes */
+#define MORSE_WPM 20            /* until the keyer speed is known */
+#define MORSE_START_MS 200      /* for the rig to key up */
+#define MORSE_POLL_MIN_MS 25
+#define MORSE_POLL_MAX_MS 400
+#define MORSE_TIMEOUT_MS 15000  /* past the estimated end */
+
+struct morse
+{
+    RIG *rig;
+    int wpm;                        /* keyer speed, 0 until asked, -1 unknown */
+    struct timespec busy_until;     /* estimated end of the text sent, CLOCK_REALTIME */
+    ptt_t ptt;                      /* of the last PTT event */
+    unsigned int ptt_seq;           /* PTT events so far */
+    unsigned int sent_seq;          /* ptt_seq when text was last sent */
+    void (*sync_cb)(int lock);
+    vfo_t vfo;                      /* of the queued text */
+    int len;
+    char text[MORSE_QUEUE_SIZE];    /* queued, not sent yet */
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_mutex_t lock;           /* all of the above */
+    pthread_mutex_t send;           /* held while a chunk is sent */
+    pthread_cond_t changed;         /* text queued, PTT event or stop */
+    int run;                        /* worker started */
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+#define MORSE_LOCK(m) pthread_mutex_lock(&(m)->lock)
+#define MORSE_UNLOCK(m) pthread_mutex_unlock(&(m)->lock)
+#else
+#define MORSE_LOCK(m)
+#define MORSE_UNLOCK(m)
+#endif
+
+static void morse_timespec_add_ms(struct timespec *ts, long ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* ms from now until ts, negative once passed */
+static long morse_ms_until(const struct timespec *ts)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    return (ts->tv_sec - now.tv_sec) * 1000L
+           + (ts->tv_nsec - now.tv_nsec) / 1000000L;
+}
+
+/* a character with its share of the gaps */
+static long morse_char_ms(const struct morse *m)
+{
+    return (long)(morse_code_dot_to_millis(m->wpm > 0 ? m->wpm : MORSE_WPM)
+                  * 50 / 6);
+}
+
+void morse_init(RIG *rig)
+{
+    struct morse *m = calloc(1, sizeof(*m));
+
+    if (m == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: out of memory\n", __func__);
+        return;
+    }
+
+    m->rig = rig;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_mutex_init(&m->send, NULL);
+    pthread_cond_init(&m->changed, NULL);
+#endif
+
+    rig->state.morse = m;
+}
+
+/* text went to the keyer, the estimate grows by its length */
+void morse_sent(RIG *rig, const char *msg)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        return;
+    }
+
+    if (m->wpm == 0)
+    {
+        value_t val;
+
+        m->wpm = -1;
+
+        if (rig_has_get_level(rig, RIG_LEVEL_KEYSPD)
+                && rig_get_level(rig, RIG_VFO_CURR, RIG_LEVEL_KEYSPD, &val) == RIG_OK
+                && val.i > 0)
+        {
+            m->wpm = val.i;
+        }
+    }
+
+    MORSE_LOCK(m);
+
+    if (morse_ms_until(&m->busy_until) < 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &m->busy_until);
+    }
+
+    morse_timespec_add_ms(&m->busy_until, (long)strlen(msg) * morse_char_ms(m));
+    m->sent_seq = m->ptt_seq;
+
+    MORSE_UNLOCK(m);
+}
+
+/* rig_stop_morse() empties the keyer and the queue */
+void morse_stop(RIG *rig)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        return;
+    }
+
+    MORSE_LOCK(m);
+    m->len = 0;
+    clock_gettime(CLOCK_REALTIME, &m->busy_until);
+#ifdef HAVE_PTHREAD
+    pthread_cond_broadcast(&m->changed);
+#endif
+    MORSE_UNLOCK(m);
+}
+
+void morse_set_wpm(RIG *rig, int wpm)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+
+    if (m != NULL)
+    {
+        m->wpm = wpm > 0 ? wpm : -1;
+    }
+}
+
+void morse_ptt_event(RIG *rig, ptt_t ptt)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        return;
+    }
+
+    MORSE_LOCK(m);
+    m->ptt = ptt;
+    m->ptt_seq++;
+#ifdef HAVE_PTHREAD
+    pthread_cond_broadcast(&m->changed);
+#endif
+    MORSE_UNLOCK(m);
+}
+
+/* sleeps up to ms, returns 1 if a PTT event ended it early */
+static int morse_sleep(struct morse *m, long ms)
+{
+#ifdef HAVE_PTHREAD
+    struct timespec until;
+    unsigned int seq;
+    int event;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    morse_timespec_add_ms(&until, ms);
+
+    pthread_mutex_lock(&m->lock);
+    seq = m->ptt_seq;
+
+    while (m->ptt_seq == seq)
+    {
+        if (pthread_cond_timedwait(&m->changed, &m->lock, &until) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    event = m->ptt_seq != seq;
+    pthread_mutex_unlock(&m->lock);
+
+    return event;
+#else
+    hl_usleep(ms * 1000);
+    return 0;
+#endif
+}
+
+/*
+ * whether the keyer is done; the PTT of an event since the text was sent
+ * is used unless poll is set
+ */
+static int morse_check(RIG *rig, struct morse *m, vfo_t vfo, int poll,
+                       int *done)
+{
+    ptt_t ptt;
+    int have_event;
+    int retval;
+
+    *done = 0;
+
+    if (rig->caps->get_morse_state)
+    {
+        int state;
+
+        HAMLIB_TRACE;
+        retval = rig->caps->get_morse_state(rig, vfo, &state);
+
+        if (retval == RIG_OK && state == RIG_MORSE_IDLE)
+        {
+            *done = 1;
+            return RIG_OK;
+        }
+
+        if (retval == RIG_OK && state == RIG_MORSE_FULL)
+        {
+            return RIG_OK;
+        }
+    }
+
+    MORSE_LOCK(m);
+    have_event = m->ptt_seq != m->sent_seq;
+    ptt = m->ptt;
+    MORSE_UNLOCK(m);
+
+    if (poll || !have_event)
+    {
+        elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_INVALIDATE);
+        HAMLIB_TRACE;
+        retval = rig_get_ptt(rig, vfo, &ptt);
+
+        if (retval != RIG_OK)
+        {
+            return retval;
+        }
+    }
+
+    *done = ptt == RIG_PTT_OFF;
+
+    return RIG_OK;
+}
+
+/* ms until the keyer should get the next chunk, 0 for now */
+static long morse_room_ms(RIG *rig, struct morse *m, vfo_t vfo)
+{
+    long ms;
+
+    if (rig->caps->get_morse_state)
+    {
+        int state;
+
+        HAMLIB_TRACE;
+
+        if (rig->caps->get_morse_state(rig, vfo, &state) == RIG_OK)
+        {
+            return state == RIG_MORSE_FULL ? MORSE_AHEAD_CHARS / 2 * morse_char_ms(m) :
+                   0;
+        }
+    }
+
+    MORSE_LOCK(m);
+    ms = morse_ms_until(&m->busy_until) - MORSE_AHEAD_CHARS * morse_char_ms(m);
+    MORSE_UNLOCK(m);
+
+    return ms > 0 ? ms : 0;
+}
+
+/* takes the next chunk off the queue, the lock is held */
+static int morse_pop(struct morse *m, char *chunk, vfo_t *vfo)
+{
+    int n = m->len < MORSE_CHUNK ? m->len : MORSE_CHUNK;
+
+    memcpy(chunk, m->text, n);
+    chunk[n] = '\0';
+    m->len -= n;
+    memmove(m->text, m->text + n, m->len);
+    *vfo = m->vfo;
+
+    return n;
+}
+
+/* sends one chunk if the keyer has room, 1 if sent, 0 if not yet */
+static int morse_send_chunk(RIG *rig, struct morse *m, long *wait_ms)
+{
+    char chunk[MORSE_CHUNK + 1];
+    vfo_t vfo;
+    int retval;
+
+    MORSE_LOCK(m);
+    vfo = m->vfo;
+    MORSE_UNLOCK(m);
+
+    *wait_ms = morse_room_ms(rig, m, vfo);
+
+    if (*wait_ms > 0)
+    {
+        return 0;
+    }
+
+    MORSE_LOCK(m);
+
+    if (morse_pop(m, chunk, &vfo) == 0)
+    {
+        MORSE_UNLOCK(m);
+        return 0;
+    }
+
+    MORSE_UNLOCK(m);
+
+    retval = rig_send_morse(rig, vfo, chunk);
+
+    if (retval != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: dropping the queued text: %s\n", __func__,
+                  rigerror(retval));
+        MORSE_LOCK(m);
+        m->len = 0;
+        MORSE_UNLOCK(m);
+        return retval;
+    }
+
+    return 1;
+}
+
+/* sends the queued text from the calling thread, paced to the keyer */
+static int morse_drain(RIG *rig, struct morse *m)
+{
+#ifdef HAVE_PTHREAD
+    int retval = RIG_OK;
+
+    pthread_mutex_lock(&m->send);
+
+    for (;;)
+    {
+        long wait_ms;
+        int len;
+
+        MORSE_LOCK(m);
+        len = m->len;
+        MORSE_UNLOCK(m);
+
+        if (len == 0)
+        {
+            break;
+        }
+
+        retval = morse_send_chunk(rig, m, &wait_ms);
+
+        if (retval < 0)
+        {
+            break;
+        }
+
+        if (retval == 0)
+        {
+            hl_usleep(wait_ms * 1000);
+        }
+
+        retval = RIG_OK;
+    }
+
+    pthread_mutex_unlock(&m->send);
+
+    return retval;
+#else
+    (void)rig;
+    (void)m;
+    return RIG_OK;
+#endif
+}
+
+int morse_wait(RIG *rig, vfo_t vfo)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+    long wait_ms = MORSE_START_MS;
+    long interval = MORSE_POLL_MIN_MS;
+    int retval;
+
+    if (m == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    retval = morse_drain(rig, m);
+
+    if (retval != RIG_OK)
+    {
+        return retval;
+    }
+
+    for (;;)
+    {
+        int event;
+        int done;
+        long remaining;
+
+        event = morse_sleep(m, wait_ms);
+
+        /* with PTT events the rig is only asked after long sleeps */
+        retval = morse_check(rig, m, vfo, !event && wait_ms >= MORSE_POLL_MAX_MS,
+                             &done);
+
+        if (retval != RIG_OK)
+        {
+            return retval;
+        }
+
+        if (done)
+        {
+            break;
+        }
+
+        MORSE_LOCK(m);
+        remaining = morse_ms_until(&m->busy_until);
+        MORSE_UNLOCK(m);
+
+        if (remaining < -MORSE_TIMEOUT_MS)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: still keyed %d ms after the estimated end\n",
+                      __func__, MORSE_TIMEOUT_MS);
+            break;
+        }
+
+        if (remaining > 2 * MORSE_POLL_MIN_MS)
+        {
+            wait_ms = remaining / 2;
+        }
+        else
+        {
+            wait_ms = interval;
+            interval = interval * 2 > MORSE_POLL_MAX_MS ? MORSE_POLL_MAX_MS : interval * 2;
+        }
+
+        rig_debug(RIG_DEBUG_TRACE, "%s: keyed, %ld ms left, next check in %ld ms\n",
+                  __func__, remaining, wait_ms);
+    }
+
+    return RIG_OK;
+}
+
+#ifdef HAVE_PTHREAD
+/* waits up to ms for a change, the lock is held */
+static void morse_worker_sleep(struct morse *m, long ms)
+{
+    struct timespec until;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    morse_timespec_add_ms(&until, ms);
+    pthread_cond_timedwait(&m->changed, &m->lock, &until);
+}
+
+static void *morse_worker(void *arg)
+{
+    struct morse *m = (struct morse *)arg;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    pthread_mutex_lock(&m->lock);
+
+    while (m->run)
+    {
+        long wait_ms;
+        int retval;
+
+        if (m->len == 0)
+        {
+            pthread_cond_wait(&m->changed, &m->lock);
+            continue;
+        }
+
+        /* the estimate needs no rig access, wait for it without the rig */
+        wait_ms = morse_ms_until(&m->busy_until) - MORSE_AHEAD_CHARS * morse_char_ms(m);
+
+        if (wait_ms > 0)
+        {
+            morse_worker_sleep(m, wait_ms);
+            continue;
+        }
+
+        pthread_mutex_unlock(&m->lock);
+
+        if (m->sync_cb) { m->sync_cb(1); }
+
+        pthread_mutex_lock(&m->send);
+        retval = morse_send_chunk(m->rig, m, &wait_ms);
+        pthread_mutex_unlock(&m->send);
+
+        if (m->sync_cb) { m->sync_cb(0); }
+
+        pthread_mutex_lock(&m->lock);
+
+        if (retval == 0 && wait_ms > 0 && m->run)
+        {
+            morse_worker_sleep(m, wait_ms);
+        }
+    }
+
+    pthread_mutex_unlock(&m->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+
+static void morse_worker_stop(struct morse *m)
+{
+    if (!m->run)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->run = 0;
+    pthread_cond_broadcast(&m->changed);
+    pthread_mutex_unlock(&m->lock);
+    pthread_join(m->thread, NULL);
+}
+#endif
+
+/* stops the worker, text still queued is dropped */
+void morse_free(RIG *rig)
+{
+    struct morse *m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    morse_worker_stop(m);
+    pthread_cond_destroy(&m->changed);
+    pthread_mutex_destroy(&m->send);
+    pthread_mutex_destroy(&m->lock);
+#endif
+
+    free(m);
+    rig->state.morse = NULL;
+}
+
+/**
+ * \brief start queueing morse text for a rig
+ * \param rig   The rig handle
+ * \param sync_cb Called with 1 before and 0 after the worker uses the rig,
+ * NULL if the application does not serialize rig calls itself
+ *
+ * Starts the worker thread for rig_send_morse_queued().  Without it, or
+ * without thread support, rig_send_morse_queued() is rig_send_morse().
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_morse_queue_stop()
+ */
+int HAMLIB_API rig_morse_queue_start(RIG *rig, void (*sync_cb)(int lock))
+{
+    struct morse *m;
+
+    ENTERFUNC;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        RETURNFUNC(-RIG_ENOMEM);
+    }
+
+#ifdef HAVE_PTHREAD
+
+    if (m->run)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+    m->sync_cb = sync_cb;
+    m->run = 1;
+
+    if (pthread_create(&m->thread, NULL, morse_worker, m))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        m->run = 0;
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
+
+#else
+    (void)sync_cb;
+#endif
+
+    RETURNFUNC(RIG_OK);
+}
+
+/**
+ * \brief stop queueing morse text for a rig
+ * \param rig   The rig handle
+ *
+ * Sends the text still queued and stops the worker.  Call it without the
+ * lock given to rig_morse_queue_start() held, the worker may wait for it.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_morse_queue_start()
+ */
+int HAMLIB_API rig_morse_queue_stop(RIG *rig)
+{
+    struct morse *m;
+    int retval = RIG_OK;
+
+    ENTERFUNC;
+
+    if (!rig || !rig->caps)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    m = (struct morse *)rig->state.morse;
+
+    if (m == NULL)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+#ifdef HAVE_PTHREAD
+
+    if (!m->run)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+    if (m->sync_cb) { m->sync_cb(1); }
+
+    if (rig->state.comm_state)
+    {
+        retval = morse_drain(rig, m);
+    }
+
+    if (m->sync_cb) { m->sync_cb(0); }
+
+    morse_worker_stop(m);
+#endif
+
+    RETURNFUNC(retval);
+}
+
+/**
+ * \brief queue morse text
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param msg   Message to be sent
+ *
+ * Like rig_send_morse() but returns as soon as the text is queued, see
+ * rig_morse_queue_start().  The text goes to the rig in chunks as the
+ * keyer runs low; rig_wait_morse() waits for all of it to be sent,
+ * rig_stop_morse() drops what is still queued.
+ *
+ * \return RIG_OK if the text is queued, -RIG_BUSBUSY if the queue has no
+ * room for it or holds text for another VFO.
+ *
+ * \sa rig_send_morse()
+ */
+int HAMLIB_API rig_send_morse_queued(RIG *rig, vfo_t vfo, const char *msg)
+{
+    struct morse *m;
+
+    if (CHECK_RIG_ARG(rig) || !msg)
+    {
+        return -RIG_EINVAL;
+    }
+
+    m = (struct morse *)rig->state.morse;
+
+#ifdef HAVE_PTHREAD
+
+    if (m != NULL && m->run)
+    {
+        int len = strlen(msg);
+
+        if (rig->caps->send_morse == NULL)
+        {
+            return -RIG_ENAVAIL;
+        }
+
+        pthread_mutex_lock(&m->lock);
+
+        if ((m->len > 0 && m->vfo != vfo) || m->len + len > MORSE_QUEUE_SIZE)
+        {
+            pthread_mutex_unlock(&m->lock);
+            rig_debug(RIG_DEBUG_WARN, "%s: no room for %d chars\n", __func__, len);
+            return -RIG_BUSBUSY;
+        }
+
+        memcpy(m->text + m->len, msg, len);
+        m->len += len;
+        m->vfo = vfo;
+        pthread_cond_broadcast(&m->changed);
+        pthread_mutex_unlock(&m->lock);
+
+        return RIG_OK;
+    }
+
+#else
+    (void)m;
+#endif
+
+    return rig_send_morse(rig, vfo, msg);
+}
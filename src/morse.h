@@ -0,0 +1,38 @@
+/*
+ *  Hamlib Interface - keyer timing and queued morse
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _MORSE_H
+#define _MORSE_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+void morse_init(RIG *rig);
+void morse_free(RIG *rig);
+void morse_sent(RIG *rig, const char *msg);
+void morse_stop(RIG *rig);
+void morse_set_wpm(RIG *rig, int wpm);
+void morse_ptt_event(RIG *rig, ptt_t ptt);
+int morse_wait(RIG *rig, vfo_t vfo);
+
+__END_DECLS
+
+#endif /* _MORSE_H */
@@ -42,6 +42,7 @@
 #include <errno.h>   /* Error number definitions */
 #include <sys/types.h>
 #include <signal.h>
+#include <time.h>
 #include <pthread.h>
 
 #ifdef HAVE_NETINET_IN_H
@@ -440,6 +441,521 @@ int network_close(hamlib_port_t *rp)
 }
 //! @endcond
 
+/*
+ * WebSocket client framing (RFC 6455) on top of a network port, for
+ * backends whose server speaks WebSocket such as TCI.  The port is opened
+ * with network_open() as usual and read and written through iofunc.c.
+ */
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+#ifdef HAVE_PTHREAD
+/* pongs from a reading thread and commands from the caller share a socket */
+static pthread_mutex_t ws_write_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* port timeouts a server may stall in the middle of a frame */
+#define WS_FRAME_TIMEOUTS 10
+
+/*
+ * The handshake key and the frame masks are meant to be unpredictable,
+ * RFC 6455 section 10.3.  The caller holds ws_write_lock.
+ */
+static void ws_random(unsigned char *buf, size_t len)
+{
+    static int fd = -2;
+    static int seeded;
+    size_t got = 0;
+
+    if (fd == -2)
+    {
+        fd = open("/dev/urandom", O_RDONLY);
+    }
+
+    while (fd >= 0 && got < len)
+    {
+        ssize_t n = read(fd, buf + got, len - got);
+
+        if (n <= 0) { break; }
+
+        got += n;
+    }
+
+    if (got == len)
+    {
+        return;
+    }
+
+    /* no /dev/urandom, e.g. on Windows */
+    if (!seeded)
+    {
+        srand((unsigned) time(NULL) ^ (unsigned) getpid());
+        seeded = 1;
+    }
+
+    for (; got < len; got++)
+    {
+        buf[got] = (unsigned char)(rand() >> 3);
+    }
+}
+
+static uint32_t ws_rol(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+/* byte i of the SHA-1 padded message */
+static unsigned char ws_sha1_byte(const unsigned char *data, size_t len,
+                                  size_t total, size_t i)
+{
+    if (i < len) { return data[i]; }
+
+    if (i == len) { return 0x80; }
+
+    if (i >= total - 8)
+    {
+        return (unsigned char)(((uint64_t) len * 8) >> (8 * (total - 1 - i)));
+    }
+
+    return 0;
+}
+
+/* SHA-1, only needed to check Sec-WebSocket-Accept */
+static void ws_sha1(const unsigned char *data, size_t len,
+                    unsigned char digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t total = ((len + 8) / 64 + 1) * 64;
+    size_t blk;
+    int i;
+
+    for (blk = 0; blk < total; blk += 64)
+    {
+        uint32_t w[80], a, b, c, d, e;
+
+        for (i = 0; i < 16; i++)
+        {
+            size_t o = blk + 4 * i;
+            w[i] = (uint32_t) ws_sha1_byte(data, len, total, o) << 24
+                   | (uint32_t) ws_sha1_byte(data, len, total, o + 1) << 16
+                   | (uint32_t) ws_sha1_byte(data, len, total, o + 2) << 8
+                   | (uint32_t) ws_sha1_byte(data, len, total, o + 3);
+        }
+
+        for (i = 16; i < 80; i++)
+        {
+            w[i] = ws_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+
+        for (i = 0; i < 80; i++)
+        {
+            uint32_t f, k, t;
+
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+            t = ws_rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = ws_rol(b, 30); b = a; a = t;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (i = 0; i < 20; i++)
+    {
+        digest[i] = (unsigned char)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static void ws_base64(const unsigned char *in, int len, char *out)
+{
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int i;
+
+    for (i = 0; i < len; i += 3)
+    {
+        uint32_t v = (uint32_t) in[i] << 16;
+
+        if (i + 1 < len) { v |= (uint32_t) in[i + 1] << 8; }
+
+        if (i + 2 < len) { v |= in[i + 2]; }
+
+        *out++ = b64[(v >> 18) & 0x3f];
+        *out++ = b64[(v >> 12) & 0x3f];
+        *out++ = i + 1 < len ? b64[(v >> 6) & 0x3f] : '=';
+        *out++ = i + 2 < len ? b64[v & 0x3f] : '=';
+    }
+
+    *out = 0;
+}
+
+/**
+ * \brief Upgrade an open network port to a WebSocket connection
+ * \param rp the port, already opened by network_open()
+ * \param resource the resource to ask for, e.g. "/"
+ *
+ * Sends the HTTP upgrade request and checks the 101 answer and its
+ * Sec-WebSocket-Accept against our key.
+ *
+ * \return RIG_OK or a negative error code
+ */
+int network_ws_handshake(hamlib_port_t *rp, const char *resource)
+{
+    unsigned char nonce[16];
+    unsigned char digest[20];
+    char key[32], accept[32], expect[32];
+    char host[256], port[6];
+    char buf[1024];
+    int got_101 = 0;
+    int ret;
+
+    ENTERFUNC2;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&ws_write_lock);
+#endif
+    ws_random(nonce, sizeof(nonce));
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&ws_write_lock);
+#endif
+
+    ws_base64(nonce, sizeof(nonce), key);
+
+    SNPRINTF(buf, sizeof(buf), "%s" WS_GUID, key);
+    ws_sha1((unsigned char *) buf, strlen(buf), digest);
+    ws_base64(digest, sizeof(digest), expect);
+
+    SNPRINTF(buf, sizeof(buf), "%s", rp->pathname);
+
+    if (parse_hoststr(buf, sizeof(buf), host, port) != RIG_OK)
+    {
+        SNPRINTF(host, sizeof(host), "localhost");
+    }
+
+    SNPRINTF(buf, sizeof(buf),
+             "GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\n"
+             "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+             "Sec-WebSocket-Version: 13\r\n\r\n", resource, host, key);
+
+    ret = write_block(rp, (unsigned char *) buf, strlen(buf));
+
+    if (ret != RIG_OK)
+    {
+        RETURNFUNC2(ret);
+    }
+
+    accept[0] = 0;
+
+    /* status line and headers, the frames start right after the blank line */
+    do
+    {
+        ret = read_string(rp, (unsigned char *) buf, sizeof(buf) - 1, "\n", 1, 0, 1);
+
+        if (ret <= 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: no handshake answer: %s\n", __func__,
+                      rigerror(ret));
+            RETURNFUNC2(ret < 0 ? ret : -RIG_EPROTO);
+        }
+
+        if (strncmp(buf, "HTTP/1.1 101", 12) == 0)
+        {
+            got_101 = 1;
+        }
+        else if (strncasecmp(buf, "Sec-WebSocket-Accept:", 21) == 0)
+        {
+            sscanf(buf + 21, " %31[^\r\n]", accept);
+        }
+    }
+    while (buf[0] != '\r' && buf[0] != '\n');
+
+    if (!got_101 || strcmp(accept, expect) != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: upgrade refused, 101=%d accept='%s'\n",
+                  __func__, got_101, accept);
+        RETURNFUNC2(-RIG_EPROTO);
+    }
+
+    RETURNFUNC2(RIG_OK);
+}
+
+/**
+ * \brief Send one masked WebSocket frame
+ * \param rp the port
+ * \param opcode NETWORK_WS_TEXT, NETWORK_WS_BINARY or a control opcode
+ * \param data payload
+ * \param len payload length
+ * \return RIG_OK or a negative error code
+ */
+int network_ws_write(hamlib_port_t *rp, int opcode, const unsigned char *data,
+                     size_t len)
+{
+    unsigned char stackbuf[512];
+    unsigned char *frame = stackbuf;
+    unsigned char mask[4];
+    size_t hdr = 2;
+    size_t i;
+    int ret;
+
+    if (len + 14 > sizeof(stackbuf))
+    {
+        frame = malloc(len + 14);
+
+        if (!frame)
+        {
+            return -RIG_ENOMEM;
+        }
+    }
+
+    frame[0] = 0x80 | (opcode & 0x0f);  /* FIN, we never fragment */
+
+    if (len < 126)
+    {
+        frame[1] = 0x80 | len;
+    }
+    else if (len < 65536)
+    {
+        frame[1] = 0x80 | 126;
+        frame[2] = len >> 8;
+        frame[3] = len & 0xff;
+        hdr = 4;
+    }
+    else
+    {
+        frame[1] = 0x80 | 127;
+
+        for (i = 0; i < 8; i++)
+        {
+            frame[2 + i] = (unsigned char)((uint64_t) len >> (56 - 8 * i));
+        }
+
+        hdr = 10;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&ws_write_lock);
+#endif
+    ws_random(mask, sizeof(mask));
+    memcpy(frame + hdr, mask, sizeof(mask));
+    hdr += 4;
+
+    for (i = 0; i < len; i++)
+    {
+        frame[hdr + i] = data[i] ^ mask[i & 3];
+    }
+
+    ret = write_block(rp, frame, hdr + len);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&ws_write_lock);
+#endif
+
+    if (frame != stackbuf)
+    {
+        free(frame);
+    }
+
+    return ret;
+}
+
+/*
+ * Reads exactly len bytes of a frame.  Once *started is set a timeout no
+ * longer means "nothing arrived", the bytes already read would be lost
+ * and the stream out of step, so keep waiting for the rest of the frame.
+ */
+static int ws_read_frame(hamlib_port_t *rp, unsigned char *buf, size_t len,
+                         int *started)
+{
+    size_t got = 0;
+    int timeouts = 0;
+
+    while (got < len)
+    {
+        int ret = read_block_partial(rp, buf + got, len - got);
+
+        if (ret == -RIG_ETIMEOUT && *started && ++timeouts < WS_FRAME_TIMEOUTS)
+        {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: waiting for the rest of the frame\n",
+                      __func__);
+            continue;
+        }
+
+        if (ret == -RIG_ETIMEOUT && *started)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: frame cut short after %d timeouts\n",
+                      __func__, timeouts);
+            return -RIG_EPROTO;
+        }
+
+        if (ret <= 0)
+        {
+            return ret < 0 ? ret : -RIG_EIO;
+        }
+
+        got += ret;
+        *started = 1;
+    }
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Read one WebSocket message
+ * \param rp the port
+ * \param buf where the payload goes, NUL terminated
+ * \param buf_len size of buf
+ * \param opcode set to the opcode of the message's first frame
+ *
+ * Fragments are joined, pings are answered and pongs skipped, so only
+ * data messages come back.  Anything beyond buf_len - 1 is dropped.
+ *
+ * A message that has started arriving is read to its end even if the
+ * server is slow, see ws_read_frame().
+ *
+ * \return the message length, -RIG_ETIMEOUT if nothing arrived, -RIG_EIO
+ * when the server closed the connection or another negative error code
+ */
+int network_ws_read(hamlib_port_t *rp, unsigned char *buf, size_t buf_len,
+                    int *opcode)
+{
+    size_t total = 0;
+    int started = 0;
+
+    *opcode = 0;
+
+    for (;;)
+    {
+        unsigned char hdr[8];
+        unsigned char mask[4];
+        unsigned char control[126];
+        uint64_t len;
+        int fin, op, masked;
+        uint64_t i;
+        int ret;
+
+        ret = ws_read_frame(rp, hdr, 2, &started);
+
+        if (ret != RIG_OK)
+        {
+            return ret;
+        }
+
+        fin = hdr[0] & 0x80;
+        op = hdr[0] & 0x0f;
+        masked = hdr[1] & 0x80;
+        len = hdr[1] & 0x7f;
+
+        if (len == 126 || len == 127)
+        {
+            int n = len == 126 ? 2 : 8;
+
+            ret = ws_read_frame(rp, hdr, n, &started);
+
+            if (ret != RIG_OK)
+            {
+                return ret;
+            }
+
+            for (len = 0, i = 0; i < (uint64_t) n; i++)
+            {
+                len = len << 8 | hdr[i];
+            }
+        }
+
+        if (masked && (ret = ws_read_frame(rp, mask, 4, &started)) != RIG_OK)
+        {
+            return ret;
+        }
+
+        if (op >= 0x8)
+        {
+            /* control frames are short and may come between fragments */
+            if (len > sizeof(control))
+            {
+                return -RIG_EPROTO;
+            }
+
+            if (len > 0 && (ret = ws_read_frame(rp, control, len, &started)) != RIG_OK)
+            {
+                return ret;
+            }
+
+            for (i = 0; masked && i < len; i++)
+            {
+                control[i] ^= mask[i & 3];
+            }
+
+            if (op == NETWORK_WS_PING)
+            {
+                network_ws_write(rp, NETWORK_WS_PONG, control, len);
+            }
+            else if (op == NETWORK_WS_CLOSE)
+            {
+                network_ws_write(rp, NETWORK_WS_CLOSE, control, len > 2 ? 2 : len);
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: server closed the connection\n", __func__);
+                return -RIG_EIO;
+            }
+
+            /* idle again unless a fragmented message is still open */
+            started = *opcode != 0;
+            continue;
+        }
+
+        if (op != NETWORK_WS_CONT)
+        {
+            *opcode = op;
+            total = 0;
+        }
+
+        for (i = 0; i < len;)
+        {
+            unsigned char skip[256];
+            uint64_t want = len - i;
+            unsigned char *dst;
+            uint64_t j;
+
+            if (total < buf_len - 1)
+            {
+                dst = buf + total;
+
+                if (want > buf_len - 1 - total) { want = buf_len - 1 - total; }
+            }
+            else
+            {
+                dst = skip;
+
+                if (want > sizeof(skip)) { want = sizeof(skip); }
+            }
+
+            ret = ws_read_frame(rp, dst, want, &started);
+
+            if (ret != RIG_OK)
+            {
+                return ret;
+            }
+
+            for (j = 0; masked && j < want; j++)
+            {
+                dst[j] ^= mask[(i + j) & 3];
+            }
+
+            if (dst != skip) { total += want; }
+
+            i += want;
+        }
+
+        if (fin)
+        {
+            buf[total] = 0;
+            return (int) total;
+        }
+    }
+}
+
 extern void sync_callback(int lock);
 
 #ifdef HAVE_PTHREAD
@@ -37,6 +37,20 @@ int network_publish_rig_spectrum_data(RIG *rig, struct rig_spectrum_line *line);
 HAMLIB_EXPORT(int) network_multicast_publisher_start(RIG *rig, const char *multicast_addr, int multicast_port, enum multicast_item_e items);
 HAMLIB_EXPORT(int) network_multicast_publisher_stop(RIG *rig);
 
+/* WebSocket opcodes */
+#define NETWORK_WS_CONT   0x0
+#define NETWORK_WS_TEXT   0x1
+#define NETWORK_WS_BINARY 0x2
+#define NETWORK_WS_CLOSE  0x8
+#define NETWORK_WS_PING   0x9
+#define NETWORK_WS_PONG   0xa
+
+int network_ws_handshake(hamlib_port_t *rp, const char *resource);
+int network_ws_write(hamlib_port_t *rp, int opcode, const unsigned char *data,
+                     size_t len);
+int network_ws_read(hamlib_port_t *rp, unsigned char *buf, size_t buf_len,
+                    int *opcode);
+
 __END_DECLS
 
 #endif /* _NETWORK_H */
@@ -0,0 +1,578 @@
+/*
+ *  Hamlib Interface - parallel rig probing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file probe.c
+ * \brief Probing serial ports for rigs, all ports at once and in bounded time
+ *
+ * The probes of the backends each open the port at every speed they know
+ * and wait out their timeouts, one backend after the other, so finding a
+ * rig took minutes.  Here a port is opened once per speed, most used
+ * speeds first, and each framing shared by several backends is asked
+ * once: "ID;" for the Kenwood style ASCII rigs, whose answer goes to the
+ * Kenwood and Elad tables, then a CI-V read transceiver ID, broadcast
+ * first and then to the known addresses, current rigs first.  Ports are
+ * probed in threads of their own and everything stops at the time limit.
+ *
+ * Models sharing an answer split its confidence.  The TS-570D and the
+ * Elecraft rigs all answer "ID017;", so those are asked "K3;", "K2;" and
+ * "OM;" too and the model the answers point to keeps the full confidence.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "probe.h"
+#include "iofunc.h"
+#include "misc.h"
+
+#define PROBE_CANDIDATES 8
+#define PROBE_DEFAULT_LIMIT_MS 20000
+
+/* most used speeds first */
+static const int probe_rates[] = { 19200, 9600, 38400, 115200, 4800, 57600, 1200, 0 };
+
+struct probe_set
+{
+    rig_probe_result_t *results;
+    int max_results;
+    int nresults;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t lock;
+#endif
+};
+
+struct probe_job
+{
+    hamlib_port_t port;
+    struct timespec start;
+    int limit_ms;
+    struct probe_set *set;
+    rig_probe_func_t cfunc;
+    rig_ptr_t data;
+    rig_model_t best;
+    int best_confidence;
+};
+
+static int probe_left_ms(struct probe_job *job)
+{
+    return job->limit_ms - (int)elapsed_ms(&job->start, HAMLIB_ELAPSED_GET);
+}
+
+static void probe_found(struct probe_job *job, rig_model_t model,
+                        int confidence)
+{
+    struct probe_set *set = job->set;
+
+    if (confidence < 1) { confidence = 1; }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %s at %d: model %u, confidence %d\n",
+              __func__, job->port.pathname, job->port.parm.serial.rate,
+              (unsigned int)model, confidence);
+
+    if (confidence > job->best_confidence)
+    {
+        job->best = model;
+        job->best_confidence = confidence;
+    }
+
+    if (job->cfunc)
+    {
+        (*job->cfunc)(&job->port, model, job->data);
+    }
+
+    if (set == NULL)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&set->lock);
+#endif
+
+    if (set->nresults < set->max_results)
+    {
+        rig_probe_result_t *r = &set->results[set->nresults++];
+
+        SNPRINTF(r->pathname, sizeof(r->pathname), "%s", job->port.pathname);
+        r->rate = job->port.parm.serial.rate;
+        r->model = model;
+        r->confidence = confidence;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&set->lock);
+#endif
+}
+
+/* drops the models listed by a backend but not built */
+static int probe_known(struct probe_candidate *cand, int n)
+{
+    int i, kept = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        if (rig_get_caps(cand[i].model) != NULL)
+        {
+            cand[kept++] = cand[i];
+        }
+    }
+
+    return kept;
+}
+
+/* ASCII command, the answer without ';' in buf, its length, 0 if none */
+static int probe_ascii_ask(struct probe_job *job, const char *cmd, char *buf,
+                           int size)
+{
+    hamlib_port_t *p = &job->port;
+    int len;
+
+    rig_flush(p);
+
+    if (write_block(p, (unsigned char *) cmd, strlen(cmd)) != RIG_OK)
+    {
+        return 0;
+    }
+
+    len = read_string(p, (unsigned char *) buf, size, ";\r", 2, 0, 1);
+
+    while (len > 0 && (buf[len - 1] == ';' || buf[len - 1] == '\r'))
+    {
+        buf[--len] = '\0';
+    }
+
+    /* "?;" is how these rigs say they do not know the command */
+    if (len <= 0 || buf[0] == '?')
+    {
+        return 0;
+    }
+
+    return len;
+}
+
+/* the TS-570D and the Elecraft rigs all answer "ID017;" */
+static rig_model_t probe_ascii_elecraft(struct probe_job *job)
+{
+    char k3[16], k2[16], om[32];
+
+    if (probe_ascii_ask(job, "K3;", k3, sizeof(k3)) > 0)
+    {
+        return kenwood_probe_elecraft(k3, NULL,
+                                      probe_ascii_ask(job, "OM;", om, sizeof(om)) > 0 ? om : NULL);
+    }
+
+    if (probe_ascii_ask(job, "K2;", k2, sizeof(k2)) > 0)
+    {
+        return kenwood_probe_elecraft(NULL, k2, NULL);
+    }
+
+    return kenwood_probe_elecraft(NULL, NULL, NULL);
+}
+
+/* Kenwood style "ID;", returns the number of models found */
+static int probe_ascii_id(struct probe_job *job)
+{
+    struct probe_candidate cand[PROBE_CANDIDATES];
+    rig_model_t model = RIG_MODEL_NONE;
+    char buf[32];
+    char *id;
+    int len, n, i;
+
+    len = probe_ascii_ask(job, "ID;", buf, sizeof(buf));
+
+    if (len < 3 || strncmp(buf, "ID", 2) != 0)
+    {
+        return 0;
+    }
+
+    id = &buf[2];
+
+    if (*id == ' ') { id++; }
+
+    n = kenwood_probe_id(id, cand, PROBE_CANDIDATES);
+    n += elad_probe_id(id, &cand[n], PROBE_CANDIDATES - n);
+    n = probe_known(cand, n);
+
+    if (n == 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: %s answers unknown ID %s\n", __func__,
+                  job->port.pathname, id);
+        return 0;
+    }
+
+    for (i = 0; i < n && n > 1; i++)
+    {
+        if (cand[i].model == RIG_MODEL_K2)
+        {
+            model = probe_ascii_elecraft(job);
+        }
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        /* the model the extra questions point to gets it all */
+        probe_found(job, cand[i].model,
+                    cand[i].model == model ? cand[i].confidence : cand[i].confidence / n);
+    }
+
+    return n;
+}
+
+/*
+ * CI-V read transceiver ID to addr, 1 if answered with the ID, 2 if with
+ * a NAK, 0 if nobody answered and -1 if that was not CI-V
+ */
+static int probe_civ_ask(struct probe_job *job, unsigned char addr,
+                         unsigned char *civ_id)
+{
+    hamlib_port_t *p = &job->port;
+    unsigned char frame[] = { 0xfe, 0xfe, addr, 0xe0, 0x19, 0x00, 0xfd };
+    unsigned char buf[32];
+    int len, i;
+
+    rig_flush(p);
+
+    if (write_block(p, frame, sizeof(frame)) != RIG_OK)
+    {
+        return 0;
+    }
+
+    /* the bus echoes what was sent */
+    for (i = 0; i < 2; i++)
+    {
+        len = read_string(p, buf, sizeof(buf), "\xfd", 1, 0, 1);
+
+        if (len <= 0)
+        {
+            return 0;
+        }
+
+        if (len < 6 || buf[0] != 0xfe || buf[1] != 0xfe)
+        {
+            return -1;
+        }
+
+        if (buf[2] != 0xe0)
+        {
+            continue;
+        }
+
+        if (buf[4] == 0xfa)
+        {
+            *civ_id = buf[3];
+            return 2;
+        }
+
+        if (len >= 8 && buf[4] == 0x19)
+        {
+            *civ_id = buf[6];
+            return 1;
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+static int probe_civ_report(struct probe_job *job, unsigned char civ_id,
+                            int answer)
+{
+    struct probe_candidate cand[PROBE_CANDIDATES];
+    int n, i;
+
+    n = icom_probe_civ_id(civ_id, cand, PROBE_CANDIDATES);
+    n = probe_known(cand, n);
+
+    if (n == 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: %s answers unknown CI-V ID %#x\n", __func__,
+                  job->port.pathname, civ_id);
+        return 0;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        /* a NAK only tells the address, which may have been changed */
+        probe_found(job, cand[i].model,
+                    cand[i].confidence * (answer == 1 ? 10 : 7) / 10 / n);
+    }
+
+    return n;
+}
+
+/* CI-V, all the rigs on the bus, returns the number of models found */
+static int probe_civ(struct probe_job *job)
+{
+    unsigned char addr[256];
+    unsigned char civ_id;
+    int naddr, found = 0;
+    int i, answer;
+
+    answer = probe_civ_ask(job, 0x00, &civ_id);
+
+    if (answer < 0)
+    {
+        return 0;
+    }
+
+    if (answer > 0)
+    {
+        return probe_civ_report(job, civ_id, answer);
+    }
+
+    naddr = icom_probe_civ_addrs(addr, sizeof(addr));
+
+    for (i = 0; i < naddr && probe_left_ms(job) > 0; i++)
+    {
+        answer = probe_civ_ask(job, addr[i], &civ_id);
+
+        if (answer < 0)
+        {
+            break;
+        }
+
+        if (answer > 0)
+        {
+            found += probe_civ_report(job, civ_id, answer);
+        }
+    }
+
+    return found;
+}
+
+static void probe_job_run(struct probe_job *job)
+{
+    hamlib_port_t *p = &job->port;
+    int i, found = 0;
+
+    for (i = 0; probe_rates[i] && !found && probe_left_ms(job) > 0; i++)
+    {
+        int retval;
+
+        p->parm.serial.rate = probe_rates[i];
+        p->timeout = 2 * 1000 / probe_rates[i] + 50;
+
+        retval = port_open(p);
+
+        if (retval != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, p->pathname,
+                      rigerror(retval));
+            return;
+        }
+
+        found = probe_ascii_id(job);
+
+        if (!found)
+        {
+            p->timeout = 2 * 1000 / probe_rates[i] + 40;
+            found = probe_civ(job);
+        }
+
+        /* all the rigs on a bus run at one speed */
+        port_close(p, RIG_PORT_SERIAL);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %s done in %.0fms\n", __func__,
+              p->pathname, elapsed_ms(&job->start, HAMLIB_ELAPSED_GET));
+}
+
+#ifdef HAVE_PTHREAD
+static void *probe_job_thread(void *arg)
+{
+    probe_job_run((struct probe_job *)arg);
+    return NULL;
+}
+#endif
+
+static void probe_job_init(struct probe_job *job, const char *pathname,
+                           int time_limit_ms)
+{
+    memset(job, 0, sizeof(*job));
+    SNPRINTF(job->port.pathname, sizeof(job->port.pathname), "%s", pathname);
+    job->port.type.rig = RIG_PORT_SERIAL;
+    job->port.parm.serial.data_bits = 8;
+    job->port.parm.serial.stop_bits = 2;
+    job->port.parm.serial.parity = RIG_PARITY_NONE;
+    job->port.parm.serial.handshake = RIG_HANDSHAKE_NONE;
+    job->port.fd = -1;
+    job->limit_ms = time_limit_ms > 0 ? time_limit_ms : PROBE_DEFAULT_LIMIT_MS;
+    elapsed_ms(&job->start, HAMLIB_ELAPSED_SET);
+}
+
+/*
+ * probe_port
+ * The shared framings on one serial port, for rig_probe() and
+ * rig_probe_all(), returns the most likely model
+ */
+int probe_port(hamlib_port_t *port, int time_limit_ms,
+               rig_probe_func_t cfunc, rig_ptr_t data)
+{
+    struct probe_job *job;
+    rig_model_t model;
+
+    if (port->type.rig != RIG_PORT_SERIAL)
+    {
+        return RIG_MODEL_NONE;
+    }
+
+    job = calloc(1, sizeof(*job));
+
+    if (job == NULL)
+    {
+        return RIG_MODEL_NONE;
+    }
+
+    probe_job_init(job, port->pathname, time_limit_ms);
+    job->cfunc = cfunc;
+    job->data = data;
+
+    probe_job_run(job);
+
+    model = job->best;
+    free(job);
+
+    return model;
+}
+
+static int probe_result_cmp(const void *a, const void *b)
+{
+    const rig_probe_result_t *ra = (const rig_probe_result_t *)a;
+    const rig_probe_result_t *rb = (const rig_probe_result_t *)b;
+
+    return rb->confidence - ra->confidence;
+}
+
+/**
+ * \brief find the rigs on serial ports
+ * \param pathnames     The serial ports to probe
+ * \param nports        Number of pathnames
+ * \param time_limit_ms Time after which probing stops, 0 for 20 s
+ * \param results       Filled with the rigs found
+ * \param max_results   Size of results
+ *
+ * Probes all the ports at once for the Kenwood style "ID;" and the Icom
+ * CI-V read transceiver ID, at the common serial speeds, and stops at the
+ * time limit.  A port answering at a speed is not tried at the others.
+ * An answer matching several models gives a result for each, their
+ * confidence split.  Backends with framings of their own are only probed
+ * by rig_probe_all().
+ *
+ * \warning Probing writes to the ports and may upset other devices there.
+ *
+ * \return the number of results, most likely first, otherwise a negative
+ * value if an error occurred.
+ *
+ * \sa rig_probe_all()
+ */
+int HAMLIB_API rig_probe_ports(const char *const *pathnames, int nports,
+                               int time_limit_ms, rig_probe_result_t *results,
+                               int max_results)
+{
+    struct probe_set set;
+    struct probe_job *jobs;
+    int i;
+#ifdef HAVE_PTHREAD
+    pthread_t *threads;
+    int *started;
+#endif
+
+    if (!pathnames || nports <= 0 || !results || max_results <= 0)
+    {
+        return -RIG_EINVAL;
+    }
+
+    jobs = calloc(nports, sizeof(jobs[0]));
+
+    if (jobs == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    memset(&set, 0, sizeof(set));
+    set.results = results;
+    set.max_results = max_results;
+
+    for (i = 0; i < nports; i++)
+    {
+        probe_job_init(&jobs[i], pathnames[i], time_limit_ms);
+        jobs[i].set = &set;
+    }
+
+#ifdef HAVE_PTHREAD
+    threads = calloc(nports, sizeof(threads[0]));
+    started = calloc(nports, sizeof(started[0]));
+
+    if (threads == NULL || started == NULL)
+    {
+        free(threads);
+        free(started);
+        free(jobs);
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_init(&set.lock, NULL);
+
+    for (i = 0; i < nports; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, probe_job_thread,
+                                    &jobs[i]) == 0;
+
+        if (!started[i])
+        {
+            /* probe it here then, within what is left */
+            probe_job_run(&jobs[i]);
+        }
+    }
+
+    for (i = 0; i < nports; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&set.lock);
+    free(threads);
+    free(started);
+#else
+
+    for (i = 0; i < nports; i++)
+    {
+        probe_job_run(&jobs[i]);
+    }
+
+#endif
+
+    free(jobs);
+
+    qsort(results, set.nresults, sizeof(results[0]), probe_result_cmp);
+
+    return set.nresults;
+}
@@ -0,0 +1,58 @@
+/*
+ *  Hamlib Interface - parallel rig probing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _PROBE_H
+#define _PROBE_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* a model an answer points to, confidence 1 to 100 */
+struct probe_candidate
+{
+    rig_model_t model;
+    int confidence;
+};
+
+/*
+ * Matchers of the shared framings, each backend knowing the answers
+ * returns its candidates, at most max of them.
+ */
+
+/* answer to "ID;" without "ID" and ';', e.g. "019" */
+int kenwood_probe_id(const char *id, struct probe_candidate *cand, int max);
+int elad_probe_id(const char *id, struct probe_candidate *cand, int max);
+/* answers to "K3;", "K2;" and "OM;" of an "ID017;" rig, NULL if none */
+rig_model_t kenwood_probe_elecraft(const char *k3, const char *k2,
+                                   const char *om);
+
+/* CI-V address of a rig, as answered to a read transceiver ID */
+int icom_probe_civ_id(unsigned char civ_id, struct probe_candidate *cand,
+                      int max);
+/* CI-V addresses worth asking, most likely first */
+int icom_probe_civ_addrs(unsigned char *addr, int max);
+
+int probe_port(hamlib_port_t *port, int time_limit_ms,
+               rig_probe_func_t cfunc, rig_ptr_t data);
+
+__END_DECLS
+
+#endif /* _PROBE_H */
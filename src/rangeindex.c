@@ -0,0 +1,371 @@
+/*
+ *  Hamlib Interface - sorted index of the frequency range lists
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file rangeindex.c
+ * \brief Sorted interval index of the rx and tx range lists of a rig
+ *
+ * Every start and end frequency of the ranges is a point of a sorted
+ * array.  Each point keeps the ranges covering the point itself and the
+ * ranges covering everything up to the next point, in the order of the
+ * lists, so rig_find_range() is a binary search and a scan of the few
+ * ranges there for the mode.  The first range in list order wins, as in
+ * rig_get_range().
+ *
+ * The tx index covers the tx range list of the selected region followed
+ * by tx_range_list1 to tx_range_list5 of the caps, the lookup the power
+ * conversions always meant to do.  The index is built by rig_init() and
+ * rig_open() and again when the "range_selected" conf changes the lists.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "rangeindex.h"
+#include "misc.h"
+
+#define RANGE_INDEX_LISTS 6
+
+struct range_index_point
+{
+    freq_t freq;
+    int at, at_count;           /* into cover, ranges including freq */
+    int after, after_count;     /* ranges including all up to the next point */
+};
+
+struct range_index
+{
+    int npoints;
+    struct range_index_point *point;
+    const freq_range_t **cover;
+};
+
+struct range_index_set
+{
+    struct range_index rx;
+    struct range_index tx;
+};
+
+static int range_index_cmp(const void *a, const void *b)
+{
+    freq_t fa = *(const freq_t *)a;
+    freq_t fb = *(const freq_t *)b;
+
+    return fa < fb ? -1 : fa > fb;
+}
+
+static void range_index_clear(struct range_index *ri)
+{
+    free(ri->point);
+    free(ri->cover);
+    memset(ri, 0, sizeof(*ri));
+}
+
+/* ranges of the lists in search order, returns their number */
+static int range_index_collect(const freq_range_t *const *lists, int nlists,
+                               const freq_range_t **range)
+{
+    int n = 0;
+    int l, i;
+
+    for (l = 0; l < nlists; l++)
+    {
+        for (i = 0; lists[l] && i < HAMLIB_FRQRANGESIZ
+                && !RIG_IS_FRNG_END(lists[l][i]); i++)
+        {
+            range[n++] = &lists[l][i];
+        }
+    }
+
+    return n;
+}
+
+static int range_index_make(struct range_index *ri,
+                            const freq_range_t *const *lists, int nlists)
+{
+    const freq_range_t *range[RANGE_INDEX_LISTS * HAMLIB_FRQRANGESIZ];
+    freq_t *freq;
+    int nranges, npoints, ncover;
+    int i, p;
+
+    range_index_clear(ri);
+
+    nranges = range_index_collect(lists, nlists, range);
+
+    if (nranges == 0)
+    {
+        return RIG_OK;
+    }
+
+    freq = calloc(2 * nranges, sizeof(freq[0]));
+
+    if (freq == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    for (i = 0; i < nranges; i++)
+    {
+        freq[2 * i] = range[i]->startf;
+        freq[2 * i + 1] = range[i]->endf;
+    }
+
+    qsort(freq, 2 * nranges, sizeof(freq[0]), range_index_cmp);
+
+    for (npoints = 0, i = 0; i < 2 * nranges; i++)
+    {
+        if (npoints == 0 || freq[i] != freq[npoints - 1])
+        {
+            freq[npoints++] = freq[i];
+        }
+    }
+
+    ri->point = calloc(npoints, sizeof(ri->point[0]));
+    ri->cover = calloc(2 * (size_t)npoints * nranges, sizeof(ri->cover[0]));
+
+    if (ri->point == NULL || ri->cover == NULL)
+    {
+        free(freq);
+        range_index_clear(ri);
+        return -RIG_ENOMEM;
+    }
+
+    ncover = 0;
+
+    for (p = 0; p < npoints; p++)
+    {
+        struct range_index_point *pt = &ri->point[p];
+
+        pt->freq = freq[p];
+        pt->at = ncover;
+
+        for (i = 0; i < nranges; i++)
+        {
+            if (range[i]->startf <= pt->freq && pt->freq <= range[i]->endf)
+            {
+                ri->cover[ncover++] = range[i];
+            }
+        }
+
+        pt->at_count = ncover - pt->at;
+        pt->after = ncover;
+
+        /* ends are points, a range past this one reaches the next point */
+        for (i = 0; i < nranges; i++)
+        {
+            if (range[i]->startf <= pt->freq && pt->freq < range[i]->endf)
+            {
+                ri->cover[ncover++] = range[i];
+            }
+        }
+
+        pt->after_count = ncover - pt->after;
+    }
+
+    ri->npoints = npoints;
+    free(freq);
+
+    /* allocated for the worst case, keep what is used */
+    if (ncover > 0)
+    {
+        const freq_range_t **cover = realloc(ri->cover, ncover * sizeof(ri->cover[0]));
+
+        if (cover != NULL)
+        {
+            ri->cover = cover;
+        }
+    }
+
+    return RIG_OK;
+}
+
+static const freq_range_t *range_index_find(const struct range_index *ri,
+        freq_t freq, rmode_t mode)
+{
+    const struct range_index_point *pt;
+    int lo = 0, hi = ri->npoints - 1;
+    int first, count, i;
+
+    if (ri->npoints == 0 || freq < ri->point[0].freq)
+    {
+        return NULL;
+    }
+
+    /* last point not above freq */
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if (ri->point[mid].freq <= freq)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    pt = &ri->point[lo];
+
+    if (pt->freq == freq)
+    {
+        first = pt->at;
+        count = pt->at_count;
+    }
+    else
+    {
+        first = pt->after;
+        count = pt->after_count;
+    }
+
+    for (i = first; i < first + count; i++)
+    {
+        if (ri->cover[i]->modes & mode)
+        {
+            return ri->cover[i];
+        }
+    }
+
+    return NULL;
+}
+
+int range_index_build(RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+    const struct rig_caps *caps = rig->caps;
+    struct range_index_set *set = (struct range_index_set *)rs->range_index;
+    const freq_range_t *rx[1];
+    const freq_range_t *tx[RANGE_INDEX_LISTS];
+    int retval;
+
+    if (set == NULL)
+    {
+        set = calloc(1, sizeof(*set));
+
+        if (set == NULL)
+        {
+            return -RIG_ENOMEM;
+        }
+
+        rs->range_index = set;
+    }
+
+    rx[0] = rs->rx_range_list;
+    tx[0] = rs->tx_range_list;
+    tx[1] = caps->tx_range_list1;
+    tx[2] = caps->tx_range_list2;
+    tx[3] = caps->tx_range_list3;
+    tx[4] = caps->tx_range_list4;
+    tx[5] = caps->tx_range_list5;
+
+    retval = range_index_make(&set->rx, rx, 1);
+
+    if (retval == RIG_OK)
+    {
+        retval = range_index_make(&set->tx, tx, RANGE_INDEX_LISTS);
+    }
+
+    if (retval != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s, searching the lists\n", __func__,
+                  rigerror(retval));
+        range_index_free(rig);
+        return retval;
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: %d rx and %d tx points\n", __func__,
+              set->rx.npoints, set->tx.npoints);
+
+    return RIG_OK;
+}
+
+void range_index_free(RIG *rig)
+{
+    struct range_index_set *set = (struct range_index_set *)
+                                  rig->state.range_index;
+
+    if (set == NULL)
+    {
+        return;
+    }
+
+    range_index_clear(&set->rx);
+    range_index_clear(&set->tx);
+    free(set);
+    rig->state.range_index = NULL;
+}
+
+/**
+ * \brief find the rx or tx range of a rig including freq and mode
+ * \param rig   The rig handle
+ * \param tx    0 for the rx ranges, 1 for the tx ranges
+ * \param freq  The frequency that will be part of this range
+ * \param mode  The mode that will be part of this range
+ *
+ * Like rig_get_range() on the rx_range_list or tx_range_list of the rig
+ * state, but a binary search.  The tx ranges of all regions of the caps
+ * are searched after the selected ones.
+ *
+ * \return the location of the #freq_range_t if found, otherwise NULL.
+ *
+ * \sa rig_get_range()
+ */
+const freq_range_t *HAMLIB_API rig_find_range(RIG *rig, int tx, freq_t freq,
+        rmode_t mode)
+{
+    const struct range_index_set *set;
+    const freq_range_t *range;
+
+    if (!rig || !rig->caps)
+    {
+        return NULL;
+    }
+
+    set = (const struct range_index_set *)rig->state.range_index;
+
+    if (set != NULL)
+    {
+        return range_index_find(tx ? &set->tx : &set->rx, freq, mode);
+    }
+
+    /* no index, search the lists */
+    if (!tx)
+    {
+        return rig_get_range(rig->state.rx_range_list, freq, mode);
+    }
+
+    range = rig_get_range(rig->state.tx_range_list, freq, mode);
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list1, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list2, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list3, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list4, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list5, freq, mode); }
+
+    return range;
+}
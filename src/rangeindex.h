@@ -0,0 +1,33 @@
+/*
+ *  Hamlib Interface - sorted index of the frequency range lists
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _RANGEINDEX_H
+#define _RANGEINDEX_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+int range_index_build(RIG *rig);
+void range_index_free(RIG *rig);
+
+__END_DECLS
+
+#endif /* _RANGEINDEX_H */
@@ -37,6 +37,7 @@
 
 #include <hamlib/rig.h>
 #include "misc.h"
+#include "probe.h"
 
 //! @cond Doxygen_Suppress
 #ifndef PATH_MAX
@@ -468,6 +469,17 @@ static int dummy_rig_probe(const hamlib_port_t *p,
 //! @endcond
 
 
+/*
+ * backends whose probe is done once for all by probe_port()
+ */
+//! @cond Doxygen_Suppress
+static int rig_probe_shared(int be_num)
+{
+    return be_num == RIG_KENWOOD || be_num == RIG_ICOM || be_num == RIG_ELAD;
+}
+//! @endcond
+
+
 /*
  * rig_probe_first
  * called straight by rig_probe
@@ -478,9 +490,17 @@ rig_model_t rig_probe_first(hamlib_port_t *p)
     int i;
     rig_model_t model;
 
+    model = probe_port(p, 0, dummy_rig_probe, (rig_ptr_t)NULL);
+
+    if (model != RIG_MODEL_NONE)
+    {
+        return model;
+    }
+
     for (i = 0; i < RIG_BACKEND_MAX && rig_backend_list[i].be_name; i++)
     {
-        if (rig_backend_list[i].be_probe_all)
+        if (rig_backend_list[i].be_probe_all
+                && !rig_probe_shared(rig_backend_list[i].be_num))
         {
             model = (*rig_backend_list[i].be_probe_all)(p, dummy_rig_probe,
                     (rig_ptr_t)NULL);
@@ -509,9 +529,12 @@ int rig_probe_all_backends(hamlib_port_t *p,
 {
     int i;
 
+    probe_port(p, 0, cfunc, data);
+
     for (i = 0; i < RIG_BACKEND_MAX && rig_backend_list[i].be_name; i++)
     {
-        if (rig_backend_list[i].be_probe_all)
+        if (rig_backend_list[i].be_probe_all
+                && !rig_probe_shared(rig_backend_list[i].be_num))
         {
             (*rig_backend_list[i].be_probe_all)(p, cfunc, data);
         }
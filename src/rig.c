@@ -75,6 +75,15 @@
 #include "sprintflst.h"
 #include "hamlibdatetime.h"
 #include "cache.h"
+#include "spectrum_ring.h"
+#include "spectrum_proc.h"
+#include "async_set.h"
+#include "rig_worker.h"
+#include "morse.h"
+#include "rangeindex.h"
+#include "statefile.h"
+#include "rig_stats.h"
+#include "ioreactor.h"
 
 /**
  * \brief Hamlib release number
@@ -559,6 +568,14 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
     rs = &rig->state;
 #ifdef HAVE_PTHREAD
     pthread_mutex_init(&rs->mutex_set_transaction, NULL);
+    {
+        pthread_mutexattr_t attr;
+
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&rs->mutex_cache, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
 #endif
 
     rs->rig_model = caps->rig_model;
@@ -568,6 +585,8 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
     rs->pttport.fd = -1;
     rs->comm_state = 0;
     rig->state.depth = 1;
+    rig_stats_init(rig);
+    morse_init(rig);
 #if 0 // extra debug if needed
     rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): %p rs->comm_state==0?=%d\n", __func__,
               __LINE__, &rs->comm_state,
@@ -648,6 +667,20 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
         rs->rigport.timeout_retry = caps->timeout_retry;
     }
 
+    if (caps->write_through < 0)
+    {
+        // Rigs that round or reject values are read back right after a set
+        rs->write_through_ms = 0;
+    }
+    else if (caps->write_through == 0)
+    {
+        rs->write_through_ms = 200;
+    }
+    else
+    {
+        rs->write_through_ms = caps->write_through;
+    }
+
     rs->pttport.type.ptt = caps->ptt_type;
     rs->dcdport.type.dcd = caps->dcd_type;
 
@@ -830,10 +863,137 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
         }
     }
 
+    range_index_build(rig);
+
     return (rig);
 }
 
 
+//! @cond Doxygen_Suppress
+/* serial speeds tried by "auto_baud", fastest first */
+static const int rig_serial_rates[] =
+{
+    115200, 57600, 38400, 19200, 9600, 4800, 2400, 1200, 0
+};
+
+static int rig_serial_rate_ok(const struct rig_caps *caps, int rate)
+{
+    return caps->serial_rate_max == 0
+           || (rate >= caps->serial_rate_min && rate <= caps->serial_rate_max);
+}
+
+static int rig_serial_rate_switch(RIG *rig, int rate)
+{
+    hamlib_port_t *rp = &rig->state.rigport;
+    int retval;
+
+    rp->parm.serial.rate = rate;
+    retval = serial_setup(rp);
+    rig_flush(rp);
+
+    return retval;
+}
+
+/*
+ * The backend open got no answer at the configured speed, tries it at
+ * the other speeds of the caps.  Returns the status of the last try.
+ */
+static int rig_open_find_rate(RIG *rig, int status)
+{
+    const struct rig_caps *caps = rig->caps;
+    int configured = rig->state.rigport.parm.serial.rate;
+    int i;
+
+    for (i = 0; rig_serial_rates[i]; i++)
+    {
+        int rate = rig_serial_rates[i];
+
+        if (rate == configured || !rig_serial_rate_ok(caps, rate)
+                || rig_serial_rate_switch(rig, rate) != RIG_OK)
+        {
+            continue;
+        }
+
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: trying %d\n", __func__, rate);
+        status = caps->rig_open(rig);
+
+        if (status == RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: rig answers at %d, not at %d\n",
+                      __func__, rate, configured);
+            return RIG_OK;
+        }
+    }
+
+    rig_serial_rate_switch(rig, configured);
+
+    return status;
+}
+
+/*
+ * Switches the rig and the port to the fastest speed the backend can set,
+ * back to the old speed when the rig does not answer at the new one.
+ */
+static void rig_open_speed_up(RIG *rig)
+{
+    const struct rig_caps *caps = rig->caps;
+    hamlib_port_t *rp = &rig->state.rigport;
+    int from = rp->parm.serial.rate;
+    int i;
+
+    for (i = 0; rig_serial_rates[i] > from; i++)
+    {
+        int rate = rig_serial_rates[i];
+        freq_t freq;
+
+        if (!rig_serial_rate_ok(caps, rate) || caps->set_serial_rate(rig, rate) != RIG_OK)
+        {
+            continue;
+        }
+
+        hl_usleep(50 * 1000); // the rig needs a moment to switch
+        rig_serial_rate_switch(rig, rate);
+
+        if (caps->get_freq == NULL || caps->get_freq(rig, RIG_VFO_CURR, &freq) == RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: switched from %d to %d\n", __func__,
+                      from, rate);
+            return;
+        }
+
+        /*
+         * The rig may have switched and only the check failed, so tell it
+         * to go back while the port still talks at the new speed.
+         */
+        rig_debug(RIG_DEBUG_WARN, "%s: no answer at %d, back to %d\n", __func__,
+                  rate, from);
+        caps->set_serial_rate(rig, from);
+        hl_usleep(50 * 1000);
+        rig_serial_rate_switch(rig, from);
+
+        if (caps->get_freq(rig, RIG_VFO_CURR, &freq) == RIG_OK)
+        {
+            return;
+        }
+
+        /* the rig did not take the way back, so it must still be at rate */
+        rig_serial_rate_switch(rig, rate);
+
+        if (caps->get_freq(rig, RIG_VFO_CURR, &freq) == RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: rig stays at %d\n", __func__, rate);
+            return;
+        }
+
+        rig_debug(RIG_DEBUG_ERR, "%s: no answer at %d or %d\n", __func__, from,
+                  rate);
+        rig_serial_rate_switch(rig, from);
+        return;
+    }
+}
+//! @endcond
+
+
 /**
  * \brief open the communication to the rig
  * \param rig   The #RIG handle of the radio to be opened
@@ -858,6 +1018,8 @@ int HAMLIB_API rig_open(RIG *rig)
     value_t parm_value;
     //unsigned int net1, net2, net3, net4, net5, net6, net7, net8, port;
     int is_network = 0;
+    struct state_file sf;
+    int have_state;
 
     ENTERFUNC2;
 
@@ -1287,6 +1449,13 @@ int HAMLIB_API rig_open(RIG *rig)
         RETURNFUNC2(status);
     }
 
+    if (rs->spectrum_shm_name && !rs->spectrum_ring)
+    {
+        // readers just see no ring, not worth failing the open for
+        spectrum_ring_create(rs->spectrum_shm_name,
+                             (struct spectrum_ring **) &rs->spectrum_ring);
+    }
+
     status = async_data_handler_start(rig);
 
     if (status < 0)
@@ -1297,11 +1466,19 @@ int HAMLIB_API rig_open(RIG *rig)
 
     add_opened_rig(rig);
 
+    rs->vfo_parked = RIG_VFO_NONE;
     rs->comm_state = 1;
     rig_debug(RIG_DEBUG_VERBOSE, "%s: %p rs->comm_state==1?=%d\n", __func__,
               &rs->comm_state,
               rs->comm_state);
-    hl_usleep(100 * 1000); // wait a bit after opening to give some serial ports time
+    have_state = state_file_read(rig, &sf);
+
+    // a network rig is known to answer when its state was saved last time
+    if (!have_state || (rs->rigport.type.rig != RIG_PORT_NETWORK
+                        && rs->rigport.type.rig != RIG_PORT_UDP_NETWORK))
+    {
+        hl_usleep(100 * 1000); // wait a bit after opening to give some serial ports time
+    }
 
     /*
      * Maybe the backend has something to initialize
@@ -1340,6 +1517,12 @@ int HAMLIB_API rig_open(RIG *rig)
 
         status = caps->rig_open(rig);
 
+        if (status != RIG_OK && rs->auto_baud
+                && rs->rigport.type.rig == RIG_PORT_SERIAL)
+        {
+            status = rig_open_find_rate(rig, status);
+        }
+
         if (status != RIG_OK)
         {
             remove_opened_rig(rig);
@@ -1351,6 +1534,18 @@ int HAMLIB_API rig_open(RIG *rig)
         }
     }
 
+    if (rs->auto_baud == 2 && caps->set_serial_rate
+            && rs->rigport.type.rig == RIG_PORT_SERIAL)
+    {
+        rig_open_speed_up(rig);
+    }
+
+    // the reads below are answered from the saved state
+    if (have_state)
+    {
+        state_file_apply(rig, &sf);
+    }
+
     /*
      * trigger state->current_vfo first retrieval
      */
@@ -1445,6 +1640,9 @@ int HAMLIB_API rig_open(RIG *rig)
 
     rs->rigport.retry = retry_save;
 
+    /* the backend may have changed the range lists */
+    range_index_build(rig);
+
     memcpy(&rs->rigport_deprecated, &rs->rigport, sizeof(hamlib_port_t_deprecated));
     memcpy(&rs->pttport_deprecated, &rs->pttport, sizeof(hamlib_port_t_deprecated));
     memcpy(&rs->dcdport_deprecated, &rs->dcdport, sizeof(hamlib_port_t_deprecated));
@@ -1485,6 +1683,8 @@ int HAMLIB_API rig_close(RIG *rig)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    state_file_write(rig);
+
     /*
      * Let the backend say 73s to the rig.
      * and ignore the return code.
@@ -1496,6 +1696,10 @@ int HAMLIB_API rig_close(RIG *rig)
 
     async_data_handler_stop(rig);
 
+    spectrum_ring_detach(rs->spectrum_ring);
+    rs->spectrum_ring = NULL;
+    spectrum_proc_free(rig);
+
     /*
      * FIXME: what happens if PTT and rig ports are the same?
      *          (eg. ptt_type = RIG_PTT_SERIAL)
@@ -1632,6 +1836,13 @@ int HAMLIB_API rig_cleanup(RIG *rig)
         return (-RIG_EINVAL);
     }
 
+    /* sets and text still queued are dropped, rig_async_set_stop() and
+     * rig_morse_queue_stop() send them */
+    rig_worker_free(rig);
+    async_set_free(rig);
+    morse_free(rig);
+    range_index_free(rig);
+
     /*
      * check if they forgot to close the rig
      */
@@ -1648,6 +1859,9 @@ int HAMLIB_API rig_cleanup(RIG *rig)
         rig->caps->rig_cleanup(rig);
     }
 
+    free(rig->state.spectrum_shm_name);
+    free(rig->state.state_file);
+    rig_stats_free(rig);
     free(rig);
 
     return (RIG_OK);
@@ -1780,6 +1994,140 @@ static int twiddling(RIG *rig)
     RETURNFUNC2(0);
 }
 
+/*
+ * VFO planner for calls on a VFO the rig cannot target.  Those select the
+ * VFO, do the call and select current_vfo again.  With "vfo_swap_hold"
+ * the swap back is left out, so the next call on the same VFO needs no
+ * swap at all and a call on another VFO swaps there directly.  The VFO
+ * is swapped back by the next call that works on current_vfo, by any
+ * other API call (see ENTERFUNC) or by rig_vfo_settle() once the rig is
+ * idle for vfo_swap_hold_ms.
+ */
+static int vfo_plan_select(RIG *rig, vfo_t vfo)
+{
+    struct rig_state *rs = &rig->state;
+    int retcode;
+
+    if (rs->vfo_parked != RIG_VFO_NONE)
+    {
+        if (rs->vfo_parked == vfo)
+        {
+            /* neither the swap back nor this swap, vfo_plan_restore()
+             * leaves it selected again */
+            rs->vfo_parked = RIG_VFO_NONE;
+            rig_stats_vfo_swap(rig, 0, 2);
+            return RIG_OK;
+        }
+
+        /* straight to the next VFO, the swap back is not needed */
+        rs->vfo_parked = RIG_VFO_NONE;
+        rig_stats_vfo_swap(rig, 0, 1);
+    }
+
+    HAMLIB_TRACE;
+    retcode = rig->caps->set_vfo(rig, vfo);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_vfo_swap(rig, 1, 0);
+    }
+
+    return retcode;
+}
+
+static int vfo_plan_restore(RIG *rig, vfo_t vfo, vfo_t curr_vfo)
+{
+    struct rig_state *rs = &rig->state;
+    int retcode;
+
+    if (rs->vfo_swap_hold_ms > 0 && vfo != curr_vfo)
+    {
+        /* callers keep seeing curr_vfo, the rig is on vfo until settled */
+        rs->current_vfo = curr_vfo;
+        rs->vfo_parked = vfo;
+        rs->vfo_parked_back = curr_vfo;
+        rs->vfo_parked_depth = rs->depth;
+        elapsed_ms(&rs->vfo_parked_time, HAMLIB_ELAPSED_SET);
+        return RIG_OK;
+    }
+
+    HAMLIB_TRACE;
+    retcode = rig->caps->set_vfo(rig, curr_vfo);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_vfo_swap(rig, 1, 0);
+    }
+
+    return retcode;
+}
+
+/* a call about to work on the current VFO needs it selected again */
+static void vfo_plan_direct(RIG *rig, vfo_t vfo)
+{
+    if (rig->state.vfo_parked != RIG_VFO_NONE && vfo != rig->state.vfo_parked)
+    {
+        rig_vfo_settle(rig, 1);
+    }
+}
+
+/**
+ * \brief swap back a VFO left selected by the VFO planner
+ * \param rig   The rig handle
+ * \param force Swap back now, otherwise only once the rig is idle for
+ * vfo_swap_hold_ms
+ *
+ * With the "vfo_swap_hold" conf, a VFO selected for a call on a VFO the
+ * rig cannot target stays selected for the next such call.  Applications
+ * call this from time to time while idle so the rig shows current_vfo
+ * again; any other call swaps back by itself.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ */
+int HAMLIB_API rig_vfo_settle(RIG *rig, int force)
+{
+    struct rig_state *rs;
+    vfo_t back;
+    int retcode;
+
+    if (!rig || !rig->caps)
+    {
+        return -RIG_EINVAL;
+    }
+
+    rs = &rig->state;
+
+    if (rs->vfo_parked == RIG_VFO_NONE)
+    {
+        return RIG_OK;
+    }
+
+    if (!force
+            && elapsed_ms(&rs->vfo_parked_time, HAMLIB_ELAPSED_GET) < rs->vfo_swap_hold_ms)
+    {
+        return RIG_OK;
+    }
+
+    ENTERFUNC_VFO_PLAN;
+
+    back = rs->vfo_parked_back;
+    rs->vfo_parked = RIG_VFO_NONE;
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: swapping back to %s\n", __func__,
+              rig_strvfo(back));
+
+    HAMLIB_TRACE;
+    retcode = rig->caps->set_vfo(rig, back);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_vfo_swap(rig, 1, 0);
+    }
+
+    RETURNFUNC(retcode);
+}
+
 /**
  * \brief set the frequency of the target VFO
  * \param rig   The rig handle
@@ -1806,9 +2154,10 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
     int retcode;
     freq_t freq_new = freq;
     vfo_t vfo_save;
+    int planned = 0;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
     LOCK(1);
 #if BUILTINFUNC
     rig_debug(RIG_DEBUG_VERBOSE, "%s called vfo=%s, freq=%.0f, called from %s\n",
@@ -1879,6 +2228,8 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
     if ((caps->targetable_vfo & RIG_TARGETABLE_FREQ)
             || vfo == RIG_VFO_CURR || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
+
         if (twiddling(rig))
         {
             rig_debug(RIG_DEBUG_TRACE, "%s: Ignoring set_freq due to VFO twiddling\n",
@@ -1957,6 +2308,8 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
     }
     else
     {
+        int rc2;
+
         rig_debug(RIG_DEBUG_TRACE, "%s: not a TARGETABLE_FREQ vfo=%s\n", __func__,
                   rig_strvfo(vfo));
 
@@ -1967,25 +2320,25 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
             RETURNFUNC(-RIG_ENAVAIL);
         }
 
-        retcode = rig_set_vfo(rig, vfo);
+        HAMLIB_TRACE;
+        retcode = vfo_plan_select(rig, vfo);
 
         if (retcode != RIG_OK)
         {
             rig_debug(RIG_DEBUG_ERR, "%s: set_vfo failed: %s\n", __func__,
                       rigerror(retcode));
+            ELAPSED2;
+            LOCK(0);
+            RETURNFUNC(retcode);
         }
 
-
         if (twiddling(rig))
         {
             rig_debug(RIG_DEBUG_TRACE, "%s: Ignoring set_freq due to VFO twiddling\n",
                       __func__);
 
-            if (vfo != vfo_save && vfo != RIG_VFO_CURR)
-            {
-                HAMLIB_TRACE;
-                rig_set_vfo(rig, vfo_save);
-            }
+            HAMLIB_TRACE;
+            vfo_plan_restore(rig, vfo, vfo_save);
 
             ELAPSED2;
             LOCK(0);
@@ -1995,6 +2348,15 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 
         HAMLIB_TRACE;
         retcode = caps->set_freq(rig, vfo, freq);
+        /* try and revert even if we had an error above */
+        rc2 = vfo_plan_restore(rig, vfo, vfo_save);
+        planned = 1;
+
+        if (retcode == RIG_OK)
+        {
+            /* return the first error code */
+            retcode = rc2;
+        }
     }
 
     if (retcode == RIG_OK && caps->get_freq != NULL)
@@ -2019,21 +2381,30 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
                 LOCK(0);
                 RETURNFUNC(RIG_OK);
             }
-            // Unidirectional rigs do not reset cache
-            if (rig->caps->rig_model != RIG_MODEL_FT736R)
+            // write-through: readers get the asked freq from the cache
+            // and rig_get_freq reads it back once write_through_ms passed
+            if (rig->state.write_through_ms > 0)
             {
-                rig_set_cache_freq(rig, RIG_VFO_ALL, (freq_t)0);
+                rig->state.verify_freq |= vfo == RIG_VFO_CURR ? rig->state.current_vfo : vfo;
             }
+            else
+            {
+                // Unidirectional rigs do not reset cache
+                if (rig->caps->rig_model != RIG_MODEL_FT736R)
+                {
+                    rig_set_cache_freq(rig, RIG_VFO_ALL, (freq_t)0);
+                }
 
-            HAMLIB_TRACE;
+                HAMLIB_TRACE;
 
-            retcode = rig_get_freq(rig, vfo, &freq_new);
+                retcode = rig_get_freq(rig, vfo, &freq_new);
 
-            if (retcode != RIG_OK)
-            {
-                ELAPSED2;
-                LOCK(0);
-                RETURNFUNC(retcode);
+                if (retcode != RIG_OK)
+                {
+                    ELAPSED2;
+                    LOCK(0);
+                    RETURNFUNC(retcode);
+                }
             }
         }
 
@@ -2051,7 +2422,7 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 
     rig_set_cache_freq(rig, vfo, freq_new);
 
-    if (vfo != RIG_VFO_CURR)
+    if (vfo != RIG_VFO_CURR && !planned)
     {
         HAMLIB_TRACE;
         rig_set_vfo(rig, vfo_save);
@@ -2063,6 +2434,50 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
 }
 
 
+/*
+ * The cache decisions of rig_get_freq(), shared with rig_get_freq_cached().
+ * vfo is resolved, the caller holds the cache lock.
+ */
+
+// we ignore get_freq for the uplink VFO for gpredict to behave better
+static int freq_uplink_ignored(const RIG *rig, vfo_t vfo)
+{
+    return (rig->state.uplink == 1 && vfo == RIG_VFO_SUB)
+           || (rig->state.uplink == 2 && vfo == RIG_VFO_MAIN)
+           || (vfo == RIG_VFO_TX && rig->state.cache.ptt == 0);
+}
+
+// there are some rigs that can't get VFOA freq while VFOB is transmitting
+// so we'll return the cached VFOA freq for them
+static int freq_needs_ptt(const RIG *rig, vfo_t vfo)
+{
+    return (vfo == RIG_VFO_A || vfo == RIG_VFO_MAIN) && rig->state.cache.split &&
+           (rig->caps->rig_model == RIG_MODEL_FTDX101D
+            || rig->caps->rig_model == RIG_MODEL_IC910);
+}
+
+// a written through freq is read back once write_through_ms passed
+static int freq_verify_due(const RIG *rig, vfo_t vfo, int cache_ms_freq)
+{
+    return (rig->state.verify_freq & vfo)
+           && cache_ms_freq >= rig->state.write_through_ms;
+}
+
+static int freq_cache_hit(const RIG *rig, vfo_t vfo, freq_t freq,
+                          int cache_ms_freq)
+{
+    // WSJT-X senses rig precision with 55 and 56 Hz values
+    // We do not want to allow cache response with these values
+    int wsjtx_special = ((long)freq % 100) == 55 || ((long)freq % 100) == 56;
+
+    return !wsjtx_special && freq != 0
+           && ((cache_ms_freq < rig->state.cache.timeout_ms
+                && !freq_verify_due(rig, vfo, cache_ms_freq))
+               || rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
+               || rig->state.use_cached_freq);
+}
+
+
 /**
  * \brief get the frequency of the target VFO
  * \param rig   The rig handle
@@ -2093,7 +2508,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
     rmode_t mode;
     pbwidth_t width;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 #if BUILTINFUNC
     rig_debug(RIG_DEBUG_VERBOSE, "%s called vfo=%s, called from %s\n",
               __func__,
@@ -2130,10 +2545,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 
     if (vfo == RIG_VFO_CURR) { vfo = curr_vfo; }
 
-    // we ignore get_freq for the uplink VFO for gpredict to behave better
-    if ((rig->state.uplink == 1 && vfo == RIG_VFO_SUB)
-            || (rig->state.uplink == 2 && vfo == RIG_VFO_MAIN)
-            || (vfo == RIG_VFO_TX && rig->state.cache.ptt == 0))
+    if (freq_uplink_ignored(rig, vfo))
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: uplink=%d, ignoring get_freq\n", __func__,
                   rig->state.uplink);
@@ -2161,12 +2573,8 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 
 
 
-    // there are some rigs that can't get VFOA freq while VFOB is transmitting
-    // so we'll return the cached VFOA freq for them
     // should we use the cached ptt maybe? No -- we have to be 100% sure we're in PTT to ignore this request
-    if ((vfo == RIG_VFO_A || vfo == RIG_VFO_MAIN) && rig->state.cache.split &&
-            (rig->caps->rig_model == RIG_MODEL_FTDX101D
-             || rig->caps->rig_model == RIG_MODEL_IC910))
+    if (freq_needs_ptt(rig, vfo))
     {
         // if we're in PTT don't get VFOA freq -- otherwise we interrupt transmission
         ptt_t ptt;
@@ -2199,16 +2607,15 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 
     rig_cache_show(rig, __func__, __LINE__);
 
-    // WSJT-X senses rig precision with 55 and 56 Hz values
-    // We do not want to allow cache response with these values 
-    int wsjtx_special = ((long)*freq % 100)==55 || ((long)*freq % 100)==56;
-    if (!wsjtx_special && *freq != 0 && (cache_ms_freq < rig->state.cache.timeout_ms
-                       || (rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
-                           || rig->state.use_cached_freq)))
+    freq_t freq_asked = *freq;
+    int verify_due = freq_verify_due(rig, vfo, cache_ms_freq);
+
+    if (freq_cache_hit(rig, vfo, *freq, cache_ms_freq))
     {
         rig_debug(RIG_DEBUG_TRACE,
                   "%s: %s cache hit age=%dms, freq=%.0f, use_cached_freq=%d\n", __func__,
                   rig_strvfo(vfo), cache_ms_freq, *freq, rig->state.use_cached_freq);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_FREQ, 1);
         ELAPSED2;
         LOCK(0);
         RETURNFUNC(RIG_OK);
@@ -2220,6 +2627,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
                   __func__,
                   cache_ms_freq,
                   rig_strvfo(vfo), rig_strvfo(vfo), rig->state.use_cached_freq);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_FREQ, 0);
     }
 
     caps = rig->caps;
@@ -2239,6 +2647,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
             || vfo == RIG_VFO_CURR || vfo == rig->state.current_vfo
             || (rig->state.vfo_opt == 1 && rig->caps->rig_model == RIG_MODEL_NETRIGCTL))
     {
+        vfo_plan_direct(rig, vfo);
         // If rig does not have set_vfo we need to change vfo
         if (vfo == RIG_VFO_CURR && caps->set_vfo == NULL)
         {
@@ -2277,7 +2686,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
         }
 
         HAMLIB_TRACE;
-        retcode = caps->set_vfo(rig, vfo);
+        retcode = vfo_plan_select(rig, vfo);
 
         if (retcode != RIG_OK)
         {
@@ -2295,7 +2704,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
 
         if (curr_vfo != RIG_VFO_NONE)
         {
-            rc2 = caps->set_vfo(rig, curr_vfo);
+            rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
         }
 
         if (RIG_OK == retcode)
@@ -2328,6 +2737,14 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
     if (retcode == RIG_OK)
     {
         rig_cache_show(rig, __func__, __LINE__);
+
+        if (verify_due && *freq != freq_asked)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: %s asked freq=%.0f, rig has freq=%.0f\n",
+                      __func__, rig_strvfo(vfo), freq_asked, *freq);
+        }
+
+        rig->state.verify_freq &= ~vfo;
     }
 
     rig_set_cache_freq(rig, vfo, *freq);
@@ -2342,6 +2759,63 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
     RETURNFUNC(retcode);
 }
 
+
+/**
+ * \brief get the frequency of the target VFO from the cache only
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param freq  The location where to store the current frequency
+ *
+ *  Answers when rig_get_freq() would answer from the cache, without
+ *  talking to the rig.  The cache is read and the decision made under
+ *  the cache lock, so a client thread can call this while another one
+ *  is in the middle of a command.
+ *
+ * \return RIG_OK if the cache answered, -RIG_ENAVAIL if rig_get_freq()
+ * has to ask the rig, otherwise a negative value if an error occurred.
+ *
+ * \sa rig_get_freq()
+ */
+int HAMLIB_API rig_get_freq_cached(RIG *rig, vfo_t vfo, freq_t *freq)
+{
+    freq_t cached;
+    rmode_t mode;
+    pbwidth_t width;
+    int cache_ms_freq, cache_ms_mode, cache_ms_width;
+    int retcode;
+
+    if (CHECK_RIG_ARG(rig) || !freq)
+    {
+        return -RIG_EINVAL;
+    }
+
+    rig_cache_lock(rig, 1);
+
+    vfo = vfo_fixup(rig, vfo, rig->state.cache.split);
+
+    if (vfo == RIG_VFO_CURR) { vfo = rig->state.current_vfo; }
+
+    retcode = rig_get_cache(rig, vfo, &cached, &cache_ms_freq, &mode,
+                            &cache_ms_mode, &width, &cache_ms_width);
+
+    if (retcode == RIG_OK && !freq_uplink_ignored(rig, vfo)
+            && (freq_needs_ptt(rig, vfo)
+                || !freq_cache_hit(rig, vfo, cached, cache_ms_freq)))
+    {
+        retcode = -RIG_ENAVAIL;
+    }
+
+    rig_cache_lock(rig, 0);
+
+    if (retcode == RIG_OK)
+    {
+        *freq = cached;
+        rig_stats_cache(rig, RIG_STATS_OP_GET_FREQ, 1);
+    }
+
+    return retcode;
+}
+
 /**
  * \brief get the frequency of VFOA and VFOB
  * \param rig   The rig handle
@@ -2392,7 +2866,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
     int retcode;
     int locked_mode;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
     ELAPSED1;
     LOCK(1);
 
@@ -2466,6 +2940,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
     if ((caps->targetable_vfo & RIG_TARGETABLE_MODE)
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_mode(rig, vfo, mode, width);
         rig_debug(RIG_DEBUG_TRACE, "%s: targetable retcode after set_mode(%s)=%d\n",
@@ -2499,7 +2974,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
         rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): curr_vfo=%s, vfo=%s\n", __func__,
                   __LINE__, rig_strvfo(curr_vfo), rig_strvfo(vfo));
         HAMLIB_TRACE;
-        retcode = caps->set_vfo(rig, vfo);
+        retcode = vfo_plan_select(rig, vfo);
 
         if (retcode != RIG_OK)
         {
@@ -2510,7 +2985,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
         retcode = caps->set_mode(rig, vfo, mode, width);
         /* try and revert even if we had an error above */
-        rc2 = caps->set_vfo(rig, curr_vfo);
+        rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
         /* return the first error code */
         if (RIG_OK == retcode)
@@ -2530,11 +3005,45 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
     rig_set_cache_mode(rig, vfo, mode, width);
 
+    // write-through: rig_get_mode reads back the mode and the width the rig chose
+    if (rig->state.write_through_ms > 0)
+    {
+        rig->state.verify_mode |= vfo == RIG_VFO_CURR ? rig->state.current_vfo : vfo;
+    }
+
     ELAPSED2;
     LOCK(0);
     RETURNFUNC(retcode);
 }
 
+/*
+ * The cache decisions of rig_get_mode(), shared with rig_get_mode_cached().
+ * The caller holds the cache lock.
+ */
+
+static int mode_cache_always(const RIG *rig)
+{
+    return rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
+           || rig->state.use_cached_mode;
+}
+
+// a written through mode is read back once write_through_ms passed
+static int mode_verify_due(const RIG *rig, vfo_t vfo, int cache_ms_mode)
+{
+    vfo_t verify_vfo = vfo == RIG_VFO_CURR ? rig->state.current_vfo : vfo;
+
+    return (rig->state.verify_mode & verify_vfo)
+           && cache_ms_mode >= rig->state.write_through_ms;
+}
+
+static int mode_cache_hit(const RIG *rig, vfo_t vfo, rmode_t mode,
+                          int cache_ms_mode, int cache_ms_width)
+{
+    return mode != RIG_MODE_NONE && cache_ms_mode < rig->state.cache.timeout_ms
+           && cache_ms_width < rig->state.cache.timeout_ms
+           && !mode_verify_due(rig, vfo, cache_ms_mode);
+}
+
 /*
  * \brief get the mode of the target VFO
  * \param rig   The rig handle
@@ -2567,7 +3076,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
     freq_t freq;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -2601,11 +3110,11 @@ int HAMLIB_API rig_get_mode(RIG *rig,
 
     rig_cache_show(rig, __func__, __LINE__);
 
-    if (rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
-            || rig->state.use_cached_mode)
+    if (mode_cache_always(rig))
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_MODE, 1);
 
         ELAPSED2;
         RETURNFUNC(RIG_OK);
@@ -2618,11 +3127,15 @@ int HAMLIB_API rig_get_mode(RIG *rig,
         RETURNFUNC(RIG_OK);
     }
 
-    if ((*mode != RIG_MODE_NONE && cache_ms_mode < rig->state.cache.timeout_ms)
-            && cache_ms_width < rig->state.cache.timeout_ms)
+    rmode_t mode_asked = *mode;
+    vfo_t verify_vfo = vfo == RIG_VFO_CURR ? rig->state.current_vfo : vfo;
+    int verify_due = mode_verify_due(rig, vfo, cache_ms_mode);
+
+    if (mode_cache_hit(rig, vfo, *mode, cache_ms_mode, cache_ms_width))
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_MODE, 1);
 
         ELAPSED2;
         RETURNFUNC(RIG_OK);
@@ -2631,6 +3144,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_MODE, 0);
     }
 
     LOCK(1); // we let the caching work before we lock things
@@ -2639,6 +3153,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_mode(rig, vfo, mode, width);
         rig_debug(RIG_DEBUG_TRACE, "%s: retcode after get_mode=%d\n", __func__,
@@ -2661,7 +3176,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
         rig_debug(RIG_DEBUG_TRACE, "%s(%d): vfo=%s, curr_vfo=%s\n", __func__, __LINE__,
                   rig_strvfo(vfo), rig_strvfo(curr_vfo));
         HAMLIB_TRACE;
-        retcode = caps->set_vfo(rig, vfo == RIG_VFO_CURR ? RIG_VFO_A : vfo);
+        retcode = vfo_plan_select(rig, vfo == RIG_VFO_CURR ? RIG_VFO_A : vfo);
 
         rig_cache_show(rig, __func__, __LINE__);
 
@@ -2675,7 +3190,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
         HAMLIB_TRACE;
         retcode = caps->get_mode(rig, vfo, mode, width);
         /* try and revert even if we had an error above */
-        rc2 = caps->set_vfo(rig, curr_vfo);
+        rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
         if (RIG_OK == retcode)
         {
@@ -2699,6 +3214,17 @@ int HAMLIB_API rig_get_mode(RIG *rig,
         *width = rig_passband_normal(rig, *mode);
     }
 
+    if (retcode == RIG_OK)
+    {
+        if (verify_due && *mode != mode_asked)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: %s asked mode=%s, rig has mode=%s\n",
+                      __func__, rig_strvfo(vfo), rig_strrmode(mode_asked), rig_strrmode(*mode));
+        }
+
+        rig->state.verify_mode &= ~verify_vfo;
+    }
+
     rig_set_cache_mode(rig, vfo, *mode, *width);
     rig_cache_show(rig, __func__, __LINE__);
 
@@ -2708,6 +3234,74 @@ int HAMLIB_API rig_get_mode(RIG *rig,
 }
 
 
+/**
+ * \brief get the mode of the target VFO from the cache only
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param mode  The location where to store the current mode
+ * \param width The location where to store the current passband width
+ *
+ *  Answers when rig_get_mode() would answer from the cache, without
+ *  talking to the rig, see rig_get_freq_cached().
+ *
+ * \return RIG_OK if the cache answered, -RIG_ENAVAIL if rig_get_mode()
+ * has to ask the rig, otherwise a negative value if an error occurred.
+ *
+ * \sa rig_get_mode()
+ */
+int HAMLIB_API rig_get_mode_cached(RIG *rig, vfo_t vfo, rmode_t *mode,
+                                   pbwidth_t *width)
+{
+    freq_t freq;
+    rmode_t cached;
+    pbwidth_t cached_width;
+    int cache_ms_freq, cache_ms_mode, cache_ms_width;
+    int retcode;
+
+    if (CHECK_RIG_ARG(rig) || !mode || !width)
+    {
+        return -RIG_EINVAL;
+    }
+
+    if (rig->caps->get_mode == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    rig_cache_lock(rig, 1);
+
+    vfo = vfo_fixup(rig, vfo, rig->state.cache.split);
+
+    retcode = rig_get_cache(rig, vfo, &freq, &cache_ms_freq, &cached,
+                            &cache_ms_mode, &cached_width, &cache_ms_width);
+
+    if (retcode == RIG_OK && !mode_cache_always(rig))
+    {
+        if (vfo == RIG_VFO_B
+                && !(rig->caps->targetable_vfo & RIG_TARGETABLE_MODE))
+        {
+            cached = rig->state.cache.modeMainA;
+            cached_width = rig->state.cache.widthMainA;
+        }
+        else if (!mode_cache_hit(rig, vfo, cached, cache_ms_mode, cache_ms_width))
+        {
+            retcode = -RIG_ENAVAIL;
+        }
+    }
+
+    rig_cache_lock(rig, 0);
+
+    if (retcode == RIG_OK)
+    {
+        *mode = cached;
+        *width = cached_width;
+        rig_stats_cache(rig, RIG_STATS_OP_GET_MODE, 1);
+    }
+
+    return retcode;
+}
+
+
 /**
  * \brief get the normal passband of a mode
  * \param rig   The rig handle
@@ -3084,12 +3678,14 @@ int HAMLIB_API rig_get_vfo(RIG *rig, vfo_t *vfo)
         *vfo = rig->state.cache.vfo;
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age=%dms, vfo=%s\n", __func__,
                   cache_ms, rig_strvfo(*vfo));
+        rig_stats_cache(rig, RIG_STATS_OP_GET_VFO, 1);
         ELAPSED2;
         RETURNFUNC(RIG_OK);
     }
     else
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age=%dms\n", __func__, cache_ms);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_VFO, 0);
     }
 
     HAMLIB_TRACE;
@@ -3205,7 +3801,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
                     retcode = RIG_OK; // fake the retcode so we retry
                 }
 
-                if (tptt != ptt) { rig_debug(RIG_DEBUG_WARN, "%s: failed, retry=%d\n", __func__, retry); }
+                if (tptt != ptt) { rig_debug(RIG_DEBUG_WARN, "%s: failed, retry=%d\n", __func__, retry); rig_stats_retry(rig); }
 
 #else
                 tptt = ptt;
@@ -3266,7 +3862,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 #if 0
                     retcode = rig_get_ptt(rig, vfo, &tptt);
 
-                    if (tptt != ptt) { rig_debug(RIG_DEBUG_WARN, "%s: failed, retry=%d\n", __func__, retry); }
+                    if (tptt != ptt) { rig_debug(RIG_DEBUG_WARN, "%s: failed, retry=%d\n", __func__, retry); rig_stats_retry(rig); }
 
 #else
                     tptt = ptt;
@@ -3329,6 +3925,9 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
             }
         }
 
+        /* commands still being paced out go before the key line changes */
+        io_reactor_drain(&rs->rigport);
+
         retcode = ser_set_dtr(&rig->state.pttport, ptt != RIG_PTT_OFF);
 
         rig_debug(RIG_DEBUG_TRACE, "%s:  rigport=%s, pttport=%s, ptt_share=%d\n",
@@ -3380,6 +3979,9 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
             }
         }
 
+        /* commands still being paced out go before the key line changes */
+        io_reactor_drain(&rs->rigport);
+
         retcode = ser_set_rts(&rig->state.pttport, ptt != RIG_PTT_OFF);
 
         rig_debug(RIG_DEBUG_TRACE, "%s:  rigport=%s, pttport=%s, ptt_share=%d\n",
@@ -3427,8 +4029,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
     // is requested on a rig that can't change freq on a transmitting VFO
     if (ptt != RIG_PTT_ON) { hl_usleep(50 * 1000); }
 
-    rig->state.cache.ptt = ptt;
-    elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+    rig_set_cache_ptt(rig, ptt);
 
     if (retcode != RIG_OK) { rig_debug(RIG_DEBUG_ERR, "%s: return code=%d\n", __func__, retcode); }
 
@@ -3486,6 +4087,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
     if (cache_ms < rig->state.cache.timeout_ms)
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age=%dms\n", __func__, cache_ms);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_PTT, 1);
         *ptt = rig->state.cache.ptt;
         ELAPSED2;
         RETURNFUNC(RIG_OK);
@@ -3493,6 +4095,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
     else
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age=%dms\n", __func__, cache_ms);
+        rig_stats_cache(rig, RIG_STATS_OP_GET_PTT, 0);
     }
 
     caps = rig->caps;
@@ -3520,8 +4123,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                rig->state.cache.ptt = *ptt;
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             ELAPSED2;
@@ -3574,8 +4176,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             {
                 /* return the first error code */
                 retcode = rc2;
-                rig->state.cache.ptt = *ptt;
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+                rig_set_cache_ptt(rig, *ptt);
             }
         }
 
@@ -3592,8 +4193,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-                rig->state.cache.ptt = *ptt;
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             LOCK(0);
@@ -3615,8 +4215,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             *ptt = status ? RIG_PTT_ON : RIG_PTT_OFF;
         }
 
-        rig->state.cache.ptt = *ptt;
-        elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+        rig_set_cache_ptt(rig, *ptt);
         ELAPSED2;
         LOCK(0);
         RETURNFUNC(retcode);
@@ -3630,8 +4229,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-                rig->state.cache.ptt = *ptt;
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             ELAPSED2;
@@ -3653,8 +4251,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             *ptt = status ? RIG_PTT_ON : RIG_PTT_OFF;
         }
 
-        rig->state.cache.ptt = *ptt;
-        elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+        rig_set_cache_ptt(rig, *ptt);
         ELAPSED2;
         LOCK(0);
         RETURNFUNC(retcode);
@@ -3667,8 +4264,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-                rig->state.cache.ptt = *ptt;
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             ELAPSED2;
@@ -3680,8 +4276,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
         if (retcode == RIG_OK)
         {
-            elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-            rig->state.cache.ptt = *ptt;
+            rig_set_cache_ptt(rig, *ptt);
         }
 
         ELAPSED2;
@@ -3696,8 +4291,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-                rig->state.cache.ptt = *ptt;
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             ELAPSED2;
@@ -3709,8 +4303,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
         if (retcode == RIG_OK)
         {
-            elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-            rig->state.cache.ptt = *ptt;
+            rig_set_cache_ptt(rig, *ptt);
         }
 
         ELAPSED2;
@@ -3726,8 +4319,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
-                elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
-                rig->state.cache.ptt = *ptt;
+                rig_set_cache_ptt(rig, *ptt);
             }
 
             ELAPSED2;
@@ -3759,6 +4351,49 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 }
 
 
+/**
+ * \brief get the status of the PTT from the cache only
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param ptt   The location where to store the status of the PTT
+ *
+ *  Answers when rig_get_ptt() would answer from the cache, without
+ *  talking to the rig, see rig_get_freq_cached().
+ *
+ * \return RIG_OK if the cache answered, -RIG_ENAVAIL if rig_get_ptt()
+ * has to ask the rig, otherwise a negative value if an error occurred.
+ *
+ * \sa rig_get_ptt()
+ */
+int HAMLIB_API rig_get_ptt_cached(RIG *rig, vfo_t vfo, ptt_t *ptt)
+{
+    int retcode = -RIG_ENAVAIL;
+
+    if (CHECK_RIG_ARG(rig) || !ptt)
+    {
+        return -RIG_EINVAL;
+    }
+
+    rig_cache_lock(rig, 1);
+
+    if (elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_GET)
+            < rig->state.cache.timeout_ms)
+    {
+        *ptt = rig->state.cache.ptt;
+        retcode = RIG_OK;
+    }
+
+    rig_cache_lock(rig, 0);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_cache(rig, RIG_STATS_OP_GET_PTT, 1);
+    }
+
+    return retcode;
+}
+
+
 /**
  * \brief get the status of the DCD
  * \param rig   The rig handle
@@ -3920,7 +4555,7 @@ int HAMLIB_API rig_set_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t rptr_shift)
     vfo_t curr_vfo;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -3939,6 +4574,7 @@ int HAMLIB_API rig_set_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t rptr_shift)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_rptr_shift(rig, vfo, rptr_shift);
         ELAPSED2;
@@ -3953,7 +4589,7 @@ int HAMLIB_API rig_set_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t rptr_shift)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -3964,7 +4600,7 @@ int HAMLIB_API rig_set_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t rptr_shift)
     HAMLIB_TRACE;
     retcode = caps->set_rptr_shift(rig, vfo, rptr_shift);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -3998,7 +4634,7 @@ int HAMLIB_API rig_get_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t *rptr_shift)
     vfo_t curr_vfo;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -4023,6 +4659,7 @@ int HAMLIB_API rig_get_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t *rptr_shift)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_rptr_shift(rig, vfo, rptr_shift);
         ELAPSED2;
@@ -4037,7 +4674,7 @@ int HAMLIB_API rig_get_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t *rptr_shift)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -4048,7 +4685,7 @@ int HAMLIB_API rig_get_rptr_shift(RIG *rig, vfo_t vfo, rptr_shift_t *rptr_shift)
     HAMLIB_TRACE;
     retcode =  caps->get_rptr_shift(rig, vfo, rptr_shift);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -4082,7 +4719,7 @@ int HAMLIB_API rig_set_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t rptr_offs)
     vfo_t curr_vfo;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -4101,6 +4738,7 @@ int HAMLIB_API rig_set_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t rptr_offs)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_rptr_offs(rig, vfo, rptr_offs);
         ELAPSED2;
@@ -4116,7 +4754,7 @@ int HAMLIB_API rig_set_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t rptr_offs)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -4126,7 +4764,7 @@ int HAMLIB_API rig_set_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t rptr_offs)
 
     retcode = caps->set_rptr_offs(rig, vfo, rptr_offs);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -4160,7 +4798,7 @@ int HAMLIB_API rig_get_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t *rptr_offs)
     vfo_t curr_vfo;
 
     ELAPSED1;
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -4185,6 +4823,7 @@ int HAMLIB_API rig_get_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t *rptr_offs)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_rptr_offs(rig, vfo, rptr_offs);
         ELAPSED2;
@@ -4199,7 +4838,7 @@ int HAMLIB_API rig_get_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t *rptr_offs)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -4209,7 +4848,7 @@ int HAMLIB_API rig_get_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t *rptr_offs)
 
     retcode = caps->get_rptr_offs(rig, vfo, rptr_offs);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -4283,6 +4922,7 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
                 || tx_vfo == rig->state.current_vfo
                 || (caps->targetable_vfo & RIG_TARGETABLE_FREQ)))
     {
+        VFO_PLAN_SETTLE(rig);
         HAMLIB_TRACE;
         retcode = caps->set_split_freq(rig, vfo, tx_freq);
         ELAPSED2;
@@ -4322,12 +4962,11 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
     if (caps->set_vfo)
     {
         HAMLIB_TRACE;
-        retcode = RIG_OK;
-
-        retcode = caps->set_vfo(rig, tx_vfo);
+        retcode = vfo_plan_select(rig, tx_vfo);
     }
     else if (rig_has_vfo_op(rig, RIG_OP_TOGGLE) && caps->vfo_op)
     {
+        VFO_PLAN_SETTLE(rig);
         retcode = caps->vfo_op(rig, vfo, RIG_OP_TOGGLE);
     }
     else
@@ -4372,7 +5011,7 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
 
         if (!(caps->targetable_vfo & RIG_TARGETABLE_FREQ))
         {
-            rc2 = caps->set_vfo(rig, curr_vfo);
+            rc2 = vfo_plan_restore(rig, tx_vfo, curr_vfo);
         }
     }
     else
@@ -5423,7 +6062,7 @@ int HAMLIB_API rig_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5441,6 +6080,7 @@ int HAMLIB_API rig_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_rit(rig, vfo, rit);
         RETURNFUNC(retcode);
@@ -5453,7 +6093,7 @@ int HAMLIB_API rig_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5462,7 +6102,7 @@ int HAMLIB_API rig_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
 
     retcode = caps->set_rit(rig, vfo, rit);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -5494,7 +6134,7 @@ int HAMLIB_API rig_get_rit(RIG *rig, vfo_t vfo, shortfreq_t *rit)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5517,6 +6157,7 @@ int HAMLIB_API rig_get_rit(RIG *rig, vfo_t vfo, shortfreq_t *rit)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_rit(rig, vfo, rit);
         RETURNFUNC(retcode);
@@ -5529,7 +6170,7 @@ int HAMLIB_API rig_get_rit(RIG *rig, vfo_t vfo, shortfreq_t *rit)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5539,7 +6180,7 @@ int HAMLIB_API rig_get_rit(RIG *rig, vfo_t vfo, shortfreq_t *rit)
     HAMLIB_TRACE;
     retcode = caps->get_rit(rig, vfo, rit);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -5571,7 +6212,7 @@ int HAMLIB_API rig_set_xit(RIG *rig, vfo_t vfo, shortfreq_t xit)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5589,6 +6230,7 @@ int HAMLIB_API rig_set_xit(RIG *rig, vfo_t vfo, shortfreq_t xit)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_xit(rig, vfo, xit);
         RETURNFUNC(retcode);
@@ -5601,7 +6243,7 @@ int HAMLIB_API rig_set_xit(RIG *rig, vfo_t vfo, shortfreq_t xit)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5610,7 +6252,7 @@ int HAMLIB_API rig_set_xit(RIG *rig, vfo_t vfo, shortfreq_t xit)
 
     retcode = caps->set_xit(rig, vfo, xit);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -5642,7 +6284,7 @@ int HAMLIB_API rig_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *xit)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5665,6 +6307,7 @@ int HAMLIB_API rig_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *xit)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_xit(rig, vfo, xit);
         RETURNFUNC(retcode);
@@ -5677,7 +6320,7 @@ int HAMLIB_API rig_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *xit)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5687,7 +6330,7 @@ int HAMLIB_API rig_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *xit)
     HAMLIB_TRACE;
     retcode = caps->get_xit(rig, vfo, xit);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -5719,7 +6362,7 @@ int HAMLIB_API rig_set_ts(RIG *rig, vfo_t vfo, shortfreq_t ts)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5736,6 +6379,7 @@ int HAMLIB_API rig_set_ts(RIG *rig, vfo_t vfo, shortfreq_t ts)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->set_ts(rig, vfo, ts);
         RETURNFUNC(retcode);
@@ -5748,7 +6392,7 @@ int HAMLIB_API rig_set_ts(RIG *rig, vfo_t vfo, shortfreq_t ts)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5758,7 +6402,7 @@ int HAMLIB_API rig_set_ts(RIG *rig, vfo_t vfo, shortfreq_t ts)
     HAMLIB_TRACE;
     retcode = caps->set_ts(rig, vfo, ts);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -5790,7 +6434,7 @@ int HAMLIB_API rig_get_ts(RIG *rig, vfo_t vfo, shortfreq_t *ts)
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ENTERFUNC;
+    ENTERFUNC_VFO_PLAN;
 
     if (CHECK_RIG_ARG(rig))
     {
@@ -5812,6 +6456,7 @@ int HAMLIB_API rig_get_ts(RIG *rig, vfo_t vfo, shortfreq_t *ts)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        vfo_plan_direct(rig, vfo);
         HAMLIB_TRACE;
         retcode = caps->get_ts(rig, vfo, ts);
         RETURNFUNC(retcode);
@@ -5824,7 +6469,7 @@ int HAMLIB_API rig_get_ts(RIG *rig, vfo_t vfo, shortfreq_t *ts)
 
     curr_vfo = rig->state.current_vfo;
     HAMLIB_TRACE;
-    retcode = caps->set_vfo(rig, vfo);
+    retcode = vfo_plan_select(rig, vfo);
 
     if (retcode != RIG_OK)
     {
@@ -5834,7 +6479,7 @@ int HAMLIB_API rig_get_ts(RIG *rig, vfo_t vfo, shortfreq_t *ts)
     HAMLIB_TRACE;
     retcode = caps->get_ts(rig, vfo, ts);
     /* try and revert even if we had an error above */
-    rc2 = caps->set_vfo(rig, curr_vfo);
+    rc2 = vfo_plan_restore(rig, vfo, curr_vfo);
 
     if (RIG_OK == retcode)
     {
@@ -6057,18 +6702,8 @@ int HAMLIB_API rig_power2mW(RIG *rig,
         RETURNFUNC(rig->caps->power2mW(rig, mwpower, power, freq, mode));
     }
 
-    txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
-
-    // check all the range lists
-    if (txrange == NULL) { rig_get_range(rig->caps->tx_range_list1, freq, mode); }
-
-    if (txrange == NULL) { rig_get_range(rig->caps->tx_range_list2, freq, mode); }
-
-    if (txrange == NULL) { rig_get_range(rig->caps->tx_range_list3, freq, mode); }
-
-    if (txrange == NULL) { rig_get_range(rig->caps->tx_range_list4, freq, mode); }
-
-    if (txrange == NULL) { rig_get_range(rig->caps->tx_range_list5, freq, mode); }
+    // the selected tx ranges, then those of all regions
+    txrange = rig_find_range(rig, 1, freq, mode);
 
     if (txrange == NULL)
     {
@@ -6127,7 +6762,7 @@ int HAMLIB_API rig_mW2power(RIG *rig,
         RETURNFUNC2(rig->caps->mW2power(rig, power, mwpower, freq, mode));
     }
 
-    txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
+    txrange = rig_find_range(rig, 1, freq, mode);
 
     if (!txrange)
     {
@@ -6812,6 +7447,12 @@ int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
         LOCK(1);
         retcode = caps->send_morse(rig, vfo, msg);
         LOCK(0);
+
+        if (retcode == RIG_OK)
+        {
+            morse_sent(rig, msg);
+        }
+
         RETURNFUNC(retcode);
     }
 
@@ -6830,6 +7471,12 @@ int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
     }
 
     retcode = caps->send_morse(rig, vfo, msg);
+
+    if (retcode == RIG_OK)
+    {
+        morse_sent(rig, msg);
+    }
+
     /* try and revert even if we had an error above */
     HAMLIB_TRACE;
     rc2 = caps->set_vfo(rig, curr_vfo);
@@ -6868,6 +7515,9 @@ int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    /* text still queued is dropped too */
+    morse_stop(rig);
+
     caps = rig->caps;
 
     if (caps->stop_morse == NULL)
@@ -6909,50 +7559,13 @@ int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
     RETURNFUNC(retcode);
 }
 
-/*
- * wait_morse_ptt
- * generic routine to wait for ptt=0
- * should work on any full breakin CW morse send
- * Assumes rig!=NULL, msg!=NULL
- */
-static int wait_morse_ptt(RIG *rig, vfo_t vfo)
-{
-    ptt_t pttStatus = RIG_PTT_OFF;
-    int loops = 0;
-
-    ENTERFUNC;
-
-    hl_usleep(200 * 1000); // give little time for CW to start PTT
-
-    do
-    {
-        int retval;
-        rig_debug(RIG_DEBUG_TRACE, "%s: loop#%d until ptt=0, ptt=%d\n", __func__, loops,
-                  pttStatus);
-        elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_INVALIDATE);
-        HAMLIB_TRACE;
-        retval = rig_get_ptt(rig, vfo, &pttStatus);
-
-        if (retval != RIG_OK)
-        {
-            RETURNFUNC(retval);
-        }
-
-        // every 25ms should be short enough
-        hl_usleep(25 * 1000);
-        ++loops;
-    }
-    while (pttStatus == RIG_PTT_ON && loops <= 600);
-
-    RETURNFUNC(RIG_OK);
-}
-
 /**
  * \brief wait morse code
  * \param rig   The rig handle
  * \param vfo   The target VFO
  *
- *  waits for the end of the morse message to be sent.
+ *  Waits for the end of the morse message to be sent, text queued with
+ *  rig_send_morse_queued() included.
  *
  * \return RIG_OK if the operation has been successful, otherwise
  * a negative value if an error occurred (in which case, cause is
@@ -6977,7 +7590,7 @@ int HAMLIB_API rig_wait_morse(RIG *rig, vfo_t vfo)
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
-        RETURNFUNC(wait_morse_ptt(rig, vfo));
+        RETURNFUNC(morse_wait(rig, vfo));
     }
 
     if (!caps->set_vfo)
@@ -6994,7 +7607,7 @@ int HAMLIB_API rig_wait_morse(RIG *rig, vfo_t vfo)
         RETURNFUNC(retcode);
     }
 
-    retcode = wait_morse_ptt(rig, vfo);
+    retcode = morse_wait(rig, vfo);
     /* try and revert even if we had an error above */
     HAMLIB_TRACE;
     rc2 = caps->set_vfo(rig, curr_vfo);
@@ -7794,9 +8407,9 @@ void *async_data_handler(void *arg)
     rig_debug(RIG_DEBUG_VERBOSE, "%s: Starting async data handler thread\n",
               __func__);
 
-    // TODO: check how to enable "transceive" on recent Kenwood/Yaesu rigs
-    // TODO: add initial support for async in Kenwood kenwood_transaction (+one) functions -> add transaction_active flag usage
-    // TODO: add initial support for async in Yaesu newcat_get_cmd/set_cmd (+validate) functions -> add transaction_active flag usage
+    // Kenwood and Yaesu newcat rigs turn AI on in their rig_open and tell
+    // their own pending replies apart from AI frames in is_async_frame,
+    // so far the TS-590S/SG, TS-890S, FT-710, FT-991, FTDX-10 and FTDX-101D
 
     while (rs->async_data_handler_thread_run)
     {
@@ -0,0 +1,551 @@
+/*
+ *  Hamlib Interface - call, cache and port statistics
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file rig_stats.c
+ * \brief Call, cache and port statistics
+ *
+ * Counters are kept in a few shards per rig; a thread always updates the
+ * shard its thread id hashes to, so threads calling the same rig rarely
+ * share cache lines.  The increments are atomic anyway, threads hashing
+ * to the same shard only cost a little.  rig_get_stats() adds the shards
+ * up.
+ *
+ * Port I/O only knows the port, the rig ports are registered here when
+ * the rig is initialized.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include <hamlib/rig_stats.h>
+#include "rig_stats.h"
+#include "misc.h"
+
+#define RIG_STATS_SHARDS 4
+#define RIG_STATS_PORTS 32
+
+#if defined(__GNUC__) || defined(__clang__)
+#define stats_add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define stats_load(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define stats_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else
+#define stats_add(p, v) (*(p) += (v))
+#define stats_load(p) (*(p))
+#define stats_store(p, v) (*(p) = (v))
+#endif
+
+struct rig_stats_shards
+{
+    struct rig_stats shard[RIG_STATS_SHARDS];
+};
+
+static struct
+{
+    const hamlib_port_t *port;
+    struct rig_stats_shards *stats;
+} rig_stats_ports[RIG_STATS_PORTS];
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t rig_stats_ports_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* function names as in __func__, indexed by enum rig_stats_op_e */
+static const char *const rig_stats_funcs[RIG_STATS_OP_COUNT] =
+{
+    "rig_set_freq", "rig_get_freq", "rig_set_mode", "rig_get_mode",
+    "rig_set_vfo", "rig_get_vfo", "rig_set_ptt", "rig_get_ptt", "rig_get_dcd",
+    "rig_set_rptr_shift", "rig_get_rptr_shift", "rig_set_rptr_offs",
+    "rig_get_rptr_offs", "rig_set_split_freq", "rig_get_split_freq",
+    "rig_set_split_mode", "rig_get_split_mode", "rig_set_split_freq_mode",
+    "rig_get_split_freq_mode", "rig_set_split_vfo", "rig_get_split_vfo",
+    "rig_vfo_op", "rig_get_vfo_info", "rig_set_level", "rig_get_level",
+    "rig_set_func", "rig_get_func", "rig_set_parm", "rig_get_parm",
+};
+
+static struct rig_stats *rig_stats_shard(struct rig_stats_shards *s)
+{
+    unsigned long id;
+
+#ifdef HAVE_PTHREAD
+    pthread_t self = pthread_self();
+    id = 0;
+    memcpy(&id, &self, sizeof(id) < sizeof(self) ? sizeof(id) : sizeof(self));
+#else
+    id = 0;
+#endif
+
+    // thread ids are aligned pointers on most systems, mix the high bits in
+    id ^= id >> 12;
+    id ^= id >> 7;
+
+    return &s->shard[id % RIG_STATS_SHARDS];
+}
+
+static uint64_t rig_stats_since_us(const struct timespec *begin)
+{
+    struct timespec now;
+    long long us;
+
+    // same clock as elapsed_ms(), begin comes from ELAPSED1
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    us = (long long)(now.tv_sec - begin->tv_sec) * 1000000
+         + (now.tv_nsec - begin->tv_nsec) / 1000;
+
+    return us > 0 ? (uint64_t) us : 0;
+}
+
+static void rig_stats_hist_add(struct rig_stats_hist *h, uint64_t us)
+{
+    int b = 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+
+    if (us > 1)
+    {
+        b = 63 - __builtin_clzll(us);
+    }
+
+#else
+
+    while ((us >> (b + 1)) != 0)
+    {
+        b++;
+    }
+
+#endif
+
+    if (b >= RIG_STATS_BUCKETS)
+    {
+        b = RIG_STATS_BUCKETS - 1;
+    }
+
+    stats_add(&h->count, 1);
+    stats_add(&h->total_us, us);
+    stats_add(&h->bucket[b], 1);
+}
+
+static void rig_stats_hist_sum(struct rig_stats_hist *dst,
+                               const struct rig_stats_hist *src)
+{
+    int i;
+
+    dst->count += stats_load(&src->count);
+    dst->total_us += stats_load(&src->total_us);
+
+    for (i = 0; i < RIG_STATS_BUCKETS; i++)
+    {
+        dst->bucket[i] += stats_load(&src->bucket[i]);
+    }
+}
+
+static struct rig_stats_shards *rig_stats_of(RIG *rig)
+{
+    return rig ? (struct rig_stats_shards *) rig->state.stats : NULL;
+}
+
+/*
+ * Allocate the counters and register the rig port, called by rig_init()
+ */
+void rig_stats_init(RIG *rig)
+{
+    struct rig_stats_shards *s = calloc(1, sizeof(*s));
+    int i;
+
+    rig->state.stats = s;
+
+    if (!s)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&rig_stats_ports_lock);
+#endif
+
+    for (i = 0; i < RIG_STATS_PORTS; i++)
+    {
+        if (rig_stats_ports[i].port == NULL)
+        {
+            rig_stats_ports[i].stats = s;
+            rig_stats_ports[i].port = &rig->state.rigport;
+            break;
+        }
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&rig_stats_ports_lock);
+#endif
+}
+
+/*
+ * Unregister and free, called by rig_cleanup()
+ */
+void rig_stats_free(RIG *rig)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+    int i;
+
+    if (!s)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&rig_stats_ports_lock);
+#endif
+
+    for (i = 0; i < RIG_STATS_PORTS; i++)
+    {
+        if (rig_stats_ports[i].stats == s)
+        {
+            rig_stats_ports[i].port = NULL;
+            rig_stats_ports[i].stats = NULL;
+        }
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&rig_stats_ports_lock);
+#endif
+
+    rig->state.stats = NULL;
+    free(s);
+}
+
+/**
+ * \brief Record an API call, used by the ELAPSED2 macro
+ * \param rig the rig
+ * \param func __func__ of the caller
+ * \param op per call site cache of the operation, -1 before the first call
+ * \param begin set by ELAPSED1
+ */
+void HAMLIB_API rig_stats_elapsed(RIG *rig, const char *func, int *op,
+                                  const struct timespec *begin)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+    int n = stats_load(op);
+
+    if (n == -1)
+    {
+        for (n = 0; n < RIG_STATS_OP_COUNT; n++)
+        {
+            if (strcmp(func, rig_stats_funcs[n]) == 0)
+            {
+                break;
+            }
+        }
+
+        // RIG_STATS_OP_COUNT for functions not counted here
+        stats_store(op, n);
+    }
+
+    if (!s || n >= RIG_STATS_OP_COUNT)
+    {
+        return;
+    }
+
+    rig_stats_hist_add(&rig_stats_shard(s)->op[n], rig_stats_since_us(begin));
+}
+
+/*
+ * Record a call not measured by ELAPSED1/ELAPSED2, level calls also by setting
+ */
+void rig_stats_call(RIG *rig, int op, setting_t level,
+                    const struct timespec *begin)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+    struct rig_stats *shard;
+    uint64_t us;
+    int idx;
+
+    if (!s)
+    {
+        return;
+    }
+
+    shard = rig_stats_shard(s);
+    us = rig_stats_since_us(begin);
+    rig_stats_hist_add(&shard->op[op], us);
+
+    if (op != RIG_STATS_OP_GET_LEVEL && op != RIG_STATS_OP_SET_LEVEL)
+    {
+        return;
+    }
+
+    idx = rig_setting2idx(level);
+
+    if (idx < 0 || idx >= RIG_SETTING_MAX)
+    {
+        return;
+    }
+
+    if (op == RIG_STATS_OP_GET_LEVEL)
+    {
+        stats_add(&shard->level[idx].get_count, 1);
+        stats_add(&shard->level[idx].get_us, us);
+    }
+    else
+    {
+        stats_add(&shard->level[idx].set_count, 1);
+        stats_add(&shard->level[idx].set_us, us);
+    }
+}
+
+/*
+ * Remember the last value of a level for monitoring, only the first shard
+ * holds values.
+ */
+void rig_stats_value(RIG *rig, setting_t level, const value_t *val)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+    int idx = rig_setting2idx(level);
+
+    if (!s || idx < 0 || idx >= RIG_SETTING_MAX)
+    {
+        return;
+    }
+
+    s->shard[0].level[idx].value = RIG_LEVEL_IS_FLOAT(level) ? val->f : val->i;
+}
+
+void rig_stats_cache(RIG *rig, int op, int hit)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+
+    if (!s)
+    {
+        return;
+    }
+
+    if (hit)
+    {
+        stats_add(&rig_stats_shard(s)->cache_hit[op], 1);
+    }
+    else
+    {
+        stats_add(&rig_stats_shard(s)->cache_miss[op], 1);
+    }
+}
+
+void rig_stats_retry(RIG *rig)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+
+    if (s)
+    {
+        stats_add(&rig_stats_shard(s)->retries, 1);
+    }
+}
+
+void rig_stats_vfo_swap(RIG *rig, int sent, int avoided)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+
+    if (s)
+    {
+        struct rig_stats *shard = rig_stats_shard(s);
+
+        stats_add(&shard->vfo_swaps, sent);
+        stats_add(&shard->vfo_swaps_avoided, avoided);
+    }
+}
+
+static struct rig_stats_shards *rig_stats_of_port(const hamlib_port_t *p)
+{
+    int i;
+
+    for (i = 0; i < RIG_STATS_PORTS; i++)
+    {
+        if (rig_stats_ports[i].port == p)
+        {
+            return rig_stats_ports[i].stats;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Record port I/O, ports not belonging to a rig are ignored
+ */
+void rig_stats_port(const hamlib_port_t *p, enum rig_stats_port_e what,
+                    const struct timespec *begin)
+{
+    struct rig_stats_shards *s = rig_stats_of_port(p);
+    struct rig_stats *shard;
+
+    if (!s)
+    {
+        return;
+    }
+
+    shard = rig_stats_shard(s);
+
+    switch (what)
+    {
+    case RIG_STATS_PORT_WRITE:
+        rig_stats_hist_add(&shard->port_write, rig_stats_since_us(begin));
+        break;
+
+    case RIG_STATS_PORT_READ:
+        rig_stats_hist_add(&shard->port_read, rig_stats_since_us(begin));
+        break;
+
+    case RIG_STATS_PORT_TIMEOUT:
+        stats_add(&shard->timeouts, 1);
+        break;
+
+    case RIG_STATS_PORT_RETRY:
+        stats_add(&shard->retries, 1);
+        break;
+    }
+}
+
+/**
+ * \brief Get the statistics of a rig
+ * \param rig the rig
+ * \param stats filled in with the sums since rig_init() or rig_reset_stats()
+ * \return RIG_OK or < 0 on error
+ */
+int HAMLIB_API rig_get_stats(RIG *rig, struct rig_stats *stats)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+    int i, j;
+
+    if (!s || !stats)
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (i = 0; i < RIG_STATS_SHARDS; i++)
+    {
+        const struct rig_stats *src = &s->shard[i];
+
+        for (j = 0; j < RIG_STATS_OP_COUNT; j++)
+        {
+            rig_stats_hist_sum(&stats->op[j], &src->op[j]);
+            stats->cache_hit[j] += stats_load(&src->cache_hit[j]);
+            stats->cache_miss[j] += stats_load(&src->cache_miss[j]);
+        }
+
+        rig_stats_hist_sum(&stats->port_write, &src->port_write);
+        rig_stats_hist_sum(&stats->port_read, &src->port_read);
+        stats->timeouts += stats_load(&src->timeouts);
+        stats->retries += stats_load(&src->retries);
+        stats->vfo_swaps += stats_load(&src->vfo_swaps);
+        stats->vfo_swaps_avoided += stats_load(&src->vfo_swaps_avoided);
+
+        for (j = 0; j < RIG_SETTING_MAX; j++)
+        {
+            stats->level[j].get_count += stats_load(&src->level[j].get_count);
+            stats->level[j].get_us += stats_load(&src->level[j].get_us);
+            stats->level[j].set_count += stats_load(&src->level[j].set_count);
+            stats->level[j].set_us += stats_load(&src->level[j].set_us);
+        }
+    }
+
+    for (j = 0; j < RIG_SETTING_MAX; j++)
+    {
+        stats->level[j].value = s->shard[0].level[j].value;
+    }
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Start counting from zero again
+ *
+ * Calls in progress on other threads may still be counted half.
+ */
+int HAMLIB_API rig_reset_stats(RIG *rig)
+{
+    struct rig_stats_shards *s = rig_stats_of(rig);
+
+    if (!s)
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(s, 0, sizeof(*s));
+
+    return RIG_OK;
+}
+
+/**
+ * \brief Name of an operation, e.g. "get_freq"
+ * \return the name or NULL when op is out of range
+ */
+const char *HAMLIB_API rig_stats_op_name(int op)
+{
+    if (op < 0 || op >= RIG_STATS_OP_COUNT)
+    {
+        return NULL;
+    }
+
+    return rig_stats_funcs[op] + 4;     /* without "rig_" */
+}
+
+/**
+ * \brief Latency below which a share of the calls completed
+ * \param hist histogram from rig_get_stats()
+ * \param q share, e.g. 0.99
+ * \return upper bound of the bucket in microseconds, 0 without calls
+ */
+double HAMLIB_API rig_stats_percentile(const struct rig_stats_hist *hist,
+                                       double q)
+{
+    uint64_t want, seen = 0;
+    int i;
+
+    if (hist->count == 0)
+    {
+        return 0;
+    }
+
+    want = (uint64_t)(q * (double) hist->count + 0.5);
+
+    if (want < 1)
+    {
+        want = 1;
+    }
+
+    for (i = 0; i < RIG_STATS_BUCKETS - 1; i++)
+    {
+        seen += hist->bucket[i];
+
+        if (seen >= want)
+        {
+            break;
+        }
+    }
+
+    return (double)(2ULL << i);
+}
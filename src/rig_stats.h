@@ -0,0 +1,50 @@
+/*
+ *  Hamlib Interface - call, cache and port statistics
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _RIG_STATS_INTERNAL_H
+#define _RIG_STATS_INTERNAL_H 1
+
+#include <hamlib/rig.h>
+#include <hamlib/rig_stats.h>
+
+__BEGIN_DECLS
+
+enum rig_stats_port_e
+{
+    RIG_STATS_PORT_WRITE,
+    RIG_STATS_PORT_READ,
+    RIG_STATS_PORT_TIMEOUT,
+    RIG_STATS_PORT_RETRY
+};
+
+void rig_stats_init(RIG *rig);
+void rig_stats_free(RIG *rig);
+void rig_stats_call(RIG *rig, int op, setting_t level,
+                    const struct timespec *begin);
+void rig_stats_value(RIG *rig, setting_t level, const value_t *val);
+void rig_stats_cache(RIG *rig, int op, int hit);
+void rig_stats_retry(RIG *rig);
+void rig_stats_vfo_swap(RIG *rig, int sent, int avoided);
+void rig_stats_port(const hamlib_port_t *p, enum rig_stats_port_e what,
+                    const struct timespec *begin);
+
+__END_DECLS
+
+#endif /* _RIG_STATS_INTERNAL_H */
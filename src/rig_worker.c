@@ -0,0 +1,460 @@
+/*
+ *  Hamlib Interface - per rig I/O worker
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file rig_worker.c
+ * \brief One thread per rig running the requests of all callers in turn
+ *
+ * Applications sharing a rig between threads, like rigctld with a thread
+ * per client, used to make every thread take one lock around its calls.
+ * Who gets the lock next is up to the scheduler, a PTT change can wait
+ * behind any number of reads, and a thread stuck behind a rig timing out
+ * cannot give up.
+ *
+ * rig_worker_start() starts a thread that makes the rig calls for the
+ * others.  rig_worker_call() queues a function, the worker runs the queue
+ * in order and the caller waits for the result.  Urgent requests, PTT
+ * changes, go ahead of everything not running yet.  A request still queued
+ * when its timeout expires is dropped and fails with -RIG_BUSBUSY, the rig
+ * was busy for others, not silent; one already running is waited for, the
+ * rig timeouts bound that.
+ *
+ * The queue is only locked to link and unlink requests, never while a
+ * request runs.  The worker takes the application lock given to
+ * rig_worker_start() around each request, so threads of the application
+ * that still call the rig directly under that lock stay serialized.
+ */
+
+#include <hamlib/config.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "rig_worker.h"
+#include "misc.h"
+
+enum rig_worker_req_e
+{
+    RIG_WORKER_QUEUED,
+    RIG_WORKER_RUNNING,
+    RIG_WORKER_DONE
+};
+
+/* lives on the stack of the caller, who waits until it is off the queue */
+struct rig_worker_req
+{
+    rig_worker_func_t func;
+    rig_ptr_t arg;
+    int urgent;
+    enum rig_worker_req_e state;
+    int retcode;
+    struct rig_worker_req *next;
+};
+
+struct rig_worker
+{
+    RIG *rig;
+    void (*sync_cb)(int lock);
+    struct rig_worker_req *head;    /* urgent requests first */
+    struct rig_worker_req *tail;
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_mutex_t lock;           /* the queue */
+    pthread_cond_t queued;
+    pthread_cond_t done;
+    int waiters;
+    int run;
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+static void rig_worker_push(struct rig_worker *w, struct rig_worker_req *req)
+{
+    struct rig_worker_req **p = &w->head;
+
+    if (req->urgent)
+    {
+        /* after the urgent ones queued before */
+        while (*p && (*p)->urgent) { p = &(*p)->next; }
+    }
+    else if (w->tail)
+    {
+        p = &w->tail->next;
+    }
+
+    req->next = *p;
+    *p = req;
+
+    if (req->next == NULL) { w->tail = req; }
+}
+
+static struct rig_worker_req *rig_worker_pop(struct rig_worker *w)
+{
+    struct rig_worker_req *req = w->head;
+
+    if (req)
+    {
+        w->head = req->next;
+
+        if (w->head == NULL) { w->tail = NULL; }
+    }
+
+    return req;
+}
+
+static void rig_worker_unlink(struct rig_worker *w,
+                              const struct rig_worker_req *req)
+{
+    struct rig_worker_req **p, *prev = NULL;
+
+    for (p = &w->head; *p; prev = *p, p = &(*p)->next)
+    {
+        if (*p == req)
+        {
+            *p = req->next;
+
+            if (w->tail == req) { w->tail = prev; }
+
+            break;
+        }
+    }
+}
+
+static void *rig_worker_thread(void *arg)
+{
+    struct rig_worker *w = (struct rig_worker *)arg;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    pthread_mutex_lock(&w->lock);
+
+    while (w->run)
+    {
+        struct rig_worker_req *req;
+        int retcode = RIG_OK;
+
+        if (w->head == NULL)
+        {
+            pthread_cond_wait(&w->queued, &w->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&w->lock);
+
+        /*
+         * take the application lock before the request, what is queued
+         * while waiting for it is ordered by urgency too
+         */
+        if (w->sync_cb) { w->sync_cb(1); }
+
+        pthread_mutex_lock(&w->lock);
+        req = rig_worker_pop(w);
+
+        if (req) { req->state = RIG_WORKER_RUNNING; }
+
+        pthread_mutex_unlock(&w->lock);
+
+        if (req)
+        {
+            retcode = req->func(w->rig, req->arg);
+        }
+
+        if (w->sync_cb) { w->sync_cb(0); }
+
+        pthread_mutex_lock(&w->lock);
+
+        if (req)
+        {
+            req->retcode = retcode;
+            req->state = RIG_WORKER_DONE;
+            pthread_cond_broadcast(&w->done);
+        }
+    }
+
+    pthread_mutex_unlock(&w->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+
+static void rig_worker_deadline(struct timespec *until, int ms)
+{
+    clock_gettime(CLOCK_REALTIME, until);
+    until->tv_sec += ms / 1000;
+    until->tv_nsec += (long)(ms % 1000) * 1000000L;
+
+    if (until->tv_nsec >= 1000000000L)
+    {
+        until->tv_sec++;
+        until->tv_nsec -= 1000000000L;
+    }
+}
+#endif
+
+/**
+ * \brief start running the requests of rig_worker_call() on a thread
+ * \param rig   The rig handle
+ * \param sync_cb Called with 1 before and 0 after the worker runs a
+ * request, NULL if the application does not serialize rig calls itself
+ *
+ * Starts the worker of the rig.  Without it, or without thread support,
+ * rig_worker_call() runs the request on the calling thread.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_worker_call(), rig_worker_stop()
+ */
+int HAMLIB_API rig_worker_start(RIG *rig, void (*sync_cb)(int lock))
+{
+    struct rig_worker *w;
+
+    ENTERFUNC;
+
+    if (!rig || !rig->caps)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    if (rig->state.worker != NULL)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
+#ifdef HAVE_PTHREAD
+    w = calloc(1, sizeof(*w));
+
+    if (w == NULL)
+    {
+        RETURNFUNC(-RIG_ENOMEM);
+    }
+
+    w->rig = rig;
+    w->sync_cb = sync_cb;
+    w->run = 1;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->queued, NULL);
+    pthread_cond_init(&w->done, NULL);
+
+    if (pthread_create(&w->thread, NULL, rig_worker_thread, w))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->queued);
+        pthread_mutex_destroy(&w->lock);
+        free(w);
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
+
+    rig->state.worker = w;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: rig calls go through the worker\n",
+              __func__);
+#else
+    (void)w;
+    (void)sync_cb;
+#endif
+
+    RETURNFUNC(RIG_OK);
+}
+
+/**
+ * \brief run a function on the worker of the rig and wait for it
+ * \param rig   The rig handle
+ * \param func  Makes the rig calls, its return value is returned
+ * \param arg   Passed to \a func
+ * \param urgent 1 to run before every request not running yet, for PTT
+ * \param timeout_ms Give up on a request not started after this many ms,
+ * 0 to wait as long as it takes
+ *
+ * Queues \a func and returns its result once the worker ran it, see
+ * rig_worker_start().  Called from the worker itself, or when no worker
+ * runs, \a func is called right away.
+ *
+ * \return the return value of \a func, -RIG_BUSBUSY if it was not started
+ * within \a timeout_ms, -RIG_EIO if the worker was stopped before.
+ *
+ * \sa rig_worker_start()
+ */
+int HAMLIB_API rig_worker_call(RIG *rig, rig_worker_func_t func,
+                               rig_ptr_t arg, int urgent, int timeout_ms)
+{
+    struct rig_worker *w;
+    struct rig_worker_req req;
+
+    if (!rig || !rig->caps || !func)
+    {
+        return -RIG_EINVAL;
+    }
+
+    w = (struct rig_worker *)rig->state.worker;
+
+    if (w == NULL)
+    {
+        return func(rig, arg);
+    }
+
+#ifdef HAVE_PTHREAD
+    {
+        struct timespec until;
+        int retcode;
+
+        if (pthread_equal(pthread_self(), w->thread))
+        {
+            return func(rig, arg);
+        }
+
+        memset(&req, 0, sizeof(req));
+        req.func = func;
+        req.arg = arg;
+        req.urgent = urgent;
+        req.state = RIG_WORKER_QUEUED;
+
+        if (timeout_ms > 0) { rig_worker_deadline(&until, timeout_ms); }
+
+        pthread_mutex_lock(&w->lock);
+
+        if (!w->run)
+        {
+            pthread_mutex_unlock(&w->lock);
+            return -RIG_EIO;
+        }
+
+        rig_worker_push(w, &req);
+        w->waiters++;
+        pthread_cond_signal(&w->queued);
+
+        while (req.state != RIG_WORKER_DONE)
+        {
+            if (timeout_ms > 0 && req.state == RIG_WORKER_QUEUED)
+            {
+                if (pthread_cond_timedwait(&w->done, &w->lock, &until) == ETIMEDOUT
+                        && req.state == RIG_WORKER_QUEUED)
+                {
+                    rig_worker_unlink(w, &req);
+                    req.retcode = -RIG_BUSBUSY;
+                    rig_debug(RIG_DEBUG_WARN, "%s: request not started within %dms\n",
+                              __func__, timeout_ms);
+                    break;
+                }
+            }
+            else
+            {
+                pthread_cond_wait(&w->done, &w->lock);
+            }
+        }
+
+        retcode = req.retcode;
+
+        /* rig_worker_free() waits for the last one */
+        if (--w->waiters == 0) { pthread_cond_broadcast(&w->done); }
+
+        pthread_mutex_unlock(&w->lock);
+
+        return retcode;
+    }
+#else
+    (void)req;
+    return func(rig, arg);
+#endif
+}
+
+/* stops the worker, requests still queued fail with -RIG_EIO */
+void rig_worker_free(RIG *rig)
+{
+    struct rig_worker *w = (struct rig_worker *)rig->state.worker;
+
+    if (w == NULL)
+    {
+        return;
+    }
+
+#ifdef HAVE_PTHREAD
+    {
+        struct rig_worker_req *req;
+
+        pthread_mutex_lock(&w->lock);
+        w->run = 0;
+        pthread_cond_signal(&w->queued);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+
+        pthread_mutex_lock(&w->lock);
+
+        while ((req = rig_worker_pop(w)) != NULL)
+        {
+            req->retcode = -RIG_EIO;
+            req->state = RIG_WORKER_DONE;
+        }
+
+        pthread_cond_broadcast(&w->done);
+
+        while (w->waiters > 0)
+        {
+            pthread_cond_wait(&w->done, &w->lock);
+        }
+
+        pthread_mutex_unlock(&w->lock);
+
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->queued);
+        pthread_mutex_destroy(&w->lock);
+    }
+#endif
+
+    free(w);
+    rig->state.worker = NULL;
+}
+
+/**
+ * \brief stop the worker of the rig
+ * \param rig   The rig handle
+ *
+ * Waits for the request running and stops the worker, requests still
+ * queued fail with -RIG_EIO.  Call it without the lock given to
+ * rig_worker_start() held, the worker may wait for it.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_worker_start()
+ */
+int HAMLIB_API rig_worker_stop(RIG *rig)
+{
+    ENTERFUNC;
+
+    if (!rig || !rig->caps)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    rig_worker_free(rig);
+
+    RETURNFUNC(RIG_OK);
+}
@@ -41,6 +41,7 @@
 
 #include "rot_conf.h"
 #include "token.h"
+#include "cfpindex.h"
 
 
 /*
@@ -595,6 +596,21 @@ int HAMLIB_API rot_token_foreach(ROT *rot,
 }
 
 
+/* hashed lookup of the conf tables, in the order searched below */
+static const struct cfp_index *rot_conf_index(const ROT *rot)
+{
+    const struct confparams *const tables[] =
+    {
+        rot->caps->cfgparams,
+        rotfrontend_cfg_params,
+        rot->caps->port_type == RIG_PORT_SERIAL ? rotfrontend_serial_cfg_params : NULL
+    };
+
+    return cfp_index_get(rot->caps, CFP_INDEX_ROT_CONF, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
+
 /**
  * \brief Query a rotator configuration parameter token by its name.
  *
@@ -612,13 +628,14 @@ int HAMLIB_API rot_token_foreach(ROT *rot,
  *
  * \sa rot_token_lookup()
  *
- * TODO: Should use Lex to speed it up, strcmp() hurts!
+ * Uses a hash index of the tables, built on first use.
  */
 const struct confparams *HAMLIB_API rot_confparam_lookup(ROT *rot,
         const char *name)
 {
     const struct confparams *cfp;
     token_t token;
+    const struct cfp_index *idx;
 
     //rot_debug(RIG_DEBUG_VERBOSE, "%s called lookup=%s\n", __func__, name);
 
@@ -630,6 +647,13 @@ const struct confparams *HAMLIB_API rot_confparam_lookup(ROT *rot,
     /* 0 returned for invalid format */
     token = strtol(name, NULL, 0);
 
+    idx = rot_conf_index(rot);
+
+    if (idx)
+    {
+        return cfp_index_name_or_token(idx, name, token);
+    }
+
     //rig_debug(RIG_DEBUG_TRACE, "%s: token=%d\n", __func__, (int)token);
     for (cfp = rot->caps->cfgparams; cfp && cfp->name; cfp++)
     {
@@ -47,6 +47,7 @@
 #include <hamlib/rotator.h>
 
 #include "token.h"
+#include "cfpindex.h"
 
 static int rot_has_ext_token(ROT *rot, token_t token)
 {
@@ -240,6 +241,18 @@ int HAMLIB_API rot_ext_parm_foreach(ROT *rot,
 }
 
 
+/* hashed lookup of the ext tables, in the order searched below */
+static const struct cfp_index *rot_ext_index(const ROT *rot)
+{
+    const struct confparams *const tables[] =
+    {
+        rot->caps->extlevels, rot->caps->extfuncs, rot->caps->extparms
+    };
+
+    return cfp_index_get(rot->caps, CFP_INDEX_ROT_EXT, tables,
+                         sizeof(tables) / sizeof(tables[0]));
+}
+
 /**
  * \brief Lookup an extension functions, levels, or parameters token by its
  * name and return a pointer to the containing #confparams structure member.
@@ -258,11 +271,12 @@ int HAMLIB_API rot_ext_parm_foreach(ROT *rot,
  *
  * \sa rot_ext_token_lookup()
  *
- * \todo Should use Lex to speed it up, strcmp() hurts!
+ * Uses a hash index of the tables, built on first use.
  */
 const struct confparams *HAMLIB_API rot_ext_lookup(ROT *rot, const char *name)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -271,6 +285,13 @@ const struct confparams *HAMLIB_API rot_ext_lookup(ROT *rot, const char *name)
         return NULL;
     }
 
+    idx = rot_ext_index(rot);
+
+    if (idx)
+    {
+        return cfp_index_name(idx, name);
+    }
+
     for (cfp = rot->caps->extlevels; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name))
@@ -315,6 +336,7 @@ const struct confparams *HAMLIB_API rot_ext_lookup(ROT *rot, const char *name)
 const struct confparams *HAMLIB_API rot_ext_lookup_tok(ROT *rot, token_t token)
 {
     const struct confparams *cfp;
+    const struct cfp_index *idx;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -323,6 +345,13 @@ const struct confparams *HAMLIB_API rot_ext_lookup_tok(ROT *rot, token_t token)
         return NULL;
     }
 
+    idx = rot_ext_index(rot);
+
+    if (idx)
+    {
+        return cfp_index_token(idx, token);
+    }
+
     for (cfp = rot->caps->extlevels; cfp && cfp->token; cfp++)
     {
         if (cfp->token == token)
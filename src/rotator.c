@@ -63,8 +63,10 @@
 #include "usb_port.h"
 #endif
 #include "network.h"
+#include "ioreactor.h"
 #include "rot_conf.h"
 #include "token.h"
+#include "misc.h"
 
 
 #ifndef DOC_HIDDEN
@@ -496,6 +498,13 @@ int HAMLIB_API rot_open(ROT *rot)
         return -RIG_EINVAL;
     }
 
+    if (rs->rotport.type.rig == RIG_PORT_SERIAL
+            || rs->rotport.type.rig == RIG_PORT_NETWORK
+            || rs->rotport.type.rig == RIG_PORT_UDP_NETWORK)
+    {
+        io_reactor_add(&rs->rotport);
+    }
+
     add_opened_rot(rot);
 
     rs->comm_state = 1;
@@ -568,6 +577,8 @@ int HAMLIB_API rot_close(ROT *rot)
     }
 
 
+    io_reactor_remove(&rs->rotport);
+
     if (rs->rotport.fd != -1)
     {
         switch (rs->rotport.type.rig)
@@ -757,7 +768,7 @@ int HAMLIB_API rot_get_position(ROT *rot,
                                 elevation_t *elevation)
 {
     const struct rot_caps *caps;
-    const struct rot_state *rs;
+    struct rot_state *rs;
     azimuth_t az;
     elevation_t el;
     int retval;
@@ -792,6 +803,10 @@ int HAMLIB_API rot_get_position(ROT *rot,
     *azimuth = az - rot->state.az_offset;
     *elevation = el - rot->state.el_offset;
 
+    rs->last_az = *azimuth;
+    rs->last_el = *elevation;
+    elapsed_ms(&rs->last_position_time, HAMLIB_ELAPSED_SET);
+
     return RIG_OK;
 }
 
@@ -85,9 +85,6 @@
 
 #include "microham.h"
 
-static int uh_ptt_fd   = -1;
-static int uh_radio_fd = -1;
-
 //! @cond Doxygen_Suppress
 typedef struct term_options_backup
 {
@@ -106,23 +103,26 @@ static term_options_backup_t *term_options_backup_head = NULL;
 
 
 /*
- * This function simply returns TRUE if the argument matches uh_radio_fd and
- * is >= 0
+ * This function simply returns TRUE if the argument is the RADIO channel
+ * of a microHam device
  *
  * This function is only used in the WIN32 case and implements access "from
- * outside" to uh_radio_fd.
+ * outside" to the microHam radio fds.
  */
 //! @cond Doxygen_Suppress
 int is_uh_radio_fd(int fd)
 {
-    if (uh_radio_fd >= 0 && uh_radio_fd == fd)
-    {
-        return 1;
-    }
-    else
-    {
-        return 0;
-    }
+    return uh_is_radio_fd(fd);
+}
+
+
+/*
+ * "uh-rig"/"uh-ptt" use the first microHam device found,
+ * "uh-rig:<path>"/"uh-ptt:<path>" the one at path
+ */
+static const char *uh_device(const char *pathname)
+{
+    return pathname[6] == ':' && pathname[7] ? pathname + 7 : NULL;
 }
 //! @endcond
 
@@ -149,7 +149,7 @@ int HAMLIB_API serial_open(hamlib_port_t *rp)
     if (!strncmp(rp->pathname, "uh-rig", 6))
     {
         /*
-         * If the pathname is EXACTLY "uh-rig", try to use a microHam device
+         * If the pathname is "uh-rig" or "uh-rig:<path>", try to use a microHam device
          * rather than a conventional serial port.
          * The microHam devices ALWAYS use "no parity", and can either use no handshake
          * or hardware handshake. Return with error if something else is requested.
@@ -169,7 +169,8 @@ int HAMLIB_API serial_open(hamlib_port_t *rp)
          * Note that serial setup is also don in uh_open_radio.
          * So we need to dig into serial_setup().
          */
-        fd = uh_open_radio(
+        fd = uh_open_radio_dev(
+                 uh_device(rp->pathname),
                  rp->parm.serial.rate,                                  // baud
                  rp->parm.serial.data_bits,                              // databits
                  rp->parm.serial.stop_bits,                              // stopbits
@@ -190,9 +191,8 @@ int HAMLIB_API serial_open(hamlib_port_t *rp)
          *
          * CAVEAT: for WIN32, it might be necessary to use win_serial_read() instead
          *         of read() for serial lines in iofunc.c. Therefore, we have to
-         *         export uh_radio_fd to iofunc.c because in the case of sockets,
+         *         export is_uh_radio_fd() to iofunc.c because in the case of sockets,
          *         read() must be used also in the WIN32 case.
-         *         This is why uh_radio_fd is declared globally in microham.h.
          * Notes from Joe Subich about microham behavior
          * Microham debug tags
          * A-RX ; Asynchronous data received (data not responsive to any
@@ -212,7 +212,6 @@ int HAMLIB_API serial_open(hamlib_port_t *rp)
          *    "auto-information" or CI-V enabled.  In that case asynchronous data
          *    from the transceiver will be returned to both applications.
          */
-        uh_radio_fd = fd;
         return (RIG_OK);
     }
 
@@ -730,7 +729,7 @@ int HAMLIB_API serial_flush(hamlib_port_t *p)
     short timeout_retry_save;
     unsigned char buf[4096];
 
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd || p->flushx)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd) || p->flushx)
     {
         /*
          * Catch microHam case:
@@ -833,13 +832,12 @@ int ser_open(hamlib_port_t *p)
             /*
              * Use microHam device for doing PTT. Although a valid file
              * descriptor is returned, it is not used for anything
-             * but must be remembered in a global variable:
+             * but is known to microham.c:
              * If it is tried later to set/unset DTR on this fd, we know
              * that we cannot use ioctl and must rather call our
              * PTT set/unset service routine.
              */
-            ret = uh_open_ptt();
-            uh_ptt_fd = ret;
+            ret = uh_open_ptt_dev(uh_device(p->pathname));
         }
         else
         {
@@ -884,20 +882,10 @@ int ser_close(hamlib_port_t *p)
      * For microHam devices, do not close the
      * socket via close but call a service routine
      * (which might decide to keep the socket open).
-     * However, unset p->fd and uh_ptt_fd/uh_radio_fd.
+     * However, unset p->fd.
      */
-    if (p->fd == uh_ptt_fd)
-    {
-        uh_close_ptt();
-        uh_ptt_fd = -1;
-        p->fd = -1;
-        return (0);
-    }
-
-    if (p->fd == uh_radio_fd)
+    if (uh_close_fd(p->fd) == 0)
     {
-        uh_close_radio();
-        uh_radio_fd = -1;
         p->fd = -1;
         return (0);
     }
@@ -991,7 +979,7 @@ int HAMLIB_API ser_set_rts(hamlib_port_t *p, int state)
     rig_debug(RIG_DEBUG_VERBOSE, "%s: RTS=%d\n", __func__, state);
 
     // ignore this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (RIG_OK);
     }
@@ -1041,7 +1029,7 @@ int HAMLIB_API ser_get_rts(hamlib_port_t *p, int *state)
     unsigned int y;
 
     // cannot do this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (-RIG_ENIMPL);
     }
@@ -1068,14 +1056,14 @@ int HAMLIB_API ser_set_dtr(hamlib_port_t *p, int state)
 
     // silently ignore on microHam RADIO channel,
     // but (un)set ptt on microHam PTT channel.
-    if (p->fd == uh_radio_fd)
+    if (uh_is_radio_fd(p->fd))
     {
         return (RIG_OK);
     }
 
-    if (p->fd == uh_ptt_fd)
+    if (uh_is_ptt_fd(p->fd))
     {
-        uh_set_ptt(state);
+        uh_set_ptt_fd(p->fd, state);
         return (RIG_OK);
     }
 
@@ -1124,13 +1112,13 @@ int HAMLIB_API ser_get_dtr(hamlib_port_t *p, int *state)
     unsigned int y;
 
     // cannot do this for the RADIO port, return PTT state for the PTT port
-    if (p->fd == uh_ptt_fd)
+    if (uh_is_ptt_fd(p->fd))
     {
-        *state = uh_get_ptt();
+        *state = uh_get_ptt_fd(p->fd);
         return (RIG_OK);
     }
 
-    if (p->fd == uh_radio_fd)
+    if (uh_is_radio_fd(p->fd))
     {
         return (-RIG_ENIMPL);
     }
@@ -1151,7 +1139,7 @@ int HAMLIB_API ser_get_dtr(hamlib_port_t *p, int *state)
 int HAMLIB_API ser_set_brk(hamlib_port_t *p, int state)
 {
     // ignore this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (RIG_OK);
     }
@@ -1176,7 +1164,7 @@ int HAMLIB_API ser_get_car(hamlib_port_t *p, int *state)
     unsigned int y;
 
     // cannot do this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (-RIG_ENIMPL);
     }
@@ -1199,7 +1187,7 @@ int HAMLIB_API ser_get_cts(hamlib_port_t *p, int *state)
     unsigned int y;
 
     // cannot do this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (-RIG_ENIMPL);
     }
@@ -1222,7 +1210,7 @@ int HAMLIB_API ser_get_dsr(hamlib_port_t *p, int *state)
     unsigned int y;
 
     // cannot do this for microHam ports
-    if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
+    if (uh_is_ptt_fd(p->fd) || uh_is_radio_fd(p->fd))
     {
         return (-RIG_ENIMPL);
     }
@@ -44,6 +44,8 @@
 #include <hamlib/rig.h>
 #include "cal.h"
 #include "misc.h"
+#include "rig_stats.h"
+#include "morse.h"
 
 
 #ifndef DOC_HIDDEN
@@ -75,6 +77,7 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
+    struct timespec begin;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -83,7 +86,10 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     if (caps->set_level == NULL || !rig_has_set_level(rig, level))
     {
@@ -94,7 +100,17 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
-        return caps->set_level(rig, vfo, level, val);
+        retcode = caps->set_level(rig, vfo, level, val);
+        rig_stats_call(rig, RIG_STATS_OP_SET_LEVEL, level, &begin);
+
+        if (retcode == RIG_OK)
+        {
+            rig_stats_value(rig, level, &val);
+
+            if (level == RIG_LEVEL_KEYSPD) { morse_set_wpm(rig, val.i); }
+        }
+
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -112,6 +128,15 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
 
     retcode = caps->set_level(rig, vfo, level, val);
     caps->set_vfo(rig, curr_vfo);
+    rig_stats_call(rig, RIG_STATS_OP_SET_LEVEL, level, &begin);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_value(rig, level, &val);
+
+        if (level == RIG_LEVEL_KEYSPD) { morse_set_wpm(rig, val.i); }
+    }
+
     return retcode;
 }
 
@@ -145,6 +170,7 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
+    struct timespec begin;
 
     // too verbose
     //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
@@ -154,7 +180,10 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     if (caps->get_level == NULL || !rig_has_get_level(rig, level))
     {
@@ -188,8 +217,15 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
+        retcode = caps->get_level(rig, vfo, level, val);
+        rig_stats_call(rig, RIG_STATS_OP_GET_LEVEL, level, &begin);
+
+        if (retcode == RIG_OK)
+        {
+            rig_stats_value(rig, level, val);
+        }
 
-        return caps->get_level(rig, vfo, level, val);
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -207,6 +243,13 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
 
     retcode = caps->get_level(rig, vfo, level, val);
     caps->set_vfo(rig, curr_vfo);
+    rig_stats_call(rig, RIG_STATS_OP_GET_LEVEL, level, &begin);
+
+    if (retcode == RIG_OK)
+    {
+        rig_stats_value(rig, level, val);
+    }
+
     return retcode;
 }
 
@@ -229,6 +272,9 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
  */
 int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
 {
+    struct timespec begin;
+    int retcode;
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_RIG_ARG(rig))
@@ -236,12 +282,18 @@ int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     if (rig->caps->set_parm == NULL || !rig_has_set_parm(rig, parm))
     {
         return -RIG_ENAVAIL;
     }
 
-    return rig->caps->set_parm(rig, parm, val);
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
+    retcode = rig->caps->set_parm(rig, parm, val);
+    rig_stats_call(rig, RIG_STATS_OP_SET_PARM, parm, &begin);
+
+    return retcode;
 }
 
 
@@ -263,6 +315,9 @@ int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
  */
 int HAMLIB_API rig_get_parm(RIG *rig, setting_t parm, value_t *val)
 {
+    struct timespec begin;
+    int retcode;
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_RIG_ARG(rig) || !val)
@@ -270,12 +325,18 @@ int HAMLIB_API rig_get_parm(RIG *rig, setting_t parm, value_t *val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     if (rig->caps->get_parm == NULL || !rig_has_get_parm(rig, parm))
     {
         return -RIG_ENAVAIL;
     }
 
-    return rig->caps->get_parm(rig, parm, val);
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
+    retcode = rig->caps->get_parm(rig, parm, val);
+    rig_stats_call(rig, RIG_STATS_OP_GET_PARM, parm, &begin);
+
+    return retcode;
 }
 
 
@@ -479,6 +540,7 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
+    struct timespec begin;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -487,7 +549,10 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     if ((caps->set_func == NULL || !rig_has_set_func(rig, func))
             && access(rig->state.tuner_control_pathname, X_OK) == -1)
@@ -521,8 +586,9 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
-
-        return caps->set_func(rig, vfo, func, status);
+        retcode = caps->set_func(rig, vfo, func, status);
+        rig_stats_call(rig, RIG_STATS_OP_SET_FUNC, func, &begin);
+        return retcode;
     }
     else
     {
@@ -546,6 +612,7 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
 
     retcode = caps->set_func(rig, vfo, func, status);
     caps->set_vfo(rig, curr_vfo);
+    rig_stats_call(rig, RIG_STATS_OP_SET_FUNC, func, &begin);
 
     return retcode;
 }
@@ -575,6 +642,7 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
+    struct timespec begin;
 
     // too verbose
     //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
@@ -584,7 +652,10 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
 
     if (caps->get_func == NULL || !rig_has_get_func(rig, func))
     {
@@ -595,8 +666,9 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
-
-        return caps->get_func(rig, vfo, func, status);
+        retcode = caps->get_func(rig, vfo, func, status);
+        rig_stats_call(rig, RIG_STATS_OP_GET_FUNC, func, &begin);
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -614,6 +686,7 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
 
     retcode = caps->get_func(rig, vfo, func, status);
     caps->set_vfo(rig, curr_vfo);
+    rig_stats_call(rig, RIG_STATS_OP_GET_FUNC, func, &begin);
 
     return retcode;
 }
@@ -650,6 +723,8 @@ int HAMLIB_API rig_set_ext_level(RIG *rig,
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_ext_level == NULL)
@@ -716,6 +791,8 @@ int HAMLIB_API rig_get_ext_level(RIG *rig,
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_ext_level == NULL)
@@ -781,6 +858,8 @@ int HAMLIB_API rig_set_ext_func(RIG *rig,
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_ext_func == NULL)
@@ -847,6 +926,8 @@ int HAMLIB_API rig_get_ext_func(RIG *rig,
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_ext_func == NULL)
@@ -905,6 +986,8 @@ int HAMLIB_API rig_set_ext_parm(RIG *rig, token_t token, value_t val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     if (rig->caps->set_ext_parm == NULL)
     {
         return -RIG_ENAVAIL;
@@ -937,6 +1020,8 @@ int HAMLIB_API rig_get_ext_parm(RIG *rig, token_t token, value_t *val)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     if (rig->caps->get_ext_parm == NULL)
     {
         return -RIG_ENAVAIL;
@@ -0,0 +1,302 @@
+/*
+ *  Hamlib Interface - spectrum line decimation, averaging and rate limiting
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file spectrum_proc.c
+ * \brief Spectrum line processing between the backend and the consumers
+ *
+ * Scopes send more and longer lines than most waterfalls draw.  Each line
+ * can be reduced to "spectrum_bins" bins, keeping the strongest point of
+ * each bin, smoothed with an exponential average ("spectrum_avg") and
+ * replaced by the running maximum ("spectrum_max_hold").  "spectrum_rate"
+ * limits the lines passed on per scope; lines in between still feed the
+ * average and the maximum so nothing short is lost.
+ *
+ * Lines come from the one thread delivering spectrum events for a rig,
+ * so the state needs no lock.  The kernels are plain loops over float
+ * arrays without branches the compiler can vectorize.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "spectrum_proc.h"
+#include "misc.h"
+
+struct spectrum_proc_scope
+{
+    int valid;
+    struct rig_spectrum_line last;      /* geometry of the previous line */
+    size_t bins;
+    size_t start[HAMLIB_MAX_SPECTRUM_DATA + 1];     /* first point of bin i */
+    int have_avg;
+    int have_hold;
+    struct timespec sent;
+    float cur[HAMLIB_MAX_SPECTRUM_DATA];
+    float avg[HAMLIB_MAX_SPECTRUM_DATA];
+    float hold[HAMLIB_MAX_SPECTRUM_DATA];
+    unsigned char data[HAMLIB_MAX_SPECTRUM_DATA];
+    struct rig_spectrum_line line;
+};
+
+struct spectrum_proc
+{
+    int bins;
+    float avg;
+    int max_hold;
+    float rate;
+    struct spectrum_proc_scope scope[HAMLIB_MAX_SPECTRUM_SCOPES];
+};
+
+static void spectrum_kernel_widen(float *dst, const unsigned char *src,
+                                  size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        dst[i] = src[i];
+    }
+}
+
+/* strongest point of each bin, a waterfall must not lose narrow signals */
+static void spectrum_kernel_decimate(float *dst, const unsigned char *src,
+                                     const size_t *start, size_t bins)
+{
+    size_t i, j;
+
+    for (i = 0; i < bins; i++)
+    {
+        unsigned char m = 0;
+
+        for (j = start[i]; j < start[i + 1]; j++)
+        {
+            m = src[j] > m ? src[j] : m;
+        }
+
+        dst[i] = m;
+    }
+}
+
+static void spectrum_kernel_average(float *avg, const float *cur, float alpha,
+                                    size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        avg[i] += alpha * (cur[i] - avg[i]);
+    }
+}
+
+static void spectrum_kernel_max(float *hold, const float *cur, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        hold[i] = cur[i] > hold[i] ? cur[i] : hold[i];
+    }
+}
+
+static void spectrum_kernel_narrow(unsigned char *dst, const float *src,
+                                   size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        dst[i] = (unsigned char)(src[i] + 0.5f);
+    }
+}
+
+static int spectrum_proc_same_geometry(const struct rig_spectrum_line *a,
+                                       const struct rig_spectrum_line *b)
+{
+    return a->spectrum_mode == b->spectrum_mode
+           && a->spectrum_data_length == b->spectrum_data_length
+           && a->center_freq == b->center_freq
+           && a->span_freq == b->span_freq
+           && a->low_edge_freq == b->low_edge_freq
+           && a->high_edge_freq == b->high_edge_freq;
+}
+
+static void spectrum_proc_reset(struct spectrum_proc_scope *s,
+                                const struct rig_spectrum_line *line, int bins)
+{
+    size_t len = line->spectrum_data_length;
+    size_t i;
+
+    s->valid = 1;
+    s->last = *line;
+    s->have_avg = 0;
+    s->have_hold = 0;
+    s->bins = (bins > 0 && len > (size_t) bins) ? (size_t) bins : len;
+
+    for (i = 0; i <= s->bins; i++)
+    {
+        s->start[i] = i * len / s->bins;
+    }
+}
+
+/**
+ * \brief Run a spectrum line through the processing stage
+ * \param rig the rig the line came from
+ * \param line line from the backend
+ * \return the line to pass on, line itself when nothing is configured,
+ * or NULL when the rate limit holds it back
+ */
+struct rig_spectrum_line *spectrum_proc_line(RIG *rig,
+        struct rig_spectrum_line *line)
+{
+    struct rig_state *rs = &rig->state;
+    struct spectrum_proc *p = rs->spectrum_proc;
+    struct spectrum_proc_scope *s;
+    const float *out;
+    size_t n;
+    int due;
+
+    if (rs->spectrum_bins <= 0 && rs->spectrum_avg <= 0
+            && !rs->spectrum_max_hold && rs->spectrum_rate <= 0)
+    {
+        return line;
+    }
+
+    if (line->id < 0 || line->id >= HAMLIB_MAX_SPECTRUM_SCOPES
+            || line->spectrum_data_length == 0
+            || line->spectrum_data_length > HAMLIB_MAX_SPECTRUM_DATA)
+    {
+        return line;
+    }
+
+    if (!p)
+    {
+        p = calloc(1, sizeof(*p));
+
+        if (!p)
+        {
+            return line;
+        }
+
+        rs->spectrum_proc = p;
+    }
+
+    if (p->bins != rs->spectrum_bins || p->avg != rs->spectrum_avg
+            || p->max_hold != rs->spectrum_max_hold || p->rate != rs->spectrum_rate)
+    {
+        int i;
+
+        p->bins = rs->spectrum_bins;
+        p->avg = rs->spectrum_avg;
+        p->max_hold = rs->spectrum_max_hold;
+        p->rate = rs->spectrum_rate;
+
+        for (i = 0; i < HAMLIB_MAX_SPECTRUM_SCOPES; i++)
+        {
+            p->scope[i].valid = 0;
+        }
+    }
+
+    s = &p->scope[line->id];
+
+    if (!s->valid || !spectrum_proc_same_geometry(&s->last, line))
+    {
+        spectrum_proc_reset(s, line, p->bins);
+    }
+
+    due = p->rate <= 0
+          || elapsed_ms(&s->sent, HAMLIB_ELAPSED_GET) >= 1000.0 / p->rate;
+
+    // without averaging or holding a line not sent is not needed at all
+    if (!due && p->avg <= 0 && !p->max_hold)
+    {
+        return NULL;
+    }
+
+    n = s->bins;
+
+    if (n < line->spectrum_data_length)
+    {
+        spectrum_kernel_decimate(s->cur, line->spectrum_data, s->start, n);
+    }
+    else
+    {
+        spectrum_kernel_widen(s->cur, line->spectrum_data, n);
+    }
+
+    out = s->cur;
+
+    if (p->avg > 0 && p->avg < 1)
+    {
+        if (s->have_avg)
+        {
+            spectrum_kernel_average(s->avg, s->cur, p->avg, n);
+        }
+        else
+        {
+            memcpy(s->avg, s->cur, n * sizeof(float));
+            s->have_avg = 1;
+        }
+
+        out = s->avg;
+    }
+
+    if (p->max_hold)
+    {
+        if (s->have_hold)
+        {
+            spectrum_kernel_max(s->hold, out, n);
+        }
+        else
+        {
+            memcpy(s->hold, out, n * sizeof(float));
+            s->have_hold = 1;
+        }
+
+        out = s->hold;
+    }
+
+    if (!due)
+    {
+        return NULL;
+    }
+
+    elapsed_ms(&s->sent, HAMLIB_ELAPSED_SET);
+
+    spectrum_kernel_narrow(s->data, out, n);
+
+    s->line = *line;
+    s->line.spectrum_data_length = n;
+    s->line.spectrum_data = s->data;
+
+    return &s->line;
+}
+
+/**
+ * \brief Free the processing state, spectrum events must have stopped
+ */
+void spectrum_proc_free(RIG *rig)
+{
+    free(rig->state.spectrum_proc);
+    rig->state.spectrum_proc = NULL;
+}
@@ -0,0 +1,34 @@
+/*
+ *  Hamlib Interface - spectrum line decimation, averaging and rate limiting
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _SPECTRUM_PROC_H
+#define _SPECTRUM_PROC_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+struct rig_spectrum_line *spectrum_proc_line(RIG *rig,
+        struct rig_spectrum_line *line);
+void spectrum_proc_free(RIG *rig);
+
+__END_DECLS
+
+#endif /* _SPECTRUM_PROC_H */
@@ -0,0 +1,370 @@
+/*
+ *  Hamlib Interface - spectrum line shared memory ring
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file spectrum_ring.c
+ * \brief Shared memory ring of spectrum scope lines
+ *
+ * The writer is the thread delivering spectrum events for one rig, so
+ * there is a single writer per ring and records need no lock.  Readers
+ * are other processes; they validate each record with its sequence
+ * number, see include/hamlib/spectrum_ring.h.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+#include <sys/mman.h>
+#define SPECTRUM_RING_SHM 1
+#endif
+
+#include <hamlib/rig.h>
+#include <hamlib/spectrum_ring.h>
+#include "spectrum_ring.h"
+#include "misc.h"
+
+/* records are read by other processes, order the stores they see */
+#if defined(__GNUC__) || defined(__clang__)
+#define spectrum_ring_barrier() __sync_synchronize()
+#else
+#define spectrum_ring_barrier()
+#endif
+
+struct spectrum_ring
+{
+    struct spectrum_ring_header *hdr;
+    size_t size;
+    int writer;
+    char name[64];
+};
+
+static size_t spectrum_ring_size(void)
+{
+    return sizeof(struct spectrum_ring_header)
+           + SPECTRUM_RING_RECORDS * sizeof(struct spectrum_ring_record);
+}
+
+/**
+ * \brief Create the shared memory object, replacing a stale one
+ * \param name POSIX shm name, e.g. "/hamlib-spectrum"
+ * \param ring the new ring
+ * \return RIG_OK or < 0 on error
+ */
+int spectrum_ring_create(const char *name, struct spectrum_ring **ring)
+{
+#ifdef SPECTRUM_RING_SHM
+    struct spectrum_ring *r;
+    int fd;
+
+    *ring = NULL;
+
+    r = calloc(1, sizeof(*r));
+
+    if (!r)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    SNPRINTF(r->name, sizeof(r->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    r->size = spectrum_ring_size();
+    r->writer = 1;
+
+    // a previous process may have died without unlinking it
+    shm_unlink(r->name);
+
+    fd = shm_open(r->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+
+    if (fd < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: shm_open(%s): %s\n", __func__, r->name,
+                  strerror(errno));
+        free(r);
+        return -RIG_EIO;
+    }
+
+    if (ftruncate(fd, r->size) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: ftruncate: %s\n", __func__, strerror(errno));
+        close(fd);
+        shm_unlink(r->name);
+        free(r);
+        return -RIG_EIO;
+    }
+
+    r->hdr = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (r->hdr == MAP_FAILED)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: mmap: %s\n", __func__, strerror(errno));
+        shm_unlink(r->name);
+        free(r);
+        return -RIG_EIO;
+    }
+
+    // ftruncate zero filled it, readers check the magic last
+    r->hdr->version = SPECTRUM_RING_VERSION;
+    r->hdr->record_size = sizeof(struct spectrum_ring_record);
+    r->hdr->record_count = SPECTRUM_RING_RECORDS;
+    spectrum_ring_barrier();
+    r->hdr->magic = SPECTRUM_RING_MAGIC;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %s, %d records of %d bytes\n", __func__,
+              r->name, SPECTRUM_RING_RECORDS, (int) sizeof(struct spectrum_ring_record));
+
+    *ring = r;
+
+    return RIG_OK;
+#else
+    rig_debug(RIG_DEBUG_ERR, "%s: no shared memory on this platform\n", __func__);
+    *ring = NULL;
+    return -RIG_ENIMPL;
+#endif
+}
+
+/**
+ * \brief Append a spectrum line
+ *
+ * One copy of the data straight into the shared record, nothing is
+ * formatted or allocated.
+ */
+void spectrum_ring_write(struct spectrum_ring *ring,
+                         const struct rig_spectrum_line *line)
+{
+    struct spectrum_ring_header *hdr = ring->hdr;
+    struct spectrum_ring_record *rec;
+    uint32_t n = hdr->head;
+    size_t len = line->spectrum_data_length;
+    struct timespec ts;
+
+    if (len > HAMLIB_MAX_SPECTRUM_DATA)
+    {
+        len = HAMLIB_MAX_SPECTRUM_DATA;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    rec = &hdr->records[n % SPECTRUM_RING_RECORDS];
+
+    rec->seq = 2 * n + 1;
+    spectrum_ring_barrier();
+
+    rec->id = line->id;
+    rec->spectrum_mode = line->spectrum_mode;
+    rec->data_level_min = line->data_level_min;
+    rec->data_level_max = line->data_level_max;
+    rec->data_length = len;
+    rec->signal_strength_min = line->signal_strength_min;
+    rec->signal_strength_max = line->signal_strength_max;
+    rec->center_freq = line->center_freq;
+    rec->span_freq = line->span_freq;
+    rec->low_edge_freq = line->low_edge_freq;
+    rec->high_edge_freq = line->high_edge_freq;
+    rec->timestamp_us = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    memcpy(rec->data, line->spectrum_data, len);
+
+    spectrum_ring_barrier();
+    rec->seq = 2 * n + 2;
+    hdr->head = n + 1;
+}
+
+/**
+ * \brief Unmap the ring, the writer also removes the shm object
+ */
+void HAMLIB_API spectrum_ring_detach(struct spectrum_ring *ring)
+{
+    if (!ring)
+    {
+        return;
+    }
+
+#ifdef SPECTRUM_RING_SHM
+    munmap(ring->hdr, ring->size);
+
+    if (ring->writer)
+    {
+        shm_unlink(ring->name);
+    }
+
+#endif
+
+    free(ring);
+}
+
+/**
+ * \brief Map a ring created by another process for reading
+ * \param name the "spectrum_shm" name the rig was opened with
+ * \return the ring or NULL when it does not exist or is not a spectrum ring
+ */
+struct spectrum_ring *HAMLIB_API spectrum_ring_attach(const char *name)
+{
+#ifdef SPECTRUM_RING_SHM
+    struct spectrum_ring *r;
+    struct stat st;
+    int fd;
+
+    r = calloc(1, sizeof(*r));
+
+    if (!r)
+    {
+        return NULL;
+    }
+
+    SNPRINTF(r->name, sizeof(r->name), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    fd = shm_open(r->name, O_RDONLY, 0);
+
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t) spectrum_ring_size())
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, r->name,
+                  fd < 0 ? strerror(errno) : "too small");
+
+        if (fd >= 0) { close(fd); }
+
+        free(r);
+        return NULL;
+    }
+
+    r->size = spectrum_ring_size();
+    r->hdr = mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (r->hdr == MAP_FAILED)
+    {
+        free(r);
+        return NULL;
+    }
+
+    if (r->hdr->magic != SPECTRUM_RING_MAGIC
+            || r->hdr->version != SPECTRUM_RING_VERSION
+            || r->hdr->record_size != sizeof(struct spectrum_ring_record)
+            || r->hdr->record_count != SPECTRUM_RING_RECORDS)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s is not a version %d spectrum ring\n",
+                  __func__, r->name, SPECTRUM_RING_VERSION);
+        munmap(r->hdr, r->size);
+        free(r);
+        return NULL;
+    }
+
+    return r;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * \brief The mapped ring, for readers that want to use records in place
+ */
+const struct spectrum_ring_header *HAMLIB_API spectrum_ring_header(
+    const struct spectrum_ring *ring)
+{
+    return ring->hdr;
+}
+
+/**
+ * \brief Read the next spectrum line
+ * \param ring from spectrum_ring_attach()
+ * \param cursor next line to read, start with the header's head for new
+ * lines only or 0 for everything still in the ring
+ * \param line filled in, spectrum_data points to data
+ * \param data HAMLIB_MAX_SPECTRUM_DATA bytes
+ *
+ * When the reader fell more than a ring behind it skips to the oldest
+ * line still there.
+ *
+ * \return 1 when a line was read, 0 when there is no new line
+ */
+int HAMLIB_API spectrum_ring_read(const struct spectrum_ring *ring,
+                                  uint32_t *cursor, struct rig_spectrum_line *line, unsigned char *data)
+{
+    const struct spectrum_ring_header *hdr = ring->hdr;
+
+    for (;;)
+    {
+        const struct spectrum_ring_record *rec;
+        uint32_t head = hdr->head;
+        uint32_t n = *cursor;
+        uint32_t seq;
+
+        if (head == n)
+        {
+            return 0;
+        }
+
+        if (head - n > SPECTRUM_RING_RECORDS)
+        {
+            n = head - SPECTRUM_RING_RECORDS;
+        }
+
+        rec = &hdr->records[n % SPECTRUM_RING_RECORDS];
+
+        spectrum_ring_barrier();
+        seq = rec->seq;
+        spectrum_ring_barrier();
+
+        if (seq != 2 * n + 2)
+        {
+            // overwritten since head was read, skip ahead
+            *cursor = n + 1;
+            continue;
+        }
+
+        line->id = rec->id;
+        line->spectrum_mode = rec->spectrum_mode;
+        line->data_level_min = rec->data_level_min;
+        line->data_level_max = rec->data_level_max;
+        line->spectrum_data_length = rec->data_length;
+        line->signal_strength_min = rec->signal_strength_min;
+        line->signal_strength_max = rec->signal_strength_max;
+        line->center_freq = rec->center_freq;
+        line->span_freq = rec->span_freq;
+        line->low_edge_freq = rec->low_edge_freq;
+        line->high_edge_freq = rec->high_edge_freq;
+        line->spectrum_data = data;
+        memcpy(data, rec->data, rec->data_length <= HAMLIB_MAX_SPECTRUM_DATA ?
+               rec->data_length : HAMLIB_MAX_SPECTRUM_DATA);
+
+        spectrum_ring_barrier();
+        *cursor = n + 1;
+
+        if (rec->seq == seq)
+        {
+            return 1;
+        }
+    }
+}
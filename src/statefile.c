@@ -0,0 +1,310 @@
+/*
+ *  Hamlib Interface - rig state kept on disk between runs
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file statefile.c
+ * \brief Rig state kept on disk for a fast rig_open()
+ *
+ * rig_open() reads the VFO, both frequencies, the split and the modes
+ * before it returns, a dozen round trips that make every short rigctl run
+ * and every daemon restart wait.  With the "state_file" conf rig_close()
+ * writes the cached VFO, split and per VFO frequency, mode and width to
+ * that file and rig_open() loads them back into the cache as if they had
+ * just been read, so the priming reads are cache hits.  Nothing is taken
+ * on trust for long: a file older than STATE_FILE_MAX_AGE is ignored, and
+ * the loaded frequencies and modes are read back like a write through set
+ * once write_through_ms passed, since the knobs may have been turned while
+ * nothing was running.  PTT is never loaded.
+ *
+ * The file is only used by the same model on the same port and is
+ * rewritten through a temporary file so a crash leaves the old one.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <hamlib/rig.h>
+#include "statefile.h"
+#include "misc.h"
+
+#define STATE_FILE_MAGIC 0x464c5348  /* "HSLF" */
+#define STATE_FILE_VERSION 1
+#define STATE_FILE_MAX_AGE 3600     /* seconds */
+
+struct state_file_map
+{
+    freq_t *freq;
+    struct timespec *time_freq;
+    rmode_t *mode;
+    struct timespec *time_mode;
+    pbwidth_t *width;
+    struct timespec *time_width;
+};
+
+static void state_file_slots(struct rig_cache *c,
+                             struct state_file_map m[STATE_FILE_SLOTS])
+{
+#define STATE_FILE_SLOT(i, n) \
+    m[i].freq = &c->freq##n; m[i].time_freq = &c->time_freq##n; \
+    m[i].mode = &c->mode##n; m[i].time_mode = &c->time_mode##n; \
+    m[i].width = &c->width##n; m[i].time_width = &c->time_width##n;
+
+    STATE_FILE_SLOT(STATE_FILE_MAIN_A, MainA);
+    STATE_FILE_SLOT(STATE_FILE_MAIN_B, MainB);
+    STATE_FILE_SLOT(STATE_FILE_MAIN_C, MainC);
+    STATE_FILE_SLOT(STATE_FILE_SUB_A, SubA);
+    STATE_FILE_SLOT(STATE_FILE_SUB_B, SubB);
+    STATE_FILE_SLOT(STATE_FILE_SUB_C, SubC);
+    STATE_FILE_SLOT(STATE_FILE_MEM, Mem);
+
+#undef STATE_FILE_SLOT
+}
+
+/* the VFOs rig_get_freq() and rig_get_mode() file under each slot */
+static const vfo_t state_file_vfos[STATE_FILE_SLOTS] =
+{
+    [STATE_FILE_MAIN_A] = RIG_VFO_A | RIG_VFO_MAIN | RIG_VFO_MAIN_A,
+    [STATE_FILE_MAIN_B] = RIG_VFO_B | RIG_VFO_SUB | RIG_VFO_MAIN_B,
+    [STATE_FILE_MAIN_C] = RIG_VFO_C | RIG_VFO_MAIN_C,
+    [STATE_FILE_SUB_A] = RIG_VFO_SUB_A,
+    [STATE_FILE_SUB_B] = RIG_VFO_SUB_B,
+    [STATE_FILE_SUB_C] = RIG_VFO_SUB_C,
+    [STATE_FILE_MEM] = RIG_VFO_MEM,
+};
+
+/* an entry that was read or set since rig_init() */
+static int state_file_known(const struct timespec *t)
+{
+    return t->tv_sec != 0 || t->tv_nsec != 0;
+}
+
+/* an entry a read now would be answered from */
+static int state_file_fresh(RIG *rig, struct timespec *t)
+{
+    return state_file_known(t)
+           && elapsed_ms(t, HAMLIB_ELAPSED_GET) < rig_get_cache_timeout_ms(rig,
+                   HAMLIB_CACHE_ALL);
+}
+
+/* reads the file of the rig, 1 if it can be used */
+int state_file_read(RIG *rig, struct state_file *sf)
+{
+    const struct rig_state *rs = &rig->state;
+    FILE *fp;
+    size_t n;
+    time_t age;
+
+    if (rs->state_file == NULL)
+    {
+        return 0;
+    }
+
+    fp = fopen(rs->state_file, "rb");
+
+    if (fp == NULL)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: no state in %s\n", __func__,
+                  rs->state_file);
+        return 0;
+    }
+
+    n = fread(sf, 1, sizeof(*sf), fp);
+    fclose(fp);
+
+    if (n != sizeof(*sf) || sf->magic != STATE_FILE_MAGIC
+            || sf->version != STATE_FILE_VERSION || sf->size != sizeof(*sf))
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: ignoring %s, not a state file of this version\n",
+                  __func__, rs->state_file);
+        return 0;
+    }
+
+    sf->pathname[sizeof(sf->pathname) - 1] = '\0';
+
+    if (sf->model != rig->caps->rig_model
+            || strcmp(sf->pathname, rs->rigport.pathname) != 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: ignoring %s, saved for model %u on %s\n",
+                  __func__, rs->state_file, (unsigned int)sf->model, sf->pathname);
+        return 0;
+    }
+
+    age = time(NULL) - (time_t)sf->saved;
+
+    if (age < 0 || age > STATE_FILE_MAX_AGE)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring %s, saved %lds ago\n", __func__,
+                  rs->state_file, (long)age);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* loads the state into the cache as if it had just been read, what the
+ * backend rig_open() already read is kept; the loaded frequencies and
+ * modes are marked to be read back once write_through_ms passed */
+void state_file_apply(RIG *rig, const struct state_file *sf)
+{
+    struct rig_state *rs = &rig->state;
+    struct state_file_map m[STATE_FILE_SLOTS];
+    int i;
+
+    state_file_slots(&rs->cache, m);
+
+    for (i = 0; i < STATE_FILE_SLOTS; i++)
+    {
+        if ((sf->have_freq & (1u << i)) && !state_file_fresh(rig, m[i].time_freq))
+        {
+            *m[i].freq = sf->freq[i];
+            elapsed_ms(m[i].time_freq, HAMLIB_ELAPSED_SET);
+            rs->verify_freq |= state_file_vfos[i];
+        }
+
+        if ((sf->have_mode & (1u << i)) && !state_file_fresh(rig, m[i].time_mode))
+        {
+            *m[i].mode = sf->mode[i];
+            elapsed_ms(m[i].time_mode, HAMLIB_ELAPSED_SET);
+            rs->verify_mode |= state_file_vfos[i];
+        }
+
+        if ((sf->have_width & (1u << i)) && !state_file_fresh(rig, m[i].time_width))
+        {
+            *m[i].width = sf->width[i];
+            elapsed_ms(m[i].time_width, HAMLIB_ELAPSED_SET);
+        }
+    }
+
+    if (sf->have_vfo && !state_file_fresh(rig, &rs->cache.time_vfo)
+            && !state_file_fresh(rig, &rs->cache.time_split))
+    {
+        rs->current_vfo = sf->current_vfo;
+        rs->tx_vfo = sf->tx_vfo;
+        rs->cache.vfo = sf->vfo;
+        elapsed_ms(&rs->cache.time_vfo, HAMLIB_ELAPSED_SET);
+        rs->cache.split = sf->split;
+        rs->cache.split_vfo = sf->split_vfo;
+        elapsed_ms(&rs->cache.time_split, HAMLIB_ELAPSED_SET);
+        rs->cache.satmode = sf->satmode;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "%s: state of %lds ago loaded from %s, vfo=%s split=%d\n", __func__,
+              (long)(time(NULL) - sf->saved), rs->state_file,
+              rig_strvfo(sf->current_vfo), sf->split);
+}
+
+/* saves the cached state, called by rig_close() */
+void state_file_write(RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+    struct state_file sf;
+    struct state_file_map m[STATE_FILE_SLOTS];
+    char tmp[HAMLIB_FILPATHLEN + 8];
+    FILE *fp;
+    size_t n;
+    int i;
+
+    if (rs->state_file == NULL)
+    {
+        return;
+    }
+
+    memset(&sf, 0, sizeof(sf));
+    sf.magic = STATE_FILE_MAGIC;
+    sf.version = STATE_FILE_VERSION;
+    sf.size = sizeof(sf);
+    sf.model = rig->caps->rig_model;
+    SNPRINTF(sf.pathname, sizeof(sf.pathname), "%s", rs->rigport.pathname);
+    sf.saved = time(NULL);
+
+    state_file_slots(&rs->cache, m);
+
+    for (i = 0; i < STATE_FILE_SLOTS; i++)
+    {
+        if (state_file_known(m[i].time_freq) && *m[i].freq != 0)
+        {
+            sf.freq[i] = *m[i].freq;
+            sf.have_freq |= 1u << i;
+        }
+
+        if (state_file_known(m[i].time_mode) && *m[i].mode != RIG_MODE_NONE)
+        {
+            sf.mode[i] = *m[i].mode;
+            sf.have_mode |= 1u << i;
+        }
+
+        if (state_file_known(m[i].time_width) && *m[i].width > 0)
+        {
+            sf.width[i] = *m[i].width;
+            sf.have_width |= 1u << i;
+        }
+    }
+
+    if (state_file_known(&rs->cache.time_vfo)
+            && state_file_known(&rs->cache.time_split))
+    {
+        sf.have_vfo = 1;
+        sf.current_vfo = rs->current_vfo;
+        sf.tx_vfo = rs->tx_vfo;
+        sf.vfo = rs->cache.vfo;
+        sf.split = rs->cache.split;
+        sf.split_vfo = rs->cache.split_vfo;
+        sf.satmode = rs->cache.satmode;
+    }
+
+    SNPRINTF(tmp, sizeof(tmp), "%s.tmp", rs->state_file);
+    fp = fopen(tmp, "wb");
+
+    if (fp == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: cannot write %s\n", __func__, tmp);
+        return;
+    }
+
+    n = fwrite(&sf, 1, sizeof(sf), fp);
+
+    if (fclose(fp) != 0 || n != sizeof(sf))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: writing %s failed\n", __func__, tmp);
+        remove(tmp);
+        return;
+    }
+
+    if (rename(tmp, rs->state_file) != 0)
+    {
+        /* Windows does not replace an existing file */
+        remove(rs->state_file);
+
+        if (rename(tmp, rs->state_file) != 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: cannot replace %s\n", __func__,
+                      rs->state_file);
+            remove(tmp);
+            return;
+        }
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: state saved to %s\n", __func__,
+              rs->state_file);
+}
@@ -0,0 +1,71 @@
+/*
+ *  Hamlib Interface - rig state kept on disk between runs
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _STATEFILE_H
+#define _STATEFILE_H 1
+
+#include <stdint.h>
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* cache slots, in the order of struct rig_cache */
+enum state_file_slot_e
+{
+    STATE_FILE_MAIN_A,
+    STATE_FILE_MAIN_B,
+    STATE_FILE_MAIN_C,
+    STATE_FILE_SUB_A,
+    STATE_FILE_SUB_B,
+    STATE_FILE_SUB_C,
+    STATE_FILE_MEM,
+    STATE_FILE_SLOTS
+};
+
+struct state_file
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      /* of this struct */
+    rig_model_t model;
+    char pathname[HAMLIB_FILPATHLEN];   /* of the rig port */
+    int64_t saved;                      /* time() of rig_close() */
+    vfo_t current_vfo;
+    vfo_t tx_vfo;
+    vfo_t vfo;                          /* cache.vfo */
+    split_t split;
+    vfo_t split_vfo;
+    int satmode;
+    uint32_t have_vfo;                  /* vfo and the split were read */
+    uint32_t have_freq;                 /* bit per slot */
+    uint32_t have_mode;
+    uint32_t have_width;
+    freq_t freq[STATE_FILE_SLOTS];
+    rmode_t mode[STATE_FILE_SLOTS];
+    pbwidth_t width[STATE_FILE_SLOTS];
+};
+
+int state_file_read(RIG *rig, struct state_file *sf);
+void state_file_apply(RIG *rig, const struct state_file *sf);
+void state_file_write(RIG *rig);
+
+__END_DECLS
+
+#endif /* _STATEFILE_H */
@@ -97,6 +97,24 @@
 #define TOK_TUNER_CONTROL_PATHNAME TOKEN_FRONTEND(38)
 /** \brief Number of retries permitted in case of read timeouts */
 #define TOK_TIMEOUT_RETRY       TOKEN_FRONTEND(39)
+/** \brief POSIX shared memory name for the spectrum line ring */
+#define TOK_SPECTRUM_SHM        TOKEN_FRONTEND(40)
+/** \brief Number of bins spectrum lines are reduced to */
+#define TOK_SPECTRUM_BINS       TOKEN_FRONTEND(41)
+/** \brief Exponential averaging weight of spectrum lines */
+#define TOK_SPECTRUM_AVG        TOKEN_FRONTEND(42)
+/** \brief Maximum hold of spectrum lines */
+#define TOK_SPECTRUM_MAX_HOLD   TOKEN_FRONTEND(43)
+/** \brief Maximum spectrum lines per second per scope */
+#define TOK_SPECTRUM_RATE       TOKEN_FRONTEND(44)
+/** \brief Delay before a written through frequency or mode is read back */
+#define TOK_WRITE_THROUGH       TOKEN_FRONTEND(45)
+/** \brief ms a VFO selected for a call on a non-targetable VFO stays selected */
+#define TOK_VFO_SWAP_HOLD       TOKEN_FRONTEND(46)
+/** \brief File the cached rig state is kept in between runs */
+#define TOK_STATE_FILE          TOKEN_FRONTEND(47)
+/** \brief Serial speed detection and switching at open */
+#define TOK_AUTO_BAUD           TOKEN_FRONTEND(48)
 
 /*
  * rig specific tokens
@@ -36,6 +36,7 @@
 
 #include <hamlib/rig.h>
 #include "tones.h"
+#include "misc.h"
 
 #if !defined(_WIN32) && !defined(__CYGWIN__)
 
@@ -108,6 +109,8 @@ int HAMLIB_API rig_set_ctcss_tone(RIG *rig, vfo_t vfo, tone_t tone)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_ctcss_tone == NULL)
@@ -175,6 +178,8 @@ int HAMLIB_API rig_get_ctcss_tone(RIG *rig, vfo_t vfo, tone_t *tone)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_ctcss_tone == NULL)
@@ -238,6 +243,8 @@ int HAMLIB_API rig_set_dcs_code(RIG *rig, vfo_t vfo, tone_t code)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_dcs_code == NULL)
@@ -300,6 +307,8 @@ int HAMLIB_API rig_get_dcs_code(RIG *rig, vfo_t vfo, tone_t *code)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_dcs_code == NULL)
@@ -370,6 +379,8 @@ int HAMLIB_API rig_set_ctcss_sql(RIG *rig, vfo_t vfo, tone_t tone)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_ctcss_sql == NULL)
@@ -437,6 +448,8 @@ int HAMLIB_API rig_get_ctcss_sql(RIG *rig, vfo_t vfo, tone_t *tone)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_ctcss_sql == NULL)
@@ -499,6 +512,8 @@ int HAMLIB_API rig_set_dcs_sql(RIG *rig, vfo_t vfo, tone_t code)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->set_dcs_sql == NULL)
@@ -561,6 +576,8 @@ int HAMLIB_API rig_get_dcs_sql(RIG *rig, vfo_t vfo, tone_t *code)
         return -RIG_EINVAL;
     }
 
+    VFO_PLAN_SETTLE(rig);
+
     caps = rig->caps;
 
     if (caps->get_dcs_sql == NULL)
@@ -2,7 +2,7 @@ LOCAL_PATH:= $(call my-dir)
 
 include $(CLEAR_VARS)
 
-LOCAL_SRC_FILES := rotctld.c rotctl_parse.c dumpcaps_rot.c ../src/rot_settings.c
+LOCAL_SRC_FILES := rotctld.c metrics.c rotctl_parse.c dumpcaps_rot.c ../src/rot_settings.c
 LOCAL_MODULE := rotctld
 
 LOCAL_CFLAGS := 
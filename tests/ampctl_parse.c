@@ -78,6 +78,9 @@ extern int read_history();
 static pthread_mutex_t amp_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+/* set by ampctld to time commands */
+void (*ampctl_command_done)(const struct timespec *begin);
+
 #define STR1(S) #S
 #define STR(S) STR1(S)
 
@@ -467,6 +470,7 @@ unsigned char resp_sep = '\n';      /* Default response separator */
 int ampctl_parse(AMP *my_amp, FILE *fin, FILE *fout, char *argv[], int argc)
 {
     int retcode;            /* generic return code from functions */
+    struct timespec begin;
     unsigned char cmd;
     struct test_table *cmd_entry;
 
@@ -1343,6 +1347,8 @@ int ampctl_parse(AMP *my_amp, FILE *fin, FILE *fout, char *argv[], int argc)
     pthread_mutex_lock(&amp_mutex);
 #endif
 
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
+
     if (!prompt)
     {
         rig_debug(RIG_DEBUG_TRACE,
@@ -1389,6 +1395,8 @@ int ampctl_parse(AMP *my_amp, FILE *fin, FILE *fout, char *argv[], int argc)
                                         "");
 #endif
 
+    if (ampctl_command_done) { ampctl_command_done(&begin); }
+
 #ifdef HAVE_PTHREAD
     pthread_mutex_unlock(&amp_mutex);
 #endif
@@ -47,4 +47,7 @@ int set_conf(AMP *my_amp, char *conf_parms);
 
 int ampctl_parse(AMP *my_amp, FILE *fin, FILE *fout, char *argv[], int argc);
 
+/* called after each command with the amplifier still locked, NULL by default */
+extern void (*ampctl_command_done)(const struct timespec *begin);
+
 #endif  /* AMPCTL_PARSE_H */
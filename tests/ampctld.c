@@ -63,6 +63,7 @@
 #include "ampctl_parse.h"
 #include "amplist.h"
 #include "rig.h"
+#include "metrics.h"
 
 struct handle_data
 {
@@ -82,7 +83,7 @@ void usage();
  * NB: do NOT use -W since it's reserved by POSIX.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "m:r:s:C:t:T:LuvhVlZ"
+#define SHORT_OPTIONS "m:r:s:C:t:T:e:LuvhVlZ"
 static struct option long_options[] =
 {
     {"model",           1, 0, 'm'},
@@ -90,6 +91,7 @@ static struct option long_options[] =
     {"serial-speed",    1, 0, 's'},
     {"port",            1, 0, 't'},
     {"listen-addr",     1, 0, 'T'},
+    {"metrics",         1, 0, 'e'},
     {"list",            0, 0, 'l'},
     {"set-conf",        1, 0, 'C'},
     {"show-conf",       0, 0, 'L'},
@@ -109,6 +111,9 @@ const char *src_addr = NULL;    /* INADDR_ANY */
 
 char send_cmd_term = '\r';      /* send_cmd termination char */
 
+static const char *metrics_listen = NULL;
+static struct metrics_daemon metrics = { "ampctld" };
+
 #define MAXCONFLEN 1024
 
 
@@ -148,6 +153,55 @@ static void handle_error(enum rig_debug_level_e lvl, const char *msg)
 }
 
 
+static void ampctld_command_done(const struct timespec *begin)
+{
+    metrics_command(&metrics, begin);
+}
+
+
+/*
+ * Metrics page, levels and power status are the ones last read by a client
+ */
+static void render_ampctld(struct metrics_buf *buf, void *arg)
+{
+    const AMP *amp = (const AMP *) arg;
+    const struct amp_state *rs = &amp->state;
+    char esc[3][128];
+    int i;
+
+    metrics_family(buf, "hamlib_amp", "info", NULL, "Amplifier served by ampctld");
+    metrics_printf(buf,
+                   "hamlib_amp_info{model=\"%d\",name=\"%s\",backend=\"%s\",version=\"%s\"} 1\n",
+                   amp->caps->amp_model,
+                   metrics_escape(esc[0], sizeof(esc[0]), amp->caps->model_name),
+                   metrics_escape(esc[1], sizeof(esc[1]), amp->caps->mfg_name),
+                   metrics_escape(esc[2], sizeof(esc[2]), amp->caps->version));
+
+    metrics_family(buf, "hamlib_amp_level", "gauge", NULL,
+                   "Last value of a level read, e.g. SWR and PWRFORWARD");
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+
+        if (rs->has_last_level & level)
+        {
+            metrics_printf(buf, "hamlib_amp_level{level=\"%s\"} %g\n",
+                           amp_strlevel(level), rs->last_level[i]);
+        }
+    }
+
+    if (rs->last_powerstat != RIG_POWER_UNKNOWN)
+    {
+        metrics_family(buf, "hamlib_amp_power_state", "gauge", NULL,
+                       "Last power status read, 0 off, 1 on, 2 standby, 4 operate");
+        metrics_printf(buf, "hamlib_amp_power_state %d\n", (int) rs->last_powerstat);
+    }
+
+    metrics_render_daemon(buf, &metrics);
+}
+
+
 int main(int argc, char *argv[])
 {
     AMP *my_amp;        /* handle to amp (instance) */
@@ -279,6 +333,10 @@ int main(int argc, char *argv[])
             src_addr = optarg;
             break;
 
+        case 'e':
+            metrics_listen = optarg;
+            break;
+
         case 'v':
             verbose++;
             break;
@@ -531,6 +589,20 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
+    if (metrics_listen)
+    {
+        retcode = metrics_start(metrics_listen, render_ampctld, my_amp);
+
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Cannot serve metrics on %s: %s\n", metrics_listen,
+                    rigerror(retcode));
+            exit(1);
+        }
+
+        ampctl_command_done = ampctld_command_done;
+    }
+
     /*
      * main loop accepting connections
      */
@@ -651,10 +723,17 @@ void *handle_socket(void *arg)
         goto handle_exit;
     }
 
+    metrics_client(&metrics, 1);
+
     do
     {
         retcode = ampctl_parse(handle_data_arg->amp, fsockin, fsockout, NULL, 0);
 
+        if (retcode == 2)
+        {
+            metrics_error(&metrics);
+        }
+
         if (ferror(fsockin) || ferror(fsockout))
         {
             retcode = 1;
@@ -682,6 +761,8 @@ void *handle_socket(void *arg)
               host,
               serv);
 
+    metrics_client(&metrics, 0);
+
     fclose(fsockin);
 #ifndef __MINGW32__
     fclose(fsockout);
@@ -713,6 +794,7 @@ void usage()
         "  -s, --serial-speed=BAUD       set serial speed of the serial port\n"
         "  -t, --port=NUM                set TCP listening port, default %s\n"
         "  -T, --listen-addr=IPADDR      set listening IP address, default ANY\n"
+        "  -e, --metrics=[IPADDR:]PORT   serve OpenMetrics over HTTP for monitoring\n"
         "  -C, --set-conf=PARM=VAL       set config parameters\n"
         "  -L, --show-conf               list all config parameters\n"
         "  -l, --list                    list all model numbers and exit\n"
@@ -0,0 +1,186 @@
+/*
+ * Hamlib ioreactor_bench program
+ *
+ * Runs Kenwood style "FA;" transactions against a fake rig on the other
+ * end of a socketpair, once through the select()/read() path and once
+ * through the port reactor, and reports the wait and read syscalls
+ * iofunc.c made per transaction.  Then it times commands on a port with
+ * a post_write_delay, the caller working as long as that delay after
+ * each, with write_block sleeping versus the reactor output scheduler
+ * running the delay while the caller works.
+ *
+ * For a full syscall count run it under "strace -c -f ./ioreactor_bench".
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "ioreactor.h"
+
+#define LOOP_COUNT 2000
+#define PACED_COUNT 100
+#define PACED_DELAY 2   /* post_write_delay in ms */
+
+static const char reply[] = "FA00014074000;";
+
+static void *fake_rig(void *arg)
+{
+    int fd = *(int *)arg;
+    char c;
+
+    /* answer every ';' terminated command with the same FA reply */
+    while (read(fd, &c, 1) == 1)
+    {
+        if (c == ';' && write(fd, reply, sizeof(reply) - 1) < 0)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int run(hamlib_port_t *port, const char *name)
+{
+    struct io_reactor_stats stats;
+    struct timeval tv1, tv2;
+    unsigned char buf[64];
+    float elapsed;
+    int i;
+
+    io_reactor_reset_stats();
+    gettimeofday(&tv1, NULL);
+
+    for (i = 0; i < LOOP_COUNT; i++)
+    {
+        int retcode = write_block(port, (unsigned char *) "FA;", 3);
+
+        if (retcode == RIG_OK)
+        {
+            retcode = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+        }
+
+        if (retcode != sizeof(reply) - 1)
+        {
+            printf("%s: transaction %d failed: %s\n", name, i,
+                   retcode < 0 ? rigerror(retcode) : (char *) buf);
+            return 1;
+        }
+    }
+
+    gettimeofday(&tv2, NULL);
+    io_reactor_get_stats(&stats);
+
+    elapsed = tv2.tv_sec - tv1.tv_sec + (tv2.tv_usec - tv1.tv_usec) / 1000000.0;
+    printf("%-8s %8.0f trans/s  waits/trans %5.2f  wait syscalls/trans %5.2f"
+           "  read syscalls/trans %5.2f\n",
+           name,
+           LOOP_COUNT / elapsed,
+           (double) stats.waits / LOOP_COUNT,
+           (double) stats.wait_syscalls / LOOP_COUNT,
+           (double) stats.read_syscalls / LOOP_COUNT);
+
+    return 0;
+}
+
+static int run_paced(hamlib_port_t *port, const char *name)
+{
+    struct timeval tv1, tv2;
+    float total;
+    int i;
+
+    gettimeofday(&tv1, NULL);
+
+    for (i = 0; i < PACED_COUNT; i++)
+    {
+        int retcode = write_block(port, (unsigned char *) "FA00014074000;", 14);
+
+        if (retcode != RIG_OK)
+        {
+            printf("%s: write %d failed: %s\n", name, i, rigerror(retcode));
+            return 1;
+        }
+
+        /* whatever the caller does before its next command */
+        hl_usleep(PACED_DELAY * 1000);
+    }
+
+    io_reactor_drain(port);
+    gettimeofday(&tv2, NULL);
+
+    total = (tv2.tv_sec - tv1.tv_sec) * 1000.0 + (tv2.tv_usec - tv1.tv_usec) /
+            1000.0;
+    printf("%-8s %7.3f ms/cmd\n", name, total / PACED_COUNT);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    hamlib_port_t port;
+    pthread_t thread;
+    int sv[2];
+    int retcode;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+
+    memset(&port, 0, sizeof(port));
+    port.type.rig = RIG_PORT_NETWORK;
+    port.fd = sv[0];
+    port.timeout = 1000;
+    port.fd_sync_read = port.fd_sync_write = -1;
+    port.fd_sync_error_read = port.fd_sync_error_write = -1;
+
+    pthread_create(&thread, NULL, fake_rig, &sv[1]);
+
+    printf("Perform %d transactions...\n", LOOP_COUNT);
+
+    io_reactor_set_enabled(0);
+    retcode = run(&port, "select");
+
+    io_reactor_set_enabled(1);
+
+    if (retcode == 0 && io_reactor_add(&port) != RIG_OK)
+    {
+        printf("reactor not available on this platform\n");
+        retcode = 0;
+    }
+    else if (retcode == 0)
+    {
+        retcode = run(&port, "reactor");
+        io_reactor_remove(&port);
+
+        printf("Write %d commands with post_write_delay=%dms...\n", PACED_COUNT,
+               PACED_DELAY);
+        port.post_write_delay = PACED_DELAY;
+
+        if (retcode == 0)
+        {
+            retcode = run_paced(&port, "sleep");
+        }
+
+        if (retcode == 0 && io_reactor_add(&port) == RIG_OK)
+        {
+            retcode = run_paced(&port, "queued");
+            io_reactor_remove(&port);
+        }
+    }
+
+    close(sv[0]);
+    pthread_join(thread, NULL);
+    close(sv[1]);
+
+    return retcode;
+}
@@ -0,0 +1,646 @@
+/*
+ * metrics.c - (C) The Hamlib Group 2024
+ *
+ * OpenMetrics text endpoint shared by rigctld, rotctld and ampctld.
+ *
+ * A listener thread answers HTTP GET requests with the page rendered by
+ * the daemon's callback.  The callback only reads what the library and
+ * the daemon already keep in memory, so a scrape never waits for the
+ * device lock and never talks to the device.  Requests are served one
+ * after the other, scrapers are few and a page renders in microseconds.
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/types.h>
+
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#elif HAVE_WS2TCPIP_H
+#  include <ws2tcpip.h>
+#  if defined(HAVE_WSPIAPI_H)
+#    include <wspiapi.h>
+#  endif
+#endif
+#ifdef HAVE_NETDB_H
+#  include <netdb.h>
+#endif
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "metrics.h"
+
+#define METRICS_REQUEST_MAX 2048
+#define METRICS_IO_TIMEOUT 2    /* seconds a scraper may take per request */
+
+#define METRICS_CONTENT_TYPE \
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define metrics_add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define metrics_load(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#else
+#define metrics_add(p, v) (*(p) += (v))
+#define metrics_load(p) (*(p))
+#endif
+
+struct metrics_server
+{
+    int sock;
+    metrics_render_t render;
+    void *arg;
+};
+
+
+static void metrics_close(int sock)
+{
+#ifdef __MINGW32__
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+
+void metrics_printf(struct metrics_buf *buf, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (;;)
+    {
+        size_t room = buf->size - buf->len;
+
+        va_start(ap, fmt);
+        n = vsnprintf(buf->data ? buf->data + buf->len : NULL, room, fmt, ap);
+        va_end(ap);
+
+        if (n < 0)
+        {
+            return;
+        }
+
+        if ((size_t) n < room)
+        {
+            buf->len += n;
+            return;
+        }
+
+        {
+            size_t size = buf->size ? buf->size * 2 : 4096;
+            char *data;
+
+            while (size - buf->len <= (size_t) n)
+            {
+                size *= 2;
+            }
+
+            data = realloc(buf->data, size);
+
+            if (!data)
+            {
+                return;
+            }
+
+            buf->data = data;
+            buf->size = size;
+        }
+    }
+}
+
+
+/*
+ * Escape a label value, dst is returned for use as a printf argument
+ */
+const char *metrics_escape(char *dst, size_t len, const char *src)
+{
+    size_t i = 0;
+
+    if (!src)
+    {
+        src = "";
+    }
+
+    for (; *src && i + 2 < len; src++)
+    {
+        switch (*src)
+        {
+        case '\\':
+        case '"':
+            dst[i++] = '\\';
+            dst[i++] = *src;
+            break;
+
+        case '\n':
+            dst[i++] = '\\';
+            dst[i++] = 'n';
+            break;
+
+        default:
+            dst[i++] = *src;
+        }
+    }
+
+    dst[i] = '\0';
+
+    return dst;
+}
+
+
+void metrics_family(struct metrics_buf *buf, const char *name,
+                    const char *type, const char *unit, const char *help)
+{
+    metrics_printf(buf, "# TYPE %s %s\n", name, type);
+
+    if (unit)
+    {
+        metrics_printf(buf, "# UNIT %s %s\n", name, unit);
+    }
+
+    metrics_printf(buf, "# HELP %s %s\n", name, help);
+}
+
+
+/*
+ * Samples of a histogram with rig_stats buckets, converted to seconds.
+ * labels is e.g. "op=\"get_freq\"" or NULL.
+ */
+void metrics_hist(struct metrics_buf *buf, const char *name,
+                  const char *labels, const struct rig_stats_hist *hist)
+{
+    const char *sep = labels ? "," : "";
+    uint64_t cumulative = 0;
+    int i;
+
+    if (!labels)
+    {
+        labels = "";
+    }
+
+    for (i = 0; i < RIG_STATS_BUCKETS - 1; i++)
+    {
+        cumulative += hist->bucket[i];
+        metrics_printf(buf, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, sep,
+                       (double)(2ULL << i) / 1e6, (unsigned long long) cumulative);
+    }
+
+    metrics_printf(buf, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep,
+                   (unsigned long long) hist->count);
+    metrics_printf(buf, "%s_count%s%s%s %llu\n", name, *sep ? "{" : "", labels,
+                   *sep ? "}" : "", (unsigned long long) hist->count);
+    metrics_printf(buf, "%s_sum%s%s%s %g\n", name, *sep ? "{" : "", labels,
+                   *sep ? "}" : "", (double) hist->total_us / 1e6);
+}
+
+
+void metrics_client(struct metrics_daemon *d, int connected)
+{
+    if (connected)
+    {
+        metrics_add(&d->clients, 1);
+        metrics_add(&d->connections, 1);
+    }
+    else
+    {
+        metrics_add(&d->clients, -1);
+    }
+}
+
+
+/*
+ * Count a command, called while the daemon holds the device lock
+ */
+void metrics_command(struct metrics_daemon *d, const struct timespec *begin)
+{
+    struct timespec b = *begin;
+    double ms = elapsed_ms(&b, HAMLIB_ELAPSED_GET);
+    uint64_t us = ms > 0 ? (uint64_t)(ms * 1000) : 0;
+    int i = 0;
+
+    while (i < RIG_STATS_BUCKETS - 1 && (us >> (i + 1)) != 0)
+    {
+        i++;
+    }
+
+    metrics_add(&d->command.count, 1);
+    metrics_add(&d->command.total_us, us);
+    metrics_add(&d->command.bucket[i], 1);
+}
+
+
+void metrics_error(struct metrics_daemon *d)
+{
+    metrics_add(&d->errors, 1);
+}
+
+
+void metrics_reconnect(struct metrics_daemon *d)
+{
+    metrics_add(&d->reconnects, 1);
+}
+
+
+/* "{rig=\"1\"}" to follow a metric name, or nothing without labels */
+static const char *metrics_label_set(char *dst, size_t len,
+                                     const char *const labels[], int k)
+{
+    if (!labels)
+    {
+        return "";
+    }
+
+    SNPRINTF(dst, len, "{%s}", labels[k]);
+    return dst;
+}
+
+
+/*
+ * Counters of n daemons in one page, e.g. one per rig of rigctld, each
+ * family once with a sample per daemon.  labels[i] tells the samples of
+ * d[i] apart, e.g. "rig=\"1\"", labels is NULL for a single daemon.
+ */
+void metrics_render_daemons(struct metrics_buf *buf,
+                            const struct metrics_daemon *const d[],
+                            const char *const labels[], int n)
+{
+    struct rig_stats_hist command;
+    char name[64];
+    char set[96];
+    int i, k;
+
+    SNPRINTF(name, sizeof(name), "%s_clients", d[0]->name);
+    metrics_family(buf, name, "gauge", NULL, "Connected clients");
+
+    for (k = 0; k < n; k++)
+    {
+        metrics_printf(buf, "%s%s %d\n", name,
+                       metrics_label_set(set, sizeof(set), labels, k),
+                       metrics_load(&d[k]->clients));
+    }
+
+    SNPRINTF(name, sizeof(name), "%s_connections", d[0]->name);
+    metrics_family(buf, name, "counter", NULL, "Client connections accepted");
+
+    for (k = 0; k < n; k++)
+    {
+        metrics_printf(buf, "%s_total%s %llu\n", name,
+                       metrics_label_set(set, sizeof(set), labels, k),
+                       (unsigned long long) metrics_load(&d[k]->connections));
+    }
+
+    SNPRINTF(name, sizeof(name), "%s_command_errors", d[0]->name);
+    metrics_family(buf, name, "counter", NULL, "Commands answered with an error");
+
+    for (k = 0; k < n; k++)
+    {
+        metrics_printf(buf, "%s_total%s %llu\n", name,
+                       metrics_label_set(set, sizeof(set), labels, k),
+                       (unsigned long long) metrics_load(&d[k]->errors));
+    }
+
+    SNPRINTF(name, sizeof(name), "%s_reconnects", d[0]->name);
+    metrics_family(buf, name, "counter", NULL,
+                   "Device reopened after an i/o error");
+
+    for (k = 0; k < n; k++)
+    {
+        metrics_printf(buf, "%s_total%s %llu\n", name,
+                       metrics_label_set(set, sizeof(set), labels, k),
+                       (unsigned long long) metrics_load(&d[k]->reconnects));
+    }
+
+    SNPRINTF(name, sizeof(name), "%s_command_seconds", d[0]->name);
+    metrics_family(buf, name, "histogram", "seconds",
+                   "Command latency with the device locked");
+
+    for (k = 0; k < n; k++)
+    {
+        command.count = metrics_load(&d[k]->command.count);
+        command.total_us = metrics_load(&d[k]->command.total_us);
+
+        for (i = 0; i < RIG_STATS_BUCKETS; i++)
+        {
+            command.bucket[i] = metrics_load(&d[k]->command.bucket[i]);
+        }
+
+        metrics_hist(buf, name, labels ? labels[k] : NULL, &command);
+    }
+}
+
+
+void metrics_render_daemon(struct metrics_buf *buf,
+                           const struct metrics_daemon *d)
+{
+    metrics_render_daemons(buf, &d, NULL, 1);
+}
+
+
+static int metrics_send(int sock, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        int n = send(sock, data, len, 0);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+
+static void metrics_reply(int sock, const char *status, const char *type,
+                          const char *body, size_t len)
+{
+    char head[256];
+
+    SNPRINTF(head, sizeof(head),
+             "HTTP/1.1 %s\r\n"
+             "Content-Type: %s\r\n"
+             "Content-Length: %lu\r\n"
+             "Connection: close\r\n"
+             "\r\n", status, type, (unsigned long) len);
+
+    if (metrics_send(sock, head, strlen(head)) == 0)
+    {
+        metrics_send(sock, body, len);
+    }
+}
+
+
+static void metrics_serve(struct metrics_server *srv, int sock)
+{
+    char req[METRICS_REQUEST_MAX];
+    size_t len = 0;
+    char *path, *end;
+
+    // read the request head, the body of a GET is ignored
+    while (len < sizeof(req) - 1)
+    {
+        int n = recv(sock, req + len, sizeof(req) - 1 - len, 0);
+
+        if (n <= 0)
+        {
+            return;
+        }
+
+        len += n;
+        req[len] = '\0';
+
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n"))
+        {
+            break;
+        }
+    }
+
+    req[len] = '\0';
+
+    if (strncmp(req, "GET ", 4) != 0)
+    {
+        static const char msg[] = "Only GET is supported\n";
+        metrics_reply(sock, "405 Method Not Allowed", "text/plain", msg,
+                      sizeof(msg) - 1);
+        return;
+    }
+
+    path = strchr(req, ' ') + 1;
+    end = strpbrk(path, " ?\r\n");
+
+    if (end)
+    {
+        *end = '\0';
+    }
+
+    if (strcmp(path, "/metrics") != 0 && strcmp(path, "/") != 0)
+    {
+        static const char msg[] = "Metrics are at /metrics\n";
+        metrics_reply(sock, "404 Not Found", "text/plain", msg, sizeof(msg) - 1);
+        return;
+    }
+
+    {
+        struct metrics_buf buf = { NULL, 0, 0 };
+
+        srv->render(&buf, srv->arg);
+        metrics_printf(&buf, "# EOF\n");
+
+        if (!buf.data)
+        {
+            static const char msg[] = "Out of memory\n";
+            metrics_reply(sock, "500 Internal Server Error", "text/plain", msg,
+                          sizeof(msg) - 1);
+            return;
+        }
+
+        metrics_reply(sock, "200 OK", METRICS_CONTENT_TYPE, buf.data, buf.len);
+        free(buf.data);
+    }
+}
+
+
+#ifdef HAVE_PTHREAD
+static void *metrics_thread(void *arg)
+{
+    struct metrics_server *srv = arg;
+
+    for (;;)
+    {
+        int sock = accept(srv->sock, NULL, NULL);
+
+        if (sock < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: accept: %s\n", __func__, strerror(errno));
+            hl_usleep(100 * 1000);
+            continue;
+        }
+
+        // a stuck scraper must not keep the next one waiting forever
+        {
+#ifdef __MINGW32__
+            DWORD tv = METRICS_IO_TIMEOUT * 1000;
+#else
+            struct timeval tv = { METRICS_IO_TIMEOUT, 0 };
+#endif
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(tv));
+            setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
+        }
+
+        metrics_serve(srv, sock);
+        metrics_close(sock);
+    }
+
+    return NULL;
+}
+#endif
+
+
+/*
+ * Listen on listen, "PORT", "IPADDR:PORT" or "[IPV6ADDR]:PORT", and serve
+ * the page rendered by render from a thread of its own.
+ * Returns RIG_OK or a negative error.
+ */
+int metrics_start(const char *listen_on, metrics_render_t render, void *arg)
+{
+#ifdef HAVE_PTHREAD
+    struct addrinfo hints, *result, *ai;
+    struct metrics_server *srv;
+    pthread_t thread;
+    pthread_attr_t attr;
+    char spec[256];
+    const char *addr = NULL;
+    const char *port = spec;
+    char *colon;
+    int sock = -1;
+    int reuseaddr = 1;
+    int retcode;
+
+    SNPRINTF(spec, sizeof(spec), "%s", listen_on);
+    colon = strrchr(spec, ':');
+
+    if (spec[0] == '[' && colon && colon[-1] == ']')
+    {
+        colon[-1] = '\0';
+        addr = spec + 1;
+        port = colon + 1;
+    }
+    else if (colon && colon == strchr(spec, ':'))
+    {
+        *colon = '\0';
+        addr = spec;
+        port = colon + 1;
+    }
+    else if (colon)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: use [IPV6ADDR]:PORT, got %s\n", __func__,
+                  listen_on);
+        return -RIG_EINVAL;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    retcode = getaddrinfo(addr, port, &hints, &result);
+
+    if (retcode != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: getaddrinfo: %s\n", __func__,
+                  gai_strerror(retcode));
+        return -RIG_EINVAL;
+    }
+
+    for (ai = result; ai != NULL; ai = ai->ai_next)
+    {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+        if (sock < 0)
+        {
+            continue;
+        }
+
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char *)&reuseaddr,
+                   sizeof(reuseaddr));
+
+#ifdef IPV6_V6ONLY
+
+        if (AF_INET6 == ai->ai_family)
+        {
+            int sockopt = 0;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&sockopt,
+                       sizeof(sockopt));
+        }
+
+#endif
+
+        if (bind(sock, ai->ai_addr, ai->ai_addrlen) == 0 && listen(sock, 4) == 0)
+        {
+            break;
+        }
+
+        metrics_close(sock);
+        sock = -1;
+    }
+
+    freeaddrinfo(result);
+
+    if (sock < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: cannot listen on %s:%s\n", __func__,
+                  addr ? addr : "*", port);
+        return -RIG_EIO;
+    }
+
+    srv = calloc(1, sizeof(*srv));
+
+    if (!srv)
+    {
+        metrics_close(sock);
+        return -RIG_ENOMEM;
+    }
+
+    srv->sock = sock;
+    srv->render = render;
+    srv->arg = arg;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    retcode = pthread_create(&thread, &attr, metrics_thread, srv);
+    pthread_attr_destroy(&attr);
+
+    if (retcode != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(retcode));
+        metrics_close(sock);
+        free(srv);
+        return -RIG_EINTERNAL;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: serving metrics on %s:%s\n", __func__,
+              addr ? addr : "*", port);
+
+    return RIG_OK;
+#else
+    rig_debug(RIG_DEBUG_ERR, "%s: metrics need thread support\n", __func__);
+    return -RIG_ENIMPL;
+#endif
+}
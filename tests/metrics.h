@@ -0,0 +1,74 @@
+/*
+ * metrics.h - (C) The Hamlib Group 2024
+ *
+ * OpenMetrics text endpoint shared by rigctld, rotctld and ampctld.
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TESTS_METRICS_H
+#define TESTS_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <hamlib/rig.h>
+#include <hamlib/rig_stats.h>
+
+/* growing text buffer a page is rendered into */
+struct metrics_buf
+{
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+/* counters of the daemon itself, updated by the client threads */
+struct metrics_daemon
+{
+    const char *name;           /* metric name prefix, e.g. "rigctld" */
+    int clients;                /* connected right now */
+    uint64_t connections;       /* accepted since start */
+    uint64_t errors;            /* commands answered with an error */
+    uint64_t reconnects;        /* rig reopened after an i/o error */
+    struct rig_stats_hist command;  /* command latency with the device locked */
+};
+
+/* renders the current state into buf, must not block on the device */
+typedef void (*metrics_render_t)(struct metrics_buf *buf, void *arg);
+
+int metrics_start(const char *listen_on, metrics_render_t render, void *arg);
+
+void metrics_printf(struct metrics_buf *buf, const char *fmt, ...);
+const char *metrics_escape(char *dst, size_t len, const char *src);
+void metrics_family(struct metrics_buf *buf, const char *name,
+                    const char *type, const char *unit, const char *help);
+void metrics_hist(struct metrics_buf *buf, const char *name,
+                  const char *labels, const struct rig_stats_hist *hist);
+
+void metrics_client(struct metrics_daemon *d, int connected);
+void metrics_command(struct metrics_daemon *d, const struct timespec *begin);
+void metrics_error(struct metrics_daemon *d);
+void metrics_reconnect(struct metrics_daemon *d);
+void metrics_render_daemon(struct metrics_buf *buf,
+                           const struct metrics_daemon *d);
+void metrics_render_daemons(struct metrics_buf *buf,
+                            const struct metrics_daemon *const d[],
+                            const char *const labels[], int n);
+
+#endif /* TESTS_METRICS_H */
@@ -37,6 +37,10 @@
 #include <errno.h>
 #include <getopt.h>
 
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
 // If true adds some debug statements to see flow of rigctl parsing
 int debugflow = 0;
 
@@ -67,6 +71,7 @@ extern int read_history();
 
 
 #include <hamlib/rig.h>
+#include <hamlib/rig_stats.h>
 #include "misc.h"
 #include "iofunc.h"
 #include "riglist.h"
@@ -103,6 +108,7 @@ static int chk_vfo_executed;
 char rigctld_password[64];
 int is_passwordOK;
 int is_rigctld;
+int rigctld_wait_ms;    /* a command not started by then fails, 0 waits */
 extern int lock_mode; // used by rigctld
 extern powerstat_t rig_powerstat;
 
@@ -184,6 +190,7 @@ declare_proto_rig(get_mode_bandwidths);
 declare_proto_rig(set_vfo);
 declare_proto_rig(get_vfo);
 declare_proto_rig(get_rig_info);
+declare_proto_rig(get_stats);
 declare_proto_rig(get_vfo_info);
 declare_proto_rig(get_vfo_list);
 declare_proto_rig(set_ptt);
@@ -264,6 +271,9 @@ declare_proto_rig(set_lock_mode);
 declare_proto_rig(get_lock_mode);
 declare_proto_rig(send_raw);
 declare_proto_rig(client_version);
+declare_proto_rig(subscribe);
+
+static int rigctld_subscription_available(RIG *rig);
 
 
 /*
@@ -379,6 +389,8 @@ static struct test_table test_list[] =
     { 0xa4, "send_raw",          ACTION(send_raw), ARG_NOVFO | ARG_IN1 | ARG_IN2 | ARG_OUT3, "Terminator", "Command", "Send raw answer" },
     { 0xa5, "client_version",    ACTION(client_version), ARG_NOVFO | ARG_IN1, "Version", "Client version" },
     { 0xa6, "get_vfo_list",    ACTION(get_vfo_list), ARG_NOVFO },
+    { 0xa7, "subscribe",         ACTION(subscribe), ARG_IN1 | ARG_NOVFO, "Items" },
+    { 0xa8, "get_stats",         ACTION(get_stats), ARG_NOVFO },
     { 0x00, "", NULL },
 };
 
@@ -667,6 +679,121 @@ static int next_word(char *buffer, int argc, char *argv[], int newline)
     })
 
 
+/* a command as rigctl_parse() runs it, maybe on the worker of the rig */
+struct rigctl_exec
+{
+    const struct test_table *cmd_entry;
+    FILE *fout;
+    FILE *fin;
+    int interactive;
+    int prompt;
+    int *vfo_opt;
+    char send_cmd_term;
+    int ext_resp;
+    char resp_sep;
+    vfo_t vfo;
+    const char *p1;
+    const char *p2;
+    const char *p3;
+};
+
+static int rigctl_exec_run(RIG *rig, rig_ptr_t arg)
+{
+    const struct rigctl_exec *e = (const struct rigctl_exec *)arg;
+
+    /* queued sets go out before anything that may depend on them */
+    if (rig->state.async_set && !strchr("FMLI", e->cmd_entry->cmd))
+    {
+        rig_async_set_flush(rig);
+    }
+
+    if (rig->state.comm_state == 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: %p rig not open...trying to reopen\n", __func__,
+                  &rig->state.comm_state);
+        rig_open(rig);
+    }
+
+    return (*e->cmd_entry->rig_routine)(rig,
+                                        e->fout,
+                                        e->fin,
+                                        e->interactive,
+                                        e->prompt,
+                                        e->vfo_opt,
+                                        e->send_cmd_term,
+                                        e->ext_resp,
+                                        e->resp_sep,
+                                        e->cmd_entry,
+                                        e->vfo,
+                                        e->p1,
+                                        e->p2,
+                                        e->p3);
+}
+
+/*
+ * f, m and t of rigctld answered from the cache on the client thread,
+ * when rig_get_freq_cached() and friends say rig_get_freq() would not
+ * ask the rig either.  Returns 1 if answered.
+ */
+static int rigctl_exec_cached(RIG *rig, const struct rigctl_exec *e)
+{
+    const struct test_table *cmd = e->cmd_entry;
+    int label = e->interactive && (e->prompt || e->ext_resp);
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    ptt_t ptt;
+
+    /* queued sets are not in the cache yet */
+    if (!e->interactive || e->prompt || rig->state.async_set != NULL)
+    {
+        return 0;
+    }
+
+    switch (cmd->cmd)
+    {
+    case 'f':
+        if (rig_get_freq_cached(rig, e->vfo, &freq) != RIG_OK)
+        {
+            return 0;
+        }
+
+        if (label) { fprintf(e->fout, "%s: ", cmd->arg1); }
+
+        fprintf(e->fout, "%"PRIll"%c", (int64_t)freq, e->resp_sep);
+        return 1;
+
+    case 'm':
+        if (rig_get_mode_cached(rig, e->vfo, &mode, &width) != RIG_OK)
+        {
+            return 0;
+        }
+
+        if (label) { fprintf(e->fout, "%s: ", cmd->arg1); }
+
+        fprintf(e->fout, "%s%c", rig_strrmode(mode), e->resp_sep);
+
+        if (label) { fprintf(e->fout, "%s: ", cmd->arg2); }
+
+        fprintf(e->fout, "%ld%c", width, e->resp_sep);
+        return 1;
+
+    case 't':
+        if (rig_get_ptt_cached(rig, e->vfo, &ptt) != RIG_OK)
+        {
+            return 0;
+        }
+
+        if (label) { fprintf(e->fout, "%s: ", cmd->arg1); }
+
+        fprintf(e->fout, "%d%c", ptt, e->resp_sep);
+        return 1;
+    }
+
+    return 0;
+}
+
+
 int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc,
                  sync_cb_t sync_cb,
                  int interactive, int prompt, int *vfo_opt, char send_cmd_term,
@@ -1704,13 +1831,6 @@ readline_repeat:
 
     rig_debug(RIG_DEBUG_TRACE, "%s: vfo_opt=%d\n", __func__, *vfo_opt);
 
-    if (my_rig->state.comm_state == 0)
-    {
-        rig_debug(RIG_DEBUG_WARN, "%s: %p rig not open...trying to reopen\n", __func__,
-                  &my_rig->state.comm_state);
-        rig_open(my_rig);
-    }
-
     // chk_vfo is the one command we'll allow without a password
     // since it's in the initial handshake
     int preCmd =
@@ -1733,7 +1853,8 @@ readline_repeat:
     else
     {
         // Allow only certain commands when the rig is powered off
-        if (my_rig->state.powerstat == RIG_POWER_OFF && (rig_powerstat == RIG_POWER_OFF || rig_powerstat == RIG_POWER_STANDBY)
+        // the state of this rig, rigctld serves several
+        if (my_rig->state.powerstat == RIG_POWER_OFF
                 && cmd_entry->cmd != '1' // dump_caps
                 && cmd_entry->cmd != '3' // dump_conf
                 && cmd_entry->cmd != 0x8f // dump_state
@@ -1751,20 +1872,36 @@ readline_repeat:
         }
         else
         {
-            retcode = (*cmd_entry->rig_routine)(my_rig,
-                                                fout,
-                                                fin,
-                                                interactive,
-                                                prompt,
-                                                vfo_opt,
-                                                send_cmd_term,
-                                                *ext_resp_ptr,
-                                                *resp_sep_ptr,
-                                                cmd_entry,
-                                                vfo,
-                                                p1,
-                                                p2 ? p2 : "",
-                                                p3 ? p3 : "");
+            struct rigctl_exec e;
+
+            e.cmd_entry = cmd_entry;
+            e.fout = fout;
+            e.fin = fin;
+            e.interactive = interactive;
+            e.prompt = prompt;
+            e.vfo_opt = vfo_opt;
+            e.send_cmd_term = send_cmd_term;
+            e.ext_resp = *ext_resp_ptr;
+            e.resp_sep = *resp_sep_ptr;
+            e.vfo = vfo;
+            e.p1 = p1;
+            e.p2 = p2 ? p2 : "";
+            e.p3 = p3 ? p3 : "";
+
+            if (my_rig->state.worker == NULL)
+            {
+                retcode = rigctl_exec_run(my_rig, &e);
+            }
+            else if (rigctl_exec_cached(my_rig, &e))
+            {
+                retcode = RIG_OK;
+            }
+            else
+            {
+                /* PTT changes go ahead of every other client */
+                retcode = rig_worker_call(my_rig, rigctl_exec_run, &e, cmd == 'T',
+                                          rigctld_wait_ms);
+            }
         }
 
         // we need to copy client_version to our thread in case there are multiple client versions
@@ -1829,6 +1966,13 @@ readline_repeat:
 
     fflush(fout);
 
+    /* let subscribers see changes made by set commands right away */
+    if (retcode == RIG_OK && is_rigctld
+            && (cmd_entry->flags & ARG_IN) && !(cmd_entry->flags & ARG_OUT))
+    {
+        rigctld_subscription_notify(my_rig);
+    }
+
 #ifdef HAVE_LIBREADLINE
 
     if (input_line != NULL && (result = strtok(NULL, " "))) { goto readline_repeat; }
@@ -2087,7 +2231,7 @@ declare_proto_rig(set_freq)
     ENTERFUNC2;
 
     CHKSCN1ARG(sscanf(arg1, "%"SCNfreq, &freq));
-    retval = rig_set_freq(rig, vfo, freq);
+    retval = rig_set_freq_async(rig, vfo, freq, NULL, NULL);
 
     if (retval == RIG_OK)
     {
@@ -2239,7 +2383,7 @@ declare_proto_rig(set_mode)
 
     if (rig->state.lock_mode) { RETURNFUNC2(RIG_OK); }
 
-    RETURNFUNC2(rig_set_mode(rig, vfo, mode, width));
+    RETURNFUNC2(rig_set_mode_async(rig, vfo, mode, width, NULL, NULL));
 }
 
 
@@ -2366,6 +2510,61 @@ declare_proto_rig(get_rig_info)
     RETURNFUNC2(RIG_OK);
 }
 
+static void print_stats_hist(FILE *fout, const char *name,
+                             const struct rig_stats_hist *h)
+{
+    fprintf(fout, "%s: calls=%" PRIu64 " avg_us=%" PRIu64
+            " p50_us=%.0f p90_us=%.0f p99_us=%.0f", name, h->count,
+            h->count ? h->total_us / h->count : 0, rig_stats_percentile(h, 0.5),
+            rig_stats_percentile(h, 0.9), rig_stats_percentile(h, 0.99));
+}
+
+/* '\get_stats' */
+declare_proto_rig(get_stats)
+{
+    struct rig_stats stats;
+    int ret;
+    int i;
+
+    ENTERFUNC2;
+    ret = rig_get_stats(rig, &stats);
+
+    if (ret != RIG_OK) { RETURNFUNC2(ret); }
+
+    for (i = 0; i < RIG_STATS_OP_COUNT; i++)
+    {
+        if (stats.op[i].count)
+        {
+            print_stats_hist(fout, rig_stats_op_name(i), &stats.op[i]);
+            fprintf(fout, " cache_hit=%" PRIu64 " cache_miss=%" PRIu64 "\n",
+                    stats.cache_hit[i], stats.cache_miss[i]);
+        }
+    }
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        const struct rig_stats_setting *l = &stats.level[i];
+
+        if (l->get_count || l->set_count)
+        {
+            fprintf(fout, "level %s: get=%" PRIu64 " get_avg_us=%" PRIu64 " set=%" PRIu64
+                    " set_avg_us=%" PRIu64 "\n", rig_strlevel(rig_idx2setting(i)),
+                    l->get_count, l->get_count ? l->get_us / l->get_count : 0,
+                    l->set_count, l->set_count ? l->set_us / l->set_count : 0);
+        }
+    }
+
+    print_stats_hist(fout, "port_write", &stats.port_write);
+    fprintf(fout, "\n");
+    print_stats_hist(fout, "port_read", &stats.port_read);
+    fprintf(fout, "\ntimeouts: %" PRIu64 "\nretries: %" PRIu64 "\n", stats.timeouts,
+            stats.retries);
+    fprintf(fout, "vfo_swaps: %" PRIu64 "\nvfo_swaps_avoided: %" PRIu64 "\n",
+            stats.vfo_swaps, stats.vfo_swaps_avoided);
+
+    RETURNFUNC2(RIG_OK);
+}
+
 /* '\get_vfo_info' */
 declare_proto_rig(get_vfo_info)
 {
@@ -2878,7 +3077,7 @@ declare_proto_rig(set_split_freq)
 
     CHKSCN1ARG(sscanf(arg1, "%"SCNfreq, &txfreq));
 
-    RETURNFUNC2(rig_set_split_freq(rig, txvfo, txfreq));
+    RETURNFUNC2(rig_set_split_freq_async(rig, txvfo, txfreq, NULL, NULL));
 }
 
 
@@ -3295,7 +3494,7 @@ declare_proto_rig(set_level)
         CHKSCN1ARG(sscanf(arg2, "%d", &val.i));
     }
 
-    RETURNFUNC2(rig_set_level(rig, vfo, level, val));
+    RETURNFUNC2(rig_set_level_async(rig, vfo, level, val, NULL, NULL));
 }
 
 
@@ -4572,6 +4771,12 @@ declare_proto_rig(dump_state)
         
         rig->state.rig_model = rig->caps->rig_model;
         fprintf(fout, "rig_model=%d\n", rig->state.rig_model);
+
+        if (rigctld_subscription_available(rig))
+        {
+            fprintf(fout, "subscribe=1\n");
+        }
+
         fprintf(fout, "done\n");
     }
 
@@ -4689,7 +4894,7 @@ declare_proto_rig(send_morse)
 {
     ENTERFUNC2;
 
-    RETURNFUNC2(rig_send_morse(rig, vfo, arg1));
+    RETURNFUNC2(rig_send_morse_queued(rig, vfo, arg1));
 }
 
 /* 0xvv */
@@ -5579,3 +5784,591 @@ declare_proto_rig(send_raw)
 
     return RIG_OK;
 }
+
+
+/*
+ * rigctld subscriptions
+ *
+ * "\subscribe freq,mode,ptt,split,STRENGTH" registers the client socket for
+ * pushed updates.  After the usual RPRT 0 the client receives lines like
+ *
+ *   event freq VFOA 14074000
+ *   event mode VFOA USB 3000
+ *   event ptt VFOA 0
+ *   event split VFOA 1 VFOB
+ *   event level VFOA STRENGTH -54
+ *
+ * whenever a subscribed value changes, starting with a full snapshot.
+ * Any level name accepted by get_level may be given, "all" subscribes to
+ * freq, mode, ptt and split, "none" cancels the subscription.
+ *
+ * A single publisher thread reads the rig on behalf of every subscriber, so
+ * N clients cost one poll instead of N.  Rig events and set commands wake
+ * it up early; all changes seen within one SUBSCRIBE_COALESCE_MS tick are
+ * collapsed into one line per item carrying the latest value.
+ */
+#define SUBSCRIBE_FREQ  0x01
+#define SUBSCRIBE_MODE  0x02
+#define SUBSCRIBE_PTT   0x04
+#define SUBSCRIBE_SPLIT 0x08
+#define SUBSCRIBE_ALL   (SUBSCRIBE_FREQ|SUBSCRIBE_MODE|SUBSCRIBE_PTT|SUBSCRIBE_SPLIT)
+
+#define SUBSCRIBE_COALESCE_MS 50
+#define SUBSCRIBE_POLL_MS 1000
+
+struct subscribe_state
+{
+    int valid;          /* SUBSCRIBE_* items read successfully */
+    setting_t levels;   /* levels read successfully */
+    vfo_t vfo;
+    freq_t freq;
+    vfo_t tx_vfo;
+    freq_t tx_freq;
+    rmode_t mode;
+    pbwidth_t width;
+    ptt_t ptt;
+    split_t split;
+    value_t level[RIG_SETTING_MAX];
+};
+
+struct subscriber
+{
+    FILE *fout;
+    int items;
+    setting_t levels;
+    int primed;         /* 0 until the initial snapshot has been sent */
+    struct subscribe_state sent;
+    struct subscriber *next;
+};
+
+#define SUBSCRIBE_MAX_RIGS 8
+
+/* publisher of one rig, its subscribers only get the events of that rig */
+struct subscribe_pub
+{
+    RIG *rig;
+    sync_cb_t sync_cb;
+    struct subscriber *subscribers;
+    volatile int wakeup;
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t subscribe_lock = PTHREAD_MUTEX_INITIALIZER;
+static int subscribe_thread_run;
+#endif
+static struct subscribe_pub subscribe_pubs[SUBSCRIBE_MAX_RIGS];
+static int subscribe_npubs;
+
+static struct subscribe_pub *subscribe_find(const RIG *rig)
+{
+    int i;
+
+    for (i = 0; i < subscribe_npubs; i++)
+    {
+        if (subscribe_pubs[i].rig == rig) { return &subscribe_pubs[i]; }
+    }
+
+    return NULL;
+}
+
+static int rigctld_subscription_available(RIG *rig)
+{
+    return is_rigctld && subscribe_find(rig) != NULL;
+}
+
+void rigctld_subscription_notify(RIG *rig)
+{
+    struct subscribe_pub *pub = subscribe_find(rig);
+
+    if (pub) { pub->wakeup = 1; }
+}
+
+static int subscribe_freq_event(RIG *rig, vfo_t vfo, freq_t freq,
+                                rig_ptr_t arg)
+{
+    rigctld_subscription_notify(rig);
+    return RIG_OK;
+}
+
+static int subscribe_mode_event(RIG *rig, vfo_t vfo, rmode_t mode,
+                                pbwidth_t width, rig_ptr_t arg)
+{
+    rigctld_subscription_notify(rig);
+    return RIG_OK;
+}
+
+static int subscribe_ptt_event(RIG *rig, vfo_t vfo, ptt_t ptt, rig_ptr_t arg)
+{
+    rigctld_subscription_notify(rig);
+    return RIG_OK;
+}
+
+static int subscribe_vfo_event(RIG *rig, vfo_t vfo, rig_ptr_t arg)
+{
+    rigctld_subscription_notify(rig);
+    return RIG_OK;
+}
+
+/* read everything any subscriber is interested in, once */
+static void subscribe_read_state(RIG *rig, int items, setting_t levels,
+                                 struct subscribe_state *st)
+{
+    int i;
+
+    st->valid = 0;
+    st->levels = 0;
+    st->vfo = rig->state.current_vfo;
+
+    if ((items & SUBSCRIBE_FREQ)
+            && rig_get_freq(rig, RIG_VFO_CURR, &st->freq) == RIG_OK)
+    {
+        st->valid |= SUBSCRIBE_FREQ;
+    }
+
+    if ((items & SUBSCRIBE_MODE)
+            && rig_get_mode(rig, RIG_VFO_CURR, &st->mode, &st->width) == RIG_OK)
+    {
+        st->valid |= SUBSCRIBE_MODE;
+    }
+
+    if ((items & SUBSCRIBE_PTT)
+            && rig_get_ptt(rig, RIG_VFO_CURR, &st->ptt) == RIG_OK)
+    {
+        st->valid |= SUBSCRIBE_PTT;
+    }
+
+    if ((items & (SUBSCRIBE_SPLIT | SUBSCRIBE_FREQ))
+            && rig_get_split_vfo(rig, RIG_VFO_CURR, &st->split,
+                                 &st->tx_vfo) == RIG_OK)
+    {
+        st->valid |= SUBSCRIBE_SPLIT;
+    }
+
+    /* the TX frequency is only interesting while split */
+    st->tx_freq = 0;
+
+    if ((st->valid & SUBSCRIBE_FREQ) && (st->valid & SUBSCRIBE_SPLIT)
+            && st->split == RIG_SPLIT_ON && st->tx_vfo != st->vfo)
+    {
+        if (rig_get_freq(rig, st->tx_vfo, &st->tx_freq) != RIG_OK)
+        {
+            st->tx_freq = 0;
+        }
+    }
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+
+        if (!(levels & level) || !rig_has_get_level(rig, level))
+        {
+            continue;
+        }
+
+        if (rig_get_level(rig, RIG_VFO_CURR, level, &st->level[i]) == RIG_OK)
+        {
+            st->levels |= level;
+        }
+    }
+}
+
+/* send what changed since the last push, returns -1 once the client is gone */
+static int subscribe_push(struct subscriber *sub,
+                          const struct subscribe_state *st)
+{
+    struct subscribe_state *sent = &sub->sent;
+    FILE *fout = sub->fout;
+    const char *vfostr = rig_strvfo(st->vfo);
+    int i;
+
+    if ((sub->items & SUBSCRIBE_FREQ) && (st->valid & SUBSCRIBE_FREQ)
+            && (!sub->primed || st->freq != sent->freq || st->vfo != sent->vfo))
+    {
+        fprintf(fout, "event freq %s %"PRIll"\n", vfostr, (int64_t)st->freq);
+    }
+
+    if ((sub->items & SUBSCRIBE_FREQ) && st->tx_freq != 0
+            && (!sub->primed || st->tx_freq != sent->tx_freq
+                || st->tx_vfo != sent->tx_vfo))
+    {
+        fprintf(fout, "event freq %s %"PRIll"\n", rig_strvfo(st->tx_vfo),
+                (int64_t)st->tx_freq);
+    }
+
+    if ((sub->items & SUBSCRIBE_MODE) && (st->valid & SUBSCRIBE_MODE)
+            && (!sub->primed || st->mode != sent->mode || st->width != sent->width
+                || st->vfo != sent->vfo))
+    {
+        fprintf(fout, "event mode %s %s %ld\n", vfostr, rig_strrmode(st->mode),
+                st->width);
+    }
+
+    if ((sub->items & SUBSCRIBE_PTT) && (st->valid & SUBSCRIBE_PTT)
+            && (!sub->primed || st->ptt != sent->ptt))
+    {
+        fprintf(fout, "event ptt %s %d\n", vfostr, st->ptt);
+    }
+
+    if ((sub->items & SUBSCRIBE_SPLIT) && (st->valid & SUBSCRIBE_SPLIT)
+            && (!sub->primed || st->split != sent->split
+                || st->tx_vfo != sent->tx_vfo))
+    {
+        fprintf(fout, "event split %s %d %s\n", vfostr, st->split,
+                rig_strvfo(st->tx_vfo));
+    }
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+
+        if (!(sub->levels & level) || !(st->levels & level))
+        {
+            continue;
+        }
+
+        if (RIG_LEVEL_IS_FLOAT(level))
+        {
+            if (sub->primed && (sent->levels & level)
+                    && st->level[i].f == sent->level[i].f)
+            {
+                continue;
+            }
+
+            fprintf(fout, "event level %s %s %g\n", vfostr, rig_strlevel(level),
+                    st->level[i].f);
+        }
+        else
+        {
+            if (sub->primed && (sent->levels & level)
+                    && st->level[i].i == sent->level[i].i)
+            {
+                continue;
+            }
+
+            fprintf(fout, "event level %s %s %d\n", vfostr, rig_strlevel(level),
+                    st->level[i].i);
+        }
+    }
+
+    /* keep the last values we actually sent for items that failed to read */
+    {
+        int valid = sent->valid | st->valid;
+        setting_t levels = sent->levels | st->levels;
+        struct subscribe_state prev = *sent;
+
+        *sent = *st;
+        sent->valid = valid;
+        sent->levels = levels;
+
+        if (!(st->valid & SUBSCRIBE_FREQ))
+        {
+            sent->freq = prev.freq;
+            sent->tx_freq = prev.tx_freq;
+        }
+
+        if (!(st->valid & SUBSCRIBE_MODE))
+        {
+            sent->mode = prev.mode;
+            sent->width = prev.width;
+        }
+
+        if (!(st->valid & SUBSCRIBE_PTT)) { sent->ptt = prev.ptt; }
+
+        if (!(st->valid & SUBSCRIBE_SPLIT))
+        {
+            sent->split = prev.split;
+            sent->tx_vfo = prev.tx_vfo;
+        }
+
+        for (i = 0; i < RIG_SETTING_MAX; i++)
+        {
+            if (!(st->levels & rig_idx2setting(i))) { sent->level[i] = prev.level[i]; }
+        }
+    }
+
+    sub->primed = 1;
+
+    if (fflush(fout) != 0 || ferror(fout))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_PTHREAD
+static void *subscribe_publisher(void *arg)
+{
+    struct subscribe_pub *pub = (struct subscribe_pub *)arg;
+    RIG *rig = pub->rig;
+    struct timespec last_poll;
+    struct subscribe_state st;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: started\n", __func__);
+
+    memset(&st, 0, sizeof(st));
+    elapsed_ms(&last_poll, HAMLIB_ELAPSED_INVALIDATE);
+
+    while (subscribe_thread_run)
+    {
+        struct subscriber *sub, **prev;
+        int items = 0;
+        setting_t levels = 0;
+        int unprimed = 0;
+
+        hl_usleep(SUBSCRIBE_COALESCE_MS * 1000);
+
+        pthread_mutex_lock(&subscribe_lock);
+
+        for (sub = pub->subscribers; sub; sub = sub->next)
+        {
+            items |= sub->items;
+            levels |= sub->levels;
+            unprimed |= !sub->primed;
+        }
+
+        pthread_mutex_unlock(&subscribe_lock);
+
+        if ((!items && !levels)
+                || (!pub->wakeup && !unprimed
+                    && elapsed_ms(&last_poll, HAMLIB_ELAPSED_GET) < SUBSCRIBE_POLL_MS))
+        {
+            continue;
+        }
+
+        pub->wakeup = 0;
+        elapsed_ms(&last_poll, HAMLIB_ELAPSED_SET);
+
+        pub->sync_cb(1);
+
+        rig_async_set_flush(rig);
+
+        if (rig->state.comm_state == 0)
+        {
+            pub->sync_cb(0);
+            continue;
+        }
+
+        subscribe_read_state(rig, items, levels, &st);
+
+        /*
+         * write while still holding the rigctld lock so pushed lines never
+         * land in the middle of a command reply on the same socket
+         */
+        pthread_mutex_lock(&subscribe_lock);
+
+        prev = &pub->subscribers;
+
+        while ((sub = *prev) != NULL)
+        {
+            if (subscribe_push(sub, &st) < 0)
+            {
+                rig_debug(RIG_DEBUG_WARN, "%s: dropping subscriber %p\n", __func__,
+                          sub->fout);
+                *prev = sub->next;
+                free(sub);
+                continue;
+            }
+
+            prev = &sub->next;
+        }
+
+        pthread_mutex_unlock(&subscribe_lock);
+
+        pub->sync_cb(0);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: stopped\n", __func__);
+
+    return NULL;
+}
+#endif
+
+/* one publisher per rig, call it for each rig before clients connect */
+int rigctld_subscription_start(RIG *my_rig, sync_cb_t sync_cb)
+{
+#ifdef HAVE_PTHREAD
+    struct subscribe_pub *pub;
+
+    if (subscribe_find(my_rig) || subscribe_npubs == SUBSCRIBE_MAX_RIGS)
+    {
+        return -RIG_EINVAL;
+    }
+
+    pub = &subscribe_pubs[subscribe_npubs];
+    memset(pub, 0, sizeof(*pub));
+    pub->rig = my_rig;
+    pub->sync_cb = sync_cb;
+
+    /* events from the poll routine or an async backend wake the publisher */
+    rig_set_freq_callback(my_rig, subscribe_freq_event, NULL);
+    rig_set_mode_callback(my_rig, subscribe_mode_event, NULL);
+    rig_set_vfo_callback(my_rig, subscribe_vfo_event, NULL);
+    rig_set_ptt_callback(my_rig, subscribe_ptt_event, NULL);
+
+    subscribe_thread_run = 1;
+
+    if (pthread_create(&pub->thread, NULL, subscribe_publisher, pub))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                  strerror(errno));
+        pub->rig = NULL;
+        return -RIG_EINTERNAL;
+    }
+
+    subscribe_npubs++;
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+void rigctld_subscription_stop(void)
+{
+#ifdef HAVE_PTHREAD
+    struct subscriber *sub;
+    int i;
+
+    subscribe_thread_run = 0;
+
+    for (i = 0; i < subscribe_npubs; i++)
+    {
+        struct subscribe_pub *pub = &subscribe_pubs[i];
+
+        pthread_join(pub->thread, NULL);
+
+        rig_set_freq_callback(pub->rig, NULL, NULL);
+        rig_set_mode_callback(pub->rig, NULL, NULL);
+        rig_set_vfo_callback(pub->rig, NULL, NULL);
+        rig_set_ptt_callback(pub->rig, NULL, NULL);
+        pub->rig = NULL;
+
+        while ((sub = pub->subscribers) != NULL)
+        {
+            pub->subscribers = sub->next;
+            free(sub);
+        }
+    }
+
+    subscribe_npubs = 0;
+#endif
+}
+
+void rigctld_unsubscribe(FILE *fout)
+{
+#ifdef HAVE_PTHREAD
+    struct subscriber *sub, **prev;
+    int i;
+
+    pthread_mutex_lock(&subscribe_lock);
+
+    for (i = 0; i < subscribe_npubs; i++)
+    {
+        for (prev = &subscribe_pubs[i].subscribers; (sub = *prev) != NULL;
+                prev = &sub->next)
+        {
+            if (sub->fout == fout)
+            {
+                *prev = sub->next;
+                free(sub);
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&subscribe_lock);
+#endif
+}
+
+/* 0xa7 */
+declare_proto_rig(subscribe)
+{
+#ifdef HAVE_PTHREAD
+    char items_list[MAXARGSZ + 1];
+    char *item, *saveptr = NULL;
+    struct subscribe_pub *pub = subscribe_find(rig);
+    struct subscriber *sub;
+    int items = 0;
+    setting_t levels = 0;
+
+    if (!is_rigctld || !pub)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: only available with rigctld\n", __func__);
+        return -RIG_ENAVAIL;
+    }
+
+    strncpy(items_list, arg1, sizeof(items_list) - 1);
+    items_list[sizeof(items_list) - 1] = '\0';
+
+    for (item = strtok_r(items_list, ",", &saveptr); item;
+            item = strtok_r(NULL, ",", &saveptr))
+    {
+        setting_t level;
+
+        if (!strcmp(item, "freq")) { items |= SUBSCRIBE_FREQ; }
+        else if (!strcmp(item, "mode")) { items |= SUBSCRIBE_MODE; }
+        else if (!strcmp(item, "ptt")) { items |= SUBSCRIBE_PTT; }
+        else if (!strcmp(item, "split")) { items |= SUBSCRIBE_SPLIT; }
+        else if (!strcmp(item, "all")) { items |= SUBSCRIBE_ALL; }
+        else if (!strcmp(item, "none")) { continue; }
+        else if ((level = rig_parse_level(item)) != 0
+                 && rig_has_get_level(rig, level))
+        {
+            levels |= level;
+        }
+        else
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: unknown item '%s'\n", __func__, item);
+            return -RIG_EINVAL;
+        }
+    }
+
+    pthread_mutex_lock(&subscribe_lock);
+
+    for (sub = pub->subscribers; sub; sub = sub->next)
+    {
+        if (sub->fout == fout) { break; }
+    }
+
+    if (!items && !levels)
+    {
+        pthread_mutex_unlock(&subscribe_lock);
+        rigctld_unsubscribe(fout);
+        return RIG_OK;
+    }
+
+    if (!sub)
+    {
+        sub = calloc(1, sizeof(*sub));
+
+        if (!sub)
+        {
+            pthread_mutex_unlock(&subscribe_lock);
+            return -RIG_ENOMEM;
+        }
+
+        sub->fout = fout;
+        sub->next = pub->subscribers;
+        pub->subscribers = sub;
+    }
+
+    sub->items = items;
+    sub->levels = levels;
+    sub->primed = 0;
+    sub->sent.valid = 0;
+    sub->sent.levels = 0;
+
+    pthread_mutex_unlock(&subscribe_lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: items=0x%x levels=0x%"PRXll"\n", __func__,
+              items, levels);
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
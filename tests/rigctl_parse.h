@@ -54,4 +54,10 @@ int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc, syn
                  int interactive, int prompt, int * vfo_mode, char send_cmd_term,
                  int * ext_resp_ptr, char * resp_sep_ptr, int use_password);
 
+/* rigctld push subscriptions, see \subscribe */
+int rigctld_subscription_start(RIG *my_rig, sync_cb_t sync_cb);
+void rigctld_subscription_stop(void);
+void rigctld_subscription_notify(RIG *rig);
+void rigctld_unsubscribe(FILE *fout);
+
 #endif  /* RIGCTL_PARSE_H */
@@ -73,13 +73,14 @@
 
 #include "rigctl_parse.h"
 #include "riglist.h"
+#include "metrics.h"
 
 /*
  * Reminder: when adding long options,
  *      keep up to date SHORT_OPTIONS, usage()'s output and man page. thanks.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "m:r:p:d:P:D:s:S:c:T:t:C:W:w:x:z:lLuovhVZMRA:n:"
+#define SHORT_OPTIONS "m:r:p:d:P:D:s:S:c:T:t:C:W:w:x:z:lLuovhVZMRA:n:e:Q:N:q:"
 static struct option long_options[] =
 {
     {"model",           1, 0, 'm'},
@@ -109,12 +110,39 @@ static struct option long_options[] =
     {"multicast-port",  1, 0, 'n'},
     {"password",        1, 0, 'A'},
     {"rigctld-idle",    0, 0, 'R'},
+    {"metrics",         1, 0, 'e'},
+    {"async-set",       1, 0, 'Q'},
+    {"add-rig",         1, 0, 'N'},
+    {"queue-wait",      1, 0, 'q'},
     {0, 0, 0, 0}
 };
 
 
+/*
+ * A rig served by this rigctld, the one of -m and those of -N, each on
+ * its own listening port and with its own lock so a slow rig only holds
+ * up its own clients
+ */
+struct rigctld_rig
+{
+    RIG *rig;
+    int sock_listen;
+    char portno[NI_MAXSERV];
+    volatile int opened;
+    unsigned clients;
+    struct timespec begin;      /* of the command being run */
+    powerstat_t powerstat;      /* last read, on until then */
+    struct metrics_daemon metrics;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t lock;
+#endif
+};
+
+#define RIGCTLD_MAX_RIGS 8
+
 struct handle_data
 {
+    struct rigctld_rig *r;
     RIG *rig;
     int sock;
     struct sockaddr_storage cli_addr;
@@ -130,10 +158,11 @@ void usage(void);
 
 #ifdef HAVE_PTHREAD
 static unsigned client_count;
+static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;  /* the counts */
 #endif
 
-static RIG *my_rig;             /* handle to rig (instance) */
-static volatile int rig_opened = 0;
+static struct rigctld_rig rigs[RIGCTLD_MAX_RIGS];    /* rigs[0] is the rig of -m */
+static int nrigs = 1;
 static int verbose;
 
 #ifdef HAVE_SIG_ATOMIC_T
@@ -147,35 +176,368 @@ const char *src_addr = NULL; /* INADDR_ANY */
 const char *multicast_addr = "0.0.0.0";
 int multicast_port = 4532;
 extern char rigctld_password[65];
+extern int rigctld_wait_ms;
 char resp_sep = '\n';
 extern int lock_mode;
-extern powerstat_t rig_powerstat;
 static int rigctld_idle =
     0; // if true then rig will close when no clients are connected
 static int skip_open = 0;
+static const char *metrics_listen = NULL;
+static int async_set_depth = -1;    /* -1 sends every set right away */
 
 #define MAXCONFLEN 1024
 
 
-void mutex_rigctld(int lock)
+static void rigctld_lock(struct rigctld_rig *r, int lock)
 {
 #ifdef HAVE_PTHREAD
-    static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;
 
     if (lock)
     {
-        pthread_mutex_lock(&client_lock);
+        pthread_mutex_lock(&r->lock);
         rig_debug(RIG_DEBUG_VERBOSE, "%s: client lock engaged\n", __func__);
     }
     else
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s: client lock disengaged\n", __func__);
-        pthread_mutex_unlock(&client_lock);
+        pthread_mutex_unlock(&r->lock);
     }
 
 #endif
 }
 
+/* returns 1 with the lock of the rig held, 0 when a client holds it */
+static int rigctld_trylock(struct rigctld_rig *r)
+{
+#ifdef HAVE_PTHREAD
+
+    if (pthread_mutex_trylock(&r->lock) != 0) { return 0; }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: client lock engaged\n", __func__);
+#endif
+    return 1;
+}
+
+/*
+ * Lock callback for the worker of the rig, or for rigctl_parse() without
+ * one, also times each command; the start time is only touched with the
+ * lock held.
+ */
+static void rigctld_sync(struct rigctld_rig *r, int lock)
+{
+    if (lock)
+    {
+        rigctld_lock(r, 1);
+        elapsed_ms(&r->begin, HAMLIB_ELAPSED_SET);
+    }
+    else
+    {
+        metrics_command(&r->metrics, &r->begin);
+        rigctld_lock(r, 0);
+    }
+}
+
+/* the lock callbacks take no argument, one pair per rig */
+#define RIGCTLD_SYNC(n) \
+    static void mutex_rig##n(int lock) { rigctld_lock(&rigs[n], lock); } \
+    static void sync_rig##n(int lock) { rigctld_sync(&rigs[n], lock); }
+
+RIGCTLD_SYNC(0)
+RIGCTLD_SYNC(1)
+RIGCTLD_SYNC(2)
+RIGCTLD_SYNC(3)
+RIGCTLD_SYNC(4)
+RIGCTLD_SYNC(5)
+RIGCTLD_SYNC(6)
+RIGCTLD_SYNC(7)
+
+static const sync_cb_t rig_mutex_cb[RIGCTLD_MAX_RIGS] =
+{
+    mutex_rig0, mutex_rig1, mutex_rig2, mutex_rig3,
+    mutex_rig4, mutex_rig5, mutex_rig6, mutex_rig7
+};
+
+static const sync_cb_t rig_sync_cb[RIGCTLD_MAX_RIGS] =
+{
+    sync_rig0, sync_rig1, sync_rig2, sync_rig3,
+    sync_rig4, sync_rig5, sync_rig6, sync_rig7
+};
+
+/*
+ * Metrics page, only from the cache and counters so it never waits for
+ * the client lock.  Each sample has a rig="N" label, 0 for the rig of -m
+ * and the rigs of -N after it.
+ */
+static void render_rigctld(struct metrics_buf *buf, void *arg)
+{
+    const struct rigctld_rig *rr = (const struct rigctld_rig *) arg;
+    struct rig_stats *stats[RIGCTLD_MAX_RIGS];
+    const struct metrics_daemon *daemon[RIGCTLD_MAX_RIGS];
+    char rig_labels[RIGCTLD_MAX_RIGS][16];
+    const char *rig_label[RIGCTLD_MAX_RIGS];
+    static const struct
+    {
+        const char *vfo;
+        size_t freq, mode, width;
+    } vfos[] =
+    {
+        { "MainA", offsetof(struct rig_cache, freqMainA), offsetof(struct rig_cache, modeMainA), offsetof(struct rig_cache, widthMainA) },
+        { "MainB", offsetof(struct rig_cache, freqMainB), offsetof(struct rig_cache, modeMainB), offsetof(struct rig_cache, widthMainB) },
+        { "SubA", offsetof(struct rig_cache, freqSubA), offsetof(struct rig_cache, modeSubA), offsetof(struct rig_cache, widthSubA) },
+        { "SubB", offsetof(struct rig_cache, freqSubB), offsetof(struct rig_cache, modeSubB), offsetof(struct rig_cache, widthSubB) },
+    };
+    char esc[3][128];
+    char labels[96];
+    int i, n;
+
+    for (n = 0; n < nrigs; n++)
+    {
+        SNPRINTF(rig_labels[n], sizeof(rig_labels[n]), "rig=\"%d\"", n);
+        rig_label[n] = rig_labels[n];
+        daemon[n] = &rr[n].metrics;
+        stats[n] = calloc(1, sizeof(*stats[n]));
+
+        if (stats[n] && rig_get_stats(rr[n].rig, stats[n]) != RIG_OK)
+        {
+            free(stats[n]);
+            stats[n] = NULL;
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig", "info", NULL, "Rig served by rigctld");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        const RIG *rig = rr[n].rig;
+
+        metrics_printf(buf,
+                       "hamlib_rig_info{%s,port=\"%s\",model=\"%d\",name=\"%s\",backend=\"%s\",version=\"%s\"} 1\n",
+                       rig_label[n], rr[n].portno, rig->caps->rig_model,
+                       metrics_escape(esc[0], sizeof(esc[0]), rig->caps->model_name),
+                       metrics_escape(esc[1], sizeof(esc[1]), rig->caps->mfg_name),
+                       metrics_escape(esc[2], sizeof(esc[2]), rig->caps->version));
+    }
+
+    metrics_family(buf, "hamlib_rig_up", "gauge", NULL,
+                   "1 while the rig is open");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        metrics_printf(buf, "hamlib_rig_up{%s} %d\n", rig_label[n], rr[n].opened);
+    }
+
+    metrics_family(buf, "hamlib_rig_frequency_hertz", "gauge", "hertz",
+                   "Cached frequency by VFO");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        const struct rig_cache *cache = &rr[n].rig->state.cache;
+
+        for (i = 0; i < (int)(sizeof(vfos) / sizeof(vfos[0])); i++)
+        {
+            freq_t freq = *(const freq_t *)((const char *) cache + vfos[i].freq);
+
+            if (freq != 0)
+            {
+                metrics_printf(buf, "hamlib_rig_frequency_hertz{%s,vfo=\"%s\"} %.0f\n",
+                               rig_label[n], vfos[i].vfo, freq);
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_mode", "gauge", NULL,
+                   "Cached mode by VFO, 1 for the mode in use");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        const struct rig_cache *cache = &rr[n].rig->state.cache;
+
+        for (i = 0; i < (int)(sizeof(vfos) / sizeof(vfos[0])); i++)
+        {
+            rmode_t mode = *(const rmode_t *)((const char *) cache + vfos[i].mode);
+
+            if (mode != RIG_MODE_NONE)
+            {
+                metrics_printf(buf, "hamlib_rig_mode{%s,vfo=\"%s\",mode=\"%s\"} 1\n",
+                               rig_label[n], vfos[i].vfo, rig_strrmode(mode));
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_passband_hertz", "gauge", "hertz",
+                   "Cached passband width by VFO");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        const struct rig_cache *cache = &rr[n].rig->state.cache;
+
+        for (i = 0; i < (int)(sizeof(vfos) / sizeof(vfos[0])); i++)
+        {
+            pbwidth_t width = *(const pbwidth_t *)((const char *) cache + vfos[i].width);
+
+            if (width > 0)
+            {
+                metrics_printf(buf, "hamlib_rig_passband_hertz{%s,vfo=\"%s\"} %ld\n",
+                               rig_label[n], vfos[i].vfo, (long) width);
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_vfo", "gauge", NULL,
+                   "Cached current VFO, 1 for the VFO in use");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        metrics_printf(buf, "hamlib_rig_vfo{%s,vfo=\"%s\"} 1\n", rig_label[n],
+                       rig_strvfo(rr[n].rig->state.cache.vfo));
+    }
+
+    metrics_family(buf, "hamlib_rig_ptt", "gauge", NULL, "Cached PTT, 1 when keyed");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        metrics_printf(buf, "hamlib_rig_ptt{%s} %d\n", rig_label[n],
+                       rr[n].rig->state.cache.ptt != RIG_PTT_OFF);
+    }
+
+    metrics_family(buf, "hamlib_rig_split", "gauge", NULL, "Cached split, 1 when on");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        metrics_printf(buf, "hamlib_rig_split{%s} %d\n", rig_label[n],
+                       rr[n].rig->state.cache.split != RIG_SPLIT_OFF);
+    }
+
+    metrics_render_daemons(buf, daemon, rig_label, nrigs);
+
+    metrics_family(buf, "hamlib_rig_level", "gauge", NULL,
+                   "Last value of a level read from or set on the rig");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        for (i = 0; stats[n] && i < RIG_SETTING_MAX; i++)
+        {
+            const char *name = rig_strlevel(rig_idx2setting(i));
+
+            if (*name && (stats[n]->level[i].get_count || stats[n]->level[i].set_count))
+            {
+                metrics_printf(buf, "hamlib_rig_level{%s,level=\"%s\"} %g\n",
+                               rig_label[n], name, stats[n]->level[i].value);
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_call_seconds", "histogram", "seconds",
+                   "Latency of rig API calls");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        for (i = 0; stats[n] && i < RIG_STATS_OP_COUNT; i++)
+        {
+            if (stats[n]->op[i].count)
+            {
+                SNPRINTF(labels, sizeof(labels), "%s,op=\"%s\"", rig_label[n],
+                         rig_stats_op_name(i));
+                metrics_hist(buf, "hamlib_rig_call_seconds", labels, &stats[n]->op[i]);
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_cache_requests", "counter", NULL,
+                   "Calls answered from the cache or by the rig");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        for (i = 0; stats[n] && i < RIG_STATS_OP_COUNT; i++)
+        {
+            if (stats[n]->cache_hit[i] || stats[n]->cache_miss[i])
+            {
+                metrics_printf(buf,
+                               "hamlib_rig_cache_requests_total{%s,op=\"%s\",result=\"hit\"} %llu\n"
+                               "hamlib_rig_cache_requests_total{%s,op=\"%s\",result=\"miss\"} %llu\n",
+                               rig_label[n], rig_stats_op_name(i),
+                               (unsigned long long) stats[n]->cache_hit[i],
+                               rig_label[n], rig_stats_op_name(i),
+                               (unsigned long long) stats[n]->cache_miss[i]);
+            }
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_port_write_seconds", "histogram", "seconds",
+                   "Writes to the rig port");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_hist(buf, "hamlib_rig_port_write_seconds", rig_label[n],
+                         &stats[n]->port_write);
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_port_read_seconds", "histogram", "seconds",
+                   "Reads waiting for the rig");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_hist(buf, "hamlib_rig_port_read_seconds", rig_label[n],
+                         &stats[n]->port_read);
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_port_timeouts", "counter", NULL,
+                   "Reads from the rig that timed out");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_printf(buf, "hamlib_rig_port_timeouts_total{%s} %llu\n",
+                           rig_label[n], (unsigned long long) stats[n]->timeouts);
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_port_retries", "counter", NULL,
+                   "Reads and commands repeated");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_printf(buf, "hamlib_rig_port_retries_total{%s} %llu\n",
+                           rig_label[n], (unsigned long long) stats[n]->retries);
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_vfo_swaps", "counter", NULL,
+                   "VFO selections sent for calls on a non-targetable VFO");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_printf(buf, "hamlib_rig_vfo_swaps_total{%s} %llu\n",
+                           rig_label[n], (unsigned long long) stats[n]->vfo_swaps);
+        }
+    }
+
+    metrics_family(buf, "hamlib_rig_vfo_swaps_avoided", "counter", NULL,
+                   "VFO selections skipped as the VFO was still selected");
+
+    for (n = 0; n < nrigs; n++)
+    {
+        if (stats[n])
+        {
+            metrics_printf(buf, "hamlib_rig_vfo_swaps_avoided_total{%s} %llu\n",
+                           rig_label[n], (unsigned long long) stats[n]->vfo_swaps_avoided);
+        }
+
+        free(stats[n]);
+    }
+}
+
 #ifdef WIN32
 static BOOL WINAPI CtrlHandler(DWORD fdwCtrlType)
 {
@@ -240,6 +602,212 @@ static void handle_error(enum rig_debug_level_e lvl, const char *msg)
 #endif
 }
 
+/*
+ * A rig of -N MODEL,DEVICE[,SPEED][,PARM=VAL]..., opened like the rig
+ * of -m, exits on errors
+ */
+static RIG *rigctld_init_rig(char *spec, volatile int *opened)
+{
+    char *device, *rest;
+    RIG *rig;
+    int retcode;
+
+    device = strchr(spec, ',');
+
+    if (!device)
+    {
+        fprintf(stderr, "Missing device in --add-rig=%s\n", spec);
+        exit(1);
+    }
+
+    *device++ = '\0';
+    rest = strchr(device, ',');
+
+    if (rest) { *rest++ = '\0'; }
+
+    rig = rig_init(atoi(spec));
+
+    if (!rig)
+    {
+        fprintf(stderr, "Unknown rig num %s, or initialization error.\n", spec);
+        exit(2);
+    }
+
+    strncpy(rig->state.rigport.pathname, device, HAMLIB_FILPATHLEN - 1);
+
+    /* a number first is the serial speed */
+    if (rest && *rest >= '0' && *rest <= '9')
+    {
+        rig->state.rigport.parm.serial.rate = atoi(rest);
+        rig->state.rigport_deprecated.parm.serial.rate = atoi(rest);
+        rest = strchr(rest, ',');
+
+        if (rest) { rest++; }
+    }
+
+    if (rest && *rest)
+    {
+        retcode = set_conf(rig, rest);
+
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Config parameter error: %s\n", rigerror(retcode));
+            exit(2);
+        }
+    }
+
+    *opened = 0;
+
+    if (!skip_open)
+    {
+        retcode = rig_open(rig);
+        *opened = retcode == RIG_OK;
+
+        if (retcode != RIG_OK)
+        {
+            // it may be powered off, clients reopen it
+            fprintf(stderr, "rig_open: error = %s %s\n", rigerror(retcode), device);
+        }
+    }
+
+    if (verbose > RIG_DEBUG_ERR)
+    {
+        printf("Opened rig model %u, '%s'\n", rig->caps->rig_model,
+               rig->caps->model_name);
+    }
+
+    if (rigctld_idle && *opened)
+    {
+        rig_close(rig);
+    }
+
+    return rig;
+}
+
+/* rig_get_powerstat() for handle_socket(), run by the worker of the rig */
+static int rigctld_get_powerstat(RIG *rig, rig_ptr_t arg)
+{
+    return rig_get_powerstat(rig, (powerstat_t *)arg);
+}
+
+/*
+ * Listening socket on port, exits on errors
+ */
+static int rigctld_listen(const char *port)
+{
+    struct addrinfo hints, *result, *saved_result;
+    int sock_listen;
+    int reuseaddr = 1;
+    int retcode;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
+    hints.ai_socktype = SOCK_STREAM;/* TCP socket */
+    hints.ai_flags = AI_PASSIVE;    /* For wildcard IP address */
+    hints.ai_protocol = 0;          /* Any protocol */
+
+    retcode = getaddrinfo(src_addr, port, &hints, &result);
+
+    if (retcode == 0 && result->ai_family == AF_INET6)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV6\n", __func__);
+    }
+    else if (retcode == 0)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV4\n", __func__);
+    }
+    else
+    {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(retcode));
+        exit(2);
+    }
+
+    saved_result = result;
+
+    do
+    {
+        sock_listen = socket(result->ai_family,
+                             result->ai_socktype,
+                             result->ai_protocol);
+
+        if (sock_listen < 0)
+        {
+            handle_error(RIG_DEBUG_ERR, "socket");
+            freeaddrinfo(saved_result);     /* No longer needed */
+            exit(2);
+        }
+
+        if (setsockopt(sock_listen,
+                       SOL_SOCKET,
+                       SO_REUSEADDR,
+                       (char *)&reuseaddr,
+                       sizeof(reuseaddr))
+                < 0)
+        {
+
+            handle_error(RIG_DEBUG_ERR, "setsockopt");
+            freeaddrinfo(saved_result);     /* No longer needed */
+            exit(1);
+        }
+
+#ifdef IPV6_V6ONLY
+
+        if (AF_INET6 == result->ai_family)
+        {
+            /* allow IPv4 mapped to IPv6 clients Windows and BSD default
+               this to 1 (i.e. disallowed) and we prefer it off */
+            int sockopt = 0;
+
+            if (setsockopt(sock_listen,
+                           IPPROTO_IPV6,
+                           IPV6_V6ONLY,
+                           (char *)&sockopt,
+                           sizeof(sockopt))
+                    < 0)
+            {
+
+                handle_error(RIG_DEBUG_ERR, "setsockopt");
+                freeaddrinfo(saved_result);     /* No longer needed */
+                exit(1);
+            }
+        }
+
+#endif
+
+        if (0 == bind(sock_listen, result->ai_addr, result->ai_addrlen))
+        {
+            break;
+        }
+
+        handle_error(RIG_DEBUG_WARN, "binding failed (trying next interface)");
+#ifdef __MINGW32__
+        closesocket(sock_listen);
+#else
+        close(sock_listen);
+#endif
+    }
+    while ((result = result->ai_next) != NULL);
+
+    freeaddrinfo(saved_result);     /* No longer needed */
+
+    if (NULL == result)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: bind error - no available interface\n", __func__);
+        exit(1);
+    }
+
+    if (listen(sock_listen, 4) < 0)
+    {
+        handle_error(RIG_DEBUG_ERR, "listening");
+        exit(1);
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: rigctld listening on port %s\n", __func__,
+              port);
+
+    return sock_listen;
+}
+
 int main(int argc, char *argv[])
 {
     rig_model_t my_model = RIG_MODEL_DUMMY;
@@ -255,15 +823,15 @@ int main(int argc, char *argv[])
     char *civaddr = NULL;   /* NULL means no need to set conf */
     char conf_parms[MAXCONFLEN] = "";
 
-    struct addrinfo hints, *result, *saved_result;
-    int sock_listen;
-    int reuseaddr = 1;
+    RIG *my_rig;                /* handle to rig (instance) */
+    char *add_rig[RIGCTLD_MAX_RIGS];
     int twiddle_timeout = 0;
     int twiddle_rit = 0;
     int uplink = 0;
     char host[NI_MAXHOST];
     char serv[NI_MAXSERV];
     char rigstartup[1024];
+    int maxfd;
     char vbuf[1024];
 #if HAVE_SIGACTION
     struct sigaction act;
@@ -284,6 +852,21 @@ int main(int argc, char *argv[])
 
     if (err) { rig_debug(RIG_DEBUG_ERR, "%s: setvbuf err=%s\n", __func__, strerror(err)); }
 
+#ifdef HAVE_PTHREAD
+
+    for (i = 0; i < RIGCTLD_MAX_RIGS; i++)
+    {
+        pthread_mutex_init(&rigs[i].lock, NULL);
+    }
+
+#endif
+
+    for (i = 0; i < RIGCTLD_MAX_RIGS; i++)
+    {
+        rigs[i].powerstat = RIG_POWER_ON;
+        rigs[i].metrics.name = "rigctld";
+    }
+
 
     while (1)
     {
@@ -316,6 +899,42 @@ int main(int argc, char *argv[])
             rigctld_idle = 1;
             break;
 
+        case 'e':
+            metrics_listen = optarg;
+            break;
+
+        case 'Q':
+            async_set_depth = atoi(optarg);
+
+            if (async_set_depth < 0)
+            {
+                fprintf(stderr, "Invalid async-set depth %s\n", optarg);
+                exit(1);
+            }
+
+            break;
+
+        case 'q':
+            rigctld_wait_ms = atoi(optarg);
+
+            if (rigctld_wait_ms < 0)
+            {
+                fprintf(stderr, "Invalid queue wait %s\n", optarg);
+                exit(1);
+            }
+
+            break;
+
+        case 'N':
+            if (nrigs == RIGCTLD_MAX_RIGS)
+            {
+                fprintf(stderr, "At most %d rigs\n", RIGCTLD_MAX_RIGS);
+                exit(1);
+            }
+
+            add_rig[nrigs++] = optarg;
+            break;
+
         case 'A':
             strncpy(rigctld_password, optarg, sizeof(rigctld_password) - 1);
             //char *md5 = rig_make_m d5(rigctld_password);
@@ -765,14 +1384,16 @@ int main(int argc, char *argv[])
     }
 
     /* attempt to open rig to check early for issues */
+    rigs[0].rig = my_rig;
+
     if (skip_open)
     {
-        rig_opened = 0;
+        rigs[0].opened = 0;
     }
     else
     {
         retcode = rig_open(my_rig);
-        rig_opened = retcode == RIG_OK ? 1 : 0;
+        rigs[0].opened = retcode == RIG_OK ? 1 : 0;
     }
 
     if (retcode != RIG_OK)
@@ -807,6 +1428,15 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* the rigs of -N listen on the ports after the one of -t */
+    SNPRINTF(rigs[0].portno, sizeof(rigs[0].portno), "%s", portno);
+
+    for (i = 1; i < nrigs; i++)
+    {
+        rigs[i].rig = rigctld_init_rig(add_rig[i], &rigs[i].opened);
+        SNPRINTF(rigs[i].portno, sizeof(rigs[i].portno), "%d", atoi(portno) + i);
+    }
+
 #ifdef __MINGW32__
 #  ifndef SO_OPENTYPE
 #    define SO_OPENTYPE     0x7008
@@ -834,33 +1464,6 @@ int main(int argc, char *argv[])
 
 #endif
 
-    /*
-     * Prepare listening socket
-     */
-    memset(&hints, 0, sizeof(struct addrinfo));
-    hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
-    hints.ai_socktype = SOCK_STREAM;/* TCP socket */
-    hints.ai_flags = AI_PASSIVE;    /* For wildcard IP address */
-    hints.ai_protocol = 0;          /* Any protocol */
-
-    retcode = getaddrinfo(src_addr, portno, &hints, &result);
-
-    if (retcode == 0 && result->ai_family == AF_INET6)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV6\n", __func__);
-    }
-    else if (retcode == 0)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV4\n", __func__);
-    }
-    else
-    {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(retcode));
-        exit(2);
-    }
-
-    saved_result = result;
-
     enum multicast_item_e items = RIG_MULTICAST_POLL | RIG_MULTICAST_TRANSCEIVE |
                                   RIG_MULTICAST_SPECTRUM;
     retcode = network_multicast_publisher_start(my_rig, multicast_addr,
@@ -873,82 +1476,66 @@ int main(int argc, char *argv[])
         // we will consider this non-fatal for now
     }
 
-    do
+    for (i = 0; i < nrigs; i++)
     {
-        sock_listen = socket(result->ai_family,
-                             result->ai_socktype,
-                             result->ai_protocol);
+        retcode = rigctld_subscription_start(rigs[i].rig, rig_mutex_cb[i]);
 
-        if (sock_listen < 0)
+        if (retcode != RIG_OK)
         {
-            handle_error(RIG_DEBUG_ERR, "socket");
-            freeaddrinfo(saved_result);     /* No longer needed */
-            exit(2);
+            rig_debug(RIG_DEBUG_ERR, "%s: rigctld_subscription_start failed: %s\n",
+                      __FILE__, rigerror(retcode));
+            // clients can still poll
         }
+    }
 
-        if (setsockopt(sock_listen,
-                       SOL_SOCKET,
-                       SO_REUSEADDR,
-                       (char *)&reuseaddr,
-                       sizeof(reuseaddr))
-                < 0)
-        {
+    for (i = 0; i < nrigs; i++)
+    {
+        /* client commands queue for a thread of the rig, PTT first */
+        retcode = rig_worker_start(rigs[i].rig, rig_sync_cb[i]);
 
-            handle_error(RIG_DEBUG_ERR, "setsockopt");
-            freeaddrinfo(saved_result);     /* No longer needed */
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Cannot start the rig worker: %s\n", rigerror(retcode));
             exit(1);
         }
+    }
 
-#ifdef IPV6_V6ONLY
+    for (i = 0; async_set_depth >= 0 && i < nrigs; i++)
+    {
+        /* F, M, L and I only queue, newer values replace queued ones */
+        retcode = rig_async_set_start(rigs[i].rig, async_set_depth, rig_mutex_cb[i]);
 
-        if (AF_INET6 == result->ai_family)
+        if (retcode != RIG_OK)
         {
-            /* allow IPv4 mapped to IPv6 clients Windows and BSD default
-               this to 1 (i.e. disallowed) and we prefer it off */
-            int sockopt = 0;
-
-            if (setsockopt(sock_listen,
-                           IPPROTO_IPV6,
-                           IPV6_V6ONLY,
-                           (char *)&sockopt,
-                           sizeof(sockopt))
-                    < 0)
-            {
-
-                handle_error(RIG_DEBUG_ERR, "setsockopt");
-                freeaddrinfo(saved_result);     /* No longer needed */
-                exit(1);
-            }
+            fprintf(stderr, "Cannot queue sets: %s\n", rigerror(retcode));
+            exit(1);
         }
 
-#endif
+        /* b too, long messages go to the keyer as it runs low */
+        retcode = rig_morse_queue_start(rigs[i].rig, rig_mutex_cb[i]);
 
-        if (0 == bind(sock_listen, result->ai_addr, result->ai_addrlen))
+        if (retcode != RIG_OK)
         {
-            break;
+            fprintf(stderr, "Cannot queue morse: %s\n", rigerror(retcode));
+            exit(1);
         }
-
-        handle_error(RIG_DEBUG_WARN, "binding failed (trying next interface)");
-#ifdef __MINGW32__
-        closesocket(sock_listen);
-#else
-        close(sock_listen);
-#endif
     }
-    while ((result = result->ai_next) != NULL);
 
-    freeaddrinfo(saved_result);     /* No longer needed */
-
-    if (NULL == result)
+    if (metrics_listen)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: bind error - no available interface\n", __func__);
-        exit(1);
+        retcode = metrics_start(metrics_listen, render_rigctld, rigs);
+
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Cannot serve metrics on %s: %s\n", metrics_listen,
+                    rigerror(retcode));
+            exit(1);
+        }
     }
 
-    if (listen(sock_listen, 4) < 0)
+    for (i = 0; i < nrigs; i++)
     {
-        handle_error(RIG_DEBUG_ERR, "listening");
-        exit(1);
+        rigs[i].sock_listen = rigctld_listen(rigs[i].portno);
     }
 
 #if HAVE_SIGACTION
@@ -1007,13 +1594,12 @@ int main(int argc, char *argv[])
     /*
      * main loop accepting connections
      */
-    rig_debug(RIG_DEBUG_TRACE, "%s: rigctld listening on port %s\n", __func__,
-              portno);
 
     do
     {
         fd_set set;
         struct timeval timeout;
+        int hold_ms;
 
         arg = calloc(1, sizeof(struct handle_data));
 
@@ -1027,10 +1613,40 @@ int main(int argc, char *argv[])
 
         /* use select to allow for periodic checks for CTRL+C */
         FD_ZERO(&set);
-        FD_SET(sock_listen, &set);
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-        retcode = select(sock_listen + 1, &set, NULL, NULL, &timeout);
+        maxfd = 0;
+        hold_ms = 5000;
+
+        for (i = 0; i < nrigs; i++)
+        {
+            const struct rig_state *rs = &rigs[i].rig->state;
+
+            FD_SET(rigs[i].sock_listen, &set);
+
+            if (rigs[i].sock_listen > maxfd) { maxfd = rigs[i].sock_listen; }
+
+            /* and to swap back a VFO a rig was left on once it is idle */
+            if (rs->vfo_parked != RIG_VFO_NONE && rs->vfo_swap_hold_ms > 0
+                    && rs->vfo_swap_hold_ms < hold_ms)
+            {
+                hold_ms = rs->vfo_swap_hold_ms;
+            }
+        }
+
+        timeout.tv_sec = hold_ms / 1000;
+        timeout.tv_usec = (hold_ms % 1000) * 1000;
+
+        retcode = select(maxfd + 1, &set, NULL, NULL, &timeout);
+
+        /* a rig busy with a client is not idle, try it on the next turn */
+        for (i = 0; i < nrigs; i++)
+        {
+            if (rigs[i].rig->state.vfo_parked != RIG_VFO_NONE
+                    && rigctld_trylock(&rigs[i]))
+            {
+                rig_vfo_settle(rigs[i].rig, 0);
+                rigctld_lock(&rigs[i], 0);
+            }
+        }
 
         if (retcode == -1)
         {
@@ -1061,10 +1677,17 @@ int main(int argc, char *argv[])
         }
         else
         {
-            arg->rig = my_rig;
+            /* one connection a turn, select() returns at once for the others */
+            for (i = 0; i < nrigs - 1; i++)
+            {
+                if (FD_ISSET(rigs[i].sock_listen, &set)) { break; }
+            }
+
+            arg->r = &rigs[i];
+            arg->rig = rigs[i].rig;
             arg->clilen = sizeof(arg->cli_addr);
             arg->vfo_mode = vfo_mode;
-            arg->sock = accept(sock_listen,
+            arg->sock = accept(rigs[i].sock_listen,
                                (struct sockaddr *)&arg->cli_addr,
                                &arg->clilen);
 
@@ -1094,6 +1717,14 @@ int main(int argc, char *argv[])
                       serv);
 
 #ifdef HAVE_PTHREAD
+            /*
+             * A thread per client, not a pool: rigctl_parse() blocks on
+             * the client socket for its whole connection, and a pool
+             * shared by all rigs would let the clients of a slow rig
+             * hold up those of the others.  Commands reach the rig
+             * through its one worker thread whatever the number of
+             * clients.
+             */
             pthread_attr_init(&attr);
             pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
@@ -1114,24 +1745,32 @@ int main(int argc, char *argv[])
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s: while loop done\n", __func__);
 
+    rigctld_subscription_stop();
+
 #ifdef HAVE_PTHREAD
-    /* allow threads to finish current action */
-    mutex_rigctld(1);
 
     if (client_count)
     {
         rig_debug(RIG_DEBUG_WARN, "%u outstanding client(s)\n", client_count);
     }
 
-    rig_close(my_rig);
-    mutex_rigctld(0);
-#else
-    rig_close(my_rig); /* close port */
 #endif
 
     network_multicast_publisher_stop(my_rig);
 
-    rig_cleanup(my_rig); /* if you care about memory */
+    for (i = 0; i < nrigs; i++)
+    {
+        rig_worker_stop(rigs[i].rig);
+        rig_async_set_stop(rigs[i].rig);
+        rig_morse_queue_stop(rigs[i].rig);
+
+        /* allow threads to finish current action */
+        rigctld_lock(&rigs[i], 1);
+        rig_close(rigs[i].rig); /* close port */
+        rigctld_lock(&rigs[i], 0);
+
+        rig_cleanup(rigs[i].rig); /* if you care about memory */
+    }
 
 #ifdef __MINGW32__
     WSACleanup();
@@ -1173,6 +1812,8 @@ static FILE *get_fsockin(struct handle_data *handle_data_arg)
 void *handle_socket(void *arg)
 {
     struct handle_data *handle_data_arg = (struct handle_data *)arg;
+    struct rigctld_rig *r = handle_data_arg->r;
+    RIG *my_rig = r->rig;
     FILE *fsockin = NULL;
     FILE *fsockout = NULL;
     int retcode = RIG_OK;
@@ -1180,7 +1821,6 @@ void *handle_socket(void *arg)
     char serv[NI_MAXSERV];
     char send_cmd_term = '\r';  /* send_cmd termination char */
     int ext_resp = 0;
-    rig_powerstat = RIG_POWER_ON; // defaults to power on
 
     fsockin = get_fsockin(handle_data_arg);
 
@@ -1204,9 +1844,11 @@ void *handle_socket(void *arg)
     }
 
 #ifdef HAVE_PTHREAD
-    mutex_rigctld(1);
+    pthread_mutex_lock(&client_lock);
 
     ++client_count;
+    ++r->clients;
+    metrics_client(&r->metrics, 1);
 #if 0
 
     if (!client_count++)
@@ -1223,11 +1865,11 @@ void *handle_socket(void *arg)
 
 #endif
 
-    mutex_rigctld(0);
+    pthread_mutex_unlock(&client_lock);
 #else
-    mutex_rigctld(1);
+    rigctld_lock(r, 1);
     retcode = rig_open(my_rig);
-    mutex_rigctld(1);
+    rigctld_lock(r, 1);
 
     if (RIG_OK == retcode && verbose > RIG_DEBUG_ERR)
     {
@@ -1240,45 +1882,54 @@ void *handle_socket(void *arg)
 
     if (my_rig->caps->get_powerstat)
     {
-        mutex_rigctld(1);
-        rig_get_powerstat(my_rig, &rig_powerstat);
-        mutex_rigctld(0);
-        my_rig->state.powerstat = rig_powerstat;
+        rig_worker_call(my_rig, rigctld_get_powerstat, &r->powerstat, 0,
+                        rigctld_wait_ms);
+        my_rig->state.powerstat = r->powerstat;
     }
 
     do
     {
-        mutex_rigctld(1);
-
-        if (!rig_opened)
+        /* only wait for the lock when there is something to do */
+        if (!r->opened)
         {
-            retcode = rig_open(my_rig);
-            rig_opened = retcode == RIG_OK ? 1 : 0;
-            rig_debug(RIG_DEBUG_ERR, "%s: rig_open reopened retcode=%d\n", __func__,
-                      retcode);
-        }
+            rigctld_lock(r, 1);
 
-        mutex_rigctld(0);
+            if (!r->opened)
+            {
+                retcode = rig_open(my_rig);
+                r->opened = retcode == RIG_OK ? 1 : 0;
+                rig_debug(RIG_DEBUG_ERR, "%s: rig_open reopened retcode=%d\n", __func__,
+                          retcode);
 
-        if (rig_opened) // only do this if rig is open
+                if (r->opened) { metrics_reconnect(&r->metrics); }
+            }
+
+            rigctld_lock(r, 0);
+        }
+
+        if (r->opened) // only do this if rig is open
         {
             powerstat_t powerstat;
             rig_debug(RIG_DEBUG_TRACE, "%s: doing rigctl_parse vfo_mode=%d, secure=%d\n",
                       __func__,
                       handle_data_arg->vfo_mode, handle_data_arg->use_password);
+            /* the worker takes the lock, cached reads need none */
             retcode = rigctl_parse(handle_data_arg->rig, fsockin, fsockout, NULL, 0,
-                                   mutex_rigctld,
+                                   my_rig->state.worker ? NULL : rig_sync_cb[r - rigs],
                                    1, 0, &handle_data_arg->vfo_mode, send_cmd_term, &ext_resp, &resp_sep,
                                    handle_data_arg->use_password);
 
             if (retcode != 0) { rig_debug(RIG_DEBUG_VERBOSE, "%s: rigctl_parse retcode=%d\n", __func__, retcode); }
 
+            if (retcode < 0) { metrics_error(&r->metrics); }
+
             // If we get a timeout, the rig might be powered off
             // Update our power status in case power gets turned off
             if (retcode == -RIG_ETIMEOUT && my_rig->caps->get_powerstat)
             {
-                rig_get_powerstat(my_rig, &powerstat);
-                rig_powerstat = powerstat;
+                rig_worker_call(my_rig, rigctld_get_powerstat, &powerstat, 0, 0);
+                r->powerstat = powerstat;
+                my_rig->state.powerstat = powerstat;
 
                 if (powerstat == RIG_POWER_OFF || powerstat == RIG_POWER_STANDBY)
                 {
@@ -1293,39 +1944,43 @@ void *handle_socket(void *arg)
 
         // if we get a hard error we try to reopen the rig again
         // this should cover short dropouts that can occur
-        if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
+        // a command that waited too long for the rig is not one
+        if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode) && retcode != -RIG_BUSBUSY)
         {
             int retry = 3;
             rig_debug(RIG_DEBUG_ERR, "%s: i/o error\n", __func__);
 
             do
             {
-                mutex_rigctld(1);
+                rigctld_lock(r, 1);
                 retcode = rig_close(my_rig);
-                rig_opened = 0;
-                mutex_rigctld(0);
+                r->opened = 0;
+                rigctld_lock(r, 0);
                 rig_debug(RIG_DEBUG_ERR, "%s: rig_close retcode=%d\n", __func__, retcode);
 
                 hl_usleep(1000 * 1000);
 
-                mutex_rigctld(1);
+                rigctld_lock(r, 1);
 
-                if (!rig_opened)
+                if (!r->opened)
                 {
                     retcode = rig_open(my_rig);
-                    rig_opened = retcode == RIG_OK ? 1 : 0;
+                    r->opened = retcode == RIG_OK ? 1 : 0;
                     rig_debug(RIG_DEBUG_ERR, "%s: rig_open retcode=%d, opened=%d\n", __func__,
-                              retcode, rig_opened);
+                              retcode, r->opened);
+
+                    if (r->opened) { metrics_reconnect(&r->metrics); }
                 }
 
-                mutex_rigctld(0);
+                rigctld_lock(r, 0);
             }
-            while (!ctrl_c && !rig_opened && retry-- > 0 && retcode != RIG_OK);
+            while (!ctrl_c && !r->opened && retry-- > 0 && retcode != RIG_OK);
         }
     }
-    while (!ctrl_c && (retcode == RIG_OK || RIG_IS_SOFT_ERRCODE(-retcode)));
+    while (!ctrl_c && (retcode == RIG_OK || RIG_IS_SOFT_ERRCODE(-retcode)
+                       || retcode == -RIG_BUSBUSY));
 
-    if (rigctld_idle && client_count == 1)
+    if (rigctld_idle && r->clients == 1)
     {
         rig_close(my_rig);
 
@@ -1334,12 +1989,16 @@ void *handle_socket(void *arg)
 
 
 #ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&client_lock);
     --client_count;
+    --r->clients;
+    metrics_client(&r->metrics, 0);
+    pthread_mutex_unlock(&client_lock);
 
-    if (rigctld_idle && client_count > 0) { printf("%d client%s still connected so rig remains open\n", client_count, client_count > 1 ? "s" : ""); }
+    if (rigctld_idle && r->clients > 0) { printf("%u client%s still connected so rig remains open\n", r->clients, r->clients > 1 ? "s" : ""); }
 
 #if 0
-    mutex_rigctld(1);
+    rigctld_lock(r, 1);
 
     /* Release rig if there are no clients */
     if (!--client_count)
@@ -1354,7 +2013,7 @@ void *handle_socket(void *arg)
         }
     }
 
-    mutex_rigctld(0);
+    rigctld_lock(r, 0);
 #endif
 #else
     rig_close(my_rig);
@@ -1388,6 +2047,9 @@ void *handle_socket(void *arg)
 
 handle_exit:
 
+    /* the publisher must not write to this client any more */
+    rigctld_unsubscribe(fsockout);
+
 // for MINGW we close the handle before fclose
 #ifdef __MINGW32__
     retcode = closesocket(handle_data_arg->sock);
@@ -1449,6 +2111,10 @@ void usage(void)
         "  -n, --multicast-port=port     set multicast UDP port, default 4532\n"
         "  -A, --password                set password for rigctld access\n"
         "  -R, --rigctld-idle            make rigctld close the rig when no clients are connected\n"
+        "  -e, --metrics=[IPADDR:]PORT   serve OpenMetrics over HTTP for monitoring\n"
+        "  -Q, --async-set=DEPTH         queue F, M, L, I and b, newest value wins, DEPTH 0 for default\n"
+        "  -N, --add-rig=MODEL,DEVICE[,SPEED][,PARM=VAL...]  serve another rig on the next TCP port\n"
+        "  -q, --queue-wait=MS           fail a command waiting longer for the rig, default 0 waits\n"
         "  -h, --help                    display this help and exit\n"
         "  -V, --version                 output version information and exit\n\n",
         portno);
@@ -97,6 +97,9 @@ extern int read_history();
 static pthread_mutex_t rot_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+/* set by rotctld to time commands */
+void (*rotctl_command_done)(const struct timespec *begin);
+
 #define STR1(S) #S
 #define STR(S) STR1(S)
 
@@ -523,6 +526,7 @@ int rotctl_parse(ROT *my_rot, FILE *fin, FILE *fout, char *argv[], int argc,
                  int interactive, int prompt, char send_cmd_term)
 {
     int retcode;            /* generic return code from functions */
+    struct timespec begin;
     unsigned char cmd;
     struct test_table *cmd_entry = NULL;
     int ext_resp = 0;
@@ -1403,6 +1407,8 @@ int rotctl_parse(ROT *my_rot, FILE *fin, FILE *fout, char *argv[], int argc,
     pthread_mutex_lock(&rot_mutex);
 #endif
 
+    elapsed_ms(&begin, HAMLIB_ELAPSED_SET);
+
     if (!prompt)
     {
         rig_debug(RIG_DEBUG_TRACE,
@@ -1453,6 +1459,8 @@ int rotctl_parse(ROT *my_rot, FILE *fin, FILE *fout, char *argv[], int argc,
                                         "");
 #endif
 
+    if (rotctl_command_done) { rotctl_command_done(&begin); }
+
 #ifdef HAVE_PTHREAD
     pthread_mutex_unlock(&rot_mutex);
 #endif
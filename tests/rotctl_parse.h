@@ -47,4 +47,7 @@ int set_conf(ROT *my_rot, char *conf_parms);
 int rotctl_parse(ROT *my_rot, FILE *fin, FILE *fout, char *argv[], int argc,
                  int interactive, int prompt, char send_cmd_term);
 
+/* called after each command with the rotator still locked, NULL by default */
+extern void (*rotctl_command_done)(const struct timespec *begin);
+
 #endif  /* ROTCTL_PARSE_H */
@@ -60,6 +60,7 @@
 #include "rig.h"
 #include "rotctl_parse.h"
 #include "rotlist.h"
+#include "metrics.h"
 
 struct handle_data
 {
@@ -79,7 +80,7 @@ void usage();
  * NB: do NOT use -W since it's reserved by POSIX.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "m:r:R:s:C:o:O:t:T:LuvhVlZ"
+#define SHORT_OPTIONS "m:r:R:s:C:o:O:t:T:e:LuvhVlZ"
 static struct option long_options[] =
 {
     {"model",           1, 0, 'm'},
@@ -88,6 +89,7 @@ static struct option long_options[] =
     {"serial-speed",    1, 0, 's'},
     {"port",            1, 0, 't'},
     {"listen-addr",     1, 0, 'T'},
+    {"metrics",         1, 0, 'e'},
     {"list",            0, 0, 'l'},
     {"set-conf",        1, 0, 'C'},
     {"set-azoffset",    1, 0, 'o'},
@@ -105,6 +107,8 @@ const char *portno = "4533";
 const char *src_addr = NULL;    /* INADDR_ANY */
 azimuth_t az_offset;
 elevation_t el_offset;
+static const char *metrics_listen = NULL;
+static struct metrics_daemon metrics = { "rotctld" };
 
 #define MAXCONFLEN 1024
 
@@ -145,6 +149,48 @@ static void handle_error(enum rig_debug_level_e lvl, const char *msg)
 }
 
 
+static void rotctld_command_done(const struct timespec *begin)
+{
+    metrics_command(&metrics, begin);
+}
+
+
+/*
+ * Metrics page, the position is the one last read by a client
+ */
+static void render_rotctld(struct metrics_buf *buf, void *arg)
+{
+    const ROT *rot = (const ROT *) arg;
+    const struct rot_state *rs = &rot->state;
+    char esc[3][128];
+
+    metrics_family(buf, "hamlib_rot", "info", NULL, "Rotator served by rotctld");
+    metrics_printf(buf,
+                   "hamlib_rot_info{model=\"%d\",name=\"%s\",backend=\"%s\",version=\"%s\"} 1\n",
+                   rot->caps->rot_model,
+                   metrics_escape(esc[0], sizeof(esc[0]), rot->caps->model_name),
+                   metrics_escape(esc[1], sizeof(esc[1]), rot->caps->mfg_name),
+                   metrics_escape(esc[2], sizeof(esc[2]), rot->caps->version));
+
+    if (rs->last_position_time.tv_sec)
+    {
+        metrics_family(buf, "hamlib_rot_azimuth_degrees", "gauge", "degrees",
+                       "Last azimuth read");
+        metrics_printf(buf, "hamlib_rot_azimuth_degrees %.2f\n", rs->last_az);
+        metrics_family(buf, "hamlib_rot_elevation_degrees", "gauge", "degrees",
+                       "Last elevation read");
+        metrics_printf(buf, "hamlib_rot_elevation_degrees %.2f\n", rs->last_el);
+        metrics_family(buf, "hamlib_rot_position_timestamp_seconds", "gauge",
+                       "seconds", "When the position was last read");
+        metrics_printf(buf, "hamlib_rot_position_timestamp_seconds %ld.%03ld\n",
+                       (long) rs->last_position_time.tv_sec,
+                       rs->last_position_time.tv_nsec / 1000000);
+    }
+
+    metrics_render_daemon(buf, &metrics);
+}
+
+
 int main(int argc, char *argv[])
 {
     ROT *my_rot;        /* handle to rot (instance) */
@@ -282,6 +328,10 @@ int main(int argc, char *argv[])
             src_addr = optarg;
             break;
 
+        case 'e':
+            metrics_listen = optarg;
+            break;
+
         case 'o':
             if (!optarg)
             {
@@ -562,6 +612,20 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
+    if (metrics_listen)
+    {
+        retcode = metrics_start(metrics_listen, render_rotctld, my_rot);
+
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Cannot serve metrics on %s: %s\n", metrics_listen,
+                    rigerror(retcode));
+            exit(1);
+        }
+
+        rotctl_command_done = rotctld_command_done;
+    }
+
     /*
      * main loop accepting connections
      */
@@ -688,11 +752,18 @@ void *handle_socket(void *arg)
         goto handle_exit;
     }
 
+    metrics_client(&metrics, 1);
+
     do
     {
         retcode = rotctl_parse(handle_data_arg->rot, fsockin, fsockout, NULL, 0, 1, 0,
                                '\r');
 
+        if (retcode == 2)
+        {
+            metrics_error(&metrics);
+        }
+
         if (ferror(fsockin) || ferror(fsockout))
         {
             retcode = 1;
@@ -720,6 +791,8 @@ void *handle_socket(void *arg)
               host,
               serv);
 
+    metrics_client(&metrics, 0);
+
     fclose(fsockin);
 #ifndef __MINGW32__
     fclose(fsockout);
@@ -752,6 +825,7 @@ void usage()
         "  -s, --serial-speed=BAUD       set serial speed of the serial port\n"
         "  -t, --port=NUM                set TCP listening port, default %s\n"
         "  -T, --listen-addr=IPADDR      set listening IP address, default ANY\n"
+        "  -e, --metrics=[IPADDR:]PORT   serve OpenMetrics over HTTP for monitoring\n"
         "  -C, --set-conf=PARM=VAL       set config parameters\n"
         "  -o, --set-azoffset==VAL       set offset for azimuth\n"
         "  -O, --set-eloffset==VAL       set offset for elevation\n"
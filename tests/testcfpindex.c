@@ -0,0 +1,167 @@
+/*
+ * Check the hashed ext and conf parameter lookups of cfpindex.c against
+ * a walk of the tables in the order the lookups used to search them.
+ * Returns the number of mismatches.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "cfpindex.h"
+
+static int errors;
+static int checks;
+
+static void check(const char *what, const char *model,
+                  const struct confparams *got, const struct confparams *want)
+{
+    checks++;
+
+    if (got != want)
+    {
+        printf("%s %s: got %s, want %s\n", model, what,
+               got ? got->name : "NULL", want ? want->name : "NULL");
+        errors++;
+    }
+}
+
+static const struct confparams *walk_name(const struct confparams *const *tables,
+        int ntables, const char *name)
+{
+    const struct confparams *cfp;
+    int i;
+
+    for (i = 0; i < ntables; i++)
+    {
+        for (cfp = tables[i]; cfp && cfp->name; cfp++)
+        {
+            if (!strcmp(cfp->name, name)) { return cfp; }
+        }
+    }
+
+    return NULL;
+}
+
+static const struct confparams *walk_token(const struct confparams *const
+        *tables, int ntables, token_t token)
+{
+    const struct confparams *cfp;
+    int i;
+
+    for (i = 0; i < ntables; i++)
+    {
+        for (cfp = tables[i]; cfp && cfp->token; cfp++)
+        {
+            if (cfp->token == token) { return cfp; }
+        }
+    }
+
+    return NULL;
+}
+
+/* duplicate names and tokens, the first one in search order wins */
+static const struct confparams first[] =
+{
+    { 101, "alpha" }, { 102, "beta" }, { 103, "gamma" }, { 102, "beta2" },
+    { RIG_CONF_END, NULL }
+};
+
+static const struct confparams second[] =
+{
+    { 201, "beta" }, { 103, "delta" }, { 202, "epsilon" },
+    { RIG_CONF_END, NULL }
+};
+
+static void check_tables(void)
+{
+    static const char caps[1];
+    const struct confparams *const tables[] = { first, NULL, second };
+    const struct cfp_index *idx = cfp_index_get(caps, CFP_INDEX_RIG_EXT, tables,
+                                  3);
+
+    if (idx == NULL)
+    {
+        printf("cfp_index_get failed\n");
+        errors++;
+        return;
+    }
+
+    if (cfp_index_get(caps, CFP_INDEX_RIG_EXT, tables, 3) != idx)
+    {
+        printf("index was built twice\n");
+        errors++;
+    }
+
+    check("name beta", "tables", cfp_index_name(idx, "beta"), &first[1]);
+    check("name epsilon", "tables", cfp_index_name(idx, "epsilon"), &second[2]);
+    check("name none", "tables", cfp_index_name(idx, "zeta"), NULL);
+    check("token 102", "tables", cfp_index_token(idx, 102), &first[1]);
+    check("token 103", "tables", cfp_index_token(idx, 103), &first[2]);
+    check("token 999", "tables", cfp_index_token(idx, 999), NULL);
+    /* "delta" is later in the search order than token 101 */
+    check("delta or 101", "tables", cfp_index_name_or_token(idx, "delta", 101),
+          &first[0]);
+    check("epsilon or 999", "tables",
+          cfp_index_name_or_token(idx, "epsilon", 999), &second[2]);
+}
+
+static int check_model(const struct rig_caps *caps, void *data)
+{
+    const struct confparams *const tables[] =
+    {
+        caps->extlevels, caps->extfuncs, caps->extparms
+    };
+    const struct confparams *cfp;
+    RIG *rig = rig_init(caps->rig_model);
+    int i;
+
+    if (rig == NULL) { return 1; }
+
+    for (i = 0; i < 3; i++)
+    {
+        for (cfp = tables[i]; cfp && cfp->name; cfp++)
+        {
+            check(cfp->name, caps->model_name, rig_ext_lookup(rig, cfp->name),
+                  walk_name(tables, 3, cfp->name));
+            check(cfp->name, caps->model_name, rig_ext_lookup_tok(rig, cfp->token),
+                  walk_token(tables, 3, cfp->token));
+        }
+    }
+
+    check("unknown", caps->model_name, rig_ext_lookup(rig, "no_such_parm"), NULL);
+
+    for (cfp = caps->cfgparams; cfp && cfp->name; cfp++)
+    {
+        check(cfp->name, caps->model_name, rig_confparam_lookup(rig, cfp->name),
+              walk_name(&caps->cfgparams, 1, cfp->name));
+    }
+
+    /* the frontend parameters are searched after the backend ones */
+    cfp = rig_confparam_lookup(rig, "timeout");
+
+    if (cfp == NULL || strcmp(cfp->name, "timeout"))
+    {
+        printf("%s timeout: not found\n", caps->model_name);
+        errors++;
+    }
+
+    rig_cleanup(rig);
+
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    check_tables();
+
+    rig_load_all_backends();
+    rig_list_foreach(check_model, NULL);
+
+    printf("%d lookups, %d mismatches\n", checks, errors);
+
+    return errors;
+}
@@ -0,0 +1,265 @@
+/*
+ * Check the table driven BCD conversions against the digit by digit
+ * arithmetic they replaced, and the streaming CI-V deframer against
+ * noise, wake up runs, a missing preamble byte, truncated and jammed
+ * frames fed through a pipe.
+ * Returns the number of failures.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "frame.h"
+
+static int errors;
+
+/* the conversions as they were before the lookup tables */
+static void ref_to_bcd(unsigned char bcd_data[], unsigned long long freq,
+                       unsigned bcd_len)
+{
+    int i;
+
+    for (i = 0; i < bcd_len / 2; i++)
+    {
+        unsigned char a = freq % 10;
+        freq /= 10;
+        a |= (freq % 10) << 4;
+        freq /= 10;
+        bcd_data[i] = a;
+    }
+
+    if (bcd_len & 1)
+    {
+        bcd_data[i] &= 0xf0;
+        bcd_data[i] |= freq % 10;
+    }
+}
+
+static unsigned long long ref_from_bcd(const unsigned char bcd_data[],
+                                       unsigned bcd_len)
+{
+    int i;
+    freq_t f = 0;
+
+    if (bcd_len & 1)
+    {
+        f = bcd_data[bcd_len / 2] & 0x0f;
+    }
+
+    for (i = (bcd_len / 2) - 1; i >= 0; i--)
+    {
+        f *= 10;
+        f += bcd_data[i] >> 4;
+        f *= 10;
+        f += bcd_data[i] & 0x0f;
+    }
+
+    return f;
+}
+
+static void ref_to_bcd_be(unsigned char bcd_data[], unsigned long long freq,
+                          unsigned bcd_len)
+{
+    int i;
+
+    if (bcd_len & 1)
+    {
+        bcd_data[bcd_len / 2] &= 0x0f;
+        bcd_data[bcd_len / 2] |= (freq % 10) << 4;
+        freq /= 10;
+    }
+
+    for (i = (bcd_len / 2) - 1; i >= 0; i--)
+    {
+        unsigned char a = freq % 10;
+        freq /= 10;
+        a |= (freq % 10) << 4;
+        freq /= 10;
+        bcd_data[i] = a;
+    }
+}
+
+static unsigned long long ref_from_bcd_be(const unsigned char bcd_data[],
+        unsigned bcd_len)
+{
+    int i;
+    freq_t f = 0;
+
+    for (i = 0; i < bcd_len / 2; i++)
+    {
+        f *= 10;
+        f += bcd_data[i] >> 4;
+        f *= 10;
+        f += bcd_data[i] & 0x0f;
+    }
+
+    if (bcd_len & 1)
+    {
+        f *= 10;
+        f += bcd_data[bcd_len / 2] >> 4;
+    }
+
+    return f;
+}
+
+static void check_bcd(void)
+{
+    unsigned char data[8], got[8], want[8];
+    unsigned len;
+    int i, n;
+
+    srand(1);
+
+    /* every byte, including invalid nibbles */
+    for (i = 0; i < 256; i++)
+    {
+        data[0] = i;
+
+        if (from_bcd(data, 2) != ref_from_bcd(data, 2)
+                || from_bcd_be(data, 2) != ref_from_bcd_be(data, 2))
+        {
+            printf("from_bcd 0x%02x: %llu, want %llu\n", i, from_bcd(data, 2),
+                   ref_from_bcd(data, 2));
+            errors++;
+        }
+    }
+
+    /* up to 14 digits so freq_t holds the invalid ones exactly */
+    for (n = 0; n < 100000; n++)
+    {
+        unsigned long long freq = ((unsigned long long) rand() << 31 | rand())
+                                  % 100000000000000ULL;
+        len = 1 + n % 14;
+
+        for (i = 0; i < sizeof(data); i++) { data[i] = rand(); }
+
+        if (from_bcd(data, len) != ref_from_bcd(data, len)
+                || from_bcd_be(data, len) != ref_from_bcd_be(data, len))
+        {
+            printf("from_bcd len %u: %llu, want %llu\n", len, from_bcd(data, len),
+                   ref_from_bcd(data, len));
+            errors++;
+        }
+
+        /* the odd digit leaves the other nibble alone */
+        memcpy(got, data, sizeof(data));
+        memcpy(want, data, sizeof(data));
+        to_bcd(got, freq, len);
+        ref_to_bcd(want, freq, len);
+
+        if (memcmp(got, want, sizeof(got)))
+        {
+            printf("to_bcd %llu len %u differs\n", freq, len);
+            errors++;
+        }
+
+        memcpy(got, data, sizeof(data));
+        memcpy(want, data, sizeof(data));
+        to_bcd_be(got, freq, len);
+        ref_to_bcd_be(want, freq, len);
+
+        if (memcmp(got, want, sizeof(got)))
+        {
+            printf("to_bcd_be %llu len %u differs\n", freq, len);
+            errors++;
+        }
+    }
+}
+
+static void expect(hamlib_port_t *p, struct icom_deframer *d, int direct,
+                   const char *what, const unsigned char *want, int want_len)
+{
+    unsigned char *frame = NULL;
+    int len = icom_deframer_next(p, d, direct, &frame);
+
+    if (len != want_len || (want_len > 0 && memcmp(frame, want, len)))
+    {
+        printf("deframer %s: got %d bytes, want %d\n", what, len, want_len);
+        errors++;
+    }
+}
+
+static void feed(int fd, const unsigned char *data, size_t len)
+{
+    if (write(fd, data, len) != (ssize_t) len)
+    {
+        perror("write");
+        exit(1);
+    }
+}
+
+static void check_deframer(void)
+{
+    static const unsigned char frame[] = { 0xfe, 0xfe, 0xe0, 0x94, 0x03, 0xfd };
+    static const unsigned char reply[] =
+    {
+        0xfe, 0xfe, 0xe0, 0x94, 0x03, 0x00, 0x40, 0x07, 0x14, 0x00, 0xfd
+    };
+    static const unsigned char jammed[] = { 0xfe, 0xfe, 0xe0, 0x94, 0xfc };
+    static const unsigned char jam[] = { 0xfc };
+    static const unsigned char input[] =
+    {
+        /* noise, then a frame */
+        0x00, 0x12, 0xfe, 0xfe, 0xe0, 0x94, 0x03, 0xfd,
+        /* wake up run */
+        0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xe0, 0x94, 0x03, 0xfd,
+        /* second preamble byte missing */
+        0xfe, 0xe0, 0x94, 0x03, 0xfd,
+        /* cut short by the next frame */
+        0xfe, 0xfe, 0xe0, 0x94, 0x03, 0xfe, 0xfe, 0xe0, 0x94, 0x03, 0xfd,
+        /* collision inside and outside of a frame */
+        0xfe, 0xfe, 0xe0, 0x94, 0xfc, 0xfc,
+    };
+    hamlib_port_t port;
+    struct icom_deframer d;
+    int fds[2];
+
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        exit(1);
+    }
+
+    memset(&port, 0, sizeof(port));
+    port.type.rig = RIG_PORT_NONE;
+    port.fd = fds[0];
+    port.timeout = 100;
+
+    icom_deframer_reset(&d);
+
+    feed(fds[1], input, sizeof(input));
+    expect(&port, &d, 1, "noise", frame, sizeof(frame));
+    expect(&port, &d, 1, "wake up", frame, sizeof(frame));
+    expect(&port, &d, 1, "preamble", frame, sizeof(frame));
+    expect(&port, &d, 1, "truncated", frame, sizeof(frame));
+    expect(&port, &d, 1, "jammed", jammed, sizeof(jammed));
+    expect(&port, &d, 1, "jam", jam, sizeof(jam));
+
+    /* a frame in two reads, the first half is not handed out */
+    feed(fds[1], reply, 5);
+    expect(&port, &d, ICOM_DEFRAMER_PENDING, "half", NULL, 0);
+    feed(fds[1], reply + 5, sizeof(reply) - 5);
+    expect(&port, &d, 1, "reply", reply, sizeof(reply));
+
+    expect(&port, &d, 1, "timeout", NULL, -RIG_ETIMEOUT);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    check_bcd();
+    check_deframer();
+
+    printf("%d failures\n", errors);
+
+    return errors;
+}
@@ -0,0 +1,211 @@
+/*
+ * Check the answers the port probing of probe.c maps to models: the
+ * Kenwood IDs, the Elecraft rigs answering as a TS-570D and the Icom
+ * CI-V addresses, then rig_probe_ports() against a fake Kenwood style
+ * rig on a pty.
+ * Returns the number of failures.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "probe.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+static int errors;
+
+static int has_candidate(const struct probe_candidate *cand, int n,
+                         rig_model_t model)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (cand[i].model == model) { return 1; }
+    }
+
+    return 0;
+}
+
+static void check_model(const char *what, rig_model_t got, rig_model_t want)
+{
+    if (got != want)
+    {
+        printf("%s: got model %u, want %u\n", what, got, want);
+        errors++;
+    }
+}
+
+static void check_answers(void)
+{
+    struct probe_candidate cand[16];
+    int n;
+
+    n = kenwood_probe_id("019", cand, 16);
+
+    if (!has_candidate(cand, n, RIG_MODEL_TS2000))
+    {
+        printf("ID019: no TS-2000\n");
+        errors++;
+    }
+
+    n = kenwood_probe_id("017", cand, 16);
+
+    if (!has_candidate(cand, n, RIG_MODEL_TS570D)
+            || !has_candidate(cand, n, RIG_MODEL_K3)
+            || !has_candidate(cand, n, RIG_MODEL_K3S)
+            || !has_candidate(cand, n, RIG_MODEL_KX2)
+            || !has_candidate(cand, n, RIG_MODEL_KX3)
+            || !has_candidate(cand, n, RIG_MODEL_K2))
+    {
+        printf("ID017: missing a TS-570D or an Elecraft candidate\n");
+        errors++;
+    }
+
+    if (kenwood_probe_id("XYZ", cand, 16) != 0)
+    {
+        printf("IDXYZ: unexpected candidates\n");
+        errors++;
+    }
+
+    /* the model is the 14th and 15th character of the OM answer */
+    check_model("KX2", kenwood_probe_elecraft("K31", NULL, "OM AP--------01"),
+                RIG_MODEL_KX2);
+    check_model("KX3", kenwood_probe_elecraft("K31", NULL, "OM AP--------02"),
+                RIG_MODEL_KX3);
+    check_model("K3S", kenwood_probe_elecraft("K31", NULL, "OM APR-------00"),
+                RIG_MODEL_K3S);
+    check_model("K3", kenwood_probe_elecraft("K30", NULL, "OM AP--------00"),
+                RIG_MODEL_K3);
+    check_model("K3 no OM", kenwood_probe_elecraft("K30", NULL, NULL),
+                RIG_MODEL_K3);
+    check_model("K2", kenwood_probe_elecraft(NULL, "K20", NULL), RIG_MODEL_K2);
+    check_model("TS-570D", kenwood_probe_elecraft(NULL, NULL, NULL),
+                RIG_MODEL_TS570D);
+
+    n = icom_probe_civ_id(0x94, cand, 16);
+
+    if (!has_candidate(cand, n, RIG_MODEL_IC7300))
+    {
+        printf("CI-V 0x94: no IC-7300\n");
+        errors++;
+    }
+}
+
+#if !defined(_WIN32)
+/* answers "ID;", "K3;" and "OM;" like a KX3, "?;" to anything else */
+static void fake_kx3(int fd)
+{
+    char buf[256], cmd[64];
+    int len = 0;
+
+    for (;;)
+    {
+        int i, n = read(fd, buf, sizeof(buf));
+
+        if (n <= 0) { return; }
+
+        for (i = 0; i < n; i++)
+        {
+            const char *ans = "?;";
+
+            if (buf[i] != ';')
+            {
+                if (len < sizeof(cmd) - 1) { cmd[len++] = buf[i]; }
+
+                continue;
+            }
+
+            cmd[len] = 0;
+            len = 0;
+
+            if (!strcmp(cmd, "ID")) { ans = "ID017;"; }
+            else if (!strcmp(cmd, "K3")) { ans = "K31;"; }
+            else if (!strcmp(cmd, "OM")) { ans = "OM AP--------02;"; }
+
+            if (write(fd, ans, strlen(ans)) < 0) { return; }
+        }
+    }
+}
+
+static void check_ports(void)
+{
+    rig_probe_result_t results[8];
+    const char *path[1];
+    struct termios tio;
+    int master, slave, n;
+    pid_t pid;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    {
+        printf("no pty, skipping rig_probe_ports()\n");
+        return;
+    }
+
+    path[0] = ptsname(master);
+
+    /* kept open so the fake does not see a hang up between opens */
+    slave = open(path[0], O_RDWR | O_NOCTTY);
+
+    if (slave < 0 || tcgetattr(slave, &tio) < 0)
+    {
+        printf("no pty, skipping rig_probe_ports()\n");
+        close(master);
+        return;
+    }
+
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    pid = fork();
+
+    if (pid == 0)
+    {
+        close(slave);
+        fake_kx3(master);
+        _exit(0);
+    }
+
+    n = rig_probe_ports(path, 1, 10000, results, 8);
+
+    if (n < 1 || results[0].model != RIG_MODEL_KX3
+            || results[0].confidence != 100)
+    {
+        printf("rig_probe_ports: %d results, first model %u confidence %d\n", n,
+               n > 0 ? results[0].model : 0, n > 0 ? results[0].confidence : 0);
+        errors++;
+    }
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(slave);
+    close(master);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    check_answers();
+#if !defined(_WIN32)
+    check_ports();
+#endif
+
+    printf("%d failures\n", errors);
+
+    return errors;
+}
@@ -0,0 +1,149 @@
+/*
+ * Check rig_find_range() of rangeindex.c against rig_get_range() on the
+ * rx range list, and on the tx range list followed by the tx lists of
+ * all regions, for every model and every selectable region.
+ * Returns the number of mismatches.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <hamlib/rig.h>
+#include "token.h"
+
+static int errors;
+static int checks;
+
+static const freq_range_t *ref_find_range(RIG *rig, int tx, freq_t freq,
+        rmode_t mode)
+{
+    const freq_range_t *range;
+
+    if (!tx)
+    {
+        return rig_get_range(rig->state.rx_range_list, freq, mode);
+    }
+
+    range = rig_get_range(rig->state.tx_range_list, freq, mode);
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list1, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list2, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list3, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list4, freq, mode); }
+
+    if (range == NULL) { range = rig_get_range(rig->caps->tx_range_list5, freq, mode); }
+
+    return range;
+}
+
+static void check(RIG *rig, int tx, freq_t freq, rmode_t mode)
+{
+    const freq_range_t *got = rig_find_range(rig, tx, freq, mode);
+    const freq_range_t *want = ref_find_range(rig, tx, freq, mode);
+
+    checks++;
+
+    if (got != want)
+    {
+        printf("%s %s %.0f %s: got %p, want %p\n", rig->caps->model_name,
+               tx ? "tx" : "rx", freq, rig_strrmode(mode), (void *) got,
+               (void *) want);
+        errors++;
+    }
+}
+
+/* the edges of every range, just inside and outside, and random ones */
+static void check_ranges(RIG *rig, const freq_range_t *list)
+{
+    int i, tx;
+
+    for (i = 0; i < HAMLIB_FRQRANGESIZ && !RIG_IS_FRNG_END(list[i]); i++)
+    {
+        const freq_range_t *r = &list[i];
+        freq_t f[] =
+        {
+            r->startf - 1, r->startf, r->startf + 1, (r->startf + r->endf) / 2,
+            r->endf - 1, r->endf, r->endf + 1,
+            r->startf + (r->endf - r->startf) * (rand() / (RAND_MAX + 1.0))
+        };
+        rmode_t modes[] =
+        {
+            r->modes, r->modes & -r->modes, RIG_MODE_USB, RIG_MODE_FM,
+            (rmode_t) 1 << (rand() % 64), RIG_MODE_NONE
+        };
+        int j, k;
+
+        for (tx = 0; tx < 2; tx++)
+        {
+            for (j = 0; j < sizeof(f) / sizeof(f[0]); j++)
+            {
+                for (k = 0; k < sizeof(modes) / sizeof(modes[0]); k++)
+                {
+                    check(rig, tx, f[j], modes[k]);
+                }
+            }
+        }
+    }
+}
+
+static void check_region(RIG *rig)
+{
+    const struct rig_caps *caps = rig->caps;
+    int n;
+
+    check_ranges(rig, rig->state.rx_range_list);
+    check_ranges(rig, rig->state.tx_range_list);
+    check_ranges(rig, caps->tx_range_list1);
+    check_ranges(rig, caps->tx_range_list2);
+    check_ranges(rig, caps->tx_range_list3);
+    check_ranges(rig, caps->tx_range_list4);
+    check_ranges(rig, caps->tx_range_list5);
+
+    for (n = 0; n < 1000; n++)
+    {
+        freq_t freq = GHz(10) * (rand() / (RAND_MAX + 1.0));
+
+        check(rig, 0, freq, RIG_MODE_USB);
+        check(rig, 1, freq, RIG_MODE_CW);
+    }
+}
+
+static int check_model(const struct rig_caps *caps, void *data)
+{
+    RIG *rig = rig_init(caps->rig_model);
+    char region[2];
+
+    if (rig == NULL) { return 1; }
+
+    check_region(rig);
+
+    /* the lists are rebuilt when another region is selected */
+    for (region[0] = '1', region[1] = 0; region[0] <= '5'; region[0]++)
+    {
+        if (rig_set_conf(rig, TOK_RANGE_SELECTED, region) == RIG_OK)
+        {
+            check_region(rig);
+        }
+    }
+
+    rig_cleanup(rig);
+
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    rig_set_debug(RIG_DEBUG_NONE);
+    srand(1);
+
+    rig_load_all_backends();
+    rig_list_foreach(check_model, NULL);
+
+    printf("%d lookups, %d mismatches\n", checks, errors);
+
+    return errors;
+}